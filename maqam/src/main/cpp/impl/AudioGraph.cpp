@@ -5,6 +5,8 @@
 // SPDX-License-Identifier: MIT
 //
 
+#include <algorithm>
+#include <iterator>
 #include <memory>
 #include <sstream>
 
@@ -12,15 +14,20 @@
 #include "AudioRoot.h"
 #include "NativeWrapper.h"
 #include "log.h"
+#include "nodes/PreparedStateLoader.h"
+#include "nodes/ValueTreeProvider.h"
 
 using namespace maqam;
 using AudioGraphIOProcessor = juce::AudioProcessorGraph::AudioGraphIOProcessor;
 
 AudioGraph::AudioGraph()
+    : mMidiInlets {}
+    , mMidiInletNodeIDs {}
+    , mNumMidiInlets(0)
 {
     mImpl.setProcessingPrecision(juce::AudioProcessor::singlePrecision);
-    mImpl.setPlayConfigDetails(0, AudioRoot::kChannelCount, AudioRoot::kSampleRate,
-                               AudioRoot::kMaxFramesPerBlock);
+    mImpl.setPlayConfigDetails(AudioRoot::kChannelCount, AudioRoot::kChannelCount,
+                               AudioRoot::kDefaultSampleRate, AudioRoot::kMaxFramesPerBlock);
     mAudioInputNodeID = mImpl.addNode(std::make_unique<AudioGraphIOProcessor>(
             AudioGraphIOProcessor::audioInputNode))->nodeID;
     mAudioOutputNodeID = mImpl.addNode(std::make_unique<AudioGraphIOProcessor>(
@@ -60,6 +67,32 @@ void AudioGraph::addNode(AudioNode* node, juce::AudioProcessor* processor)
     juce::AudioProcessorGraph::NodeID nodeID =
             mImpl.addNode(std::unique_ptr<juce::AudioProcessor>(processor))->nodeID;
     node->setAudioProcessorGraphNodeID(nodeID);
+    mNodeIDs.push_back(nodeID);
+    mNodes.push_back(node);
+    mSnapshotNodes.emplace_back();
+
+    // Briefly silences the output, nodes are usually added before the stream starts
+    const juce::ScopedLock lock(mImpl.getCallbackLock());
+    mPresetMorphs.push_back(&node->getPresetMorph());
+}
+
+void AudioGraph::prepareToPlay(double sampleRate, int maximumExpectedSamplesPerBlock)
+{
+    for (PresetMorph* morph : mPresetMorphs) {
+        morph->prepare(sampleRate);
+    }
+
+    mImpl.prepareToPlay(sampleRate, maximumExpectedSamplesPerBlock);
+}
+
+void AudioGraph::processBlock(juce::AudioBuffer<float>& buffer,
+                              juce::MidiBuffer& midiMessages) noexcept
+{
+    for (PresetMorph* morph : mPresetMorphs) {
+        morph->process(buffer.getNumSamples());
+    }
+
+    mImpl.processBlock(buffer, midiMessages);
 }
 
 void AudioGraph::connectNodes(AudioNode* source, AudioNode* sink, bool audio, bool midi)
@@ -112,6 +145,275 @@ void AudioGraph::connectNodes(AudioNode* source, AudioNode* sink, bool audio, bo
     }
 }
 
+int AudioGraph::getMidiInletIndex(AudioNode* sink)
+{
+    const NodeID sinkNodeID = sink->getAudioProcessorGraphNodeID();
+
+    if (sinkNodeID.uid == 0) {
+        throw std::runtime_error("Sink node is not owned by graph");
+    }
+
+    const int numMidiInlets = mNumMidiInlets;
+
+    for (int i = 0; i < numMidiInlets; ++i) {
+        if (mMidiInletSinks[i] == sinkNodeID) {
+            return i;
+        }
+    }
+
+    if (numMidiInlets == kMaxMidiInlets) {
+        throw std::runtime_error("No more MIDI inlets available");
+    }
+
+    auto inlet = std::make_unique<MidiInlet>();
+    MidiInlet* inletPtr = inlet.get();
+    const NodeID inletNodeID = mImpl.addNode(std::move(inlet))->nodeID;
+
+    const bool success = mImpl.addConnection({
+        { inletNodeID, juce::AudioProcessorGraph::midiChannelIndex },
+        { sinkNodeID, juce::AudioProcessorGraph::midiChannelIndex }
+    });
+
+    if (! success) {
+        mImpl.removeNode(inletNodeID);
+        throw std::runtime_error("Could not connect MIDI inlet");
+    }
+
+    mMidiInlets[numMidiInlets] = inletPtr;
+    mMidiInletNodeIDs[numMidiInlets] = inletNodeID;
+    mMidiInletSinks[numMidiInlets] = sinkNodeID;
+    mNumMidiInlets = numMidiInlets + 1;
+
+    return numMidiInlets;
+}
+
+void AudioGraph::clearMidiInlets()
+{
+    const int numMidiInlets = mNumMidiInlets;
+    mNumMidiInlets = 0;
+
+    for (int i = 0; i < numMidiInlets; ++i) {
+        // Also removes the connection to the sink, the render sequence is rebuilt right away so
+        // the inlet is no longer referenced when it gets deleted
+        mImpl.removeNode(mMidiInletNodeIDs[i], juce::AudioProcessorGraph::UpdateKind::sync);
+
+        mMidiInlets[i] = nullptr;
+        mMidiInletNodeIDs[i] = {};
+        mMidiInletSinks[i] = {};
+    }
+}
+
+void AudioGraph::getSnapshot(juce::MemoryBlock& destData)
+{
+    juce::ValueTree snapshot { "GRAPH" };
+    snapshot.setProperty("version", kSnapshotVersion, nullptr);
+
+    for (size_t i = 0; i < mNodeIDs.size(); ++i) {
+        // Flag is consumed first so a change made while serializing is caught next time
+        if (mNodes[i]->consumeStateChanged() || ! mSnapshotNodes[i].isValid()) {
+            juce::AudioProcessor* processor = mImpl.getNodeForId(mNodeIDs[i])->getProcessor();
+            juce::ValueTree node { "NODE" };
+
+            juce::MemoryBlock state;
+            processor->getStateInformation(state);
+
+            node.setProperty("name", processor->getName(), nullptr);
+            node.setProperty("state", state, nullptr);
+
+            if (auto* provider = dynamic_cast<ValueTreeProvider*>(processor)) {
+                node.appendChild(provider->getValueTree().createCopy(), nullptr);
+            }
+
+            mSnapshotNodes[i] = node;
+        }
+
+        snapshot.appendChild(mSnapshotNodes[i], nullptr);
+    }
+
+    for (const juce::AudioProcessorGraph::Connection& conn : mImpl.getConnections()) {
+        if (! isSnapshotConnection(conn)) {
+            continue;
+        }
+
+        juce::ValueTree connection { "CONNECTION" };
+        connection.setProperty("src", getEndpointIndex(conn.source.nodeID), nullptr);
+        connection.setProperty("srcChannel", conn.source.channelIndex, nullptr);
+        connection.setProperty("dst", getEndpointIndex(conn.destination.nodeID), nullptr);
+        connection.setProperty("dstChannel", conn.destination.channelIndex, nullptr);
+        snapshot.appendChild(connection, nullptr);
+    }
+
+    juce::MemoryOutputStream stream { destData, /*appendToExistingBlockContent=*/false };
+    snapshot.writeToStream(stream);
+
+    // Cached entries can only have one parent, release them for the next snapshot
+    snapshot.removeAllChildren(nullptr);
+}
+
+bool AudioGraph::restoreSnapshot(const void* data, size_t sizeInBytes)
+{
+    const juce::ValueTree snapshot = juce::ValueTree::readFromData(data, sizeInBytes);
+
+    if (! snapshot.hasType("GRAPH")
+            || (static_cast<int>(snapshot.getProperty("version")) != kSnapshotVersion)) {
+        return false;
+    }
+
+    std::vector<juce::ValueTree> nodes;
+    std::vector<juce::AudioProcessorGraph::Connection> connections;
+
+    for (const juce::ValueTree& child : snapshot) {
+        if (child.hasType("NODE")) {
+            nodes.push_back(child);
+        } else if (child.hasType("CONNECTION")) {
+            const NodeID src = getEndpointNodeID(child.getProperty("src"));
+            const NodeID dst = getEndpointNodeID(child.getProperty("dst"));
+
+            if ((src.uid == 0) || (dst.uid == 0)) {
+                return false;
+            }
+
+            connections.push_back({ { src, child.getProperty("srcChannel") },
+                                    { dst, child.getProperty("dstChannel") } });
+        }
+    }
+
+    // Reject snapshots taken from a different graph before touching anything
+    if (nodes.size() != mNodeIDs.size()) {
+        return false;
+    }
+
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        if (nodes[i].getProperty("name").toString()
+                != mImpl.getNodeForId(mNodeIDs[i])->getProcessor()->getName()) {
+            return false;
+        }
+    }
+
+    // Slow parts, like decoding the samples of an instrument, happen while the graph renders
+    std::vector<PreparedStateLoader*> loaders(nodes.size(), nullptr);
+
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        const juce::MemoryBlock* state = nodes[i].getProperty("state").getBinaryData();
+
+        if (state == nullptr) {
+            continue;
+        }
+
+        juce::AudioProcessor* processor = mImpl.getNodeForId(mNodeIDs[i])->getProcessor();
+        loaders[i] = dynamic_cast<PreparedStateLoader*>(processor);
+
+        if (loaders[i] != nullptr) {
+            loaders[i]->prepareState(state->getData(), static_cast<int>(state->getSize()));
+        }
+    }
+
+    restoreSnapshotLocked(nodes, loaders, connections);
+
+    for (PreparedStateLoader* loader : loaders) {
+        if (loader != nullptr) {
+            loader->releaseReplacedState();
+        }
+    }
+
+    return true;
+}
+
+void AudioGraph::restoreSnapshotLocked(
+        const std::vector<juce::ValueTree>& nodes,
+        const std::vector<PreparedStateLoader*>& loaders,
+        std::vector<juce::AudioProcessorGraph::Connection>& connections)
+{
+    // AudioRoot only renders while it can take this lock, so the whole snapshot lands between
+    // two blocks and no block sees a mix of old and new state
+    const juce::ScopedLock lock(mImpl.getCallbackLock());
+
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        juce::AudioProcessor* processor = mImpl.getNodeForId(mNodeIDs[i])->getProcessor();
+
+        if (loaders[i] != nullptr) {
+            loaders[i]->applyPreparedState();
+        } else if (const juce::MemoryBlock* state = nodes[i].getProperty("state").getBinaryData()) {
+            processor->setStateInformation(state->getData(), static_cast<int>(state->getSize()));
+        }
+
+        auto* provider = dynamic_cast<ValueTreeProvider*>(processor);
+        const juce::ValueTree tree = nodes[i].getChild(0);
+
+        if ((provider != nullptr) && tree.isValid()) {
+            provider->getValueTree().copyPropertiesAndChildrenFrom(tree, nullptr);
+        }
+    }
+
+    // Rebuilding the render sequence is the expensive part, skip it when topology is unchanged
+    std::vector<juce::AudioProcessorGraph::Connection> current = mImpl.getConnections();
+    current.erase(std::remove_if(current.begin(), current.end(),
+        [this](const auto& conn) { return ! isSnapshotConnection(conn); }), current.end());
+
+    std::sort(connections.begin(), connections.end());
+    std::sort(current.begin(), current.end());
+
+    if (connections != current) {
+        for (const juce::AudioProcessorGraph::Connection& conn : current) {
+            mImpl.removeConnection(conn, juce::AudioProcessorGraph::UpdateKind::none);
+        }
+
+        for (const juce::AudioProcessorGraph::Connection& conn : connections) {
+            mImpl.addConnection(conn, juce::AudioProcessorGraph::UpdateKind::none);
+        }
+
+        mImpl.rebuild();
+    }
+}
+
+// MIDI inlets belong to AudioRoot MIDI routes, not to the graph topology
+bool AudioGraph::isSnapshotConnection(
+        const juce::AudioProcessorGraph::Connection& conn) const noexcept
+{
+    return (getEndpointIndex(conn.source.nodeID) >= 0)
+            && (getEndpointIndex(conn.destination.nodeID) >= 0);
+}
+
+int AudioGraph::getEndpointIndex(NodeID nodeID) const noexcept
+{
+    const NodeID ioNodeIDs[] = {
+        mAudioInputNodeID, mAudioOutputNodeID, mMidiInputNodeID, mMidiOutputNodeID
+    };
+    constexpr int numIONodes = static_cast<int>(std::size(ioNodeIDs));
+
+    for (int i = 0; i < numIONodes; ++i) {
+        if (ioNodeIDs[i] == nodeID) {
+            return i;
+        }
+    }
+
+    for (size_t i = 0; i < mNodeIDs.size(); ++i) {
+        if (mNodeIDs[i] == nodeID) {
+            return numIONodes + static_cast<int>(i);
+        }
+    }
+
+    return -1;
+}
+
+juce::AudioProcessorGraph::NodeID AudioGraph::getEndpointNodeID(int index) const noexcept
+{
+    const NodeID ioNodeIDs[] = {
+        mAudioInputNodeID, mAudioOutputNodeID, mMidiInputNodeID, mMidiOutputNodeID
+    };
+    constexpr int numIONodes = static_cast<int>(std::size(ioNodeIDs));
+
+    if ((index >= 0) && (index < numIONodes)) {
+        return ioNodeIDs[index];
+    }
+
+    if ((index >= numIONodes) && (index - numIONodes < static_cast<int>(mNodeIDs.size()))) {
+        return mNodeIDs[static_cast<size_t>(index - numIONodes)];
+    }
+
+    return {};
+}
+
 void AudioGraph::debugPrintConnections() const noexcept
 {
     std::stringstream ss;
@@ -164,6 +466,34 @@ Java_im_taqs_maqam_AudioGraph_jniConnectNodes(JNIEnv *env, jobject thiz,
     }
 }
 
+extern "C"
+JNIEXPORT jbyteArray JNICALL
+Java_im_taqs_maqam_AudioGraph_jniSaveSnapshot(JNIEnv *env, jobject thiz)
+{
+    juce::MemoryBlock snapshot;
+    AudioGraph::fromJava(env, thiz)->getSnapshot(snapshot);
+
+    const auto size = static_cast<jsize>(snapshot.getSize());
+    jbyteArray bytes = env->NewByteArray(size);
+    env->SetByteArrayRegion(bytes, 0, size, static_cast<const jbyte*>(snapshot.getData()));
+
+    return bytes;
+}
+
+extern "C"
+JNIEXPORT jboolean JNICALL
+Java_im_taqs_maqam_AudioGraph_jniRestoreSnapshot(JNIEnv *env, jobject thiz, jbyteArray snapshot)
+{
+    jbyte* data = env->GetByteArrayElements(snapshot, nullptr);
+    const jsize size = env->GetArrayLength(snapshot);
+
+    const bool success = AudioGraph::fromJava(env, thiz)->restoreSnapshot(data,
+                                                                         static_cast<size_t>(size));
+    env->ReleaseByteArrayElements(snapshot, data, JNI_ABORT);
+
+    return success;
+}
+
 extern "C"
 JNIEXPORT void JNICALL
 Java_im_taqs_maqam_AudioGraph_jniDebugPrintConnections(JNIEnv *env, jobject thiz)
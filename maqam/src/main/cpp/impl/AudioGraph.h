@@ -8,15 +8,23 @@
 #ifndef AUDIOGRAPH_H
 #define AUDIOGRAPH_H
 
+#include <atomic>
+#include <vector>
+
 #include <jni.h>
 #include <juce_audio_processors/juce_audio_processors.h>
 
 #include "AudioNode.h"
+#include "MidiInlet.h"
 
 namespace maqam {
 
+class PreparedStateLoader;
+
 class AudioGraph {
 public:
+    static constexpr int kMaxMidiInlets = 32;
+
     AudioGraph();
     ~AudioGraph();
 
@@ -24,17 +32,79 @@ public:
 
     juce::AudioProcessorGraph& getAudioProcessorGraph() noexcept { return mImpl; }
 
+    const juce::CriticalSection& getCallbackLock() const noexcept
+    {
+        return mImpl.getCallbackLock();
+    }
+
+    void prepareToPlay(double sampleRate, int maximumExpectedSamplesPerBlock);
+
+    // Makes the next prepareToPlay() prepare every node again, even with unchanged settings
+    void releaseResources() { mImpl.releaseResources(); }
+
+    // Passed down to every node while rendering, see juce::AudioProcessor::getPlayHead()
+    void setPlayHead(juce::AudioPlayHead* playHead) noexcept { mImpl.setPlayHead(playHead); }
+
+    // Audio thread, caller holds getCallbackLock(). Runs preset morphs before the nodes render.
+    void processBlock(juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages) noexcept;
+
     void addNode(AudioNode* node, juce::AudioProcessor* processor);
     void connectNodes(AudioNode* source, AudioNode* sink, bool audio, bool midi);
 
+    // Java thread, inlet connected only to sink MIDI input, created on first use
+    int getMidiInletIndex(AudioNode* sink);
+
+    // Java thread, removes all inlets and their connections. Caller makes sure the audio thread
+    // no longer looks up any inlet index, see AudioRoot::clearMidiRoutes().
+    void clearMidiInlets();
+
+    // Audio thread
+    MidiInlet* getMidiInlet(int index) const noexcept
+    {
+        return (index >= 0) && (index < mNumMidiInlets) ? mMidiInlets[index] : nullptr;
+    }
+
+    // Topology, parameters and ValueTree state of every node in a single binary ValueTree, see
+    // juce::ValueTree::writeToStream(). Restoring requires a graph built with the same nodes in
+    // the same order, the new state is swapped in between two render calls. Only nodes that
+    // changed since the previous snapshot are serialized again, see
+    // AudioNode::consumeStateChanged().
+    void getSnapshot(juce::MemoryBlock& destData);
+    bool restoreSnapshot(const void* data, size_t sizeInBytes);
+
     void debugPrintConnections() const noexcept;
 
 private:
+    using NodeID = juce::AudioProcessorGraph::NodeID;
+
+    static constexpr int kSnapshotVersion = 1;
+
+    // Snapshot connection endpoints are stored as indexes into the I/O nodes followed by mNodeIDs
+    int getEndpointIndex(NodeID nodeID) const noexcept;
+    bool isSnapshotConnection(const juce::AudioProcessorGraph::Connection& conn) const noexcept;
+    NodeID getEndpointNodeID(int index) const noexcept;
+
+    // Swaps in node states and topology between two render calls
+    void restoreSnapshotLocked(const std::vector<juce::ValueTree>& nodes,
+                               const std::vector<PreparedStateLoader*>& loaders,
+                               std::vector<juce::AudioProcessorGraph::Connection>& connections);
+
     juce::AudioProcessorGraph         mImpl;
     juce::AudioProcessorGraph::NodeID mAudioInputNodeID;
     juce::AudioProcessorGraph::NodeID mAudioOutputNodeID;
     juce::AudioProcessorGraph::NodeID mMidiInputNodeID;
     juce::AudioProcessorGraph::NodeID mMidiOutputNodeID;
+    std::vector<NodeID>               mNodeIDs;
+    std::vector<AudioNode*>           mNodes;
+    std::vector<juce::ValueTree>      mSnapshotNodes; // NODE entries of the last snapshot
+    std::vector<PresetMorph*>         mPresetMorphs;
+
+    // Appended while routes are added, the audio thread never sees a slot below mNumMidiInlets
+    // change. Only cleared all at once, after every route pointing to them is gone.
+    MidiInlet*       mMidiInlets[kMaxMidiInlets];
+    NodeID           mMidiInletNodeIDs[kMaxMidiInlets];
+    NodeID           mMidiInletSinks[kMaxMidiInlets];
+    std::atomic<int> mNumMidiInlets;
 
 };
 
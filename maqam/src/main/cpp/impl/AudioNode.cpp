@@ -5,8 +5,13 @@
 // SPDX-License-Identifier: MIT
 //
 
+#include <cmath>
+#include <limits>
+
 #include "AudioNode.h"
+#include "JNICache.h"
 #include "NativeWrapper.h"
+#include "NotificationHub.h"
 #include "nodes/ValueTreeProvider.h"
 
 using namespace maqam;
@@ -38,16 +43,22 @@ static juce::AudioParameterFloat* asAudioParameterFloat(juce::AudioProcessorPara
 }
 
 AudioNode::AudioNode()
-    : mJVM(nullptr)
-    , mEnv(nullptr)
+    : mOwner(nullptr)
+    , mDSP(nullptr)
+    , mHasPendingNotifications(false)
+    , mStateChanged(true)
+    , mNumParameters(0)
 {}
 
 AudioNode::~AudioNode()
 {
-    AudioNode::getDSP(mEnv, mOwner)->removeListener(this);
-    mEnv->DeleteGlobalRef(mOwner);
+    JNIEnv* env = JNICache::getEnv();
+
+    NotificationHub::getInstance().removeNode(this);
+    mDSP->removeListener(this);
+    NativeWrapper::deleteImpl(env, mOwner, AudioNode::kDSPFieldName);
 
-    NativeWrapper::deleteImpl(mEnv, mOwner, AudioNode::kDSPFieldName);
+    env->DeleteGlobalRef(mOwner);
 }
 
 AudioNode* AudioNode::fromJava(JNIEnv *env, jobject thiz) noexcept
@@ -64,12 +75,10 @@ void AudioNode::createDSP(JNIEnv *env, jobject thiz) noexcept
 {
     NativeWrapper::createImpl(env, thiz, AudioNode::kDSPFieldName);
 
-    mEnv = env;
-    mEnv->GetJavaVM(&mJVM);
-    mEnvThreadId = std::this_thread::get_id();
-    mOwner = mEnv->NewGlobalRef(thiz);
+    mOwner = env->NewGlobalRef(thiz);
+    mDSP = AudioNode::getDSP(env, mOwner);
 
-    juce::AudioProcessor* processor = AudioNode::getDSP(mEnv, mOwner);
+    juce::AudioProcessor* processor = mDSP;
     const juce::Array<juce::AudioProcessorParameter*> parameters = processor->getParameters();
 
     for (juce::AudioProcessorParameter* p : parameters) {
@@ -80,7 +89,17 @@ void AudioNode::createDSP(JNIEnv *env, jobject thiz) noexcept
         }
     }
 
+    mNumParameters = parameters.size();
+    mParameterChanged = std::make_unique<std::atomic<bool>[]>(static_cast<size_t>(mNumParameters));
+
+    for (int i = 0; i < mNumParameters; ++i) {
+        mParameterChanged[i] = false;
+    }
+
+    mPresetMorph.setParameters(parameters);
+
     processor->addListener(this);
+    NotificationHub::getInstance().addNode(this);
 
     auto* proc = dynamic_cast<maqam::ValueTreeProvider*>(processor);
 
@@ -157,7 +176,7 @@ juce::String AudioNode::getParameterLabel(const juce::String& id) noexcept
 
 float AudioNode::getValueTreePropertyFloatValue(const juce::String& id) noexcept
 {
-    auto* proc = dynamic_cast<maqam::ValueTreeProvider*>(getDSP(mEnv, mOwner));
+    auto* proc = dynamic_cast<maqam::ValueTreeProvider*>(mDSP);
 
     if (proc != nullptr) {
         return proc->getValueTree().getProperty(id);
@@ -168,7 +187,7 @@ float AudioNode::getValueTreePropertyFloatValue(const juce::String& id) noexcept
 
 void AudioNode::setValueTreePropertyFloatValue(const juce::String& id, const float value)
 {
-    auto* proc = dynamic_cast<maqam::ValueTreeProvider*>(getDSP(mEnv, mOwner));
+    auto* proc = dynamic_cast<maqam::ValueTreeProvider*>(mDSP);
 
     if (proc != nullptr) {
         proc->getValueTree().setProperty(id, value, nullptr);
@@ -177,7 +196,7 @@ void AudioNode::setValueTreePropertyFloatValue(const juce::String& id, const flo
 
 juce::String AudioNode::getValueTreePropertyStringValue(const juce::String& id) noexcept
 {
-    auto* proc = dynamic_cast<maqam::ValueTreeProvider*>(getDSP(mEnv, mOwner));
+    auto* proc = dynamic_cast<maqam::ValueTreeProvider*>(mDSP);
 
     if (proc != nullptr) {
         return proc->getValueTree().getProperty(id);
@@ -188,73 +207,112 @@ juce::String AudioNode::getValueTreePropertyStringValue(const juce::String& id)
 
 void AudioNode::setValueTreePropertyStringValue(const juce::String& id, const juce::String& value)
 {
-    auto* proc = dynamic_cast<maqam::ValueTreeProvider*>(getDSP(mEnv, mOwner));
+    auto* proc = dynamic_cast<maqam::ValueTreeProvider*>(mDSP);
 
     if (proc != nullptr) {
         proc->getValueTree().setProperty(id, value, nullptr);
     }
 }
 
-// FIXME - make this RT-safe as AudioNode must deal with arbitrary processors not just TAQS.IM's
-// IMPORTANT NOTE: This will be called synchronously when a parameter changes, and many audio
-// processors will change their parameter during their audio callback. This means that not only has
-// your handler code got to be completely thread-safe, but it's also got to be VERY fast, and avoid
-// blocking. If you need to handle this event on your message thread, use this callback to trigger
-// an AsyncUpdater or ChangeBroadcaster which you can respond to on the message thread
+// Called synchronously on whatever thread changed the parameter, including the audio thread.
+// Only flags the change, NotificationHub picks it up later.
 void AudioNode::audioProcessorParameterChanged(juce::AudioProcessor* processor, int parameterIndex,
                                                float newValue)
 {
-    juce::AudioProcessorParameter* param = processor->getParameters()[parameterIndex];
-    jmethodID method = mEnv->GetMethodID(mEnv->GetObjectClass(mOwner), "jniOnParameterChanged",
-                                         "(Ljava/lang/String;F)V");
-
-    if (auto* fparam = asAudioParameterFloat(param)) {
-        jstring id = mEnv->NewStringUTF(fparam->getParameterID().toUTF8());
-        mEnv->CallVoidMethod(mOwner, method, id, fparam->get());
-        mEnv->DeleteLocalRef(id);
+    if ((parameterIndex >= 0) && (parameterIndex < mNumParameters)) {
+        mParameterChanged[parameterIndex] = true;
+        mHasPendingNotifications = true;
+        mStateChanged = true;
     }
 }
 
 void AudioNode::valueTreePropertyChanged(juce::ValueTree& treeWhosePropertyHasChanged,
                                          const juce::Identifier& property)
 {
+    mStateChanged = true;
+
     if (property.toString() == "value") {
         return; // some parameter value changed, ignore.
     }
 
-    const bool shouldAttachCurrentThread = std::this_thread::get_id() != mEnvThreadId;
-    JNIEnv* env = mEnv;
+    const juce::var& value = treeWhosePropertyHasChanged.getProperty(property);
+    const float floatValue = value.isBool() || value.isInt() || value.isDouble()
+            ? static_cast<float>(value) : std::numeric_limits<float>::quiet_NaN();
 
-    if (shouldAttachCurrentThread) {
-        JavaVMAttachArgs args;
-        args.version = JNI_VERSION_1_6;
-        args.name = nullptr;
-        args.group = nullptr;
-        mJVM->AttachCurrentThread(&env, &args);
+    {
+        const juce::SpinLock::ScopedLockType lock(mChangedStatesLock);
+        mChangedStates[property.toString()] = floatValue;
     }
 
-    jstring id = env->NewStringUTF(property.toString().toUTF8());
-    const juce::var& value = treeWhosePropertyHasChanged.getProperty(property);
+    mHasPendingNotifications = true;
+}
 
-    if (value.isBool() || value.isInt() || value.isDouble()) {
-        jmethodID method = env->GetMethodID(env->GetObjectClass(mOwner),
-                                            "jniOnValueTreePropertyFloatValueChanged",
-                                            "(Ljava/lang/String;F)V");
-        env->CallVoidMethod(mOwner, method, id, static_cast<float>(value));
-    } else {
-        jmethodID method = env->GetMethodID(env->GetObjectClass(mOwner),
-                                            "jniOnValueTreePropertyStringValueChanged",
-                                            "(Ljava/lang/String;Ljava/lang/String;)V");
-        jstring sval = env->NewStringUTF(value.toString().toUTF8());
-        env->CallVoidMethod(mOwner, method, id, sval);
-        env->DeleteLocalRef(sval);
+bool AudioNode::collectNotifications(juce::StringArray& ids, juce::Array<float>& values) noexcept
+{
+    // Morphs write parameters on the audio thread without notifying, this reaches the listeners
+    // including audioProcessorParameterChanged() below, and the state of the processor
+    mPresetMorph.consumeChanges([](juce::AudioProcessorParameter& parameter) {
+        parameter.sendValueChangedMessageToListeners(parameter.getValue());
+    });
+
+    if (! mHasPendingNotifications.exchange(false)) {
+        return false;
     }
 
-    env->DeleteLocalRef(id);
+    ids.clearQuick();
+    values.clearQuick();
 
-    if (shouldAttachCurrentThread) {
-        mJVM->DetachCurrentThread();
+    const juce::Array<juce::AudioProcessorParameter*>& parameters = mDSP->getParameters();
+
+    for (int i = 0; i < mNumParameters; ++i) {
+        if (mParameterChanged[i].exchange(false)) {
+            if (auto* fparam = asAudioParameterFloat(parameters[i])) {
+                ids.add(fparam->getParameterID());
+                values.add(fparam->get());
+            }
+        }
     }
+
+    {
+        const juce::SpinLock::ScopedLockType lock(mChangedStatesLock);
+
+        for (const auto& [id, value] : mChangedStates) {
+            ids.add(id);
+            values.add(value);
+        }
+
+        mChangedStates.clear();
+    }
+
+    return ! ids.isEmpty();
+}
+
+void AudioNode::deliverNotifications(JNIEnv *env, jobject owner, const juce::StringArray& ids,
+                                     const juce::Array<float>& values) noexcept
+{
+    const int size = ids.size();
+
+    jobjectArray jIds = env->NewObjectArray(size, JNICache::getStringClass(), nullptr);
+
+    for (int i = 0; i < size; ++i) {
+        jstring id = env->NewStringUTF(ids[i].toUTF8());
+        env->SetObjectArrayElement(jIds, i, id);
+        env->DeleteLocalRef(id);
+    }
+
+    jfloatArray jValues = env->NewFloatArray(size);
+    env->SetFloatArrayRegion(jValues, 0, size, values.getRawDataPointer());
+
+    env->CallVoidMethod(owner, JNICache::getMethodID(JNICache::kAudioNodeOnPropertiesChanged),
+                        jIds, jValues);
+
+    if (env->ExceptionCheck()) {
+        env->ExceptionDescribe();
+        env->ExceptionClear();
+    }
+
+    env->DeleteLocalRef(jValues);
+    env->DeleteLocalRef(jIds);
 }
 
 extern "C"
@@ -384,3 +442,86 @@ Java_im_taqs_maqam_AudioNode_jniSetValueTreePropertyStringValue(JNIEnv *env, job
     env->ReleaseStringUTFChars(value, cValue);
     env->ReleaseStringUTFChars(id, cId);
 }
+
+extern "C"
+JNIEXPORT void JNICALL
+Java_im_taqs_maqam_AudioNode_jniStorePreset(JNIEnv *env, jobject thiz, jstring name)
+{
+    const char* cName = env->GetStringUTFChars(name, nullptr);
+    AudioNode::fromJava(env, thiz)->getPresetMorph().storePreset(cName);
+    env->ReleaseStringUTFChars(name, cName);
+}
+
+extern "C"
+JNIEXPORT jboolean JNICALL
+Java_im_taqs_maqam_AudioNode_jniRemovePreset(JNIEnv *env, jobject thiz, jstring name)
+{
+    const char* cName = env->GetStringUTFChars(name, nullptr);
+    const bool success = AudioNode::fromJava(env, thiz)->getPresetMorph().removePreset(cName);
+    env->ReleaseStringUTFChars(name, cName);
+
+    return success;
+}
+
+extern "C"
+JNIEXPORT jboolean JNICALL
+Java_im_taqs_maqam_AudioNode_jniRecallPreset(JNIEnv *env, jobject thiz, jstring name)
+{
+    const char* cName = env->GetStringUTFChars(name, nullptr);
+    const bool success = AudioNode::fromJava(env, thiz)->getPresetMorph().recallPreset(cName);
+    env->ReleaseStringUTFChars(name, cName);
+
+    return success;
+}
+
+extern "C"
+JNIEXPORT jobjectArray JNICALL
+Java_im_taqs_maqam_AudioNode_jniGetPresetNames(JNIEnv *env, jobject thiz)
+{
+    const juce::StringArray names = AudioNode::fromJava(env, thiz)->getPresetMorph()
+            .getPresetNames();
+    jobjectArray result = env->NewObjectArray(names.size(), JNICache::getStringClass(), nullptr);
+
+    for (int i = 0; i < names.size(); ++i) {
+        jstring name = env->NewStringUTF(names[i].toUTF8());
+        env->SetObjectArrayElement(result, i, name);
+        env->DeleteLocalRef(name);
+    }
+
+    return result;
+}
+
+extern "C"
+JNIEXPORT jboolean JNICALL
+Java_im_taqs_maqam_AudioNode_jniSetMorphPresets(JNIEnv *env, jobject thiz, jstring from, jstring to)
+{
+    const char* cFrom = env->GetStringUTFChars(from, nullptr);
+    const char* cTo = env->GetStringUTFChars(to, nullptr);
+    const bool success = AudioNode::fromJava(env, thiz)->getPresetMorph().setMorphPresets(cFrom,
+                                                                                          cTo);
+    env->ReleaseStringUTFChars(to, cTo);
+    env->ReleaseStringUTFChars(from, cFrom);
+
+    return success;
+}
+
+extern "C"
+JNIEXPORT void JNICALL
+Java_im_taqs_maqam_AudioNode_jniClearMorph(JNIEnv *env, jobject thiz)
+{
+    AudioNode::fromJava(env, thiz)->getPresetMorph().clearMorph();
+}
+
+extern "C"
+JNIEXPORT jfloat JNICALL
+Java_im_taqs_maqam_AudioNode_jniGetMorphPosition(JNIEnv *env, jobject thiz)
+{
+    return AudioNode::fromJava(env, thiz)->getPresetMorph().getPosition();
+}
+
+extern "C"
+JNIEXPORT void JNICALL
+Java_im_taqs_maqam_AudioNode_jniSetMorphPosition(JNIEnv *env, jobject thiz, jfloat position)
+{
+    AudioNode::fromJava(env, thiz)->getPresetMorph().setPosition(position);
+}
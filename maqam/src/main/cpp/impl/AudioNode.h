@@ -8,13 +8,15 @@
 #ifndef AUDIONODE_H
 #define AUDIONODE_H
 
+#include <atomic>
 #include <map>
-#include <thread>
+#include <memory>
 #include <jni.h>
 
 #include <juce_audio_processors/juce_audio_processors.h>
 
 #include "NativeWrapper.h"
+#include "PresetMorph.h"
 
 namespace maqam {
 
@@ -55,6 +57,8 @@ public:
         mAudioProcessorGraphNodeID = nodeID;
     }
 
+    PresetMorph& getPresetMorph() noexcept { return mPresetMorph; }
+
     float getParameterValue(const juce::String& id) noexcept;
     void  setParameterValue(const juce::String& id, float value) noexcept;
     void  getParameterValueRange(const juce::String& id, float range[]) noexcept;
@@ -67,29 +71,58 @@ public:
     juce::String getValueTreePropertyStringValue(const juce::String& id) noexcept;
     void         setValueTreePropertyStringValue(const juce::String& id, const juce::String& value);
 
+    // Called by NotificationHub with its nodes lock held, moves all properties that changed since
+    // the last call into ids and values. Returns false when nothing changed.
+    bool collectNotifications(juce::StringArray& ids, juce::Array<float>& values) noexcept;
+
+    // Called by NotificationHub without any lock held, owner is a reference of its own that keeps
+    // the Kotlin object alive even if the node is deleted meanwhile
+    static void deliverNotifications(JNIEnv *env, jobject owner, const juce::StringArray& ids,
+                                     const juce::Array<float>& values) noexcept;
+
+    jobject getOwner() const noexcept { return mOwner; }
+
+    // True when parameters or state changed since the last call, lets AudioGraph::getSnapshot()
+    // reuse the state it serialized before for all other nodes
+    bool consumeStateChanged() noexcept { return mStateChanged.exchange(false); }
+
 protected:
     // juce::AudioProcessorListener
     void audioProcessorParameterChanged(juce::AudioProcessor *processor, int parameterIndex,
             float newValue) override;
 
     void audioProcessorChanged(juce::AudioProcessor *processor, const ChangeDetails &details) override
-    {}
+    {
+        if (details.nonParameterStateChanged) {
+            mStateChanged = true;
+        }
+    }
 
     // juce::ValueTree::Listener
     void valueTreePropertyChanged(juce::ValueTree& treeWhosePropertyHasChanged,
                                   const juce::Identifier& property) override;
 
 private:
-    JavaVM*         mJVM;
-    JNIEnv*         mEnv;
-    std::thread::id mEnvThreadId;
-    jobject         mOwner;
+    jobject               mOwner;
+    juce::AudioProcessor* mDSP;
+
+    // Set from any thread including audio, cleared by collectNotifications()
+    std::atomic<bool>                    mHasPendingNotifications;
+    std::atomic<bool>                    mStateChanged;
+    std::unique_ptr<std::atomic<bool>[]> mParameterChanged;
+    int                                  mNumParameters;
+
+    // ValueTree changes never come from the audio thread, NaN for string values
+    juce::SpinLock                mChangedStatesLock;
+    std::map<juce::String, float> mChangedStates;
 
     using AudioProcessorParameterMap = std::map<juce::String, juce::AudioParameterFloat *>;
     AudioProcessorParameterMap mAudioProcessorParameters;
 
     juce::AudioProcessorGraph::NodeID mAudioProcessorGraphNodeID;
 
+    PresetMorph mPresetMorph;
+
 };
 
 } // maqam
@@ -5,23 +5,49 @@
 // SPDX-License-Identifier: MIT
 //
 
+#include <algorithm>
+#include <ctime>
+#include <iterator>
+#include <stdexcept>
+
 #include "AudioRoot.h"
 #include "AudioGraph.h"
+#include "Interleave.h"
 #include "NativeWrapper.h"
+#include "RealtimeSanitizer.h"
 #include "log.h"
 
 using namespace maqam;
 
 AudioRoot::AudioRoot()
-    : mMidiSource {}
+    : mMidiSources {}
+    , mNumMidiSources(0)
     , mMidiQueue(kMidiEventQueueSize)
     , mAudioBuffer(kChannelCount, kMaxFramesPerBlock)
     , mAudioStreamStarted(false)
+    , mInputEnabled(false)
+    , mBlockSizeAdapter(kChannelCount)
     , mGraph(nullptr)
+    , mReopenPending(false)
+    , mSampleRate(kDefaultSampleRate)
+    , mBlockSize(kMaxFramesPerBlock)
+    , mBlockTimeNanos(0)
 {
+    // Keeps addEvent() from allocating on the audio thread for any realistic burst of events
+    mMidiBuffer.ensureSize(kMidiBufferReservedSize);
+    mPendingMidi.ensureSize(kMidiBufferReservedSize);
+    mPendingMidiScratch.ensureSize(kMidiBufferReservedSize);
+
     createStream();
 }
 
+AudioRoot::~AudioRoot()
+{
+    if (mReopenThread.joinable()) {
+        mReopenThread.join();
+    }
+}
+
 AudioRoot* AudioRoot::fromJava(JNIEnv *env, jobject thiz) noexcept
 {
     return NativeWrapper::getImpl<AudioRoot>(env, thiz);
@@ -29,62 +55,170 @@ AudioRoot* AudioRoot::fromJava(JNIEnv *env, jobject thiz) noexcept
 
 void AudioRoot::setGraph(AudioGraph* graph) noexcept
 {
+    // Routes point to MIDI inlets of the previous graph
+    clearMidiRoutes();
+
+    // A stream reopening meanwhile prepares the graph too, possibly at another rate
+    std::lock_guard<std::mutex> streamLock(mStreamMutex);
+
     if (graph != nullptr) {
-        juce::AudioProcessorGraph& audioProcessorGraph = graph->getAudioProcessorGraph();
-        audioProcessorGraph.prepareToPlay(kSampleRate, kMaxFramesPerBlock);
-        mGraph = &audioProcessorGraph;
+        graph->prepareToPlay(mSampleRate, mBlockSize);
+        graph->setPlayHead(&mTransport);
+    }
+
+    AudioGraph* previous = mGraph.exchange(graph);
+
+    // Waits for a block of the previous graph still in flight
+    if ((previous != nullptr) && (previous != graph)) {
+        const juce::ScopedLock lock(previous->getCallbackLock());
+        previous->setPlayHead(nullptr);
+    }
+}
+
+void AudioRoot::setInputEnabled(bool enabled) noexcept
+{
+    std::lock_guard<std::mutex> lock(mStreamMutex);
+
+    if (enabled == mInputEnabled) {
+        return;
+    }
+
+    mInputEnabled = enabled;
+
+    if (enabled && (mAudioStream != nullptr)) {
+        mInput.open(mAudioStream->getSampleRate(), kChannelCount, mBlockSize);
     } else {
-        mGraph = nullptr;
+        mInput.close();
+    }
+}
+
+void AudioRoot::setFixedBlockSize(int32_t blockSize)
+{
+    std::lock_guard<std::mutex> lock(mStreamMutex);
+
+    if ((blockSize != 0) && (! juce::isPowerOfTwo(blockSize) || (blockSize < kMinFixedBlockSize)
+            || (blockSize > std::min(BlockSizeAdapter::kMaxBlockSize, mBlockSize.load())))) {
+        throw std::invalid_argument("Invalid fixed block size");
     }
+
+    mBlockSizeAdapter.setBlockSize(blockSize);
 }
 
 void AudioRoot::connectMidiDevice(int id, AMidiDevice* midiDevice) noexcept
 {
-    mMidiSourceMutex.lock();
+    // Graph MIDI output goes to every device that accepts MIDI
+    if (AMidiDevice_getNumInputPorts(midiDevice) > 0) {
+        mMidiOutput.openPort(id, midiDevice);
+    }
 
-    if (AMidiDevice_getNumOutputPorts(midiDevice) > 0) {
-        int idx = -1;
+    std::lock_guard<std::mutex> lock(mMidiSourceMutex);
 
-        for (int i = 0; i < kMaxMidiPorts; ++i) {
-            if (mMidiSource[i].port == nullptr) {
-                idx = i;
-                break;
-            }
-        }
+    const auto numPorts = static_cast<int32_t>(AMidiDevice_getNumOutputPorts(midiDevice));
 
-        if (idx == -1) {
+    for (int32_t portNumber = 0; portNumber < numPorts; ++portNumber) {
+        if (mNumMidiSources == kMaxMidiPorts) {
             LOG_E(LOG_TAG, "AudioRoot no more source MIDI ports available");
-            mMidiSourceMutex.unlock();
             return;
         }
 
-        AMidiOutputPort* port;
-        const int32_t result = AMidiOutputPort_open(midiDevice, /*portNumber*/0, &port);
+        MidiSource source { id, portNumber, nullptr, {} };
 
-        if (result != AMEDIA_OK) {
-            LOG_E(LOG_TAG, "AudioRoot could not open source MIDI port [%d]", id);
-            mMidiSourceMutex.unlock();
-            return;
+        if (AMidiOutputPort_open(midiDevice, portNumber, &source.port) != AMEDIA_OK) {
+            LOG_E(LOG_TAG, "AudioRoot could not open source MIDI port [%d:%d]", id, portNumber);
+            continue;
         }
 
-        mMidiSource[idx].isOpen = true;
-        mMidiSource[idx].id = id;
-        mMidiSource[idx].port = port;
+        applyMidiRoutes(source);
 
-    } else if (AMidiDevice_getNumInputPorts(midiDevice) > 0) {
-        // MIDI output currently not supported
+        const juce::SpinLock::ScopedLockType sourcesLock(mMidiSourcesLock);
+        mMidiSources[mNumMidiSources++] = source;
     }
-
-    mMidiSourceMutex.unlock();
 }
 
 void AudioRoot::disconnectMidiDevice(int id) noexcept
 {
-    for (int i = 0; i < kMaxMidiPorts; ++i) {
-        if (mMidiSource[i].id == id) {
-            mMidiSource[i].isOpen = false;
+    mMidiOutput.closePort(id);
+
+    std::lock_guard<std::mutex> lock(mMidiSourceMutex);
+
+    AMidiOutputPort* closedPorts[kMaxMidiPorts];
+    int numClosedPorts = 0;
+
+    {
+        const juce::SpinLock::ScopedLockType sourcesLock(mMidiSourcesLock);
+
+        for (int i = 0; i < mNumMidiSources; ) {
+            if (mMidiSources[i].deviceId == id) {
+                closedPorts[numClosedPorts++] = mMidiSources[i].port;
+                mMidiSources[i] = mMidiSources[--mNumMidiSources];
+            } else {
+                ++i;
+            }
+        }
+    }
+
+    // Out of the array, no callback can be polling these anymore
+    for (int i = 0; i < numClosedPorts; ++i) {
+        AMidiOutputPort_close(closedPorts[i]);
+    }
+}
+
+void AudioRoot::routeMidi(int deviceId, int portNumber, int channel, AudioNode* sink)
+{
+    AudioGraph* graph = mGraph.load();
+
+    if (graph == nullptr) {
+        throw std::runtime_error("No graph");
+    }
+
+    if ((channel < -1) || (channel >= MidiSource::kNumChannels)) {
+        throw std::invalid_argument("Invalid MIDI channel");
+    }
+
+    // Inlets are created and cleared with the mutex held
+    std::lock_guard<std::mutex> lock(mMidiSourceMutex);
+
+    const int inletIndex = graph->getMidiInletIndex(sink);
+
+    for (int ch = 0; ch < MidiSource::kNumChannels; ++ch) {
+        if ((channel == -1) || (channel == ch)) {
+            mMidiRoutes[{ deviceId, portNumber, ch }] = inletIndex;
+        }
+    }
+
+    const juce::SpinLock::ScopedLockType sourcesLock(mMidiSourcesLock);
+
+    for (int i = 0; i < mNumMidiSources; ++i) {
+        applyMidiRoutes(mMidiSources[i]);
+    }
+}
+
+void AudioRoot::clearMidiRoutes() noexcept
+{
+    std::lock_guard<std::mutex> lock(mMidiSourceMutex);
+    mMidiRoutes.clear();
+
+    {
+        const juce::SpinLock::ScopedLockType sourcesLock(mMidiSourcesLock);
+
+        for (int i = 0; i < mNumMidiSources; ++i) {
+            applyMidiRoutes(mMidiSources[i]);
         }
     }
+
+    // No source routes to an inlet anymore, so the audio thread stops using them once the lock
+    // above is released. Otherwise every route ever added would leave a node in the graph.
+    if (AudioGraph* graph = mGraph.load()) {
+        graph->clearMidiInlets();
+    }
+}
+
+void AudioRoot::applyMidiRoutes(MidiSource& source) const noexcept
+{
+    for (int ch = 0; ch < MidiSource::kNumChannels; ++ch) {
+        const auto it = mMidiRoutes.find({ source.deviceId, source.portNumber, ch });
+        source.routes[ch] = it != mMidiRoutes.end() ? it->second : -1;
+    }
 }
 
 void AudioRoot::queueMidiEvent(const MidiEvent& event) noexcept
@@ -94,30 +228,49 @@ void AudioRoot::queueMidiEvent(const MidiEvent& event) noexcept
 
 void AudioRoot::startStream() noexcept
 {
+    std::lock_guard<std::mutex> lock(mStreamMutex);
+
+    // Input first so the first output callbacks find data queued
+    mInput.start();
     mAudioStream->requestStart();
     mAudioStreamStarted = true;
 }
 
 void AudioRoot::stopStream() noexcept
 {
+    std::lock_guard<std::mutex> lock(mStreamMutex);
+
     mAudioStreamStarted = false;
-    mAudioStream->requestStop();
+
+    // Blocking, the input stream must not be touched by a callback still in flight
+    mAudioStream->stop();
+    mInput.stop();
+
+    // No-op unless built with MAQAM_RT_SANITIZER
+    RealtimeSanitizer::dump();
 }
 
 oboe::DataCallbackResult
 AudioRoot::onAudioReady(oboe::AudioStream *audioStream, void *audioData, int32_t numFrames)
 {
-    mAudioBuffer.setSize(kChannelCount, numFrames, /*keepExistingContent=*/false,
-        /*clearExtraSpace=*/false, /*avoidReallocating=*/true);
-    juce::AudioProcessorGraph* graph = mGraph.load();
+    // Sets up scheduling on the first callback of a thread, then times every callback
+    const ThreadPolicy::CallbackScope threadPolicyScope(mThreadPolicy, numFrames, mSampleRate);
 
-    juce::MidiBuffer midiBuffer;
-    processMidi(midiBuffer);
+    MAQAM_REALTIME_SCOPE;
 
-    if (graph != nullptr) {
-        graph->processBlock(mAudioBuffer, midiBuffer);
-    } else {
-        mAudioBuffer.clear();
+    // Grows the buffer size one burst at a time on underruns, starting from the minimum
+    if (mLatencyTuner != nullptr) {
+        mLatencyTuner->tune();
+    }
+
+    AudioGraph* graph = mGraph.load();
+
+    // clear() keeps the allocated storage
+    mMidiBuffer.clear();
+    processMidi(mMidiBuffer, graph);
+
+    if (mMidiOutput.isActive()) {
+        mBlockTimeNanos = getPresentationTimeNanos(audioStream);
     }
 
     // We requested AudioFormat::Float. So if the stream opens
@@ -126,9 +279,88 @@ AudioRoot::onAudioReady(oboe::AudioStream *audioStream, void *audioData, int32_t
     // the stream has and cast to the appropriate type.
     const auto samples = static_cast<float *>(audioData);
 
+    if (mBlockSizeAdapter.update()) {
+        // Held until the block they fall in renders, possibly in a later callback
+        mPendingMidi.addEvents(mMidiBuffer, 0, -1, mBlockSizeAdapter.getArrivalOffset());
+
+        mBlockSizeAdapter.process(samples, numFrames, [this, graph](float* block, int32_t n) {
+            mMidiBuffer.clear();
+            mMidiBuffer.addEvents(mPendingMidi, 0, n, 0);
+
+            renderBlock(graph, block, n);
+
+            mPendingMidiScratch.clear();
+            mPendingMidiScratch.addEvents(mPendingMidi, n, -1, -n);
+            mPendingMidi.swapWith(mPendingMidiScratch);
+        });
+
+        return oboe::DataCallbackResult::Continue;
+    }
+
+    // Left over from fixed block size mode, late but not lost
+    for (const juce::MidiMessageMetadata metadata : mPendingMidi) {
+        mMidiBuffer.addEvent(metadata.data, metadata.numBytes, /*sampleNumber*/0);
+    }
+
+    mPendingMidi.clear();
+
+    // Callbacks are usually one burst, anything larger than the prepared block size is split
+    const int32_t blockSize = mBlockSize;
+
+    for (int32_t offset = 0; offset < numFrames; offset += blockSize) {
+        renderBlock(graph, samples + offset * kChannelCount,
+                    std::min(blockSize, numFrames - offset));
+
+        // MIDI goes to the first block only
+        mMidiBuffer.clear();
+    }
+
+    return oboe::DataCallbackResult::Continue;
+}
+
+void AudioRoot::renderBlock(AudioGraph* graph, float* samples, int32_t numFrames) noexcept
+{
+    mAudioBuffer.setSize(kChannelCount, numFrames, /*keepExistingContent=*/false,
+        /*clearExtraSpace=*/false, /*avoidReallocating=*/true);
+
+    // Graph input node reads from the same buffer, silence when there is no input stream
+    mInput.read(mAudioBuffer, numFrames);
+
+    // Nodes read the transport state of the block start through their play head
+    mTransport.beginBlock(mSampleRate);
+
+    if (graph != nullptr) {
+        // Same as juce::AudioProcessorPlayer but never blocks. The lock is only contended while
+        // AudioGraph::restoreSnapshot() swaps state in, that block is silent.
+        const juce::ScopedTryLock lock(graph->getCallbackLock());
+
+        if (lock.isLocked()) {
+            graph->processBlock(mAudioBuffer, mMidiBuffer);
+
+            // Graph replaced the input events with whatever reached its MIDI output node
+            if (mMidiOutput.isActive() && ! mMidiBuffer.isEmpty()) {
+                mMidiOutput.queue(mMidiBuffer, mBlockTimeNanos, mSampleRate);
+            }
+        } else {
+            mAudioBuffer.clear();
+        }
+    } else {
+        mAudioBuffer.clear();
+    }
+
+    mTransport.endBlock(numFrames);
+    mBlockTimeNanos += static_cast<int64_t>(numFrames * kNanosPerSecond / mSampleRate);
+
     // Oboe expects interleaved channels sample data
     // JUCE/modules/juce_audio_devices/native/juce_android_Oboe.cpp
     const int numChannels = mAudioBuffer.getNumChannels();
+
+    if (numChannels == 2) {
+        interleaveStereo(mAudioBuffer.getReadPointer(0), mAudioBuffer.getReadPointer(1), samples,
+                         numFrames);
+        return;
+    }
+
     using Format = juce::AudioData::Format<juce::AudioData::Float32, juce::AudioData::NativeEndian>;
 
     juce::AudioData::interleaveSamples (
@@ -137,19 +369,41 @@ AudioRoot::onAudioReady(oboe::AudioStream *audioStream, void *audioData, int32_t
         juce::AudioData::InterleavedDest<Format> { samples, numChannels },
         numFrames
     );
+}
 
-    return oboe::DataCallbackResult::Continue;
+// Time at which the first frame of the current callback leaves the device, on the same clock
+// as AMidi timestamps. Falls back to now when the stream cannot report a timestamp yet.
+int64_t AudioRoot::getPresentationTimeNanos(oboe::AudioStream* audioStream) noexcept
+{
+    const oboe::ResultWithValue<oboe::FrameTimestamp> timestamp =
+            audioStream->getTimestamp(CLOCK_MONOTONIC);
+
+    if (! timestamp) {
+        timespec now {};
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        return static_cast<int64_t>(now.tv_sec) * kNanosPerSecond + now.tv_nsec;
+    }
+
+    const int64_t framesAhead = audioStream->getFramesWritten() - timestamp.value().position;
+
+    return timestamp.value().timestamp
+            + static_cast<int64_t>(framesAhead * kNanosPerSecond / mSampleRate);
 }
 
+// Constructor or mStreamMutex held
 void AudioRoot::createStream() noexcept
 {
+    // References the stream about to be replaced
+    mLatencyTuner = nullptr;
+
+    // No sample rate requested, the stream opens at the device native rate and Oboe does not
+    // have to resample in the mixer
     oboe::AudioStreamBuilder builder;
     builder.setDirection(oboe::Direction::Output)
             ->setPerformanceMode(oboe::PerformanceMode::LowLatency)
             ->setSharingMode(oboe::SharingMode::Exclusive)
             ->setFormat(oboe::AudioFormat::Float)
             ->setChannelCount(kChannelCount)
-            ->setSampleRate(kSampleRate)
             ->setDataCallback(this)
             ->setErrorCallback(this);
 
@@ -157,40 +411,80 @@ void AudioRoot::createStream() noexcept
 
     if (result != oboe::Result::OK) {
         LOG_E(LOG_TAG, "AudioRoot failed to create stream. Error: %s", oboe::convertToText(result));
+        return;
+    }
+
+    const double sampleRate = mAudioStream->getSampleRate();
+    const int32_t framesPerBurst = mAudioStream->getFramesPerBurst();
+    const int32_t capacity = mAudioStream->getBufferCapacityInFrames();
+
+    // Largest callback the stream can deliver, rounded down to whole bursts
+    int32_t blockSize = std::min(capacity > 0 ? capacity : kMaxFramesPerBlock, kMaxFramesPerBlock);
+
+    if (framesPerBurst > 0) {
+        blockSize = std::max(framesPerBurst, blockSize / framesPerBurst * framesPerBurst);
+    }
+
+    LOG_I(LOG_TAG, "AudioRoot stream opened at %d Hz, burst %d, capacity %d frames",
+          static_cast<int>(sampleRate), framesPerBurst, capacity);
+
+    mLatencyTuner = std::make_unique<oboe::LatencyTuner>(*mAudioStream);
+
+    if ((sampleRate != mSampleRate) || (blockSize != mBlockSize)) {
+        mSampleRate = sampleRate;
+        mBlockSize = blockSize;
+        mAudioBuffer.setSize(kChannelCount, mBlockSize);
+        clampFixedBlockSize();
+        prepareGraph();
+    }
+
+    if (mInputEnabled) {
+        mInput.open(static_cast<int32_t>(sampleRate), kChannelCount, mBlockSize);
+    }
+}
+
+// A fixed block size accepted for the previous stream may not fit in the new one
+void AudioRoot::clampFixedBlockSize() noexcept
+{
+    const int32_t fixedBlockSize = mBlockSizeAdapter.getBlockSize();
+
+    if (fixedBlockSize <= mBlockSize) {
+        return;
+    }
+
+    // Largest power of two not above the stream block size
+    int32_t blockSize = juce::nextPowerOfTwo(mBlockSize + 1) / 2;
+
+    if (blockSize < kMinFixedBlockSize) {
+        blockSize = 0;
+    }
+
+    LOG_I(LOG_TAG, "AudioRoot fixed block size %d does not fit the stream, now %d",
+          static_cast<int>(fixedBlockSize), static_cast<int>(blockSize));
+
+    mBlockSizeAdapter.setBlockSize(blockSize);
+}
+
+void AudioRoot::prepareGraph() noexcept
+{
+    AudioGraph* graph = mGraph.load();
+
+    if (graph != nullptr) {
+        graph->prepareToPlay(mSampleRate, mBlockSize);
     }
 }
 
 // MIDI events are currently not sample accurate
-void AudioRoot::processMidi(juce::MidiBuffer& inBuffer) noexcept
+void AudioRoot::processMidi(juce::MidiBuffer& inBuffer, AudioGraph* graph) noexcept
 {
-    uint8_t midiBytes[kMaxMidiReadBufferBytes];
-    int32_t opcode;
-    size_t numBytesReceived;
-    int64_t timestamp;
-    int32_t numMessages;
-
-    for (int i = 0; i < kMaxMidiPorts; ++i) {
-        bool receiveMidi = true;
-
-        if (mMidiSource[i].port != nullptr) {
-            if (mMidiSource[i].isOpen) {
-                while (receiveMidi) {
-                    numMessages = AMidiOutputPort_receive(mMidiSource[i].port, &opcode, midiBytes,
-                                                          sizeof(midiBytes), &numBytesReceived,
-                                                          &timestamp);
-                    if (numMessages == 1) {
-                        inBuffer.addEvent(midiBytes,
-                                          static_cast<int>(numBytesReceived), /*sampleNumber*/0);
-                    } else {
-                        if (numMessages < 0) {
-                            LOG_E(LOG_TAG, "AudioRoot error receiving data from MIDI port");
-                        }
-                        receiveMidi = false;
-                    }
-                }
-            } else {
-                AMidiOutputPort_close(mMidiSource[i].port);
-                mMidiSource[i].port = nullptr;
+    {
+        // Contended only while a Java thread changes ports or routes, events stay queued in the
+        // ports until the next callback
+        const juce::SpinLock::ScopedTryLockType sourcesLock(mMidiSourcesLock);
+
+        if (sourcesLock.isLocked()) {
+            for (int i = 0; i < mNumMidiSources; ++i) {
+                receiveMidi(mMidiSources[i], inBuffer, graph);
             }
         }
     }
@@ -202,11 +496,64 @@ void AudioRoot::processMidi(juce::MidiBuffer& inBuffer) noexcept
     }
 }
 
+// Routing happens here so nodes never see, and never have to filter, events meant for others
+void AudioRoot::receiveMidi(const MidiSource& source, juce::MidiBuffer& inBuffer,
+                            AudioGraph* graph) noexcept
+{
+    uint8_t midiBytes[kMaxMidiReadBufferBytes];
+    int32_t opcode;
+    size_t numBytesReceived;
+    int64_t timestamp;
+    ssize_t numMessages;
+
+    while ((numMessages = AMidiOutputPort_receive(source.port, &opcode, midiBytes,
+                                                  sizeof(midiBytes), &numBytesReceived,
+                                                  &timestamp)) == 1) {
+        if ((opcode != AMIDI_OPCODE_DATA) || (numBytesReceived == 0)) {
+            continue;
+        }
+
+        // System messages have no channel and always go to the graph MIDI input
+        const bool hasChannel = (midiBytes[0] & 0xF0) != 0xF0;
+        const int inletIndex = hasChannel ? source.routes[midiBytes[0] & 0x0F] : -1;
+        MidiInlet* inlet = (graph != nullptr) ? graph->getMidiInlet(inletIndex) : nullptr;
+
+        juce::MidiBuffer& dest = inlet != nullptr ? inlet->getEvents() : inBuffer;
+        dest.addEvent(midiBytes, static_cast<int>(numBytesReceived), /*sampleNumber*/0);
+    }
+
+    if (numMessages < 0) {
+        LOG_E(LOG_TAG, "AudioRoot error receiving data from MIDI port");
+    }
+}
+
 void AudioRoot::onErrorAfterClose(oboe::AudioStream* /* audioStream */, oboe::Result /* error */)
 {
+    // Oboe error thread. A Java thread may hold the stream mutex for as long as the graph takes
+    // to prepare, the reopen waits for it on a thread of its own.
+    if (mReopenPending.exchange(true)) {
+        return; // Not started yet, it opens a new stream anyway
+    }
+
+    // Already past the point it could block on anything but the stream mutex
+    if (mReopenThread.joinable()) {
+        mReopenThread.join();
+    }
+
+    mReopenThread = std::thread([this]() { reopenStream(); });
+}
+
+void AudioRoot::reopenStream() noexcept
+{
+    std::lock_guard<std::mutex> lock(mStreamMutex);
+    mReopenPending = false;
+
+    // Output is closed so no callback can be reading the input, reopen both as a pair
+    mInput.close();
     createStream();
 
-    if (mAudioStreamStarted) {
+    if (mAudioStreamStarted && (mAudioStream != nullptr)) {
+        mInput.start();
         mAudioStream->requestStart();
     }
 }
@@ -241,6 +588,26 @@ Java_im_taqs_maqam_AudioRoot_jniQueueMidi(JNIEnv *env, jobject thiz, jbyteArray
     AudioRoot::fromJava(env, thiz)->queueMidiEvent(event);
 }
 
+extern "C"
+JNIEXPORT void JNICALL
+Java_im_taqs_maqam_AudioRoot_jniRouteMidi(JNIEnv *env, jobject thiz, jint device_id,
+                                          jint port_number, jint channel, jobject sink)
+{
+    try {
+        AudioRoot::fromJava(env, thiz)->routeMidi(device_id, port_number, channel,
+                                                  AudioNode::fromJava(env, sink));
+    } catch (const std::exception& e) {
+        env->ThrowNew(env->FindClass("im/taqs/maqam/Library$Exception"), e.what());
+    }
+}
+
+extern "C"
+JNIEXPORT void JNICALL
+Java_im_taqs_maqam_AudioRoot_jniClearMidiRoutes(JNIEnv *env, jobject thiz)
+{
+    AudioRoot::fromJava(env, thiz)->clearMidiRoutes();
+}
+
 extern "C"
 JNIEXPORT void JNICALL
 Java_im_taqs_maqam_AudioRoot_jniStartStream(JNIEnv *env, jobject thiz)
@@ -255,9 +622,153 @@ Java_im_taqs_maqam_AudioRoot_jniStopStream(JNIEnv *env, jobject thiz)
     AudioRoot::fromJava(env, thiz)->stopStream();
 }
 
+extern "C"
+JNIEXPORT void JNICALL
+Java_im_taqs_maqam_AudioRoot_jniSetInputEnabled(JNIEnv *env, jobject thiz, jboolean enabled)
+{
+    AudioRoot::fromJava(env, thiz)->setInputEnabled(enabled);
+}
+
+extern "C"
+JNIEXPORT void JNICALL
+Java_im_taqs_maqam_AudioRoot_jniSetFixedBlockSize(JNIEnv *env, jobject thiz, jint block_size)
+{
+    try {
+        AudioRoot::fromJava(env, thiz)->setFixedBlockSize(block_size);
+    } catch (const std::exception& e) {
+        env->ThrowNew(env->FindClass("im/taqs/maqam/Library$Exception"), e.what());
+    }
+}
+
+extern "C"
+JNIEXPORT jint JNICALL
+Java_im_taqs_maqam_AudioRoot_jniGetFixedBlockSize(JNIEnv *env, jobject thiz)
+{
+    return AudioRoot::fromJava(env, thiz)->getFixedBlockSize();
+}
+
+extern "C"
+JNIEXPORT jint JNICALL
+Java_im_taqs_maqam_AudioRoot_jniGetExtraLatencyFrames(JNIEnv *env, jobject thiz)
+{
+    return AudioRoot::fromJava(env, thiz)->getExtraLatencyFrames();
+}
+
+extern "C"
+JNIEXPORT jlongArray JNICALL
+Java_im_taqs_maqam_AudioRoot_jniGetThreadPolicyStats(JNIEnv *env, jobject thiz)
+{
+    const ThreadPolicy::Stats stats = AudioRoot::fromJava(env, thiz)->getThreadPolicyStats();
+
+    // Same order as AudioRoot.ThreadPolicyStats
+    const jlong values[] = {
+        stats.isFifo, stats.isAffinitySet, stats.hasPerformanceHint, stats.numCallbacks,
+        stats.numCallbacksOffFastCores, stats.maxWorkNanos
+    };
+    constexpr auto size = static_cast<jsize>(std::size(values));
+
+    jlongArray result = env->NewLongArray(size);
+    env->SetLongArrayRegion(result, 0, size, values);
+
+    return result;
+}
+
 extern "C"
 JNIEXPORT void JNICALL
 Java_im_taqs_maqam_AudioRoot_jniSetGraph(JNIEnv *env, jobject thiz, jobject graph)
 {
     AudioRoot::fromJava(env, thiz)->setGraph(AudioGraph::fromJava(env, graph));
 }
+
+extern "C"
+JNIEXPORT void JNICALL
+Java_im_taqs_maqam_AudioRoot_jniTransportPlay(JNIEnv *env, jobject thiz)
+{
+    try {
+        AudioRoot::fromJava(env, thiz)->getTransport().play();
+    } catch (const std::exception& e) {
+        env->ThrowNew(env->FindClass("im/taqs/maqam/Library$Exception"), e.what());
+    }
+}
+
+extern "C"
+JNIEXPORT void JNICALL
+Java_im_taqs_maqam_AudioRoot_jniTransportStop(JNIEnv *env, jobject thiz)
+{
+    try {
+        AudioRoot::fromJava(env, thiz)->getTransport().stop();
+    } catch (const std::exception& e) {
+        env->ThrowNew(env->FindClass("im/taqs/maqam/Library$Exception"), e.what());
+    }
+}
+
+extern "C"
+JNIEXPORT jboolean JNICALL
+Java_im_taqs_maqam_AudioRoot_jniTransportIsPlaying(JNIEnv *env, jobject thiz)
+{
+    return AudioRoot::fromJava(env, thiz)->getTransport().isPlaying();
+}
+
+extern "C"
+JNIEXPORT void JNICALL
+Java_im_taqs_maqam_AudioRoot_jniTransportSetTempo(JNIEnv *env, jobject thiz, jdouble bpm)
+{
+    try {
+        AudioRoot::fromJava(env, thiz)->getTransport().setTempo(bpm);
+    } catch (const std::exception& e) {
+        env->ThrowNew(env->FindClass("im/taqs/maqam/Library$Exception"), e.what());
+    }
+}
+
+extern "C"
+JNIEXPORT jdouble JNICALL
+Java_im_taqs_maqam_AudioRoot_jniTransportGetTempo(JNIEnv *env, jobject thiz)
+{
+    return AudioRoot::fromJava(env, thiz)->getTransport().getTempo();
+}
+
+extern "C"
+JNIEXPORT void JNICALL
+Java_im_taqs_maqam_AudioRoot_jniTransportSetTimeSignature(JNIEnv *env, jobject thiz,
+                                                          jint numerator, jint denominator)
+{
+    try {
+        AudioRoot::fromJava(env, thiz)->getTransport().setTimeSignature(numerator, denominator);
+    } catch (const std::exception& e) {
+        env->ThrowNew(env->FindClass("im/taqs/maqam/Library$Exception"), e.what());
+    }
+}
+
+extern "C"
+JNIEXPORT jintArray JNICALL
+Java_im_taqs_maqam_AudioRoot_jniTransportGetTimeSignature(JNIEnv *env, jobject thiz)
+{
+    const Transport& transport = AudioRoot::fromJava(env, thiz)->getTransport();
+    const jint values[] = {
+        transport.getTimeSignatureNumerator(), transport.getTimeSignatureDenominator()
+    };
+
+    jintArray result = env->NewIntArray(2);
+    env->SetIntArrayRegion(result, 0, 2, values);
+
+    return result;
+}
+
+extern "C"
+JNIEXPORT void JNICALL
+Java_im_taqs_maqam_AudioRoot_jniTransportSetPosition(JNIEnv *env, jobject thiz,
+                                                     jdouble quarter_notes)
+{
+    try {
+        AudioRoot::fromJava(env, thiz)->getTransport().setPpqPosition(quarter_notes);
+    } catch (const std::exception& e) {
+        env->ThrowNew(env->FindClass("im/taqs/maqam/Library$Exception"), e.what());
+    }
+}
+
+extern "C"
+JNIEXPORT jdouble JNICALL
+Java_im_taqs_maqam_AudioRoot_jniTransportGetPosition(JNIEnv *env, jobject thiz)
+{
+    return AudioRoot::fromJava(env, thiz)->getTransport().getPpqPosition();
+}
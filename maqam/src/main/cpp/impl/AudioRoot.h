@@ -9,8 +9,11 @@
 #define AUDIOROOT_H
 
 #include <atomic>
+#include <map>
 #include <memory>
 #include <mutex>
+#include <thread>
+#include <tuple>
 
 #include <jni.h>
 #include <AMidi/AMidi.h>
@@ -19,14 +22,24 @@
 #include <ring_buffer/ring_buffer.h>
 
 #include "AudioGraph.h"
+#include "BlockSizeAdapter.h"
+#include "DuplexInput.h"
+#include "MidiOutput.h"
+#include "ThreadPolicy.h"
+#include "Transport.h"
 
 namespace maqam {
 
 struct MidiSource
 {
-    int id;
-    std::atomic_bool isOpen;
-    std::atomic<AMidiOutputPort*> port;
+    static constexpr int kNumChannels = 16;
+
+    int              deviceId;
+    int              portNumber;
+    AMidiOutputPort* port;
+
+    // Per channel index into the graph MIDI inlets, -1 sends to the graph MIDI input
+    int routes[kNumChannels];
 };
 
 // juce::MidiMessage not suitable for Ring_Buffer
@@ -41,27 +54,52 @@ struct MidiEvent
 class AudioRoot : public oboe::AudioStreamDataCallback, public oboe::AudioStreamErrorCallback
 {
 public:
-    static constexpr int kMaxMidiPorts           = 16;
+    static constexpr int kMaxMidiPorts           = 32;
     static constexpr int kMaxMidiReadBufferBytes = 3;
     static constexpr int kMidiEventQueueSize     = 128 * sizeof(MidiEvent);
+    static constexpr int kMidiBufferReservedSize = 4096;
 
+    // Upper bound for the graph block size, the actual size is derived from the opened stream
     static constexpr int32_t kMaxFramesPerBlock = 8192;
-    static constexpr int32_t kSampleRate        = 48000;
+    // Used until a stream opens, the stream runs at the device native rate
+    static constexpr int32_t kDefaultSampleRate = 48000;
     static constexpr int32_t kChannelCount      = oboe::ChannelCount::Stereo;
 
+    static constexpr int32_t kMinFixedBlockSize = 16;
+
     AudioRoot();
+    ~AudioRoot();
 
     static AudioRoot* fromJava(JNIEnv *env, jobject thiz) noexcept;
 
     void setGraph(AudioGraph* graph) noexcept;
 
+    // Stream must be stopped
+    void setInputEnabled(bool enabled) noexcept;
+
+    // Renders the graph in blocks of exactly blockSize frames, 0 renders at the callback size.
+    // A reopened stream with smaller callbacks lowers it to the largest size that still fits.
+    void setFixedBlockSize(int32_t blockSize);
+    int32_t getFixedBlockSize() const noexcept { return mBlockSizeAdapter.getBlockSize(); }
+    int32_t getExtraLatencyFrames() const noexcept { return mBlockSizeAdapter.getLatencyFrames(); }
+
     void connectMidiDevice(int id, AMidiDevice* midiDevice) noexcept;
     void disconnectMidiDevice(int id) noexcept;
     void queueMidiEvent(const MidiEvent& event) noexcept;
 
+    // Events from a device port, on one channel 0-15 or all channels if -1, go only to sink
+    // instead of the graph MIDI input. Routes are cleared when the graph changes.
+    void routeMidi(int deviceId, int portNumber, int channel, AudioNode* sink);
+    void clearMidiRoutes() noexcept;
+
     void startStream() noexcept;
     void stopStream() noexcept;
 
+    ThreadPolicy::Stats getThreadPolicyStats() const noexcept { return mThreadPolicy.getStats(); }
+
+    // Play head of the current graph, advances only while the stream runs
+    Transport& getTransport() noexcept { return mTransport; }
+
 protected:
     oboe::DataCallbackResult
     onAudioReady(oboe::AudioStream *audioStream, void *audioData, int32_t numFrames);
@@ -70,18 +108,61 @@ protected:
 
 private:
     void createStream() noexcept;
-    void processMidi(juce::MidiBuffer& inBuffer) noexcept;
-
-    MidiSource  mMidiSource[kMaxMidiPorts];
-    std::mutex  mMidiSourceMutex;
-    Ring_Buffer mMidiQueue;
+    void reopenStream() noexcept;
+    void clampFixedBlockSize() noexcept;
+    void prepareGraph() noexcept;
+    void renderBlock(AudioGraph* graph, float* samples, int32_t numFrames) noexcept;
+    void processMidi(juce::MidiBuffer& inBuffer, AudioGraph* graph) noexcept;
+    void receiveMidi(const MidiSource& source, juce::MidiBuffer& inBuffer,
+                     AudioGraph* graph) noexcept;
+    void applyMidiRoutes(MidiSource& source) const noexcept;
+    int64_t getPresentationTimeNanos(oboe::AudioStream* audioStream) noexcept;
+
+    static constexpr int64_t kNanosPerSecond = 1000000000;
+
+    // (device id, port number, channel) to MIDI inlet index
+    using MidiRouteMap = std::map<std::tuple<int, int, int>, int>;
+
+    // Sources are kept compact so the audio thread only polls open ports. Java threads serialize
+    // on the mutex, the spin lock guards the array against the audio thread which only tries it.
+    MidiSource     mMidiSources[kMaxMidiPorts];
+    int            mNumMidiSources;
+    std::mutex     mMidiSourceMutex;
+    juce::SpinLock mMidiSourcesLock;
+    MidiRouteMap   mMidiRoutes;
+    Ring_Buffer    mMidiQueue;
+    MidiOutput     mMidiOutput;
 
     juce::AudioBuffer<float> mAudioBuffer;
+    juce::MidiBuffer         mMidiBuffer;
+
+    // Fixed block size mode, events not rendered yet at offsets from the next block start
+    juce::MidiBuffer mPendingMidi;
+    juce::MidiBuffer mPendingMidiScratch;
 
     bool mAudioStreamStarted;
+    bool mInputEnabled;
+
+    DuplexInput      mInput;
+    BlockSizeAdapter mBlockSizeAdapter;
+    ThreadPolicy     mThreadPolicy;
+    Transport        mTransport;
 
     std::shared_ptr<oboe::AudioStream>      mAudioStream;
-    std::atomic<juce::AudioProcessorGraph*> mGraph;
+    std::unique_ptr<oboe::LatencyTuner>     mLatencyTuner;
+    std::atomic<AudioGraph*>                mGraph;
+
+    // Held by Java threads and the reopen thread while they use the stream or prepare the graph
+    std::mutex        mStreamMutex;
+    std::thread       mReopenThread;
+    std::atomic<bool> mReopenPending;
+
+    // Change while the stream is closed, with mStreamMutex held
+    std::atomic<double>  mSampleRate;
+    std::atomic<int32_t> mBlockSize;
+
+    // Audio thread, presentation time of the block being rendered
+    int64_t mBlockTimeNanos;
 
 };
 
@@ -0,0 +1,105 @@
+//
+// Maqam - Mobile App Quick Audio & MIDI
+//
+// SPDX-FileCopyrightText: 2024 TAQS.IM <contact@taqs.im>
+// SPDX-License-Identifier: MIT
+//
+
+#ifndef BLOCKSIZEADAPTER_H
+#define BLOCKSIZEADAPTER_H
+
+#include <algorithm>
+#include <atomic>
+#include <vector>
+
+namespace maqam {
+
+/**
+ * Turns variable size device callbacks into fixed size render calls. Whole blocks are rendered
+ * ahead into an interleaved buffer and handed out as the device asks for them, so output is not
+ * delayed but events and input reach the graph up to one block late. Events are kept at a
+ * constant delay of one block by placing them at getArrivalOffset(). Single threaded except for
+ * setBlockSize(), a new size takes effect on the audio thread once the pending frames are played.
+ */
+class BlockSizeAdapter
+{
+public:
+    static constexpr int32_t kMaxBlockSize = 1024;
+
+    explicit BlockSizeAdapter(int32_t numChannels)
+        : mNumChannels(numChannels)
+        , mBuffer(static_cast<size_t>(numChannels * kMaxBlockSize), 0)
+        , mRequestedBlockSize(0)
+        , mBlockSize(0)
+        , mReadPosition(0)
+    {}
+
+    // Any thread, 0 disables
+    void setBlockSize(int32_t blockSize) noexcept
+    {
+        mRequestedBlockSize = std::clamp(blockSize, 0, kMaxBlockSize);
+    }
+
+    int32_t getBlockSize() const noexcept { return mRequestedBlockSize; }
+
+    // Audio thread, size of the blocks rendered now, lags getBlockSize() during a change
+    int32_t getActiveBlockSize() const noexcept { return mBlockSize; }
+
+    // Delay between a MIDI event arriving and the frame it is rendered at
+    int32_t getLatencyFrames() const noexcept { return mRequestedBlockSize; }
+
+    // Audio thread, between update() and process(). Offset from the start of the next rendered
+    // block for events arriving at the start of the current callback. Goes up to getBlockSize(),
+    // events at or past the block size belong to the block after.
+    int32_t getArrivalOffset() const noexcept { return mReadPosition; }
+
+    // Audio thread, applies a pending size change and returns true if process() should be used
+    bool update() noexcept
+    {
+        const int32_t requested = mRequestedBlockSize;
+
+        if ((requested != mBlockSize) && (mReadPosition >= mBlockSize)) {
+            mBlockSize = requested;
+            mReadPosition = requested;
+        }
+
+        return mBlockSize > 0;
+    }
+
+    // Audio thread, calls renderFunction(float* interleaved, int32_t numFrames) with exactly
+    // getBlockSize() frames as many times as needed to fill dest
+    template<class RenderFunction>
+    void process(float* dest, int32_t numFrames, RenderFunction&& renderFunction) noexcept
+    {
+        int32_t numWritten = 0;
+
+        while (numWritten < numFrames) {
+            if (mReadPosition == mBlockSize) {
+                renderFunction(mBuffer.data(), mBlockSize);
+                mReadPosition = 0;
+            }
+
+            const int32_t n = std::min(mBlockSize - mReadPosition, numFrames - numWritten);
+
+            std::copy_n(mBuffer.data() + mReadPosition * mNumChannels, n * mNumChannels,
+                        dest + numWritten * mNumChannels);
+
+            mReadPosition += n;
+            numWritten += n;
+        }
+    }
+
+private:
+    const int32_t      mNumChannels;
+    std::vector<float> mBuffer;
+
+    std::atomic<int32_t> mRequestedBlockSize;
+
+    int32_t mBlockSize;
+    int32_t mReadPosition;
+
+};
+
+} // maqam
+
+#endif // BLOCKSIZEADAPTER_H
@@ -0,0 +1,144 @@
+//
+// Maqam - Mobile App Quick Audio & MIDI
+//
+// SPDX-FileCopyrightText: 2024 TAQS.IM <contact@taqs.im>
+// SPDX-License-Identifier: MIT
+//
+
+#include <algorithm>
+
+#include "DuplexInput.h"
+#include "Interleave.h"
+#include "log.h"
+
+using namespace maqam;
+
+DuplexInput::DuplexInput() noexcept
+    : mChannelCount(0)
+    , mMaxFramesPerBlock(0)
+    , mCallbackCount(0)
+{}
+
+DuplexInput::~DuplexInput()
+{
+    close();
+}
+
+bool DuplexInput::open(int32_t sampleRate, int32_t channelCount, int32_t maxFramesPerBlock) noexcept
+{
+    close();
+
+    // Mono microphones are upmixed by Oboe, a mismatching device rate is resampled by Oboe
+    oboe::AudioStreamBuilder builder;
+    builder.setDirection(oboe::Direction::Input)
+            ->setPerformanceMode(oboe::PerformanceMode::LowLatency)
+            ->setSharingMode(oboe::SharingMode::Exclusive)
+            ->setFormat(oboe::AudioFormat::Float)
+            ->setChannelCount(channelCount)
+            ->setSampleRate(sampleRate)
+            ->setInputPreset(oboe::InputPreset::VoicePerformance)
+            ->setFormatConversionAllowed(true)
+            ->setChannelConversionAllowed(true)
+            ->setSampleRateConversionQuality(oboe::SampleRateConversionQuality::Medium);
+
+    const oboe::Result result = builder.openStream(mStream);
+
+    if (result != oboe::Result::OK) {
+        LOG_E(LOG_TAG, "DuplexInput failed to create stream. Error: %s", oboe::convertToText(result));
+        mStream = nullptr;
+        return false;
+    }
+
+    mChannelCount = channelCount;
+    mMaxFramesPerBlock = maxFramesPerBlock;
+    mInterleaved.assign(static_cast<size_t>(channelCount * maxFramesPerBlock), 0);
+
+    return true;
+}
+
+void DuplexInput::close() noexcept
+{
+    if (mStream != nullptr) {
+        mStream->close();
+        mStream = nullptr;
+    }
+}
+
+void DuplexInput::start() noexcept
+{
+    if (mStream != nullptr) {
+        mCallbackCount = 0;
+        mStream->requestStart();
+    }
+}
+
+void DuplexInput::stop() noexcept
+{
+    if (mStream != nullptr) {
+        mStream->requestStop();
+    }
+}
+
+void DuplexInput::read(juce::AudioBuffer<float>& buffer, int32_t numFrames) noexcept
+{
+    const int numChannels = std::min(buffer.getNumChannels(), static_cast<int>(mChannelCount));
+
+    if ((mStream == nullptr) || (numFrames > mMaxFramesPerBlock)) {
+        buffer.clear(0, numFrames);
+        return;
+    }
+
+    if (mCallbackCount < kNumCallbacksToDrain) {
+        ++mCallbackCount;
+        discard(mMaxFramesPerBlock * kNumCallbacksToDrain);
+        buffer.clear(0, numFrames);
+        return;
+    }
+
+    const oboe::ResultWithValue<int32_t> result = mStream->read(mInterleaved.data(), numFrames,
+                                                                /*timeoutNanoseconds*/0);
+    const int32_t numRead = result ? result.value() : 0;
+
+    if ((numChannels == 2) && (mChannelCount == 2)) {
+        deinterleaveStereo(mInterleaved.data(), buffer.getWritePointer(0),
+                           buffer.getWritePointer(1), numRead);
+    } else {
+        using Format = juce::AudioData::Format<juce::AudioData::Float32,
+                                               juce::AudioData::NativeEndian>;
+
+        juce::AudioData::deinterleaveSamples(
+            juce::AudioData::InterleavedSource<Format> { mInterleaved.data(), mChannelCount },
+            juce::AudioData::NonInterleavedDest<Format> { buffer.getArrayOfWritePointers(),
+                                                          numChannels },
+            numRead
+        );
+    }
+
+    // Input running behind the output clock
+    if (numRead < numFrames) {
+        buffer.clear(numRead, numFrames - numRead);
+        return;
+    }
+
+    // Input running ahead of the output clock
+    const oboe::ResultWithValue<int32_t> available = mStream->getAvailableFrames();
+    const int32_t maxQueued = numFrames + kDriftWindowBursts * mStream->getFramesPerBurst();
+
+    if (available && (available.value() > maxQueued)) {
+        discard(available.value() - numFrames);
+    }
+}
+
+void DuplexInput::discard(int32_t numFrames) noexcept
+{
+    while (numFrames > 0) {
+        const oboe::ResultWithValue<int32_t> result = mStream->read(mInterleaved.data(),
+                std::min(numFrames, mMaxFramesPerBlock), /*timeoutNanoseconds*/0);
+
+        if (! result || (result.value() == 0)) {
+            break;
+        }
+
+        numFrames -= result.value();
+    }
+}
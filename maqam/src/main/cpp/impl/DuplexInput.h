@@ -0,0 +1,64 @@
+//
+// Maqam - Mobile App Quick Audio & MIDI
+//
+// SPDX-FileCopyrightText: 2024 TAQS.IM <contact@taqs.im>
+// SPDX-License-Identifier: MIT
+//
+
+#ifndef DUPLEXINPUT_H
+#define DUPLEXINPUT_H
+
+#include <memory>
+#include <vector>
+
+#include <oboe/Oboe.h>
+#include <juce_audio_basics/juce_audio_basics.h>
+
+namespace maqam {
+
+/**
+ * Input side of a full-duplex pair, read from the output stream data callback the same way
+ * oboe::FullDuplexStream does. The input stream has no callback of its own, its internal lock-free
+ * buffer acts as the FIFO between both clocks. Reads never block. A short read is padded with
+ * silence, and frames queued beyond a small window are dropped so clock drift between the input
+ * and output devices cannot accumulate into latency.
+ */
+class DuplexInput
+{
+public:
+    // Startup spikes are discarded until the input settles, same as oboe::FullDuplexStream
+    static constexpr int kNumCallbacksToDrain = 20;
+
+    // Frames allowed to queue on top of one callback worth of frames
+    static constexpr int kDriftWindowBursts = 2;
+
+    DuplexInput() noexcept;
+    ~DuplexInput();
+
+    // Not thread safe, output stream must be stopped
+    bool open(int32_t sampleRate, int32_t channelCount, int32_t maxFramesPerBlock) noexcept;
+    void close() noexcept;
+
+    bool isOpen() const noexcept { return mStream != nullptr; }
+
+    void start() noexcept;
+    void stop() noexcept;
+
+    // Audio thread, writes numFrames to the first channels of buffer
+    void read(juce::AudioBuffer<float>& buffer, int32_t numFrames) noexcept;
+
+private:
+    void discard(int32_t numFrames) noexcept;
+
+    std::shared_ptr<oboe::AudioStream> mStream;
+    std::vector<float>                 mInterleaved;
+
+    int32_t mChannelCount;
+    int32_t mMaxFramesPerBlock;
+    int     mCallbackCount;
+
+};
+
+} // maqam
+
+#endif // DUPLEXINPUT_H
@@ -0,0 +1,78 @@
+//
+// Maqam - Mobile App Quick Audio & MIDI
+//
+// SPDX-FileCopyrightText: 2024 TAQS.IM <contact@taqs.im>
+// SPDX-License-Identifier: MIT
+//
+
+#ifndef INTERLEAVE_H
+#define INTERLEAVE_H
+
+#include <cstdint>
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#elif defined(__SSE__)
+#include <xmmintrin.h>
+#endif
+
+namespace maqam {
+
+// Writes L R L R ... into dest. Unaligned loads and stores, the Oboe buffer has no alignment
+// guarantees beyond the sample size.
+inline void interleaveStereo(const float* left, const float* right, float* dest,
+                             int32_t numFrames) noexcept
+{
+    int32_t i = 0;
+
+#if defined(__ARM_NEON)
+    for (; i + 4 <= numFrames; i += 4) {
+        float32x4x2_t frames;
+        frames.val[0] = vld1q_f32(left + i);
+        frames.val[1] = vld1q_f32(right + i);
+        vst2q_f32(dest + 2 * i, frames);
+    }
+#elif defined(__SSE__)
+    for (; i + 4 <= numFrames; i += 4) {
+        const __m128 l = _mm_loadu_ps(left + i);
+        const __m128 r = _mm_loadu_ps(right + i);
+        _mm_storeu_ps(dest + 2 * i, _mm_unpacklo_ps(l, r));
+        _mm_storeu_ps(dest + 2 * i + 4, _mm_unpackhi_ps(l, r));
+    }
+#endif
+
+    for (; i < numFrames; ++i) {
+        dest[2 * i] = left[i];
+        dest[2 * i + 1] = right[i];
+    }
+}
+
+inline void deinterleaveStereo(const float* source, float* left, float* right,
+                               int32_t numFrames) noexcept
+{
+    int32_t i = 0;
+
+#if defined(__ARM_NEON)
+    for (; i + 4 <= numFrames; i += 4) {
+        const float32x4x2_t frames = vld2q_f32(source + 2 * i);
+        vst1q_f32(left + i, frames.val[0]);
+        vst1q_f32(right + i, frames.val[1]);
+    }
+#elif defined(__SSE__)
+    for (; i + 4 <= numFrames; i += 4) {
+        const __m128 a = _mm_loadu_ps(source + 2 * i);
+        const __m128 b = _mm_loadu_ps(source + 2 * i + 4);
+        _mm_storeu_ps(left + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+        _mm_storeu_ps(right + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+    }
+#endif
+
+    for (; i < numFrames; ++i) {
+        left[i] = source[2 * i];
+        right[i] = source[2 * i + 1];
+    }
+}
+
+} // maqam
+
+#endif // INTERLEAVE_H
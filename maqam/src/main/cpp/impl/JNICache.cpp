@@ -0,0 +1,141 @@
+//
+// Maqam - Mobile App Quick Audio & MIDI
+//
+// SPDX-FileCopyrightText: 2024 TAQS.IM <contact@taqs.im>
+// SPDX-License-Identifier: MIT
+//
+
+#include <cstring>
+
+#include "JNICache.h"
+#include "AudioNode.h"
+#include "NativeWrapper.h"
+
+using namespace maqam;
+
+JavaVM*             JNICache::sJVM = nullptr;
+jclass              JNICache::sStringClass = nullptr;
+jclass              JNICache::sClasses[kNumMethods] = {};
+jmethodID           JNICache::sMethods[kNumMethods] = {};
+JNICache::LongField JNICache::sLongFields[kMaxLongFields] = {};
+int                 JNICache::sNumLongFields = 0;
+
+namespace {
+
+struct MethodSignature
+{
+    const char* className;
+    const char* name;
+    const char* signature;
+};
+
+// Same order as JNICache::Method
+constexpr MethodSignature kMethodSignatures[] = {
+    { "java/lang/Class", "getName", "()Ljava/lang/String;" },
+    { "im/taqs/maqam/AudioNode", "jniOnPropertiesChanged", "([Ljava/lang/String;[F)V" }
+};
+
+// Detaches on thread exit whatever getEnv() attached
+struct ThreadAttachment
+{
+    JavaVM* jvm = nullptr;
+    JNIEnv* env = nullptr;
+
+    ~ThreadAttachment()
+    {
+        if (jvm != nullptr) {
+            jvm->DetachCurrentThread();
+        }
+    }
+};
+
+thread_local ThreadAttachment tAttachment;
+
+} // namespace
+
+void JNICache::init(JNIEnv *env)
+{
+    if (sJVM != nullptr) {
+        return;
+    }
+
+    env->GetJavaVM(&sJVM);
+
+    for (int i = 0; i < kNumMethods; ++i) {
+        jclass clazz = env->FindClass(kMethodSignatures[i].className);
+        sClasses[i] = static_cast<jclass>(env->NewGlobalRef(clazz));
+        sMethods[i] = env->GetMethodID(clazz, kMethodSignatures[i].name,
+                                       kMethodSignatures[i].signature);
+        env->DeleteLocalRef(clazz);
+    }
+
+    jclass stringClass = env->FindClass("java/lang/String");
+    sStringClass = static_cast<jclass>(env->NewGlobalRef(stringClass));
+    env->DeleteLocalRef(stringClass);
+
+    jclass nativeWrapperClass = env->FindClass("im/taqs/maqam/impl/NativeWrapper");
+    addLongField(env, nativeWrapperClass, NativeWrapper::kDefaultImplFieldName);
+    env->DeleteLocalRef(nativeWrapperClass);
+
+    jclass audioNodeClass = env->FindClass("im/taqs/maqam/AudioNode");
+    addLongField(env, audioNodeClass, AudioNode::kDSPFieldName);
+    env->DeleteLocalRef(audioNodeClass);
+}
+
+JNIEnv* JNICache::getEnv() noexcept
+{
+    if (tAttachment.env != nullptr) {
+        return tAttachment.env;
+    }
+
+    JNIEnv* env = nullptr;
+    const jint result = sJVM->GetEnv(reinterpret_cast<void**>(&env), JNI_VERSION_1_6);
+
+    if (result == JNI_EDETACHED) {
+        JavaVMAttachArgs args;
+        args.version = JNI_VERSION_1_6;
+        args.name = nullptr;
+        args.group = nullptr;
+
+#if defined(__ANDROID__)
+        const jint attached = sJVM->AttachCurrentThread(&env, &args);
+#else
+        // Desktop jni.h declares the env as void**, the host tests build against it
+        const jint attached = sJVM->AttachCurrentThread(reinterpret_cast<void**>(&env), &args);
+#endif
+
+        if (attached != JNI_OK) {
+            return nullptr;
+        }
+
+        tAttachment.jvm = sJVM;
+    } else if (result != JNI_OK) {
+        return nullptr;
+    }
+
+    tAttachment.env = env;
+
+    return env;
+}
+
+jfieldID JNICache::getLongFieldID(JNIEnv *env, jobject obj, const char* name) noexcept
+{
+    for (int i = 0; i < sNumLongFields; ++i) {
+        if (std::strcmp(sLongFields[i].name, name) == 0) {
+            return sLongFields[i].id;
+        }
+    }
+
+    jclass clazz = env->GetObjectClass(obj);
+    jfieldID id = env->GetFieldID(clazz, name, "J");
+    env->DeleteLocalRef(clazz);
+
+    return id;
+}
+
+void JNICache::addLongField(JNIEnv *env, jclass clazz, const char* name)
+{
+    if (sNumLongFields < kMaxLongFields) {
+        sLongFields[sNumLongFields++] = { name, env->GetFieldID(clazz, name, "J") };
+    }
+}
@@ -0,0 +1,66 @@
+//
+// Maqam - Mobile App Quick Audio & MIDI
+//
+// SPDX-FileCopyrightText: 2024 TAQS.IM <contact@taqs.im>
+// SPDX-License-Identifier: MIT
+//
+
+#ifndef JNICACHE_H
+#define JNICACHE_H
+
+#include <jni.h>
+
+namespace maqam {
+
+/**
+ * Java classes, fields and methods used by the library, resolved once in init() so JNI entry
+ * points and callbacks into Java do not pay for GetObjectClass() and Get*ID() on every call.
+ * IDs stay valid for the lifetime of the classes, classes are held as global references.
+ */
+class JNICache
+{
+public:
+    enum Method
+    {
+        kClassGetName,
+        kAudioNodeOnPropertiesChanged,
+        kNumMethods
+    };
+
+    // Call from a Java thread, FindClass() only sees app classes there
+    static void init(JNIEnv *env);
+
+    // Env for the calling thread. Native threads are attached on first use and stay attached until
+    // they exit instead of attaching and detaching around every callback.
+    static JNIEnv* getEnv() noexcept;
+
+    // Falls back to a lookup for fields that were not known to init()
+    static jfieldID getLongFieldID(JNIEnv *env, jobject obj, const char* name) noexcept;
+
+    static jmethodID getMethodID(Method method) noexcept { return sMethods[method]; }
+
+    static jclass getStringClass() noexcept { return sStringClass; }
+
+private:
+    struct LongField
+    {
+        const char* name;
+        jfieldID    id;
+    };
+
+    static constexpr int kMaxLongFields = 4;
+
+    static void addLongField(JNIEnv *env, jclass clazz, const char* name);
+
+    static JavaVM*   sJVM;
+    static jclass    sStringClass;
+    static jclass    sClasses[kNumMethods];
+    static jmethodID sMethods[kNumMethods];
+    static LongField sLongFields[kMaxLongFields];
+    static int       sNumLongFields;
+
+};
+
+} // maqam
+
+#endif // JNICACHE_H
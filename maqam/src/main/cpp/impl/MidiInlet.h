@@ -0,0 +1,73 @@
+//
+// Maqam - Mobile App Quick Audio & MIDI
+//
+// SPDX-FileCopyrightText: 2024 TAQS.IM <contact@taqs.im>
+// SPDX-License-Identifier: MIT
+//
+
+#ifndef MIDIINLET_H
+#define MIDIINLET_H
+
+#include <juce_audio_processors/juce_audio_processors.h>
+
+namespace maqam {
+
+/**
+ * Graph node that feeds routed MIDI to a single other node. AudioRoot adds events while ingesting
+ * MIDI input, the next render emits them and clears the queue. Both happen on the audio thread.
+ */
+class MidiInlet : public juce::AudioProcessor
+{
+public:
+    // Same reserve as the AudioRoot MIDI buffer, addEvent() does not allocate in practice
+    static constexpr int kReservedSize = 4096;
+
+    MidiInlet()
+        : AudioProcessor(BusesProperties())
+    {
+        mEvents.ensureSize(kReservedSize);
+    }
+
+    // Audio thread
+    juce::MidiBuffer& getEvents() noexcept { return mEvents; }
+
+    const juce::String getName() const override { return "MidiInlet"; }
+
+    void prepareToPlay(double sampleRate, int maximumExpectedSamplesPerBlock) override {}
+    void releaseResources() override {}
+
+    void processBlock(juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages) override
+    {
+        midiMessages.clear();
+        midiMessages.addEvents(mEvents, 0, -1, 0);
+        mEvents.clear();
+    }
+
+    double getTailLengthSeconds() const override { return 0; }
+
+    bool acceptsMidi() const override { return false; }
+    bool producesMidi() const override { return true; }
+    bool isMidiEffect() const override { return true; }
+
+    juce::AudioProcessorEditor* createEditor() override { return nullptr; }
+    bool hasEditor() const override { return false; }
+
+    int getNumPrograms() override { return 1; }
+    int getCurrentProgram() override { return 0; }
+    void setCurrentProgram(int index) override {}
+    const juce::String getProgramName(int index) override { return {}; }
+    void changeProgramName(int index, const juce::String& newName) override {}
+
+    void getStateInformation(juce::MemoryBlock& destData) override {}
+    void setStateInformation(const void* data, int sizeInBytes) override {}
+
+private:
+    juce::MidiBuffer mEvents;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MidiInlet)
+
+};
+
+} // maqam
+
+#endif // MIDIINLET_H
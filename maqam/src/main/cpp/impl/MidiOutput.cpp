@@ -0,0 +1,137 @@
+//
+// Maqam - Mobile App Quick Audio & MIDI
+//
+// SPDX-FileCopyrightText: 2024 TAQS.IM <contact@taqs.im>
+// SPDX-License-Identifier: MIT
+//
+
+#include <cstring>
+
+#include "MidiOutput.h"
+#include "log.h"
+
+using namespace maqam;
+
+constexpr static int kStopTimeoutMillis = 1000;
+
+MidiOutput::MidiOutput()
+    : Thread("Maqam MIDI output")
+    , mQueue(kQueueSize * sizeof(Event))
+    , mPorts {}
+    , mNumOpenPorts(0)
+{
+    sem_init(&mQueueSemaphore, /*pshared*/0, /*value*/0);
+}
+
+MidiOutput::~MidiOutput()
+{
+    // run() waits on the semaphore, not on the juce::Thread event stopThread() signals
+    signalThreadShouldExit();
+    sem_post(&mQueueSemaphore);
+    stopThread(kStopTimeoutMillis);
+    sem_destroy(&mQueueSemaphore);
+
+    for (Port& port : mPorts) {
+        if (port.port != nullptr) {
+            AMidiInputPort_close(port.port);
+        }
+    }
+}
+
+void MidiOutput::openPort(int id, AMidiDevice* midiDevice) noexcept
+{
+    std::lock_guard<std::mutex> lock(mPortsMutex);
+
+    const auto numPorts = static_cast<int32_t>(AMidiDevice_getNumInputPorts(midiDevice));
+    int32_t portNumber = 0;
+
+    for (Port& port : mPorts) {
+        if (portNumber == numPorts) {
+            break;
+        }
+
+        if (port.port != nullptr) {
+            continue;
+        }
+
+        if (AMidiInputPort_open(midiDevice, portNumber, &port.port) == AMEDIA_OK) {
+            port.id = id;
+            ++mNumOpenPorts;
+        } else {
+            LOG_E(LOG_TAG, "MidiOutput could not open sink MIDI port [%d:%d]", id, portNumber);
+            port.port = nullptr;
+        }
+
+        ++portNumber;
+    }
+
+    if (portNumber < numPorts) {
+        LOG_E(LOG_TAG, "MidiOutput no more sink MIDI ports available");
+    }
+
+    if ((mNumOpenPorts > 0) && ! isThreadRunning()) {
+        startThread(juce::Thread::Priority::high);
+    }
+}
+
+void MidiOutput::closePort(int id) noexcept
+{
+    std::lock_guard<std::mutex> lock(mPortsMutex);
+
+    for (Port& port : mPorts) {
+        if ((port.port != nullptr) && (port.id == id)) {
+            AMidiInputPort_close(port.port);
+            port.port = nullptr;
+            --mNumOpenPorts;
+        }
+    }
+}
+
+void MidiOutput::queue(const juce::MidiBuffer& buffer, int64_t blockTimeNanos,
+                       double sampleRate) noexcept
+{
+    const double nanosPerFrame = 1e9 / sampleRate;
+    bool queued = false;
+
+    for (const juce::MidiMessageMetadata metadata : buffer) {
+        if (metadata.numBytes > kMaxSizeBytes) {
+            continue;
+        }
+
+        Event event {};
+        event.timestampNanos = blockTimeNanos
+                + static_cast<int64_t>(metadata.samplePosition * nanosPerFrame);
+        event.size = metadata.numBytes;
+        std::memcpy(event.bytes, metadata.data, static_cast<size_t>(metadata.numBytes));
+
+        // Full queue means the writer is stalled, dropping is the only realtime safe option
+        queued |= mQueue.put(event);
+    }
+
+    if (queued) {
+        sem_post(&mQueueSemaphore);
+    }
+}
+
+void MidiOutput::run()
+{
+    Event event {};
+
+    while (! threadShouldExit()) {
+        if (sem_wait(&mQueueSemaphore) != 0) {
+            continue; // EINTR
+        }
+
+        std::lock_guard<std::mutex> lock(mPortsMutex);
+
+        while (mQueue.get(event)) {
+            for (Port& port : mPorts) {
+                if (port.port != nullptr) {
+                    AMidiInputPort_sendWithTimestamp(port.port, event.bytes,
+                                                     static_cast<size_t>(event.size),
+                                                     event.timestampNanos);
+                }
+            }
+        }
+    }
+}
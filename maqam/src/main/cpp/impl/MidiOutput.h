@@ -0,0 +1,77 @@
+//
+// Maqam - Mobile App Quick Audio & MIDI
+//
+// SPDX-FileCopyrightText: 2024 TAQS.IM <contact@taqs.im>
+// SPDX-License-Identifier: MIT
+//
+
+#ifndef MIDIOUTPUT_H
+#define MIDIOUTPUT_H
+
+#include <atomic>
+#include <mutex>
+
+#include <semaphore.h>
+
+#include <AMidi/AMidi.h>
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <ring_buffer/ring_buffer.h>
+
+namespace maqam {
+
+/**
+ * Sends the graph MIDI output to external devices. The audio thread only timestamps events and
+ * queues them, a dedicated thread writes them to the AMidi input ports. Events carry the time their
+ * frame is presented by the audio device so the Android MIDI service delivers them with the same
+ * timing as the audio, regardless of when the writer thread gets scheduled. The writer is woken
+ * with a POSIX semaphore, sem_post() never takes a lock unlike juce::Thread::notify().
+ */
+class MidiOutput : private juce::Thread
+{
+public:
+    static constexpr int kMaxPorts     = 32;
+    static constexpr int kMaxSizeBytes = 3;
+    static constexpr int kQueueSize    = 256;
+
+    MidiOutput();
+    ~MidiOutput() override;
+
+    // Java thread, opens all input ports of the device
+    void openPort(int id, AMidiDevice* midiDevice) noexcept;
+    void closePort(int id) noexcept;
+
+    // Any thread, lets the audio thread skip timestamping when nobody listens
+    bool isActive() const noexcept { return mNumOpenPorts > 0; }
+
+    // Audio thread, events longer than kMaxSizeBytes (SysEx) are dropped
+    void queue(const juce::MidiBuffer& buffer, int64_t blockTimeNanos, double sampleRate) noexcept;
+
+private:
+    struct Event
+    {
+        int64_t timestampNanos;
+        int     size;
+        uint8_t bytes[kMaxSizeBytes];
+    };
+
+    struct Port
+    {
+        int             id;
+        AMidiInputPort* port;
+    };
+
+    // juce::Thread
+    void run() override;
+
+    Ring_Buffer mQueue;
+    sem_t       mQueueSemaphore;
+
+    std::mutex       mPortsMutex;
+    Port             mPorts[kMaxPorts];
+    std::atomic<int> mNumOpenPorts;
+
+};
+
+} // maqam
+
+#endif // MIDIOUTPUT_H
@@ -17,12 +17,12 @@ NativeWrapper::ImplDeleterMap NativeWrapper::sImplDeleter;
 // https://stackoverflow.com/questions/61870844/how-to-obtain-the-name-of-a-java-class-from-its-corresponding-jclass
 std::string NativeWrapper::getClassName(JNIEnv *env, /*Class<T>*/jclass clazz)
 {
-    jclass cls = env->GetObjectClass(clazz); // Class<Class>
-    jmethodID mid = env->GetMethodID(cls, "getName", "()Ljava/lang/String;");
+    jmethodID mid = JNICache::getMethodID(JNICache::kClassGetName);
     auto jClsName = reinterpret_cast<jstring>(env->CallObjectMethod(clazz, mid));
     const char* cClsName = env->GetStringUTFChars(jClsName, nullptr);
     std::string clsName (cClsName);
     env->ReleaseStringUTFChars(jClsName, cClsName);
+    env->DeleteLocalRef(jClsName);
     return clsName;
 }
 
@@ -42,7 +42,7 @@ void NativeWrapper::createImpl(JNIEnv *env, jobject thiz, const char* field)
     }
 
     const auto impl = reinterpret_cast<jlong>(factory());
-    env->SetLongField(thiz, env->GetFieldID(env->GetObjectClass(thiz), field, "J"), impl);
+    env->SetLongField(thiz, JNICache::getLongFieldID(env, thiz, field), impl);
 }
 
 void NativeWrapper::deleteImpl(JNIEnv *env, jobject thiz, const char* field)
@@ -61,7 +61,7 @@ void NativeWrapper::deleteImpl(JNIEnv *env, jobject thiz, const char* field)
     }
 
     deleter(NativeWrapper::getImpl<void*>(env, thiz));
-    env->SetLongField(thiz, env->GetFieldID(env->GetObjectClass(thiz), field, "J"), 0LL);
+    env->SetLongField(thiz, JNICache::getLongFieldID(env, thiz, field), 0LL);
 }
 
 extern "C"
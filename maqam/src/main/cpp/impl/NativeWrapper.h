@@ -15,11 +15,15 @@
 
 #include <jni.h>
 
+#include "JNICache.h"
+
 namespace maqam {
 
 class NativeWrapper
 {
 public:
+    static constexpr const char* kDefaultImplFieldName = "impl";
+
     using ImplFactoryFunction = void*(*)();
     using ImplDeleterFunction = void(*)(void*);
 
@@ -52,14 +56,11 @@ public:
             return nullptr;
         }
 
-        const jlong impl = env->GetLongField(thiz, env->GetFieldID(env->GetObjectClass(thiz),
-                                                                   field, "J"));
+        const jlong impl = env->GetLongField(thiz, JNICache::getLongFieldID(env, thiz, field));
         return reinterpret_cast<T*>(impl);
     }
 
 private:
-    static constexpr const char* kDefaultImplFieldName = "impl";
-
     static inline std::string implKey(const std::string& javaClassName,
                                       const std::string& field)
     {
@@ -0,0 +1,99 @@
+//
+// Maqam - Mobile App Quick Audio & MIDI
+//
+// SPDX-FileCopyrightText: 2024 TAQS.IM <contact@taqs.im>
+// SPDX-License-Identifier: MIT
+//
+
+#include <algorithm>
+
+#include "NotificationHub.h"
+#include "AudioNode.h"
+#include "JNICache.h"
+
+using namespace maqam;
+
+constexpr static int kStopTimeoutMillis = 1000;
+
+NotificationHub& NotificationHub::getInstance()
+{
+    static NotificationHub instance;
+    return instance;
+}
+
+NotificationHub::NotificationHub()
+    : Thread("Maqam notifications")
+    , mIntervalMillis(1000 / kDefaultRateHz)
+{}
+
+NotificationHub::~NotificationHub()
+{
+    stopThread(kStopTimeoutMillis);
+}
+
+void NotificationHub::setRate(int hz) noexcept
+{
+    mIntervalMillis = 1000 / juce::jlimit(1, kMaxRateHz, hz);
+    notify();
+}
+
+void NotificationHub::addNode(AudioNode* node)
+{
+    {
+        std::lock_guard<std::mutex> lock(mNodesMutex);
+        mNodes.push_back(node);
+    }
+
+    if (! isThreadRunning()) {
+        startThread(juce::Thread::Priority::low);
+    }
+}
+
+void NotificationHub::removeNode(AudioNode* node)
+{
+    // Blocks until a collection in progress for this node is done, delivery holds its own
+    // reference to the Kotlin object
+    std::lock_guard<std::mutex> lock(mNodesMutex);
+    mNodes.erase(std::remove(mNodes.begin(), mNodes.end(), node), mNodes.end());
+}
+
+void NotificationHub::run()
+{
+    JNIEnv* env = JNICache::getEnv();
+
+    if (env == nullptr) {
+        return;
+    }
+
+    while (! threadShouldExit()) {
+        wait(mIntervalMillis);
+
+        size_t numNotifications = 0;
+
+        {
+            std::lock_guard<std::mutex> lock(mNodesMutex);
+
+            if (mNotifications.size() < mNodes.size()) {
+                mNotifications.resize(mNodes.size());
+            }
+
+            for (AudioNode* node : mNodes) {
+                Notification& notification = mNotifications[numNotifications];
+
+                if (node->collectNotifications(notification.ids, notification.values)) {
+                    notification.owner = env->NewLocalRef(node->getOwner());
+                    numNotifications++;
+                }
+            }
+        }
+
+        // Calling Kotlin with the lock held deadlocks when a listener removes a node
+        for (size_t i = 0; i < numNotifications; ++i) {
+            const Notification& notification = mNotifications[i];
+
+            AudioNode::deliverNotifications(env, notification.owner, notification.ids,
+                                            notification.values);
+            env->DeleteLocalRef(notification.owner);
+        }
+    }
+}
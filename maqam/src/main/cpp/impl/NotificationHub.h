@@ -0,0 +1,70 @@
+//
+// Maqam - Mobile App Quick Audio & MIDI
+//
+// SPDX-FileCopyrightText: 2024 TAQS.IM <contact@taqs.im>
+// SPDX-License-Identifier: MIT
+//
+
+#ifndef NOTIFICATIONHUB_H
+#define NOTIFICATIONHUB_H
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <jni.h>
+
+#include <juce_core/juce_core.h>
+
+namespace maqam {
+
+class AudioNode;
+
+/**
+ * Delivers property change notifications from all nodes to Kotlin on a single background thread
+ * at a fixed rate. Nodes only flag what changed, any number of changes to the same property
+ * between two deliveries result in a single notification with the latest value. Changes are
+ * collected with the nodes lock held and delivered after releasing it, so Kotlin listeners are
+ * free to create or delete nodes.
+ */
+class NotificationHub : private juce::Thread
+{
+public:
+    static constexpr int kDefaultRateHz = 60;
+    static constexpr int kMaxRateHz     = 1000;
+
+    static NotificationHub& getInstance();
+
+    ~NotificationHub() override;
+
+    void setRate(int hz) noexcept;
+
+    void addNode(AudioNode* node);
+    void removeNode(AudioNode* node);
+
+private:
+    NotificationHub();
+
+    // juce::Thread
+    void run() override;
+
+    std::atomic<int> mIntervalMillis;
+
+    // Owner is a local reference of the notification thread
+    struct Notification
+    {
+        jobject            owner;
+        juce::StringArray  ids;
+        juce::Array<float> values;
+    };
+
+    std::mutex              mNodesMutex;
+    std::vector<AudioNode*> mNodes;
+
+    // Notification thread, kept between deliveries to reuse the storage
+    std::vector<Notification> mNotifications;
+
+};
+
+} // maqam
+
+#endif // NOTIFICATIONHUB_H
@@ -0,0 +1,213 @@
+//
+// Maqam - Mobile App Quick Audio & MIDI
+//
+// SPDX-FileCopyrightText: 2024 TAQS.IM <contact@taqs.im>
+// SPDX-License-Identifier: MIT
+//
+
+#include <algorithm>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+
+#include <juce_audio_formats/juce_audio_formats.h>
+
+#include "OfflineRenderer.h"
+#include "AudioRoot.h"
+#include "NativeWrapper.h"
+#include "RealtimeSanitizer.h"
+#include "Transport.h"
+
+using namespace maqam;
+
+OfflineRenderer* OfflineRenderer::fromJava(JNIEnv *env, jobject thiz) noexcept
+{
+    return NativeWrapper::getImpl<OfflineRenderer>(env, thiz);
+}
+
+void OfflineRenderer::addMidiEvent(int64_t frame, const uint8_t* data, int size)
+{
+    // juce::MidiBuffer positions are int, over 12 hours at 48 kHz
+    if ((frame < 0) || (frame > std::numeric_limits<int>::max())) {
+        throw std::invalid_argument("Invalid MIDI event frame");
+    }
+
+    mMidiEvents.addEvent(data, size, static_cast<int>(frame));
+}
+
+void OfflineRenderer::addParameterChange(int64_t frame, AudioNode* node, const juce::String& id,
+                                         float value)
+{
+    if (frame < 0) {
+        throw std::invalid_argument("Invalid parameter change frame");
+    }
+
+    mParameterChanges.push_back({ frame, node, id, value });
+}
+
+void OfflineRenderer::clear() noexcept
+{
+    mMidiEvents.clear();
+    mParameterChanges.clear();
+}
+
+void OfflineRenderer::render(AudioGraph& graph, double sampleRate, int blockSize, double tempo,
+                             int numerator, int denominator, int64_t numFrames,
+                             const juce::File& file)
+{
+    // Plays from the first frame so tempo-synced nodes render the same every time
+    Transport transport;
+    transport.setTempo(tempo);
+    transport.setTimeSignature(numerator, denominator);
+    transport.play();
+
+    if ((blockSize <= 0) || (blockSize > AudioRoot::kMaxFramesPerBlock)) {
+        throw std::invalid_argument("Invalid block size");
+    }
+
+    if (! file.deleteFile()) {
+        throw std::runtime_error("Could not replace output file");
+    }
+
+    std::unique_ptr<juce::FileOutputStream> stream = file.createOutputStream();
+
+    if (stream == nullptr) {
+        throw std::runtime_error("Could not create output file");
+    }
+
+    juce::WavAudioFormat wav;
+    std::unique_ptr<juce::AudioFormatWriter> writer(wav.createWriterFor(stream.get(), sampleRate,
+        AudioRoot::kChannelCount, /*bitsPerSample*/32, /*metadataValues*/{}, /*quality*/0));
+
+    if (writer == nullptr) {
+        throw std::runtime_error("Could not create WAV writer");
+    }
+
+    // Owned by the writer now
+    stream.release();
+
+    std::stable_sort(mParameterChanges.begin(), mParameterChanges.end(),
+        [](const ParameterChange& a, const ParameterChange& b) { return a.frame < b.frame; });
+
+    // Nodes that hand work to other threads while live, like the convolution reverb tail, do it
+    // on this thread instead so the output does not depend on scheduling
+    graph.getAudioProcessorGraph().setNonRealtime(true);
+
+    // juce::AudioProcessorGraph skips preparing nodes when the settings did not change, releasing
+    // first resets delay lines, reverb tails and voices left over from a previous render
+    graph.releaseResources();
+    graph.prepareToPlay(sampleRate, blockSize);
+
+    // Restored after rendering, the graph may be assigned to a stopped AudioRoot
+    juce::AudioPlayHead* const playHead = graph.getAudioProcessorGraph().getPlayHead();
+    graph.setPlayHead(&transport);
+
+    juce::AudioBuffer<float> buffer(AudioRoot::kChannelCount, blockSize);
+    juce::MidiBuffer midiBuffer;
+    midiBuffer.ensureSize(AudioRoot::kMidiBufferReservedSize);
+    size_t nextChange = 0;
+
+    for (int64_t position = 0; position < numFrames; position += blockSize) {
+        const auto n = static_cast<int>(std::min<int64_t>(blockSize, numFrames - position));
+
+        // Parameters change at the start of the block containing their frame, same as live
+        while ((nextChange < mParameterChanges.size())
+                && (mParameterChanges[nextChange].frame < position + n)) {
+            const ParameterChange& change = mParameterChanges[nextChange++];
+            change.node->setParameterValue(change.id, change.value);
+        }
+
+        // MIDI is sample accurate
+        midiBuffer.clear();
+
+        if (position <= std::numeric_limits<int>::max() - n) {
+            midiBuffer.addEvents(mMidiEvents, static_cast<int>(position), n,
+                                 -static_cast<int>(position));
+        }
+
+        buffer.setSize(AudioRoot::kChannelCount, n, /*keepExistingContent=*/false,
+            /*clearExtraSpace=*/false, /*avoidReallocating=*/true);
+        buffer.clear();
+
+        {
+            const juce::ScopedLock lock(graph.getCallbackLock());
+
+            // Same rules as the audio callback, see RealtimeSanitizer
+            MAQAM_REALTIME_SCOPE;
+            transport.beginBlock(sampleRate);
+            graph.processBlock(buffer, midiBuffer);
+            transport.endBlock(n);
+        }
+
+        writer->writeFromAudioSampleBuffer(buffer, 0, n);
+    }
+
+    graph.setPlayHead(playHead);
+
+    // Prepared again so the nodes pick up the real-time setting before an AudioRoot plays them
+    graph.getAudioProcessorGraph().setNonRealtime(false);
+    graph.releaseResources();
+    graph.prepareToPlay(sampleRate, blockSize);
+}
+
+extern "C"
+JNIEXPORT void JNICALL
+Java_im_taqs_maqam_OfflineRenderer_jniAddMidiEvent(JNIEnv *env, jobject thiz, jlong frame,
+                                                   jbyteArray bytes)
+{
+    jbyte* data = env->GetByteArrayElements(bytes, nullptr);
+    const jsize size = env->GetArrayLength(bytes);
+
+    try {
+        OfflineRenderer::fromJava(env, thiz)->addMidiEvent(frame,
+            reinterpret_cast<const uint8_t*>(data), size);
+    } catch (const std::exception& e) {
+        env->ThrowNew(env->FindClass("im/taqs/maqam/Library$Exception"), e.what());
+    }
+
+    env->ReleaseByteArrayElements(bytes, data, JNI_ABORT);
+}
+
+extern "C"
+JNIEXPORT void JNICALL
+Java_im_taqs_maqam_OfflineRenderer_jniAddParameterChange(JNIEnv *env, jobject thiz, jlong frame,
+                                                         jobject node, jstring id, jfloat value)
+{
+    const char* cId = env->GetStringUTFChars(id, nullptr);
+
+    try {
+        OfflineRenderer::fromJava(env, thiz)->addParameterChange(frame,
+            AudioNode::fromJava(env, node), cId, value);
+    } catch (const std::exception& e) {
+        env->ThrowNew(env->FindClass("im/taqs/maqam/Library$Exception"), e.what());
+    }
+
+    env->ReleaseStringUTFChars(id, cId);
+}
+
+extern "C"
+JNIEXPORT void JNICALL
+Java_im_taqs_maqam_OfflineRenderer_jniClear(JNIEnv *env, jobject thiz)
+{
+    OfflineRenderer::fromJava(env, thiz)->clear();
+}
+
+extern "C"
+JNIEXPORT void JNICALL
+Java_im_taqs_maqam_OfflineRenderer_jniRender(JNIEnv *env, jobject thiz, jobject graph,
+                                             jint sample_rate, jint block_size, jdouble tempo,
+                                             jint numerator, jint denominator, jlong num_frames,
+                                             jstring path)
+{
+    const char* cPath = env->GetStringUTFChars(path, nullptr);
+
+    try {
+        OfflineRenderer::fromJava(env, thiz)->render(*AudioGraph::fromJava(env, graph),
+            sample_rate, block_size, tempo, numerator, denominator, num_frames,
+            juce::File(juce::CharPointer_UTF8(cPath)));
+    } catch (const std::exception& e) {
+        env->ThrowNew(env->FindClass("im/taqs/maqam/Library$Exception"), e.what());
+    }
+
+    env->ReleaseStringUTFChars(path, cPath);
+}
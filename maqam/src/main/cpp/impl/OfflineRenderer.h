@@ -0,0 +1,59 @@
+//
+// Maqam - Mobile App Quick Audio & MIDI
+//
+// SPDX-FileCopyrightText: 2024 TAQS.IM <contact@taqs.im>
+// SPDX-License-Identifier: MIT
+//
+
+#ifndef OFFLINERENDERER_H
+#define OFFLINERENDERER_H
+
+#include <cstdint>
+#include <vector>
+
+#include <jni.h>
+#include <juce_audio_processors/juce_audio_processors.h>
+
+#include "AudioGraph.h"
+#include "AudioNode.h"
+
+namespace maqam {
+
+/**
+ * Renders a graph without an audio device, as fast as possible, into a 32-bit float WAV file.
+ * Input is a script of MIDI events and parameter changes at absolute frame positions. Nodes are
+ * prepared again before rendering and soundpipe randomness is seeded the same way on every
+ * prepare, so the same script and settings always produce the same file.
+ */
+class OfflineRenderer
+{
+public:
+    OfflineRenderer() = default;
+
+    static OfflineRenderer* fromJava(JNIEnv *env, jobject thiz) noexcept;
+
+    void addMidiEvent(int64_t frame, const uint8_t* data, int size);
+    void addParameterChange(int64_t frame, AudioNode* node, const juce::String& id, float value);
+    void clear() noexcept;
+
+    // Blocking. The graph must not be assigned to a started AudioRoot at the same time.
+    void render(AudioGraph& graph, double sampleRate, int blockSize, double tempo, int numerator,
+                int denominator, int64_t numFrames, const juce::File& file);
+
+private:
+    struct ParameterChange
+    {
+        int64_t      frame;
+        AudioNode*   node;
+        juce::String id;
+        float        value;
+    };
+
+    juce::MidiBuffer             mMidiEvents;
+    std::vector<ParameterChange> mParameterChanges;
+
+};
+
+} // maqam
+
+#endif // OFFLINERENDERER_H
@@ -0,0 +1,202 @@
+//
+// Maqam - Mobile App Quick Audio & MIDI
+//
+// SPDX-FileCopyrightText: 2024 TAQS.IM <contact@taqs.im>
+// SPDX-License-Identifier: MIT
+//
+
+#include "PresetMorph.h"
+#include "AudioRoot.h"
+
+using namespace maqam;
+
+PresetMorph::PresetMorph() noexcept
+    : mPresets(std::make_shared<const PresetMap>())
+    , mMorphActive(false)
+    , mMorphChanged(false)
+    , mHasChanges(false)
+    , mTargetPosition(0)
+{
+    mPosition.reset(AudioRoot::kDefaultSampleRate, kSmoothingSeconds);
+}
+
+void PresetMorph::setParameters(const juce::Array<juce::AudioProcessorParameter*>& parameters)
+{
+    // Same FIXME as AudioNode, all parameters are assumed to be juce::AudioParameterFloat
+    mParameters.assign(parameters.begin(), parameters.end());
+    mDiscreteIndexes.clear();
+
+    for (size_t i = 0; i < mParameters.size(); ++i) {
+        if (isDiscrete(*mParameters[i])) {
+            mDiscreteIndexes.push_back(i);
+        }
+    }
+
+    const size_t size = mParameters.size();
+    mFrom.assign(size, 0);
+    mDelta.assign(size, 0);
+    mValues.assign(size, 0);
+    mChanged = std::make_unique<std::atomic<bool>[]>(size);
+
+    for (size_t i = 0; i < size; ++i) {
+        mChanged[i] = false;
+    }
+}
+
+void PresetMorph::prepare(double sampleRate) noexcept
+{
+    const juce::SpinLock::ScopedLockType lock(mMorphLock);
+    mPosition.reset(sampleRate, kSmoothingSeconds);
+    mPosition.setCurrentAndTargetValue(mTargetPosition);
+}
+
+void PresetMorph::storePreset(const juce::String& name)
+{
+    const std::lock_guard<std::mutex> lock(mPresetsMutex);
+    auto presets = std::make_shared<PresetMap>(*getPresets());
+
+    std::vector<float>& values = (*presets)[name];
+    values.resize(mParameters.size());
+
+    for (size_t i = 0; i < mParameters.size(); ++i) {
+        values[i] = mParameters[i]->getValue();
+    }
+
+    publishPresets(std::move(presets));
+}
+
+bool PresetMorph::removePreset(const juce::String& name)
+{
+    const std::lock_guard<std::mutex> lock(mPresetsMutex);
+    auto presets = std::make_shared<PresetMap>(*getPresets());
+
+    // An ongoing morph keeps working, it holds copies of the values
+    if (presets->erase(name) == 0) {
+        return false;
+    }
+
+    publishPresets(std::move(presets));
+
+    return true;
+}
+
+bool PresetMorph::recallPreset(const juce::String& name)
+{
+    const std::shared_ptr<const PresetMap> presets = getPresets();
+    const auto it = presets->find(name);
+
+    if (it == presets->end()) {
+        return false;
+    }
+
+    // Otherwise the next position change would override the recalled values
+    clearMorph();
+
+    for (size_t i = 0; i < mParameters.size(); ++i) {
+        mParameters[i]->setValueNotifyingHost(it->second[i]);
+    }
+
+    return true;
+}
+
+juce::StringArray PresetMorph::getPresetNames() const
+{
+    juce::StringArray names;
+
+    for (const auto& [name, values] : *getPresets()) {
+        names.add(name);
+    }
+
+    return names;
+}
+
+bool PresetMorph::setMorphPresets(const juce::String& from, const juce::String& to)
+{
+    const std::shared_ptr<const PresetMap> presets = getPresets();
+    const auto itFrom = presets->find(from);
+    const auto itTo = presets->find(to);
+
+    if ((itFrom == presets->end()) || (itTo == presets->end())) {
+        return false;
+    }
+
+    const int size = static_cast<int>(mParameters.size());
+
+    const juce::SpinLock::ScopedLockType lock(mMorphLock);
+
+    juce::FloatVectorOperations::copy(mFrom.data(), itFrom->second.data(), size);
+    juce::FloatVectorOperations::subtract(mDelta.data(), itTo->second.data(),
+                                          itFrom->second.data(), size);
+    mMorphActive = true;
+    mMorphChanged = true;
+
+    return true;
+}
+
+void PresetMorph::clearMorph() noexcept
+{
+    const juce::SpinLock::ScopedLockType lock(mMorphLock);
+    mMorphActive = false;
+}
+
+void PresetMorph::setPosition(float position) noexcept
+{
+    mTargetPosition = juce::jlimit(0.f, 1.f, position);
+}
+
+void PresetMorph::process(int numFrames) noexcept
+{
+    const juce::SpinLock::ScopedTryLockType lock(mMorphLock);
+
+    if (! lock.isLocked() || ! mMorphActive) {
+        return;
+    }
+
+    mPosition.setTargetValue(mTargetPosition);
+
+    // Idle morphs cost nothing and do not fight parameter changes made elsewhere
+    if (! mPosition.isSmoothing() && ! mMorphChanged) {
+        return;
+    }
+
+    mPosition.skip(numFrames);
+    mMorphChanged = false;
+
+    const float t = mPosition.getCurrentValue();
+    const int size = static_cast<int>(mParameters.size());
+
+    // from + t * (to - from)
+    juce::FloatVectorOperations::copy(mValues.data(), mFrom.data(), size);
+    juce::FloatVectorOperations::addWithMultiply(mValues.data(), mDelta.data(), t, size);
+
+    // In between values of a switch mean nothing, jump at the midpoint instead
+    for (size_t i : mDiscreteIndexes) {
+        mValues[i] = t < 0.5f ? mFrom[i] : mFrom[i] + mDelta[i];
+    }
+
+    for (int i = 0; i < size; ++i) {
+        juce::AudioProcessorParameter* parameter = mParameters[static_cast<size_t>(i)];
+
+        if (parameter->getValue() != mValues[static_cast<size_t>(i)]) {
+            parameter->setValue(mValues[static_cast<size_t>(i)]);
+            mChanged[static_cast<size_t>(i)] = true;
+            mHasChanges = true;
+        }
+    }
+}
+
+bool PresetMorph::isDiscrete(const juce::AudioProcessorParameter& parameter) noexcept
+{
+    return parameter.isDiscrete() || parameter.isBoolean()
+            || (parameter.getNumSteps() < juce::AudioProcessor::getDefaultNumParameterSteps());
+}
+
+std::shared_ptr<const PresetMorph::PresetMap> PresetMorph::getPresets() const noexcept
+{
+    return std::atomic_load(&mPresets);
+}
+
+void PresetMorph::publishPresets(std::shared_ptr<const PresetMap> presets) noexcept
+{
+    std::atomic_store(&mPresets, std::move(presets));
+}
@@ -0,0 +1,111 @@
+//
+// Maqam - Mobile App Quick Audio & MIDI
+//
+// SPDX-FileCopyrightText: 2024 TAQS.IM <contact@taqs.im>
+// SPDX-License-Identifier: MIT
+//
+
+#ifndef PRESETMORPH_H
+#define PRESETMORPH_H
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <juce_audio_processors/juce_audio_processors.h>
+
+namespace maqam {
+
+/**
+ * Named snapshots of the float parameters of a single node, and a morph between two of them
+ * driven by one position control. Snapshots hold normalized values so the morph is a plain lerp
+ * over one contiguous array, evaluated once per block on the audio thread. Discrete parameters,
+ * see isDiscrete(), are not interpolated and switch to the second preset halfway. Only parameters
+ * whose value actually changed are written back to the processor, with setValue() because
+ * setValueNotifyingHost() takes listener locks. Listeners hear about them from consumeChanges().
+ */
+class PresetMorph
+{
+public:
+    // Position changes are ramped over this time to avoid zipper noise
+    static constexpr double kSmoothingSeconds = 0.05;
+
+    PresetMorph() noexcept;
+
+    // Not thread safe, called once after the processor is created
+    void setParameters(const juce::Array<juce::AudioProcessorParameter*>& parameters);
+
+    // Not realtime
+    void prepare(double sampleRate) noexcept;
+
+    // Java thread
+    void storePreset(const juce::String& name);
+    bool removePreset(const juce::String& name);
+    bool recallPreset(const juce::String& name);
+    juce::StringArray getPresetNames() const;
+
+    // Java thread, starts morphing from the current position
+    bool setMorphPresets(const juce::String& from, const juce::String& to);
+    void clearMorph() noexcept;
+
+    // Any thread, 0 is the first preset and 1 the second
+    void setPosition(float position) noexcept;
+    float getPosition() const noexcept { return mTargetPosition; }
+
+    // Audio thread, call before the node renders
+    void process(int numFrames) noexcept;
+
+    // Not the audio thread, calls function for every parameter process() wrote since last time
+    template<class Function>
+    void consumeChanges(Function&& function)
+    {
+        if (! mHasChanges.exchange(false)) {
+            return;
+        }
+
+        for (size_t i = 0; i < mParameters.size(); ++i) {
+            if (mChanged[i].exchange(false)) {
+                function(*mParameters[i]);
+            }
+        }
+    }
+
+private:
+    using PresetMap = std::map<juce::String, std::vector<float>>;
+
+    // Bypass switches, factor indexes, see createSteppedParameter()
+    static bool isDiscrete(const juce::AudioProcessorParameter& parameter) noexcept;
+
+    std::shared_ptr<const PresetMap> getPresets() const noexcept;
+    void publishPresets(std::shared_ptr<const PresetMap> presets) noexcept;
+
+    std::vector<juce::AudioProcessorParameter*> mParameters;
+    std::vector<size_t>                         mDiscreteIndexes;
+
+    // Copy on write, the Java threads that change presets serialize on the mutex and swap in a
+    // new map atomically, readers keep whatever map they loaded without locking
+    std::mutex                       mPresetsMutex;
+    std::shared_ptr<const PresetMap> mPresets;
+
+    // Java thread holds it while replacing the morph, the audio thread only tries
+    juce::SpinLock     mMorphLock;
+    std::vector<float> mFrom;
+    std::vector<float> mDelta;
+    std::vector<float> mValues;
+    bool               mMorphActive;
+    bool               mMorphChanged;
+
+    // Set by process(), cleared by consumeChanges()
+    std::unique_ptr<std::atomic<bool>[]> mChanged;
+    std::atomic<bool>                    mHasChanges;
+
+    std::atomic<float>         mTargetPosition;
+    juce::SmoothedValue<float> mPosition;
+
+};
+
+} // maqam
+
+#endif // PRESETMORPH_H
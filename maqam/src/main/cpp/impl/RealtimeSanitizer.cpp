@@ -0,0 +1,299 @@
+//
+// Maqam - Mobile App Quick Audio & MIDI
+//
+// SPDX-FileCopyrightText: 2024 TAQS.IM <contact@taqs.im>
+// SPDX-License-Identifier: MIT
+//
+
+#include "RealtimeSanitizer.h"
+
+using namespace maqam;
+
+#if MAQAM_RT_SANITIZER
+
+#include <algorithm>
+#include <cstdarg>
+#include <cstdlib>
+#include <ctime>
+#include <dlfcn.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <unwind.h>
+
+#include "log.h"
+
+RealtimeSanitizer::Record RealtimeSanitizer::sRecords[kMaxRecords] = {};
+std::atomic<int>          RealtimeSanitizer::sNumViolations { 0 };
+std::atomic<int>          RealtimeSanitizer::sNumDumped { 0 };
+
+namespace {
+
+constexpr const char* kViolationNames[] = {
+    "malloc", "free", "pthread_mutex_lock", "pthread_cond_wait", "sleep", "write", "log"
+};
+
+thread_local int  tRealtimeDepth = 0;
+thread_local bool tChecking = false;
+
+struct Backtrace
+{
+    uintptr_t* frames;
+    int        maxFrames;
+    int        numFrames;
+};
+
+_Unwind_Reason_Code unwindCallback(_Unwind_Context* context, void* arg)
+{
+    auto* backtrace = static_cast<Backtrace*>(arg);
+    const uintptr_t pc = _Unwind_GetIP(context);
+
+    if (pc != 0) {
+        backtrace->frames[backtrace->numFrames++] = pc;
+    }
+
+    return backtrace->numFrames == backtrace->maxFrames ? _URC_END_OF_STACK : _URC_NO_REASON;
+}
+
+} // namespace
+
+RealtimeSanitizer::Scope::Scope() noexcept
+{
+    ++tRealtimeDepth;
+}
+
+RealtimeSanitizer::Scope::~Scope()
+{
+    --tRealtimeDepth;
+}
+
+void RealtimeSanitizer::check(Violation violation) noexcept
+{
+    if ((tRealtimeDepth == 0) || tChecking) {
+        return;
+    }
+
+    tChecking = true;
+
+    const int index = sNumViolations.fetch_add(1);
+
+    if (index < kMaxRecords) {
+        Record& record = sRecords[index];
+        Backtrace backtrace { record.frames, kMaxFrames, 0 };
+        _Unwind_Backtrace(unwindCallback, &backtrace);
+
+        record.violation = violation;
+        record.numFrames = backtrace.numFrames;
+        record.ready.store(true, std::memory_order_release);
+    }
+
+    tChecking = false;
+}
+
+int RealtimeSanitizer::dump() noexcept
+{
+    const int numViolations = sNumViolations;
+    const int numRecords = std::min(numViolations, kMaxRecords);
+
+    // Not a realtime scope, but keeps logging below from checking itself
+    tChecking = true;
+
+    int index = sNumDumped;
+
+    while (index < numRecords) {
+        const Record& record = sRecords[index];
+
+        if (! record.ready.load(std::memory_order_acquire)) {
+            break;
+        }
+
+        // Concurrent callers each claim different records, index is reloaded on failure
+        if (! sNumDumped.compare_exchange_weak(index, index + 1)) {
+            continue;
+        }
+
+        LOG_E(LOG_TAG, "Realtime violation #%d: %s", index, kViolationNames[record.violation]);
+
+        // Skips check() and the wrapper
+        for (int i = 2; i < record.numFrames; ++i) {
+            Dl_info info {};
+            const auto pc = reinterpret_cast<const void*>(record.frames[i]);
+
+            if ((dladdr(pc, &info) != 0) && (info.dli_fname != nullptr)) {
+                LOG_E(LOG_TAG, "  #%02d pc %p %s (%s+%td)", i - 2, pc, info.dli_fname,
+                      info.dli_sname != nullptr ? info.dli_sname : "?",
+                      static_cast<const char*>(pc) - static_cast<const char*>(info.dli_saddr));
+            } else {
+                LOG_E(LOG_TAG, "  #%02d pc %p", i - 2, pc);
+            }
+        }
+
+        ++index;
+    }
+
+    if (numViolations > kMaxRecords) {
+        LOG_E(LOG_TAG, "Realtime violations: %d, only the first %d have stack traces",
+              numViolations, kMaxRecords);
+    }
+
+    tChecking = false;
+
+    return numViolations;
+}
+
+//
+// Targets of the -Wl,--wrap options added by CMakeLists.txt
+//
+
+extern "C" {
+
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t count, size_t size);
+void* __real_realloc(void* ptr, size_t size);
+int   __real_posix_memalign(void** ptr, size_t alignment, size_t size);
+void  __real_free(void* ptr);
+int   __real_pthread_mutex_lock(pthread_mutex_t* mutex);
+int   __real_pthread_cond_wait(pthread_cond_t* cond, pthread_mutex_t* mutex);
+int   __real_pthread_cond_timedwait(pthread_cond_t* cond, pthread_mutex_t* mutex,
+                                    const timespec* abstime);
+int   __real_nanosleep(const timespec* duration, timespec* remaining);
+int   __real_usleep(useconds_t usec);
+ssize_t __real_write(int fd, const void* buf, size_t count);
+
+void* __wrap_malloc(size_t size)
+{
+    RealtimeSanitizer::check(RealtimeSanitizer::kMalloc);
+    return __real_malloc(size);
+}
+
+void* __wrap_calloc(size_t count, size_t size)
+{
+    RealtimeSanitizer::check(RealtimeSanitizer::kMalloc);
+    return __real_calloc(count, size);
+}
+
+void* __wrap_realloc(void* ptr, size_t size)
+{
+    RealtimeSanitizer::check(RealtimeSanitizer::kMalloc);
+    return __real_realloc(ptr, size);
+}
+
+int __wrap_posix_memalign(void** ptr, size_t alignment, size_t size)
+{
+    RealtimeSanitizer::check(RealtimeSanitizer::kMalloc);
+    return __real_posix_memalign(ptr, alignment, size);
+}
+
+void __wrap_free(void* ptr)
+{
+    if (ptr != nullptr) {
+        RealtimeSanitizer::check(RealtimeSanitizer::kFree);
+    }
+
+    __real_free(ptr);
+}
+
+int __wrap_pthread_mutex_lock(pthread_mutex_t* mutex)
+{
+    RealtimeSanitizer::check(RealtimeSanitizer::kMutexLock);
+    return __real_pthread_mutex_lock(mutex);
+}
+
+int __wrap_pthread_cond_wait(pthread_cond_t* cond, pthread_mutex_t* mutex)
+{
+    RealtimeSanitizer::check(RealtimeSanitizer::kConditionWait);
+    return __real_pthread_cond_wait(cond, mutex);
+}
+
+int __wrap_pthread_cond_timedwait(pthread_cond_t* cond, pthread_mutex_t* mutex,
+                                  const timespec* abstime)
+{
+    RealtimeSanitizer::check(RealtimeSanitizer::kConditionWait);
+    return __real_pthread_cond_timedwait(cond, mutex, abstime);
+}
+
+int __wrap_nanosleep(const timespec* duration, timespec* remaining)
+{
+    RealtimeSanitizer::check(RealtimeSanitizer::kSleep);
+    return __real_nanosleep(duration, remaining);
+}
+
+int __wrap_usleep(useconds_t usec)
+{
+    RealtimeSanitizer::check(RealtimeSanitizer::kSleep);
+    return __real_usleep(usec);
+}
+
+ssize_t __wrap_write(int fd, const void* buf, size_t count)
+{
+    RealtimeSanitizer::check(RealtimeSanitizer::kWrite);
+    return __real_write(fd, buf, count);
+}
+
+int __wrap___android_log_print(int prio, const char* tag, const char* fmt, ...)
+{
+    RealtimeSanitizer::check(RealtimeSanitizer::kLog);
+
+    va_list args;
+    va_start(args, fmt);
+    const int result = __android_log_vprint(prio, tag, fmt, args);
+    va_end(args);
+
+    return result;
+}
+
+} // extern "C"
+
+// libc++ is a shared library, its operator new does not go through the wrapped malloc. These
+// replacements are the ones libmaqam.so code binds to.
+
+void* operator new(size_t size)
+{
+    RealtimeSanitizer::check(RealtimeSanitizer::kMalloc);
+    void* ptr = __real_malloc(size == 0 ? 1 : size);
+
+    if (ptr == nullptr) {
+        std::abort();
+    }
+
+    return ptr;
+}
+
+void* operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void* ptr) noexcept
+{
+    __wrap_free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+    __wrap_free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept
+{
+    __wrap_free(ptr);
+}
+
+void operator delete[](void* ptr, size_t) noexcept
+{
+    __wrap_free(ptr);
+}
+
+#else
+
+RealtimeSanitizer::Scope::Scope() noexcept {}
+
+RealtimeSanitizer::Scope::~Scope() {}
+
+void RealtimeSanitizer::check(Violation) noexcept {}
+
+int RealtimeSanitizer::dump() noexcept
+{
+    return 0;
+}
+
+#endif // MAQAM_RT_SANITIZER
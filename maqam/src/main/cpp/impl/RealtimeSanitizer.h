@@ -0,0 +1,78 @@
+//
+// Maqam - Mobile App Quick Audio & MIDI
+//
+// SPDX-FileCopyrightText: 2024 TAQS.IM <contact@taqs.im>
+// SPDX-License-Identifier: MIT
+//
+
+#ifndef REALTIMESANITIZER_H
+#define REALTIMESANITIZER_H
+
+#include <atomic>
+#include <cstdint>
+
+namespace maqam {
+
+/**
+ * Debug aid enabled with the MAQAM_RT_SANITIZER CMake option. The linker redirects heap, mutex,
+ * sleep, write and log calls made by anything linked into libmaqam.so to wrappers that check
+ * whether the calling thread is inside a realtime scope. Violations are recorded with a stack
+ * trace into a fixed lock-free array and only symbolized and logged later by dump(), so recording
+ * itself does not break the rules it checks. Compiles to nothing when the option is off.
+ */
+class RealtimeSanitizer
+{
+public:
+    enum Violation
+    {
+        kMalloc,
+        kFree,
+        kMutexLock,
+        kConditionWait,
+        kSleep,
+        kWrite,
+        kLog,
+        kNumViolations
+    };
+
+    // Marks the calling thread realtime for the lifetime of the object, nests
+    class Scope
+    {
+    public:
+        Scope() noexcept;
+        ~Scope();
+    };
+
+    static void check(Violation violation) noexcept;
+
+    // Any thread but realtime, logs violations recorded since the last call. Returns the total
+    // count, always 0 when the sanitizer is not compiled in.
+    static int dump() noexcept;
+
+private:
+    static constexpr int kMaxRecords = 64;
+    static constexpr int kMaxFrames  = 16;
+
+    struct Record
+    {
+        std::atomic<bool> ready;
+        Violation         violation;
+        int               numFrames;
+        uintptr_t         frames[kMaxFrames];
+    };
+
+    static Record           sRecords[kMaxRecords];
+    static std::atomic<int> sNumViolations;
+    static std::atomic<int> sNumDumped;
+
+};
+
+} // maqam
+
+#if MAQAM_RT_SANITIZER
+#define MAQAM_REALTIME_SCOPE const maqam::RealtimeSanitizer::Scope realtimeSanitizerScope
+#else
+#define MAQAM_REALTIME_SCOPE
+#endif
+
+#endif // REALTIMESANITIZER_H
@@ -0,0 +1,246 @@
+//
+// Maqam - Mobile App Quick Audio & MIDI
+//
+// SPDX-FileCopyrightText: 2024 TAQS.IM <contact@taqs.im>
+// SPDX-License-Identifier: MIT
+//
+
+#include <algorithm>
+#include <climits>
+#include <cstdio>
+#include <ctime>
+#include <dlfcn.h>
+#include <unistd.h>
+
+#include "ThreadPolicy.h"
+#include "log.h"
+
+using namespace maqam;
+
+namespace {
+
+constexpr int64_t kNanosPerSecond = 1000000000;
+
+// android/performance_hint.h is API 33, minSdk is lower so the functions are looked up at runtime
+struct PerformanceHint
+{
+    using GetManager = void* (*)();
+    using CreateSession = void* (*)(void*, const int32_t*, size_t, int64_t);
+    using UpdateTarget = int (*)(void*, int64_t);
+    using ReportActual = int (*)(void*, int64_t);
+    using CloseSession = void (*)(void*);
+
+    GetManager    getManager = nullptr;
+    CreateSession createSession = nullptr;
+    UpdateTarget  updateTargetWorkDuration = nullptr;
+    ReportActual  reportActualWorkDuration = nullptr;
+    CloseSession  closeSession = nullptr;
+
+    static const PerformanceHint& getInstance()
+    {
+        static const PerformanceHint instance;
+        return instance;
+    }
+
+    bool isAvailable() const noexcept
+    {
+        return (getManager != nullptr) && (createSession != nullptr)
+               && (updateTargetWorkDuration != nullptr) && (reportActualWorkDuration != nullptr)
+               && (closeSession != nullptr);
+    }
+
+private:
+    PerformanceHint()
+    {
+        void* lib = dlopen("libandroid.so", RTLD_NOW | RTLD_LOCAL);
+
+        if (lib == nullptr) {
+            return;
+        }
+
+        getManager = reinterpret_cast<GetManager>(dlsym(lib, "APerformanceHint_getManager"));
+        createSession = reinterpret_cast<CreateSession>(
+                dlsym(lib, "APerformanceHint_createSession"));
+        updateTargetWorkDuration = reinterpret_cast<UpdateTarget>(
+                dlsym(lib, "APerformanceHint_updateTargetWorkDuration"));
+        reportActualWorkDuration = reinterpret_cast<ReportActual>(
+                dlsym(lib, "APerformanceHint_reportActualWorkDuration"));
+        closeSession = reinterpret_cast<CloseSession>(dlsym(lib, "APerformanceHint_closeSession"));
+    }
+};
+
+} // namespace
+
+ThreadPolicy::CallbackScope::CallbackScope(ThreadPolicy& policy, int32_t numFrames,
+                                           double sampleRate) noexcept
+    : mPolicy(policy)
+    , mStartNanos(nowNanos())
+{
+    const auto targetNanos = static_cast<int64_t>(numFrames * kNanosPerSecond / sampleRate);
+
+    if (! mPolicy.mHasThread || ! pthread_equal(mPolicy.mThread, pthread_self())) {
+        mPolicy.setUpThread(targetNanos);
+        mStartNanos = nowNanos();
+    } else if (targetNanos != mPolicy.mTargetNanos) {
+        mPolicy.setTarget(targetNanos);
+    }
+}
+
+ThreadPolicy::CallbackScope::~CallbackScope()
+{
+    mPolicy.reportWork(nowNanos() - mStartNanos);
+}
+
+ThreadPolicy::ThreadPolicy() noexcept
+    : mFastCores {}
+    , mHasFastCores(false)
+    , mThread {}
+    , mHasThread(false)
+    , mSession(nullptr)
+    , mTargetNanos(0)
+    , mIsFifo(false)
+    , mIsAffinitySet(false)
+    , mHasPerformanceHint(false)
+    , mNumCallbacks(0)
+    , mNumCallbacksOffFastCores(0)
+    , mMaxWorkNanos(0)
+{
+    mHasFastCores = findFastCores(mFastCores, kCpuSysfsRoot, sysconf(_SC_NPROCESSORS_CONF));
+}
+
+ThreadPolicy::~ThreadPolicy()
+{
+    if (mSession != nullptr) {
+        PerformanceHint::getInstance().closeSession(mSession);
+    }
+}
+
+ThreadPolicy::Stats ThreadPolicy::getStats() const noexcept
+{
+    return {
+        .isFifo = mIsFifo,
+        .isAffinitySet = mIsAffinitySet,
+        .hasPerformanceHint = mHasPerformanceHint,
+        .numCallbacks = mNumCallbacks,
+        .numCallbacksOffFastCores = mNumCallbacksOffFastCores,
+        .maxWorkNanos = mMaxWorkNanos
+    };
+}
+
+// Runs once per callback thread, Oboe starts a new one whenever the stream is reopened. Session
+// creation is a binder call, Oboe's own ADPF support does it from the callback in the same way.
+void ThreadPolicy::setUpThread(int64_t targetNanos) noexcept
+{
+    mThread = pthread_self();
+    mHasThread = true;
+
+    // AAudio MMAP streams already run SCHED_FIFO, apps are usually not allowed to request it
+    if (sched_getscheduler(0) != SCHED_FIFO) {
+        sched_param param { .sched_priority = kFifoPriority };
+        sched_setscheduler(0, SCHED_FIFO, &param);
+    }
+
+    mIsFifo = sched_getscheduler(0) == SCHED_FIFO;
+
+    mIsAffinitySet = mHasFastCores
+            && (sched_setaffinity(0, sizeof(mFastCores), &mFastCores) == 0);
+
+    const PerformanceHint& hint = PerformanceHint::getInstance();
+
+    if (hint.isAvailable()) {
+        if (mSession != nullptr) {
+            hint.closeSession(mSession);
+        }
+
+        const auto tid = static_cast<int32_t>(gettid());
+        mSession = hint.createSession(hint.getManager(), &tid, 1, targetNanos);
+    }
+
+    mHasPerformanceHint = mSession != nullptr;
+    mTargetNanos = targetNanos;
+}
+
+// Callback sizes rarely change, mostly when the latency tuner grows the buffer
+void ThreadPolicy::setTarget(int64_t targetNanos) noexcept
+{
+    mTargetNanos = targetNanos;
+
+    if (mSession != nullptr) {
+        PerformanceHint::getInstance().updateTargetWorkDuration(mSession, targetNanos);
+    }
+}
+
+void ThreadPolicy::reportWork(int64_t workNanos) noexcept
+{
+    mNumCallbacks.store(mNumCallbacks.load(std::memory_order_relaxed) + 1,
+                        std::memory_order_relaxed);
+
+    if (workNanos > mMaxWorkNanos.load(std::memory_order_relaxed)) {
+        mMaxWorkNanos.store(workNanos, std::memory_order_relaxed);
+    }
+
+    const int cpu = sched_getcpu();
+
+    if (mHasFastCores && (cpu >= 0) && ! CPU_ISSET(cpu, &mFastCores)) {
+        mNumCallbacksOffFastCores.store(
+                mNumCallbacksOffFastCores.load(std::memory_order_relaxed) + 1,
+                std::memory_order_relaxed);
+    }
+
+    if (mSession != nullptr) {
+        PerformanceHint::getInstance().reportActualWorkDuration(mSession, workNanos);
+    }
+}
+
+// Every core except those in the cluster with the lowest maximum frequency. Pinning to the single
+// fastest cluster would leave one or two cores for the whole app on phones with a prime core.
+bool ThreadPolicy::findFastCores(cpu_set_t& cores, const char* cpuRoot, long numCpus) noexcept
+{
+    numCpus = std::clamp(numCpus, 0L, static_cast<long>(CPU_SETSIZE));
+    long maxFreqs[CPU_SETSIZE] = {};
+    long lowest = 0;
+    long highest = 0;
+
+    for (long cpu = 0; cpu < numCpus; ++cpu) {
+        char path[PATH_MAX];
+        snprintf(path, sizeof(path), "%s/cpu%ld/cpufreq/cpuinfo_max_freq", cpuRoot, cpu);
+
+        FILE* file = fopen(path, "r");
+
+        if (file == nullptr) {
+            continue;
+        }
+
+        if (fscanf(file, "%ld", &maxFreqs[cpu]) == 1) {
+            lowest = (lowest == 0) ? maxFreqs[cpu] : std::min(lowest, maxFreqs[cpu]);
+            highest = std::max(highest, maxFreqs[cpu]);
+        }
+
+        fclose(file);
+    }
+
+    // Symmetric or unknown topology, nothing to gain
+    if (lowest == highest) {
+        return false;
+    }
+
+    CPU_ZERO(&cores);
+
+    for (long cpu = 0; cpu < numCpus; ++cpu) {
+        if (maxFreqs[cpu] > lowest) {
+            CPU_SET(static_cast<int>(cpu), &cores);
+        }
+    }
+
+    LOG_I(LOG_TAG, "ThreadPolicy audio thread limited to %d of %ld cores", CPU_COUNT(&cores),
+          numCpus);
+
+    return true;
+}
+
+int64_t ThreadPolicy::nowNanos() noexcept
+{
+    timespec now {};
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return static_cast<int64_t>(now.tv_sec) * kNanosPerSecond + now.tv_nsec;
+}
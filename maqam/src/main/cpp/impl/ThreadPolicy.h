@@ -0,0 +1,90 @@
+//
+// Maqam - Mobile App Quick Audio & MIDI
+//
+// SPDX-FileCopyrightText: 2024 TAQS.IM <contact@taqs.im>
+// SPDX-License-Identifier: MIT
+//
+
+#ifndef THREADPOLICY_H
+#define THREADPOLICY_H
+
+#include <atomic>
+#include <cstdint>
+#include <pthread.h>
+#include <sched.h>
+
+namespace maqam {
+
+/**
+ * Scheduling for the audio callback thread. The first callback on a new thread requests
+ * SCHED_FIFO unless the thread already has it, pins the thread to the cores outside the slowest
+ * cluster and opens an APerformanceHint session (API 33+, resolved at runtime). Every callback
+ * then reports its work duration against the callback period, so the kernel raises clocks before
+ * a deadline is missed instead of after. Each step is best effort, failures only show in stats.
+ */
+class ThreadPolicy
+{
+public:
+    static constexpr int kFifoPriority = 2;
+    static constexpr const char* kCpuSysfsRoot = "/sys/devices/system/cpu";
+
+    struct Stats
+    {
+        bool    isFifo;
+        bool    isAffinitySet;
+        bool    hasPerformanceHint;
+        int64_t numCallbacks;
+        int64_t numCallbacksOffFastCores;
+        int64_t maxWorkNanos;
+    };
+
+    // Times one callback, first declared object in onAudioReady() so it covers everything else
+    class CallbackScope
+    {
+    public:
+        CallbackScope(ThreadPolicy& policy, int32_t numFrames, double sampleRate) noexcept;
+        ~CallbackScope();
+
+    private:
+        ThreadPolicy& mPolicy;
+        int64_t       mStartNanos;
+    };
+
+    ThreadPolicy() noexcept;
+    ~ThreadPolicy();
+
+    // Any thread, values are updated by the audio thread without synchronization
+    Stats getStats() const noexcept;
+
+    // Reads cpuinfo_max_freq of the first numCpus cores under cpuRoot, tests pass a fake tree.
+    // False for symmetric or unknown topologies.
+    static bool findFastCores(cpu_set_t& cores, const char* cpuRoot, long numCpus) noexcept;
+
+private:
+    void setUpThread(int64_t targetNanos) noexcept;
+    void setTarget(int64_t targetNanos) noexcept;
+    void reportWork(int64_t workNanos) noexcept;
+
+    static int64_t nowNanos() noexcept;
+
+    cpu_set_t mFastCores;
+    bool      mHasFastCores;
+
+    // Audio thread
+    pthread_t mThread;
+    bool      mHasThread;
+    void*     mSession;
+    int64_t   mTargetNanos;
+
+    std::atomic<bool>    mIsFifo;
+    std::atomic<bool>    mIsAffinitySet;
+    std::atomic<bool>    mHasPerformanceHint;
+    std::atomic<int64_t> mNumCallbacks;
+    std::atomic<int64_t> mNumCallbacksOffFastCores;
+    std::atomic<int64_t> mMaxWorkNanos;
+
+};
+
+} // maqam
+
+#endif // THREADPOLICY_H
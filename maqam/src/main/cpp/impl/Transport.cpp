@@ -0,0 +1,180 @@
+//
+// Maqam - Mobile App Quick Audio & MIDI
+//
+// SPDX-FileCopyrightText: 2024 TAQS.IM <contact@taqs.im>
+// SPDX-License-Identifier: MIT
+//
+
+#include <cmath>
+#include <stdexcept>
+
+#include "Transport.h"
+
+using namespace maqam;
+
+Transport::Transport() noexcept
+    : mCommands(kCommandQueueSize)
+    , mTempo(kDefaultTempo)
+    , mNumerator(4)
+    , mDenominator(4)
+    , mReportedPlaying(false)
+    , mReportedPosition(0)
+    , mSampleRate(0)
+    , mBarOrigin(0)
+    , mBarOriginCount(0)
+{
+    mInfo.setBpm(kDefaultTempo);
+    mInfo.setTimeSignature(juce::AudioPlayHead::TimeSignature { 4, 4 });
+    mInfo.setTimeInSamples(0);
+    mInfo.setTimeInSeconds(0);
+    mInfo.setPpqPosition(0);
+    mInfo.setPpqPositionOfLastBarStart(0);
+    mInfo.setBarCount(0);
+    mInfo.setIsPlaying(false);
+}
+
+void Transport::play()
+{
+    queue({ CommandType::Play, 0, 0, 0 });
+}
+
+void Transport::stop()
+{
+    queue({ CommandType::Stop, 0, 0, 0 });
+}
+
+void Transport::setTempo(double bpm)
+{
+    if (! ((bpm >= kMinTempo) && (bpm <= kMaxTempo))) {
+        throw std::invalid_argument("Invalid tempo");
+    }
+
+    queue({ CommandType::Tempo, bpm, 0, 0 });
+    mTempo = bpm;
+}
+
+void Transport::setTimeSignature(int numerator, int denominator)
+{
+    if ((numerator < 1) || (numerator > kMaxNumerator)) {
+        throw std::invalid_argument("Invalid time signature numerator");
+    }
+
+    if ((denominator < 1) || (denominator > kMaxDenominator)
+            || ((denominator & (denominator - 1)) != 0)) {
+        throw std::invalid_argument("Time signature denominator must be a power of two");
+    }
+
+    queue({ CommandType::TimeSignature, 0, numerator, denominator });
+    mNumerator = numerator;
+    mDenominator = denominator;
+}
+
+void Transport::setPpqPosition(double quarterNotes)
+{
+    if (! (quarterNotes >= 0)) {
+        throw std::invalid_argument("Invalid position");
+    }
+
+    queue({ CommandType::Position, quarterNotes, 0, 0 });
+}
+
+void Transport::beginBlock(double sampleRate) noexcept
+{
+    mSampleRate = sampleRate;
+
+    Command command {};
+
+    while (mCommands.get(command)) {
+        apply(command);
+    }
+
+    const double ppq = *mInfo.getPpqPosition();
+    const auto bars = static_cast<int64_t>(std::floor((ppq - mBarOrigin)
+            / getQuarterNotesPerBar()));
+
+    mInfo.setPpqPositionOfLastBarStart(mBarOrigin + static_cast<double>(bars)
+            * getQuarterNotesPerBar());
+    mInfo.setBarCount(mBarOriginCount + bars);
+}
+
+void Transport::endBlock(int numFrames) noexcept
+{
+    if (mInfo.getIsPlaying()) {
+        const int64_t samples = *mInfo.getTimeInSamples() + numFrames;
+
+        mInfo.setPpqPosition(*mInfo.getPpqPosition()
+                + numFrames * *mInfo.getBpm() / (60.0 * mSampleRate));
+        mInfo.setTimeInSamples(samples);
+        mInfo.setTimeInSeconds(static_cast<double>(samples) / mSampleRate);
+    }
+
+    mReportedPlaying.store(mInfo.getIsPlaying(), std::memory_order_relaxed);
+    mReportedPosition.store(*mInfo.getPpqPosition(), std::memory_order_relaxed);
+}
+
+juce::Optional<juce::AudioPlayHead::PositionInfo> Transport::getPosition() const
+{
+    return mInfo;
+}
+
+void Transport::queue(const Command& command)
+{
+    const std::lock_guard<std::mutex> lock(mQueueMutex);
+
+    if (! mCommands.put(command)) {
+        throw std::runtime_error("Transport command queue is full");
+    }
+}
+
+void Transport::apply(const Command& command) noexcept
+{
+    switch (command.type) {
+        case CommandType::Play:
+            mInfo.setIsPlaying(true);
+            break;
+
+        case CommandType::Stop:
+            mInfo.setIsPlaying(false);
+            break;
+
+        case CommandType::Tempo:
+            mInfo.setBpm(command.value);
+            break;
+
+        case CommandType::TimeSignature: {
+            // Takes effect at the start of the current bar
+            const double barLength = getQuarterNotesPerBar();
+            const auto bars = static_cast<int64_t>(std::floor((*mInfo.getPpqPosition()
+                    - mBarOrigin) / barLength));
+
+            mBarOrigin += static_cast<double>(bars) * barLength;
+            mBarOriginCount += bars;
+            mInfo.setTimeSignature(juce::AudioPlayHead::TimeSignature {
+                command.numerator, command.denominator
+            });
+            break;
+        }
+
+        case CommandType::Position: {
+            // Sample time is derived as if the tempo never changed, bars keep following the
+            // time signature changes
+            const double seconds = command.value * 60.0 / *mInfo.getBpm();
+
+            mInfo.setPpqPosition(command.value);
+            mInfo.setTimeInSeconds(seconds);
+            mInfo.setTimeInSamples(static_cast<int64_t>(std::llround(seconds * mSampleRate)));
+
+            if (command.value < mBarOrigin) {
+                mBarOrigin = 0;
+                mBarOriginCount = 0;
+            }
+            break;
+        }
+    }
+}
+
+double Transport::getQuarterNotesPerBar() const noexcept
+{
+    const juce::AudioPlayHead::TimeSignature signature = *mInfo.getTimeSignature();
+    return 4.0 * signature.numerator / signature.denominator;
+}
@@ -0,0 +1,109 @@
+//
+// Maqam - Mobile App Quick Audio & MIDI
+//
+// SPDX-FileCopyrightText: 2024 TAQS.IM <contact@taqs.im>
+// SPDX-License-Identifier: MIT
+//
+
+#ifndef TRANSPORT_H
+#define TRANSPORT_H
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+
+#include <juce_audio_processors/juce_audio_processors.h>
+#include <ring_buffer/ring_buffer.h>
+
+namespace maqam {
+
+/**
+ * Musical clock of the host, play state, tempo, time signature and position, advanced by the
+ * audio thread after every rendered block. Nodes read it through juce::AudioPlayHead, see
+ * juce::AudioProcessor::getPlayHead(), so tempo-synced processing needs no JNI call per block.
+ * Java threads change it with commands queued on a lock-free ring buffer, they are applied in
+ * order at the start of the next block.
+ */
+class Transport : public juce::AudioPlayHead
+{
+public:
+    static constexpr double kMinTempo          = 20.0;
+    static constexpr double kMaxTempo          = 999.0;
+    static constexpr double kDefaultTempo      = 120.0;
+    static constexpr int    kMaxNumerator      = 32;
+    static constexpr int    kMaxDenominator    = 32;
+    static constexpr int    kMaxQueuedCommands = 256;
+
+    Transport() noexcept;
+
+    // Any thread except the audio thread, throw std::invalid_argument or std::runtime_error when
+    // the queue is full
+    void play();
+    void stop();
+    void setTempo(double bpm);
+    void setTimeSignature(int numerator, int denominator);
+    void setPpqPosition(double quarterNotes);
+
+    // Last requested values
+    double getTempo() const noexcept { return mTempo; }
+    int getTimeSignatureNumerator() const noexcept { return mNumerator; }
+    int getTimeSignatureDenominator() const noexcept { return mDenominator; }
+
+    // As of the last rendered block
+    bool isPlaying() const noexcept { return mReportedPlaying; }
+    double getPpqPosition() const noexcept { return mReportedPosition; }
+
+    // Audio thread, or a thread that renders offline. Applies queued commands before rendering
+    // a block and moves the position past it afterwards.
+    void beginBlock(double sampleRate) noexcept;
+    void endBlock(int numFrames) noexcept;
+
+    // Audio thread, valid between beginBlock() and endBlock()
+    juce::Optional<PositionInfo> getPosition() const override;
+
+private:
+    enum class CommandType
+    {
+        Play,
+        Stop,
+        Tempo,
+        TimeSignature,
+        Position
+    };
+
+    // POD for Ring_Buffer
+    struct Command
+    {
+        CommandType type;
+        double      value;
+        int         numerator;
+        int         denominator;
+    };
+
+    static constexpr int kCommandQueueSize = kMaxQueuedCommands * sizeof(Command);
+
+    void queue(const Command& command);
+    void apply(const Command& command) noexcept;
+    double getQuarterNotesPerBar() const noexcept;
+
+    // Writers serialize on the mutex, Ring_Buffer has a single producer
+    std::mutex          mQueueMutex;
+    Ring_Buffer         mCommands;
+    std::atomic<double> mTempo;
+    std::atomic<int>    mNumerator;
+    std::atomic<int>    mDenominator;
+
+    std::atomic<bool>   mReportedPlaying;
+    std::atomic<double> mReportedPosition;
+
+    // Audio thread
+    PositionInfo mInfo;
+    double       mSampleRate;
+    double       mBarOrigin;      // quarter notes, the last time signature change is a bar line
+    int64_t      mBarOriginCount; // bars before mBarOrigin
+
+};
+
+} // maqam
+
+#endif // TRANSPORT_H
@@ -12,7 +12,11 @@
 
 #include "impl/AudioRoot.h"
 #include "impl/AudioGraph.h"
+#include "impl/JNICache.h"
 #include "impl/NativeWrapper.h"
+#include "impl/NotificationHub.h"
+#include "impl/OfflineRenderer.h"
+#include "impl/RealtimeSanitizer.h"
 #include "nodes/nodes.h"
 #include "client/maqam.h"
 
@@ -24,10 +28,14 @@ extern "C"
 JNIEXPORT void JNICALL
 Java_im_taqs_maqam_LibraryKt_jniInit(JNIEnv *env, jclass /*clazz*/, jobject context)
 {
+    // Resolve JNI classes, fields and methods once
+    JNICache::init(env);
+
     // Bind Java to native library classes
     NativeWrapper::bindClass<AudioRoot>(LIBRARY_JAVA_PACKAGE ".AudioRoot");
     NativeWrapper::bindClass<AudioGraph>(LIBRARY_JAVA_PACKAGE ".AudioGraph");
     NativeWrapper::bindClass<AudioNode>(LIBRARY_JAVA_PACKAGE ".AudioNode");
+    NativeWrapper::bindClass<OfflineRenderer>(LIBRARY_JAVA_PACKAGE ".OfflineRenderer");
 
     // Bind Java to native node classes
     bindNodeClasses();
@@ -43,6 +51,20 @@ Java_im_taqs_maqam_LibraryKt_jniInit(JNIEnv *env, jclass /*clazz*/, jobject cont
     juce::MessageManager::getInstance();
 }
 
+extern "C"
+JNIEXPORT void JNICALL
+Java_im_taqs_maqam_LibraryKt_jniSetNotificationRate(JNIEnv *env, jclass /*clazz*/, jint hz)
+{
+    NotificationHub::getInstance().setRate(hz);
+}
+
+extern "C"
+JNIEXPORT jint JNICALL
+Java_im_taqs_maqam_LibraryKt_jniDumpRealtimeViolations(JNIEnv *env, jclass /*clazz*/)
+{
+    return RealtimeSanitizer::dump();
+}
+
 extern "C"
 void _maqam_bind_dsp_class(const char* name, maqam_impl_factory_func_t factory,
                            maqam_impl_deleter_func_t deleter)
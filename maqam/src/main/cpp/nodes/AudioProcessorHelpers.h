@@ -8,6 +8,7 @@
 #ifndef AUDIO_PROCESSOR_HELPERS
 #define AUDIO_PROCESSOR_HELPERS
 
+#include <algorithm>
 #include <memory>
 
 #include <juce_audio_processors/juce_audio_processors.h>
@@ -35,10 +36,33 @@ createFloatParameter(
     );
 }
 
+// Whole values only, switches like bypass or a factor index. PresetMorph switches these halfway
+// through a morph instead of interpolating them.
+static std::unique_ptr<juce::AudioParameterFloat>
+createSteppedParameter(
+        const juce::ParameterID& parameterID,
+        const juce::String& parameterName,
+        const juce::String& parameterLabel,
+        float rangeStart,
+        float rangeEnd,
+        float defaultValue,
+        juce::AudioParameterFloatAttributes::StringFromValue stringFromValue = nullptr)
+{
+    return std::make_unique<juce::AudioParameterFloat>(
+            parameterID,
+            parameterName,
+            juce::NormalisableRange<float>(rangeStart, rangeEnd, /*intervalValue*/1.f),
+            defaultValue,
+            juce::AudioParameterFloatAttributes()
+                    .withLabel(parameterLabel)
+                    .withStringFromValueFunction(std::move(stringFromValue))
+    );
+}
+
 static std::unique_ptr<juce::AudioParameterFloat>
 createParameterBypass(const juce::ParameterID& parameterID)
 {
-    return createFloatParameter(
+    return createSteppedParameter(
             parameterID,
             "Bypass", "", /*min*/0, /*max*/1.f, /*def*/0,
             [](float v, int _) { return juce::String(v == 0 ? "off" : "on"); }
@@ -55,6 +79,181 @@ createParameterMix(const juce::ParameterID& parameterID)
     );
 }
 
+// Binary ValueTree format, parses much faster than the XML helpers in juce::AudioProcessor
+static void
+writeParameterState(juce::AudioProcessorValueTreeState& parameters, juce::MemoryBlock& destData)
+{
+    juce::MemoryOutputStream stream(destData, /*appendToExistingBlockContent*/false);
+    parameters.copyState().writeToStream(stream);
+}
+
+static void
+readParameterState(juce::AudioProcessorValueTreeState& parameters, const void* data, int sizeInBytes)
+{
+    juce::ValueTree state = juce::ValueTree::readFromData(data, static_cast<size_t>(sizeInBytes));
+
+    if (state.hasType(parameters.state.getType())) {
+        parameters.replaceState(state);
+    }
+}
+
+/**
+ * Click-free bypass shared by the effect nodes. Crossfades between the processed and the input
+ * signal for kFadeSeconds when the bypass state changes. Once fully bypassed the processing
+ * function is not called at all. Nodes that report latency pass it to setLatencySamples(), the
+ * input is then delayed by the same amount while bypassed and during the crossfade so the two
+ * signals line up and the reported latency holds in both states.
+ */
+class BypassCrossfade
+{
+public:
+    static constexpr double kFadeSeconds = 0.005;
+
+    // Upper bound for the latency of any node, sizes dry paths that compensate it
+    static constexpr int kMaxLatencySamples = 256;
+
+    void prepare(double sampleRate, int maximumBlockSize, int numChannels, bool bypassed)
+    {
+        mDryBuffer.setSize(numChannels, maximumBlockSize + kMaxLatencySamples);
+        mHistory.setSize(numChannels, kMaxLatencySamples);
+        mHistory.clear();
+        mMaximumBlockSize = maximumBlockSize;
+        mFadeStep = 1.f / static_cast<float>(std::max(1, juce::roundToInt(kFadeSeconds * sampleRate)));
+        mGain = bypassed ? 0 : 1.f;
+    }
+
+    // Audio thread, before process()
+    void setLatencySamples(int latency) noexcept
+    {
+        latency = juce::jlimit(0, kMaxLatencySamples, latency);
+
+        if (latency != mLatency) {
+            mHistory.clear();
+            mLatency = latency;
+        }
+    }
+
+    bool isBypassed() const noexcept { return mGain == 0; }
+
+    // Blocks longer than prepared for are processed in chunks of the prepared size, so the fade
+    // and the latency history work the same
+    template<class ProcessFunction>
+    void process(juce::AudioBuffer<float>& buffer, bool bypassed, ProcessFunction&& processFunction)
+    {
+        const int numSamples = buffer.getNumSamples();
+
+        if ((numSamples <= mMaximumBlockSize) || (mMaximumBlockSize <= 0)) {
+            processChunk(buffer, bypassed, processFunction);
+            return;
+        }
+
+        for (int start = 0; start < numSamples; start += mMaximumBlockSize) {
+            // Refers to the samples of buffer, no allocation
+            juce::AudioBuffer<float> chunk(buffer.getArrayOfWritePointers(),
+                                           buffer.getNumChannels(), start,
+                                           std::min(mMaximumBlockSize, numSamples - start));
+            processChunk(chunk, bypassed, processFunction);
+        }
+    }
+
+private:
+    template<class ProcessFunction>
+    void processChunk(juce::AudioBuffer<float>& buffer, bool bypassed,
+                      ProcessFunction& processFunction)
+    {
+        const float target = bypassed ? 0 : 1.f;
+        const int numSamples = buffer.getNumSamples();
+
+        if (mGain == target) {
+            if (bypassed) {
+                delayInput(buffer);
+            } else {
+                pushHistory(buffer);
+                processFunction(buffer);
+            }
+
+            return;
+        }
+
+        const int numChannels = std::min(buffer.getNumChannels(), mDryBuffer.getNumChannels());
+
+        fillDryBuffer(buffer);
+        processFunction(buffer);
+
+        const float step = target > mGain ? mFadeStep : -mFadeStep;
+
+        for (int ch = 0; ch < numChannels; ++ch) {
+            const float* dry = mDryBuffer.getReadPointer(ch);
+            float* wet = buffer.getWritePointer(ch);
+            float gain = mGain;
+
+            for (int i = 0; i < numSamples; ++i) {
+                gain = juce::jlimit(0.f, 1.f, gain + step);
+                wet[i] = dry[i] + gain * (wet[i] - dry[i]);
+            }
+        }
+
+        mGain = juce::jlimit(0.f, 1.f, mGain + step * static_cast<float>(numSamples));
+    }
+
+    // Input delayed by the latency into mDryBuffer, its last mLatency samples become the history
+    void fillDryBuffer(const juce::AudioBuffer<float>& buffer) noexcept
+    {
+        const int numSamples = buffer.getNumSamples();
+        const int numChannels = std::min(buffer.getNumChannels(), mDryBuffer.getNumChannels());
+
+        for (int ch = 0; ch < numChannels; ++ch) {
+            mDryBuffer.copyFrom(ch, 0, mHistory, ch, 0, mLatency);
+            mDryBuffer.copyFrom(ch, mLatency, buffer, ch, 0, numSamples);
+            mHistory.copyFrom(ch, 0, mDryBuffer, ch, numSamples, mLatency);
+        }
+    }
+
+    // Nothing to do for nodes without latency, the buffer is left untouched
+    void delayInput(juce::AudioBuffer<float>& buffer) noexcept
+    {
+        if (mLatency == 0) {
+            return;
+        }
+
+        const int numChannels = std::min(buffer.getNumChannels(), mDryBuffer.getNumChannels());
+
+        fillDryBuffer(buffer);
+
+        for (int ch = 0; ch < numChannels; ++ch) {
+            buffer.copyFrom(ch, 0, mDryBuffer, ch, 0, buffer.getNumSamples());
+        }
+    }
+
+    // Keeps the last mLatency samples of input while processing, for the next crossfade
+    void pushHistory(const juce::AudioBuffer<float>& buffer) noexcept
+    {
+        if (mLatency == 0) {
+            return;
+        }
+
+        const int numSamples = buffer.getNumSamples();
+        const int numChannels = std::min(buffer.getNumChannels(), mHistory.getNumChannels());
+        const int numNew = std::min(mLatency, numSamples);
+        const int numKept = mLatency - numNew;
+
+        for (int ch = 0; ch < numChannels; ++ch) {
+            float* history = mHistory.getWritePointer(ch);
+            std::copy(history + numNew, history + mLatency, history);
+            std::copy_n(buffer.getReadPointer(ch, numSamples - numNew), numNew, history + numKept);
+        }
+    }
+
+    juce::AudioBuffer<float> mDryBuffer;
+    juce::AudioBuffer<float> mHistory;
+
+    int   mMaximumBlockSize = 0;
+    int   mLatency = 0;
+    float mGain = 1.f;
+    float mFadeStep = 1.f;
+
+};
+
 } // namespace
 
 #endif // AUDIO_PROCESSOR_HELPERS
@@ -0,0 +1,101 @@
+//
+// Maqam - Mobile App Quick Audio & MIDI
+//
+// SPDX-FileCopyrightText: 2024 TAQS.IM <contact@taqs.im>
+// SPDX-License-Identifier: MIT
+//
+
+#ifndef OVERSAMPLER_H
+#define OVERSAMPLER_H
+
+#include <array>
+#include <atomic>
+#include <memory>
+
+#include <juce_dsp/juce_dsp.h>
+
+namespace maqam {
+
+/**
+ * Runs a nonlinear processing function at 1x, 2x, 4x or 8x the host sample rate using
+ * juce::dsp::Oversampling polyphase IIR half-band stages. All factors are allocated in prepare()
+ * for the maximum block size the node was prepared with, so the factor can be switched between
+ * two blocks without allocating. Owners should report getLatencySamples() via
+ * setLatencySamples().
+ */
+class Oversampler
+{
+public:
+    static constexpr int kNumFactors = 4;
+
+    static int getFactor(int index) noexcept { return 1 << index; }
+
+    void prepare(int numChannels, int maximumBlockSize)
+    {
+        for (int i = 1; i < kNumFactors; ++i) {
+            auto& stage = mStages[i];
+
+            if ((stage == nullptr) || (mNumChannels != numChannels)) {
+                stage = std::make_unique<juce::dsp::Oversampling<float>>(
+                        static_cast<size_t>(numChannels), static_cast<size_t>(i),
+                        juce::dsp::Oversampling<float>::filterHalfBandPolyphaseIIR,
+                        /*isMaxQuality*/true, /*useIntegerLatency*/true);
+            }
+
+            stage->initProcessing(static_cast<size_t>(maximumBlockSize));
+        }
+
+        mNumChannels = numChannels;
+        mActiveIndex = -1;
+    }
+
+    void setFactorIndex(int index) noexcept
+    {
+        mFactorIndex = juce::jlimit(0, kNumFactors - 1, index);
+    }
+
+    int getFactorIndex() const noexcept { return mFactorIndex; }
+
+    int getLatencySamples() const noexcept
+    {
+        const int index = mFactorIndex;
+        return (index == 0) || (mStages[index] == nullptr) ? 0
+                : juce::roundToInt(mStages[index]->getLatencyInSamples());
+    }
+
+    // Calls processFunction(juce::dsp::AudioBlock<float>& block, int factor) at the current factor
+    template<class ProcessFunction>
+    void process(juce::dsp::AudioBlock<float>& block, ProcessFunction&& processFunction) noexcept
+    {
+        const int index = mFactorIndex;
+
+        if ((index == 0) || (mStages[index] == nullptr)) {
+            processFunction(block, 1);
+            return;
+        }
+
+        auto& stage = *mStages[index];
+
+        if (index != mActiveIndex) {
+            stage.reset();
+            mActiveIndex = index;
+        }
+
+        auto oversampledBlock = stage.processSamplesUp(block);
+        processFunction(oversampledBlock, getFactor(index));
+        stage.processSamplesDown(block);
+    }
+
+private:
+    std::array<std::unique_ptr<juce::dsp::Oversampling<float>>, kNumFactors> mStages;
+
+    std::atomic<int> mFactorIndex { 0 };
+
+    int mActiveIndex = -1;
+    int mNumChannels = 0;
+
+};
+
+} // maqam
+
+#endif // OVERSAMPLER_H
@@ -0,0 +1,34 @@
+//
+// Maqam - Mobile App Quick Audio & MIDI
+//
+// SPDX-FileCopyrightText: 2024 TAQS.IM <contact@taqs.im>
+// SPDX-License-Identifier: MIT
+//
+
+#ifndef PREPARED_STATE_LOADER_H
+#define PREPARED_STATE_LOADER_H
+
+// This is an optional interface for nodes whose setStateInformation() does slow work, like
+// decoding files. AudioGraph::restoreSnapshot() prepares the state while the graph keeps
+// rendering, then applies it with the callback lock held and releases what it replaced after.
+
+namespace maqam {
+
+class PreparedStateLoader {
+public:
+    virtual ~PreparedStateLoader() = default;
+
+    // Not the audio thread, same data as setStateInformation()
+    virtual void prepareState(const void* data, int sizeInBytes) = 0;
+
+    // Caller holds the graph callback lock, only swaps in what prepareState() built
+    virtual void applyPreparedState() = 0;
+
+    // Frees the state applyPreparedState() replaced, after the lock is released
+    virtual void releaseReplacedState() noexcept = 0;
+
+};
+
+} // namespace
+
+#endif // PREPARED_STATE_LOADER_H
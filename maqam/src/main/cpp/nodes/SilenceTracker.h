@@ -0,0 +1,100 @@
+//
+// Maqam - Mobile App Quick Audio & MIDI
+//
+// SPDX-FileCopyrightText: 2024 TAQS.IM <contact@taqs.im>
+// SPDX-License-Identifier: MIT
+//
+
+#ifndef SILENCE_TRACKER_H
+#define SILENCE_TRACKER_H
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+#include <juce_audio_basics/juce_audio_basics.h>
+
+namespace maqam {
+
+/**
+ * Lets an effect node stop processing once its input went silent and its tail has rung out.
+ * Call skipBlock() at the top of processBlock() and trackOutput() after the DSP ran.
+ */
+class SilenceTracker
+{
+public:
+    static constexpr float kThreshold = 3.1623e-5f; // -90 dBFS
+
+    // Time for a recirculating loop of given length and gain to decay below kThreshold
+    static double getFeedbackTailSeconds(double loopSeconds, double loopGain) noexcept
+    {
+        if (loopGain <= 0) {
+            return loopSeconds;
+        }
+
+        if (loopGain >= 1.0) {
+            return std::numeric_limits<double>::infinity();
+        }
+
+        return loopSeconds * (1.0 + std::log(kThreshold) / std::log(loopGain));
+    }
+
+    void prepare(double sampleRate) noexcept
+    {
+        mSampleRate = sampleRate;
+        reset();
+    }
+
+    void reset() noexcept
+    {
+        mSilentSamples = 0;
+        mLastOutputPeak = 0;
+        mIdle = false;
+    }
+
+    bool isIdle() const noexcept { return mIdle; }
+
+    // Returns true if the node can skip its DSP for this block, the buffer is then zeroed
+    bool skipBlock(juce::AudioBuffer<float>& buffer, double tailSeconds) noexcept
+    {
+        const int numSamples = buffer.getNumSamples();
+
+        if (buffer.getMagnitude(0, numSamples) > kThreshold) {
+            mSilentSamples = 0;
+            mIdle = false;
+            return false;
+        }
+
+        if (! mIdle) {
+            mSilentSamples += numSamples;
+
+            if (! std::isfinite(tailSeconds)
+                    || (mLastOutputPeak > kThreshold)
+                    || (static_cast<double>(mSilentSamples) < tailSeconds * mSampleRate)) {
+                return false;
+            }
+
+            mIdle = true;
+        }
+
+        buffer.clear();
+
+        return true;
+    }
+
+    void trackOutput(const juce::AudioBuffer<float>& buffer) noexcept
+    {
+        mLastOutputPeak = buffer.getMagnitude(0, buffer.getNumSamples());
+    }
+
+private:
+    double  mSampleRate = 48000;
+    int64_t mSilentSamples = 0;
+    float   mLastOutputPeak = 0;
+    bool    mIdle = false;
+
+};
+
+} // maqam
+
+#endif // SILENCE_TRACKER_H
@@ -0,0 +1,110 @@
+//
+// Maqam - Mobile App Quick Audio & MIDI
+//
+// SPDX-FileCopyrightText: 2024 TAQS.IM <contact@taqs.im>
+// SPDX-License-Identifier: MIT
+//
+
+#ifndef SOUNDPIPE_ARENA_H
+#define SOUNDPIPE_ARENA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+
+extern "C" {
+#include "soundpipe.h"
+}
+
+namespace maqam {
+
+/**
+ * Owns the sp_data and the auxiliary memory of a node's Soundpipe modules. Memory is reserved
+ * once at construction for kMaxSampleRate, later calls to reset() and allocate() only rewind
+ * and hand out chunks of it, so re-preparing a node never touches the heap.
+ */
+class SoundpipeArena
+{
+public:
+    static constexpr int kMaxSampleRate = 192000;
+
+    // Same seed on every reset(), renders of the same input are reproducible
+    static constexpr uint32_t kRandomSeed = 0;
+
+    explicit SoundpipeArena(size_t capacityBytes = 0) noexcept
+        : mData {}
+        , mOut(0)
+        , mCapacity(capacityBytes)
+        , mUsed(0)
+        , mMemory(capacityBytes > 0 ? new (std::nothrow) uint8_t[capacityBytes] : nullptr)
+    {
+        mData.out = &mOut;
+        mData.nchan = 1;
+        mData.sr = 44100;
+
+        if (mMemory == nullptr) {
+            mCapacity = 0;
+        }
+    }
+
+    SoundpipeArena(const SoundpipeArena&) = delete;
+    SoundpipeArena& operator=(const SoundpipeArena&) = delete;
+
+    sp_data* getData() noexcept { return &mData; }
+
+    int getSampleRate() const noexcept { return mData.sr; }
+
+    // Releases all previous allocations and sets the sample rate seen by the modules
+    bool reset(double sampleRate) noexcept
+    {
+        const int sr = static_cast<int>(sampleRate);
+
+        if ((sr <= 0) || (sr > kMaxSampleRate)) {
+            return false;
+        }
+
+        mData.sr = sr;
+        mData.pos = 0;
+        mData.rand = kRandomSeed;
+        mUsed = 0;
+
+        return true;
+    }
+
+    // Replacement for sp_auxdata_alloc(), the returned memory is zeroed
+    bool allocate(sp_auxdata* aux, size_t size) noexcept
+    {
+        const size_t offset = (mUsed + kAlignment - 1) & ~(kAlignment - 1);
+
+        if ((offset > mCapacity) || (size > mCapacity - offset)) {
+            aux->ptr = nullptr;
+            aux->size = 0;
+            return false;
+        }
+
+        aux->ptr = mMemory.get() + offset;
+        aux->size = size;
+        std::memset(aux->ptr, 0, size);
+        mUsed = offset + size;
+
+        return true;
+    }
+
+private:
+    static constexpr size_t kAlignment = alignof(std::max_align_t);
+
+    sp_data mData;
+    SPFLOAT mOut;
+
+    size_t mCapacity;
+    size_t mUsed;
+
+    std::unique_ptr<uint8_t[]> mMemory;
+
+};
+
+} // maqam
+
+#endif // SOUNDPIPE_ARENA_H
@@ -0,0 +1,68 @@
+//
+// Maqam - Mobile App Quick Audio & MIDI
+//
+// SPDX-FileCopyrightText: 2024 TAQS.IM <contact@taqs.im>
+// SPDX-License-Identifier: MIT
+//
+
+#ifndef TRIPLE_BUFFER_H
+#define TRIPLE_BUFFER_H
+
+#include <array>
+#include <atomic>
+
+namespace maqam {
+
+/**
+ * Lock-free handoff of a whole value from one writer thread to the audio thread. The writer fills
+ * its own slot and swaps it with the shared one, the reader swaps the shared slot with its own
+ * when it is newer. Neither side ever waits for the other, so publishing works the same whether
+ * the audio stream is running or not, and the reader never sees a partly written value.
+ */
+template<class T>
+class TripleBuffer
+{
+public:
+    TripleBuffer() noexcept
+        : mBuffers()
+        , mWriteIndex(0)
+        , mShared(1)
+        , mReadIndex(2)
+    {}
+
+    // Writer, one thread at a time. Slot contents are stale, fill all of it before publishing.
+    T& getWriteBuffer() noexcept { return mBuffers[mWriteIndex]; }
+
+    void publish() noexcept
+    {
+        const int previous = mShared.exchange(mWriteIndex | kDirty, std::memory_order_acq_rel);
+        mWriteIndex = previous & kIndexMask;
+    }
+
+    // Reader, true when a newer value was taken
+    bool update() noexcept
+    {
+        if ((mShared.load(std::memory_order_relaxed) & kDirty) == 0) {
+            return false;
+        }
+
+        mReadIndex = mShared.exchange(mReadIndex, std::memory_order_acq_rel) & kIndexMask;
+        return true;
+    }
+
+    const T& getReadBuffer() const noexcept { return mBuffers[mReadIndex]; }
+
+private:
+    static constexpr int kIndexMask = 3;
+    static constexpr int kDirty = 4;
+
+    std::array<T,3>  mBuffers;
+    int              mWriteIndex;
+    std::atomic<int> mShared;
+    int              mReadIndex;
+
+};
+
+} // maqam
+
+#endif // TRIPLE_BUFFER_H
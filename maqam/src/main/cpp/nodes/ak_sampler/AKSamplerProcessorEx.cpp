@@ -7,6 +7,7 @@
 
 #include <algorithm>
 #include <chrono>
+#include <cmath>
 #include <memory>
 #include <stdexcept>
 #include <thread>
@@ -19,71 +20,53 @@ using namespace juce;
 using namespace maqam;
 
 static const char* kBuiltinTestWaveformPath = "builtin:test-waveform";
+static const Identifier kStateSfzPath { "sfzPath" };
 
 AKSamplerProcessorEx::AKSamplerProcessorEx()
     : mParameters (*this, nullptr, "AKSampler", createParameterLayout())
-    , mA4Frequency(440.0)
+    , mDetuneRatio(1.f)
+    , mA4Frequency(440.f)
     , mCentsFromC()
     , mSamplerBusy ATOMIC_FLAG_INIT
+    , mLoadingSampler(nullptr)
+    , mSamplerReplaced(false)
     , mMidiChannel(kMidiChannelOmni)
-    , mPitchKeycenter(0)
-    , mLoKey(0)
-    , mHiKey(0)
-    , mLoVel(0)
-    , mHiVel(0)
-    , mLoopStart(0)
-    , mLoopEnd(0)
+    , mMpeMemberChannels(0)
+    , mMpeActiveChannels(0)
+    , mMpeChannels()
+    , mGroupOpcodes()
+    , mRegionOpcodes()
+    , mOpcodes(&mGroupOpcodes)
 {
     AKSamplerProcessor::addListener(this);
+    resetMpe();
 }
 
 void AKSamplerProcessorEx::load(const String& path)
 {
-    std::filesystem::path sfzPath(path.toStdString());
+    const std::filesystem::path sfzPath(path.toStdString());
 
-    if (mSfzPath == sfzPath) {
-        return;
-    }
-
-    // AKSamplerProcessor::loadSfz() can make the program crash, just create a new AKSampler.
+    {
+        std::lock_guard<std::mutex> lock(mLoadMutex);
 
-    int millis = 0;
+        if (mSfzPath == sfzPath) {
+            return;
+        }
 
-    while (mSamplerBusy.test_and_set()) {
-        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        // Samples are decoded while the current instrument keeps playing
+        std::unique_ptr<AKSampler> sampler = createSampler(sfzPath);
+        const bool swapped = swapSampler(sampler);
+        releaseSampler(std::move(sampler));
 
-        if (++millis == 1000) {
+        if (! swapped) {
             throw std::runtime_error("Could not lock the sampler");
         }
-    }
-
-    samplerPtr->deinit(); // free previously loaded samples memory, ~Sampler() is not doing it.
 
-    samplerPtr = std::make_unique<AKSampler>();
-    samplerPtr->init(getSampleRate());
-    samplerPtr->deinit();
-
-    mSfzPath = sfzPath;
-    mErrorMessage.clear();
-    setDefaultOpcodeValues();
-
-    if (path == kBuiltinTestWaveformPath) {
-        samplerPtr->loadTestWaveform();
-    } else {
-        sfz::Parser parser;
-        parser.setListener(this);
-        parser.parseFile(mSfzPath.string());
-
-        if (! mErrorMessage.empty()) {
-            mSamplerBusy.clear();
-            throw std::runtime_error(mErrorMessage);
-        }
+        mSfzPath = sfzPath;
     }
 
-    samplerPtr->buildKeyMap();
-    samplerPtr->setParams(mSamplerParams);
-
-    mSamplerBusy.clear();
+    // The path is part of the saved state, see getStateInformation()
+    updateHostDisplay(ChangeDetails().withNonParameterStateChanged(true));
 }
 
 void AKSamplerProcessorEx::stopAllVoices() noexcept
@@ -93,70 +76,349 @@ void AKSamplerProcessorEx::stopAllVoices() noexcept
 
 void AKSamplerProcessorEx::setA4Frequency(float frequency) noexcept
 {
+    std::lock_guard<std::mutex> lock(mTuningMutex);
     mA4Frequency = frequency;
+    mTuning.publish(TuningTable::computeFrequencies(mA4Frequency, mCentsFromC));
 }
 
 void AKSamplerProcessorEx::setScaleCents(std::array<int,12> centsFromC) noexcept
 {
-    for (int i = 0; i < 12; i++) {
-        mCentsFromC[i] = centsFromC[i];
-    }
+    std::lock_guard<std::mutex> lock(mTuningMutex);
+    mCentsFromC = centsFromC;
+    mTuning.publish(TuningTable::computeFrequencies(mA4Frequency, mCentsFromC));
+}
+
+void AKSamplerProcessorEx::setScalaTuning(const String& scale, const String& keyboardMapping)
+{
+    std::lock_guard<std::mutex> lock(mTuningMutex);
+    const TuningTable::Scale scl = TuningTable::parseScale(scale);
+    const TuningTable::KeyboardMapping kbm = keyboardMapping.isEmpty()
+            ? TuningTable::createDefaultKeyboardMapping(mA4Frequency)
+            : TuningTable::parseKeyboardMapping(keyboardMapping);
+    mTuning.publish(TuningTable::computeFrequencies(scl, kbm));
+}
+
+void AKSamplerProcessorEx::retuneNote(int note, float frequency) noexcept
+{
+    mTuning.setNoteFrequency(note, frequency);
+}
+
+void AKSamplerProcessorEx::setMpeMemberChannels(int numChannels) noexcept
+{
+    mMpeMemberChannels = std::clamp(numChannels, 0, kMpeMaxMemberChannels);
 }
 
 void AKSamplerProcessorEx::processBlock(AudioBuffer<float>& buffer, MidiBuffer& midiMessages)
 {
     if (! mSamplerBusy.test_and_set()) {
+        if (mTuning.update()) {
+            retuneSoundingNotes();
+        }
+
+        if (mMpeActiveChannels != mMpeMemberChannels) {
+            mMpeActiveChannels = mMpeMemberChannels;
+            resetMpe();
+        }
+
         AKSamplerProcessor::processBlock(buffer, midiMessages);
         mSamplerBusy.clear();
     }
 }
 
+// Parameters plus the path of the loaded SFZ, so restoring a state brings back the instrument
+void AKSamplerProcessorEx::getStateInformation(MemoryBlock& destData)
+{
+    ValueTree state = mParameters.copyState();
+    state.setProperty(kStateSfzPath, String(mSfzPath.string()), nullptr);
+
+    MemoryOutputStream stream(destData, /*appendToExistingBlockContent*/false);
+    state.writeToStream(stream);
+}
+
+void AKSamplerProcessorEx::setStateInformation(const void* data, int sizeInBytes)
+{
+    prepareState(data, sizeInBytes);
+    applyPreparedState();
+    releaseReplacedState();
+}
+
+void AKSamplerProcessorEx::prepareState(const void* data, int sizeInBytes)
+{
+    std::lock_guard<std::mutex> lock(mLoadMutex);
+    releaseSampler(std::move(mPreparedSampler));
+    mPreparedSfzPath.clear();
+    mSamplerReplaced = false;
+    mPreparedState = ValueTree::readFromData(data, static_cast<size_t>(sizeInBytes));
+
+    if (! mPreparedState.hasType(mParameters.state.getType())) {
+        mPreparedState = {};
+        return;
+    }
+
+    const std::filesystem::path sfzPath(
+            mPreparedState.getProperty(kStateSfzPath).toString().toStdString());
+    mPreparedState.removeProperty(kStateSfzPath, nullptr);
+
+    if (sfzPath.empty() || (sfzPath == mSfzPath)) {
+        return;
+    }
+
+    // A missing or broken file must not prevent restoring the parameters, the error is kept
+    // like for any other failed load
+    try {
+        mPreparedSampler = createSampler(sfzPath);
+        mPreparedSfzPath = sfzPath;
+    } catch (const std::exception& e) {
+        mErrorMessage = e.what();
+    }
+}
+
+void AKSamplerProcessorEx::applyPreparedState()
+{
+    std::lock_guard<std::mutex> lock(mLoadMutex);
+
+    if (mPreparedState.isValid()) {
+        mParameters.replaceState(mPreparedState);
+        mPreparedState = {};
+    }
+
+    if (mPreparedSampler == nullptr) {
+        return;
+    }
+
+    // The replaced sampler stays in mPreparedSampler until releaseReplacedState()
+    mSamplerReplaced = swapSampler(mPreparedSampler);
+
+    if (mSamplerReplaced) {
+        mSfzPath = mPreparedSfzPath;
+    } else {
+        mErrorMessage = "Could not lock the sampler";
+    }
+}
+
+void AKSamplerProcessorEx::releaseReplacedState() noexcept
+{
+    bool replaced;
+
+    {
+        std::lock_guard<std::mutex> lock(mLoadMutex);
+        replaced = mSamplerReplaced;
+        mSamplerReplaced = false;
+        releaseSampler(std::move(mPreparedSampler));
+    }
+
+    if (replaced) {
+        updateHostDisplay(ChangeDetails().withNonParameterStateChanged(true));
+    }
+}
+
 /* realtime */
 void AKSamplerProcessorEx::handleMidiEvent(const MidiMessage& message) noexcept
 {
-    // isForChannel() expects 1-based index [1-16]
-    if ((mMidiChannel != kMidiChannelOmni) && ! message.isForChannel(mMidiChannel + 1)) {
+    // Zero based, -1 for messages without a channel
+    const int channel = message.getChannel() - 1;
+    const bool isMpeMember = (channel >= 1) && (channel <= mMpeActiveChannels);
+
+    if (mMpeActiveChannels > 0) {
+        if (channel > mMpeActiveChannels) {
+            return;
+        }
+    } else if ((mMidiChannel != kMidiChannelOmni) && ! message.isForChannel(mMidiChannel + 1)) {
+        // isForChannel() expects 1-based index [1-16]
         return;
     }
 
     if (message.isNoteOn()) {
         const int noteNumber = message.getNoteNumber();
         const int smpNn = noteNumber + mSamplerParams.osc1.pitchOffsetSemitones;
-        const float cents = static_cast<float>(mCentsFromC[noteNumber % 12])
-                + mSamplerParams.osc1.detuneOffsetCents;
-        const float n = static_cast<float>(smpNn) + cents / 100.f;
-        const auto fSmpHz = mA4Frequency * pow(2.f, (n - 69.f) / 12.f);
         const int vel = static_cast<int>(127.f * message.getFloatVelocity());
+        // Releases first, a note held on a key the tuning unmapped since still has to stop
         if (vel == 0) {
+            if (isMpeMember) {
+                releaseMpeNote(channel, smpNn);
+            }
             samplerPtr->stopNote(smpNn, false);
         } else {
+            const float fSmpHz = mTuning.getFrequency(noteNumber) * mDetuneRatio;
+            if (fSmpHz <= 0) {
+                return; // unmapped key
+            }
+            if (isMpeMember) {
+                // Expression sent before the note applies from its start
+                mMpeChannels[channel].note = smpNn;
+                setMpeExpression(channel);
+            }
             samplerPtr->playNote(smpNn, vel, fSmpHz);
         }
     } else if (message.isNoteOff()) {
         int smpNn = message.getNoteNumber() + mSamplerParams.osc1.pitchOffsetSemitones;
+        if (isMpeMember) {
+            releaseMpeNote(channel, smpNn);
+        }
         samplerPtr->stopNote(smpNn, false);
     } else if (message.isAllNotesOff() || message.isAllSoundOff()) {
         for (unsigned i = 0; i < 128; i++) {
             samplerPtr->stopNote(i, true);
         }
     } else if (message.isPitchWheel()) {
-        samplerPtr->pitchBend(2.f * static_cast<float>(message.getPitchWheelValue() - 8192) / 8192.f);
+        const float bend = static_cast<float>(message.getPitchWheelValue() - 8192) / 8192.f;
+        if (isMpeMember) {
+            mMpeChannels[channel].expression.pitchBend = kMpePitchBendRangeSemitones * bend;
+            setMpeExpression(channel);
+        } else {
+            samplerPtr->pitchBend(2.f * bend);
+        }
+    } else if (message.isChannelPressure()) {
+        if (isMpeMember) {
+            mMpeChannels[channel].expression.pressure =
+                    static_cast<float>(message.getChannelPressureValue()) / 127.f;
+            setMpeExpression(channel);
+        }
     } else if (message.isController()) {
-        samplerPtr->controller(message.getControllerNumber(), message.getControllerValue());
+        if (isMpeMember && (message.getControllerNumber() == kMpeTimbreController)) {
+            mMpeChannels[channel].expression.timbre =
+                    static_cast<float>(message.getControllerValue()) / 127.f;
+            setMpeExpression(channel);
+        } else {
+            samplerPtr->controller(message.getControllerNumber(), message.getControllerValue());
+        }
+    }
+}
+
+/* realtime */
+void AKSamplerProcessorEx::resetMpe() noexcept
+{
+    for (MpeChannel& mpeChannel : mMpeChannels) {
+        mpeChannel = { .note = -1, .expression = { 0, 0, 0.5f } };
+    }
+
+    samplerPtr->resetNoteExpression();
+}
+
+/* realtime */
+void AKSamplerProcessorEx::setMpeExpression(int channel) noexcept
+{
+    const MpeChannel& mpeChannel = mMpeChannels[channel];
+
+    if (mpeChannel.note >= 0) {
+        samplerPtr->setNoteExpression(mpeChannel.note, mpeChannel.expression);
+    }
+}
+
+/* realtime */
+void AKSamplerProcessorEx::releaseMpeNote(int channel, int note) noexcept
+{
+    // Expression is kept per note number, the next note on the same key may come from another
+    // channel or from outside the zone and must not inherit it
+    if (mMpeChannels[channel].note == note) {
+        mMpeChannels[channel].note = -1;
+        samplerPtr->setNoteExpression(note, { 0, 0, 0.5f });
+    }
+}
+
+/* realtime */
+void AKSamplerProcessorEx::retuneSoundingNotes() noexcept
+{
+    for (int note = 0; note < TuningTable::kNumNotes; note++) {
+        const float frequency = mTuning.getFrequency(note);
+        const int smpNn = note + mSamplerParams.osc1.pitchOffsetSemitones;
+
+        if ((frequency > 0) && (frequency != mTuning.getPreviousFrequency(note))
+                && (smpNn >= 0) && (smpNn < TuningTable::kNumNotes)) {
+            samplerPtr->retuneNote(smpNn, frequency * mDetuneRatio);
+        }
     }
 }
 
 void AKSamplerProcessorEx::setDefaultOpcodeValues() noexcept
 {
-    mPitchKeycenter = 69; // A4 - 440Hz
-    mLoKey = 0;
-    mHiKey = 127;
-    mLoVel = 0;
-    mHiVel = 127;
-    mLoopStart = 0;
-    mLoopEnd = 0;
-    mLoopMode = "no_loop";
-    mSample = "";
+    mGroupOpcodes = {
+        .pitchKeycenter = 69, // A4 - 440Hz
+        .loKey = 0,
+        .hiKey = 127,
+        .loVel = 0,
+        .hiVel = 127,
+        .loopStart = 0,
+        .loopEnd = 0,
+        .loopMode = "no_loop",
+        .sample = "",
+        .releaseTrigger = false,
+        .offset = 0,
+        .seqLength = 1,
+        .seqPosition = 1,
+        .xfinLoKey = 0,
+        .xfinHiKey = 0,
+        .xfoutLoKey = 127,
+        .xfoutHiKey = 127,
+        .xfinLoVel = 0,
+        .xfinHiVel = 0,
+        .xfoutLoVel = 127,
+        .xfoutHiVel = 127,
+        .group = 0,
+        .offBy = 0
+    };
+
+    mOpcodes = &mGroupOpcodes;
+}
+
+// AKSamplerProcessor::loadSfz() can make the program crash, just create a new AKSampler.
+std::unique_ptr<AKSampler> AKSamplerProcessorEx::createSampler(const std::filesystem::path& sfzPath)
+{
+    std::unique_ptr<AKSampler> sampler = std::make_unique<AKSampler>();
+    sampler->init(getSampleRate());
+    sampler->deinit();
+
+    mErrorMessage.clear();
+    setDefaultOpcodeValues();
+
+    if (sfzPath == kBuiltinTestWaveformPath) {
+        sampler->loadTestWaveform();
+    } else {
+        mLoadingSfzPath = sfzPath;
+        mLoadingSampler = sampler.get();
+
+        sfz::Parser parser;
+        parser.setListener(this);
+        parser.parseFile(sfzPath.string());
+
+        mLoadingSampler = nullptr;
+
+        if (! mErrorMessage.empty()) {
+            releaseSampler(std::move(sampler));
+            throw std::runtime_error(mErrorMessage);
+        }
+    }
+
+    sampler->buildKeyMap();
+
+    return sampler;
+}
+
+// Swaps between two processBlock() calls, sampler gets the replaced one
+bool AKSamplerProcessorEx::swapSampler(std::unique_ptr<AKSampler>& sampler) noexcept
+{
+    int millis = 0;
+
+    while (mSamplerBusy.test_and_set()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+        if (++millis == 1000) {
+            return false;
+        }
+    }
+
+    sampler->setParams(mSamplerParams);
+    samplerPtr.swap(sampler);
+    mSamplerBusy.clear();
+
+    return true;
+}
+
+void AKSamplerProcessorEx::releaseSampler(std::unique_ptr<AKSampler> sampler) noexcept
+{
+    if (sampler != nullptr) {
+        sampler->deinit(); // free loaded samples memory, ~Sampler() is not doing it.
+    }
 }
 
 int AKSamplerProcessorEx::parseOpcodeIntValue(const std::string& opcode,
@@ -242,6 +504,11 @@ void AKSamplerProcessorEx::audioProcessorParameterChanged(AudioProcessor* proces
     mSamplerParams.osc1.detuneOffsetCents =
             getParameterValue(kParameterOsc1DetuneOffsetCents);
 
+    // Pitch offset and detune applied on top of the tuning table
+    const float offsetCents = 100.f * static_cast<float>(mSamplerParams.osc1.pitchOffsetSemitones)
+            + mSamplerParams.osc1.detuneOffsetCents;
+    mDetuneRatio = std::pow(2.f, offsetCents / 1200.f);
+
     mSamplerParams.filter.stages = juce::roundToInt(getParameterValue(kParameterFilterStages));
     mSamplerParams.filter.cutoff = getParameterValue(kParameterFilterCutoff);
     mSamplerParams.filter.resonance = getParameterValue(kParameterFilterResonance);
@@ -282,6 +549,11 @@ void AKSamplerProcessorEx::onParseHeader(const sfz::SourceRange& /*range*/,
 {
     if (header == "group") {
         setDefaultOpcodeValues();
+    } else if (header == "region") {
+        mRegionOpcodes = mGroupOpcodes;
+        mOpcodes = &mRegionOpcodes;
+    } else {
+        mOpcodes = &mGroupOpcodes;
     }
 }
 
@@ -289,24 +561,55 @@ void AKSamplerProcessorEx::onParseOpcode(const sfz::SourceRange& /*rangeOpcode*/
                                          const sfz::SourceRange& /*rangeValue*/,
                                          const std::string& name, const std::string& value)
 {
+    SfzOpcodes& op = *mOpcodes;
+
     if (name == "pitch_keycenter") {
-        mPitchKeycenter = parseOpcodeIntValue(name, value);
+        op.pitchKeycenter = parseOpcodeIntValue(name, value);
     } else if (name == "lokey") {
-        mLoKey = parseOpcodeIntValue(name, value);
+        op.loKey = parseOpcodeIntValue(name, value);
     } else if (name == "hikey") {
-        mHiKey = parseOpcodeIntValue(name, value);
+        op.hiKey = parseOpcodeIntValue(name, value);
     } else if (name == "lovel") {
-        mLoVel = parseOpcodeIntValue(name, value);
+        op.loVel = parseOpcodeIntValue(name, value);
     } else if (name == "hivel") {
-        mHiVel = parseOpcodeIntValue(name, value);
+        op.hiVel = parseOpcodeIntValue(name, value);
     } else if (name == "loop_start") {
-        mLoopStart = parseOpcodeIntValue(name, value);
+        op.loopStart = parseOpcodeIntValue(name, value);
     } else if (name == "loop_end") {
-        mLoopEnd = parseOpcodeIntValue(name, value);
+        op.loopEnd = parseOpcodeIntValue(name, value);
     } else if (name == "loop_mode") {
-        mLoopMode = value;
+        op.loopMode = value;
     } else if (name == "sample") {
-        mSample = value;
+        op.sample = value;
+    } else if (name == "trigger") {
+        // first and legato play like attack, there is no legato tracking
+        op.releaseTrigger = (value == "release") || (value == "release_key");
+    } else if (name == "offset") {
+        op.offset = parseOpcodeIntValue(name, value);
+    } else if (name == "seq_length") {
+        op.seqLength = parseOpcodeIntValue(name, value);
+    } else if (name == "seq_position") {
+        op.seqPosition = parseOpcodeIntValue(name, value);
+    } else if (name == "xfin_lokey") {
+        op.xfinLoKey = parseOpcodeIntValue(name, value);
+    } else if (name == "xfin_hikey") {
+        op.xfinHiKey = parseOpcodeIntValue(name, value);
+    } else if (name == "xfout_lokey") {
+        op.xfoutLoKey = parseOpcodeIntValue(name, value);
+    } else if (name == "xfout_hikey") {
+        op.xfoutHiKey = parseOpcodeIntValue(name, value);
+    } else if (name == "xfin_lovel") {
+        op.xfinLoVel = parseOpcodeIntValue(name, value);
+    } else if (name == "xfin_hivel") {
+        op.xfinHiVel = parseOpcodeIntValue(name, value);
+    } else if (name == "xfout_lovel") {
+        op.xfoutLoVel = parseOpcodeIntValue(name, value);
+    } else if (name == "xfout_hivel") {
+        op.xfoutHiVel = parseOpcodeIntValue(name, value);
+    } else if (name == "group") {
+        op.group = parseOpcodeIntValue(name, value);
+    } else if (name == "off_by") {
+        op.offBy = parseOpcodeIntValue(name, value);
     }
 }
 
@@ -323,34 +626,50 @@ void AKSamplerProcessorEx::onParseFullBlock(const std::string& header,
         return;
     }
 
-    if (mSample.empty()) {
+    SfzOpcodes& op = mRegionOpcodes;
+
+    if (op.sample.empty()) {
         mErrorMessage = "Empty filename in sample opcode";
         return;
     }
 
-    std::replace(mSample.begin(), mSample.end(), '\\', '/');
-    const std::filesystem::path samplePath = mSfzPath.parent_path().append(mSample).make_preferred();
+    std::replace(op.sample.begin(), op.sample.end(), '\\', '/');
+    const std::filesystem::path samplePath =
+            mLoadingSfzPath.parent_path().append(op.sample).make_preferred();
 
     AKSampleFileDescriptor sfd;
     sfd.path = samplePath.c_str();
-    sfd.sd.bLoop = mLoopMode != "no_loop";
-    sfd.sd.fStart = 0.0;
-    sfd.sd.fLoopStart = static_cast<float>(mLoopStart);
-    sfd.sd.fLoopEnd = static_cast<float>(mLoopEnd);
+    sfd.sd.bLoop = op.loopMode != "no_loop";
+    sfd.sd.fStart = static_cast<float>(op.offset);
+    sfd.sd.fLoopStart = static_cast<float>(op.loopStart);
+    sfd.sd.fLoopEnd = static_cast<float>(op.loopEnd);
     sfd.sd.fEnd = 0.0f;
-    sfd.sd.noteNumber = mPitchKeycenter;
+    sfd.sd.noteNumber = op.pitchKeycenter;
     sfd.sd.noteHz = 440.f * powf(2.f, (static_cast<float>(sfd.sd.noteNumber) - 69.f) / 12.f);
-    sfd.sd.min_note = mLoKey;
-    sfd.sd.max_note = mHiKey;
-    sfd.sd.min_vel = mLoVel;
-    sfd.sd.max_vel = mHiVel;
+    sfd.sd.min_note = op.loKey;
+    sfd.sd.max_note = op.hiKey;
+    sfd.sd.min_vel = op.loVel;
+    sfd.sd.max_vel = op.hiVel;
+    sfd.sd.bReleaseTrigger = op.releaseTrigger;
+    sfd.sd.seqLength = op.seqLength;
+    sfd.sd.seqPosition = op.seqPosition;
+    sfd.sd.xfinLoKey = op.xfinLoKey;
+    sfd.sd.xfinHiKey = op.xfinHiKey;
+    sfd.sd.xfoutLoKey = op.xfoutLoKey;
+    sfd.sd.xfoutHiKey = op.xfoutHiKey;
+    sfd.sd.xfinLoVel = op.xfinLoVel;
+    sfd.sd.xfinHiVel = op.xfinHiVel;
+    sfd.sd.xfoutLoVel = op.xfoutLoVel;
+    sfd.sd.xfoutHiVel = op.xfoutHiVel;
+    sfd.sd.group = op.group;
+    sfd.sd.offBy = op.offBy;
 
     if (samplePath.extension() == ".wv") {
-        if (! loadCompressedSampleFile(sfd)) {
+        if (! loadCompressedSampleFile(sfd, *mLoadingSampler)) {
             mErrorMessage = "Error loading compressed sample file";
         }
     } else {
-        if (! loadSampleFile(sfd)) {
+        if (! loadSampleFile(sfd, *mLoadingSampler)) {
             mErrorMessage = "Error loading sample file";
         }
     }
@@ -415,7 +734,7 @@ AKSamplerProcessorEx::createParameterLayout() noexcept
                 "Filter envelope amount", "",
                 /*min*/0, /*max*/1000.f, /*def*/0
         ),
-        createFloatParameter(
+        createSteppedParameter(
                 kParameterAmpEGBypass,
                 "Amplifier envelope generator bypass", "",
                 /*min*/0, /*max*/1.f, /*def*/0,
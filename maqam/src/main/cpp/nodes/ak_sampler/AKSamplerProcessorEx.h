@@ -11,6 +11,7 @@
 #include <array>
 #include <atomic>
 #include <filesystem>
+#include <mutex>
 
 #include <parser/Parser.h>
 #include <parser/ParserListener.h>
@@ -18,6 +19,8 @@
 #include "dsp/Plugin/JuceHeader.h"
 
 #include "AKSamplerProcessor.h"
+#include "TuningTable.h"
+#include "nodes/PreparedStateLoader.h"
 
 /**
  * This class extends AudioKit's AKSamplerProcessor:
@@ -26,8 +29,10 @@
  *   - Replace basic SFZ parsing code with the standard-compliant parser from Sfizz
  *   - Allow to optionally listen on a single MIDI channel
  *   - Avoid a race condition while loading sounds
- *   - Support 12-ET microtonal scales
+ *   - Support 12-ET microtonal scales, Scala scales and per-note retuning
  *   - Parameter for disabling ADSR envelope
+ *   - MPE lower zone with per-note pitch bend, pressure and timbre
+ *   - SFZ release triggers, round robin, velocity crossfades, choke groups and sample offset
  *
  */
 
@@ -36,10 +41,16 @@ namespace maqam {
 class AKSamplerProcessorEx : public AKSamplerProcessor
                            , private juce::AudioProcessorListener
                            , private sfz::ParserListener
+                           , public PreparedStateLoader
 {
 public:
     static constexpr int kMidiChannelOmni = 16; // out of range [0-15]
 
+    // MPE specification defaults
+    static constexpr int   kMpeMaxMemberChannels = 15;
+    static constexpr float kMpePitchBendRangeSemitones = 48.f;
+    static constexpr int   kMpeTimbreController = 74;
+
     // See PatchParams.h
     static constexpr const char* kParameterMainMasterLevel               = "main_master_level";
     static constexpr const char* kParameterMainPitchBendUpSemitones      = "main_pitchbend_up_semitones";
@@ -71,16 +82,76 @@ public:
     int  getMidiChannel() const noexcept { return mMidiChannel; }
     void setMidiChannel(int midiChannel) noexcept { mMidiChannel = midiChannel; }
 
+    // 0 disables MPE, otherwise channel 1 is the zone master and the next ones are members.
+    // While enabled it replaces the single MIDI channel setting.
+    int  getMpeMemberChannels() const noexcept { return mMpeMemberChannels; }
+    void setMpeMemberChannels(int numChannels) noexcept;
+
+    // Both replace a Scala tuning with 12-TET plus per pitch class offsets
     void setA4Frequency(float frequency) noexcept;
     void setScaleCents(std::array<int,12> centsFromC) noexcept;
 
+    // Keyboard mapping text is optional, throw std::runtime_error on parse errors
+    void setScalaTuning(const String& scale, const String& keyboardMapping);
+
+    // Sounding voices follow, as they do for all tuning changes
+    void retuneNote(int note, float frequency) noexcept;
+
+    // Keeps the samples loaded, AKSamplerProcessor unloads them. The graph releases its nodes
+    // before every offline render and when the stream settings change.
+    void releaseResources() override {}
+
     void processBlock(AudioBuffer<float>& buffer, MidiBuffer& midiMessages) override;
 
+    // Parameters plus the SFZ path, the base class XML patch format does not know about them
+    void getStateInformation(MemoryBlock& destData) override;
+    void setStateInformation(const void* data, int sizeInBytes) override;
+
+    // PreparedStateLoader, samples are decoded by prepareState()
+    void prepareState(const void* data, int sizeInBytes) override;
+    void applyPreparedState() override;
+    void releaseReplacedState() noexcept override;
+
 protected:
     void handleMidiEvent(const MidiMessage& message) noexcept override;
 
 private:
+    struct MpeChannel
+    {
+        int note; // sampler note number, -1 when none
+        AudioKitCore::NoteExpression expression;
+    };
+
+    // Opcode values of the SFZ header being parsed. Every region starts from the values of its
+    // group, so region opcodes do not leak into the next region.
+    struct SfzOpcodes
+    {
+        int         pitchKeycenter;
+        int         loKey, hiKey;
+        int         loVel, hiVel;
+        int         loopStart, loopEnd;
+        std::string loopMode;
+        std::string sample;
+        bool        releaseTrigger;
+        int         offset;
+        int         seqLength, seqPosition;
+        int         xfinLoKey, xfinHiKey;
+        int         xfoutLoKey, xfoutHiKey;
+        int         xfinLoVel, xfinHiVel;
+        int         xfoutLoVel, xfoutHiVel;
+        int         group, offBy;
+    };
+
+    void resetMpe() noexcept;
+    void setMpeExpression(int channel) noexcept;
+    void releaseMpeNote(int channel, int note) noexcept;
+    void retuneSoundingNotes() noexcept;
     void setDefaultOpcodeValues() noexcept;
+
+    // Throw std::runtime_error on parse or decode errors
+    std::unique_ptr<AKSampler> createSampler(const std::filesystem::path& sfzPath);
+    bool swapSampler(std::unique_ptr<AKSampler>& sampler) noexcept;
+    static void releaseSampler(std::unique_ptr<AKSampler> sampler) noexcept;
     int  parseOpcodeIntValue(const std::string& opcode, const std::string& value) noexcept;
 
     static void debugPrint(const AKSamplerParams& params) noexcept;
@@ -108,19 +179,33 @@ private:
     // AudioProcessorValueTreeState only handles RangedAudioParameter
     juce::AudioProcessorValueTreeState mParameters;
     AKSamplerParams mSamplerParams;
-    std::atomic<float> mA4Frequency;
-    std::array<std::atomic<int>,12> mCentsFromC;
+    float mDetuneRatio;
+
+    TuningTable mTuning;
+    std::mutex mTuningMutex;
+    float mA4Frequency;
+    std::array<int,12> mCentsFromC;
 
     std::atomic_flag mSamplerBusy;
     std::filesystem::path mSfzPath;
 
+    // Loading and state restore, samples are decoded into mLoadingSampler
+    std::mutex mLoadMutex;
+    AKSampler* mLoadingSampler;
+    std::filesystem::path mLoadingSfzPath;
+    std::unique_ptr<AKSampler> mPreparedSampler;
+    std::filesystem::path mPreparedSfzPath;
+    juce::ValueTree mPreparedState;
+    bool mSamplerReplaced;
+
     int mMidiChannel;
-    int mPitchKeycenter;
-    int mLoKey, mHiKey;
-    int mLoVel, mHiVel;
-    int mLoopStart, mLoopEnd;
-    std::string mLoopMode;
-    std::string mSample;
+
+    std::atomic<int> mMpeMemberChannels;
+    int mMpeActiveChannels; // audio thread copy
+    std::array<MpeChannel,16> mMpeChannels;
+    SfzOpcodes mGroupOpcodes;
+    SfzOpcodes mRegionOpcodes;
+    SfzOpcodes* mOpcodes; // the one opcodes are parsed into
     std::string mErrorMessage;
 
 };
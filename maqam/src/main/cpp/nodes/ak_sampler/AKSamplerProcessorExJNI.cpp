@@ -16,7 +16,7 @@ using namespace maqam;
 
 extern "C"
 JNIEXPORT void JNICALL
-Java_im_taqs_maqam_node_AKSampler_load(JNIEnv *env, jobject thiz, jstring path)
+Java_im_taqs_maqam_node_AKSampler_jniLoad(JNIEnv *env, jobject thiz, jstring path)
 {
     const char* cPath = env->GetStringUTFChars(path, nullptr);
 
@@ -80,3 +80,49 @@ Java_im_taqs_maqam_node_AKSampler_setScaleTuning(JNIEnv *env, jobject thiz, jint
 
     env->ReleaseIntArrayElements(cents_from_c, jcents, 0);
 }
+
+extern "C"
+JNIEXPORT void JNICALL
+Java_im_taqs_maqam_node_AKSampler_setScalaTuning(JNIEnv *env, jobject thiz, jstring scale,
+                                                 jstring keyboard_mapping)
+{
+    const char* cScale = env->GetStringUTFChars(scale, nullptr);
+    const char* cMapping = keyboard_mapping != nullptr
+            ? env->GetStringUTFChars(keyboard_mapping, nullptr) : nullptr;
+
+    try {
+        GET_DSP(env, thiz).setScalaTuning(String::fromUTF8(cScale),
+            cMapping != nullptr ? String::fromUTF8(cMapping) : String());
+    } catch (const std::exception& e) {
+        env->ThrowNew(env->FindClass("im/taqs/maqam/Library$Exception"), e.what());
+    }
+
+    if (cMapping != nullptr) {
+        env->ReleaseStringUTFChars(keyboard_mapping, cMapping);
+    }
+
+    env->ReleaseStringUTFChars(scale, cScale);
+}
+
+extern "C"
+JNIEXPORT void JNICALL
+Java_im_taqs_maqam_node_AKSampler_retuneNote(JNIEnv *env, jobject thiz, jint note,
+                                             jfloat frequency)
+{
+    GET_DSP(env, thiz).retuneNote(note, frequency);
+}
+
+extern "C"
+JNIEXPORT jint JNICALL
+Java_im_taqs_maqam_node_AKSampler_jniGetMpeMemberChannels(JNIEnv *env, jobject thiz)
+{
+    return GET_DSP(env, thiz).getMpeMemberChannels();
+}
+
+extern "C"
+JNIEXPORT void JNICALL
+Java_im_taqs_maqam_node_AKSampler_jniSetMpeMemberChannels(JNIEnv *env, jobject thiz,
+                                                          jint num_channels)
+{
+    GET_DSP(env, thiz).setMpeMemberChannels(num_channels);
+}
@@ -0,0 +1,279 @@
+//
+// Maqam - Mobile App Quick Audio & MIDI
+//
+// SPDX-FileCopyrightText: 2024 TAQS.IM <contact@taqs.im>
+// SPDX-License-Identifier: MIT
+//
+
+#include <cmath>
+#include <stdexcept>
+
+#include "TuningTable.h"
+
+using namespace juce;
+using namespace maqam;
+
+namespace {
+
+// Scala files use '!' for comments, anywhere else a line is data
+StringArray getDataLines(const String& text)
+{
+    StringArray lines;
+
+    for (const String& line : StringArray::fromLines(text)) {
+        if (! line.startsWithChar('!')) {
+            lines.add(line.trim());
+        }
+    }
+
+    return lines;
+}
+
+String getFirstToken(const String& line)
+{
+    return StringArray::fromTokens(line, " \t", "")[0];
+}
+
+int parseInt(const String& line, const char* what)
+{
+    const String token = getFirstToken(line);
+
+    if (token.isEmpty() || ! token.containsOnly("-+0123456789")) {
+        throw std::runtime_error(std::string("Invalid ") + what + " - " + line.toStdString());
+    }
+
+    return token.getIntValue();
+}
+
+int floorDiv(int a, int b) noexcept
+{
+    return (a >= 0) ? (a / b) : -((-a + b - 1) / b);
+}
+
+} // namespace
+
+TuningTable::Scale TuningTable::parseScale(const String& text)
+{
+    StringArray lines = getDataLines(text);
+
+    // First line is the description and may be empty, blank lines after it are ignored
+    if (lines.size() < 2) {
+        throw std::runtime_error("Scale file is too short");
+    }
+
+    lines.remove(0);
+    lines.removeEmptyStrings();
+
+    const int count = parseInt(lines[0], "scale size");
+
+    if ((count < 1) || (count >= lines.size())) {
+        throw std::runtime_error("Scale size does not match the number of pitches");
+    }
+
+    Scale scale;
+    scale.cents.reserve(static_cast<size_t>(count));
+
+    for (int i = 1; i <= count; ++i) {
+        const String pitch = getFirstToken(lines[i]);
+        double cents;
+
+        if (pitch.isEmpty() || ! pitch.containsOnly("-+0123456789./")) {
+            throw std::runtime_error("Invalid pitch - " + lines[i].toStdString());
+        }
+
+        if (pitch.containsChar('.')) {
+            cents = pitch.getDoubleValue();
+        } else {
+            const double numerator = pitch.upToFirstOccurrenceOf("/", false, false)
+                    .getDoubleValue();
+            const double denominator = pitch.containsChar('/')
+                    ? pitch.fromFirstOccurrenceOf("/", false, false).getDoubleValue() : 1.0;
+
+            if ((numerator <= 0) || (denominator <= 0)) {
+                throw std::runtime_error("Invalid ratio - " + lines[i].toStdString());
+            }
+
+            cents = 1200.0 * std::log2(numerator / denominator);
+        }
+
+        scale.cents.push_back(cents);
+    }
+
+    if (scale.cents.back() <= 0) {
+        throw std::runtime_error("Scale period must be positive");
+    }
+
+    return scale;
+}
+
+TuningTable::KeyboardMapping TuningTable::parseKeyboardMapping(const String& text)
+{
+    StringArray lines = getDataLines(text);
+    lines.removeEmptyStrings();
+
+    if (lines.size() < 7) {
+        throw std::runtime_error("Keyboard mapping file is too short");
+    }
+
+    KeyboardMapping mapping {
+        .size = parseInt(lines[0], "map size"),
+        .firstNote = parseInt(lines[1], "first note"),
+        .lastNote = parseInt(lines[2], "last note"),
+        .middleNote = parseInt(lines[3], "middle note"),
+        .referenceNote = parseInt(lines[4], "reference note"),
+        .referenceFrequency = getFirstToken(lines[5]).getDoubleValue(),
+        .octaveDegree = parseInt(lines[6], "octave degree"),
+        .degrees = {}
+    };
+
+    const auto isNote = [](int note) { return (note >= 0) && (note < kNumNotes); };
+
+    if ((mapping.size < 0) || ! isNote(mapping.firstNote) || ! isNote(mapping.lastNote)
+            || ! isNote(mapping.middleNote) || ! isNote(mapping.referenceNote)
+            || (mapping.referenceFrequency <= 0) || (mapping.octaveDegree < 0)) {
+        throw std::runtime_error("Invalid keyboard mapping header");
+    }
+
+    // Missing entries at the end are unmapped keys
+    for (int i = 0; i < mapping.size; ++i) {
+        const int line = 7 + i;
+
+        if ((line >= lines.size()) || getFirstToken(lines[line]).equalsIgnoreCase("x")) {
+            mapping.degrees.push_back(-1);
+        } else {
+            mapping.degrees.push_back(parseInt(lines[line], "mapping entry"));
+        }
+    }
+
+    return mapping;
+}
+
+TuningTable::KeyboardMapping TuningTable::createDefaultKeyboardMapping(float a4Frequency) noexcept
+{
+    return {
+        .size = 0,
+        .firstNote = 0,
+        .lastNote = kNumNotes - 1,
+        .middleNote = 60,
+        .referenceNote = 60,
+        .referenceFrequency = a4Frequency * std::pow(2.0, -9.0 / 12.0),
+        .octaveDegree = 0,
+        .degrees = {}
+    };
+}
+
+TuningTable::Frequencies TuningTable::computeFrequencies(const Scale& scale,
+                                                         const KeyboardMapping& mapping)
+{
+    const int numDegrees = static_cast<int>(scale.cents.size());
+    const int octaveDegree = mapping.octaveDegree > 0 ? mapping.octaveDegree : numDegrees;
+
+    // Returns false for unmapped keys
+    const auto getNoteCents = [&](int note, double& cents) {
+        const int offset = note - mapping.middleNote;
+
+        if (mapping.size == 0) {
+            cents = getDegreeCents(scale, offset);
+            return true;
+        }
+
+        const int octave = floorDiv(offset, mapping.size);
+        const int degree = mapping.degrees[static_cast<size_t>(offset - octave * mapping.size)];
+
+        if (degree < 0) {
+            return false;
+        }
+
+        cents = octave * getDegreeCents(scale, octaveDegree) + getDegreeCents(scale, degree);
+        return true;
+    };
+
+    double referenceCents;
+
+    if (! getNoteCents(mapping.referenceNote, referenceCents)) {
+        throw std::runtime_error("Keyboard mapping reference note is not mapped");
+    }
+
+    Frequencies frequencies {};
+
+    for (int note = mapping.firstNote; note <= mapping.lastNote; ++note) {
+        double cents;
+
+        if (getNoteCents(note, cents)) {
+            frequencies[static_cast<size_t>(note)] = static_cast<float>(
+                    mapping.referenceFrequency * std::pow(2.0, (cents - referenceCents) / 1200.0));
+        }
+    }
+
+    return frequencies;
+}
+
+TuningTable::Frequencies TuningTable::computeFrequencies(float a4Frequency,
+                                                         const std::array<int,12>& centsFromC) noexcept
+{
+    Frequencies frequencies {};
+
+    for (int note = 0; note < kNumNotes; ++note) {
+        const double semitones = note - 69 + centsFromC[static_cast<size_t>(note % 12)] / 100.0;
+        frequencies[static_cast<size_t>(note)] =
+                static_cast<float>(a4Frequency * std::pow(2.0, semitones / 12.0));
+    }
+
+    return frequencies;
+}
+
+TuningTable::TuningTable() noexcept
+    : mPending(computeFrequencies(440.f, {}))
+    , mVersion(0)
+    , mActiveVersion(0)
+    , mActive(mPending)
+    , mPrevious(mPending)
+{}
+
+void TuningTable::publish(const Frequencies& frequencies) noexcept
+{
+    const SpinLock::ScopedLockType lock(mLock);
+    mPending = frequencies;
+    mVersion.fetch_add(1, std::memory_order_release);
+}
+
+void TuningTable::setNoteFrequency(int note, float frequency) noexcept
+{
+    if ((note < 0) || (note >= kNumNotes)) {
+        return;
+    }
+
+    const SpinLock::ScopedLockType lock(mLock);
+    mPending[static_cast<size_t>(note)] = frequency;
+    mVersion.fetch_add(1, std::memory_order_release);
+}
+
+bool TuningTable::update() noexcept
+{
+    if (mVersion.load(std::memory_order_acquire) == mActiveVersion) {
+        return false;
+    }
+
+    // Taken again next block if a writer holds it
+    const SpinLock::ScopedTryLockType lock(mLock);
+
+    if (! lock.isLocked()) {
+        return false;
+    }
+
+    mPrevious = mActive;
+    mActive = mPending;
+    mActiveVersion = mVersion.load(std::memory_order_relaxed);
+
+    return true;
+}
+
+double TuningTable::getDegreeCents(const Scale& scale, int degree) noexcept
+{
+    const int numDegrees = static_cast<int>(scale.cents.size());
+    const int octave = floorDiv(degree, numDegrees);
+    const int index = degree - octave * numDegrees;
+
+    return octave * scale.cents.back()
+            + (index == 0 ? 0.0 : scale.cents[static_cast<size_t>(index - 1)]);
+}
@@ -0,0 +1,92 @@
+//
+// Maqam - Mobile App Quick Audio & MIDI
+//
+// SPDX-FileCopyrightText: 2024 TAQS.IM <contact@taqs.im>
+// SPDX-License-Identifier: MIT
+//
+
+#ifndef TUNING_TABLE_H
+#define TUNING_TABLE_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#include <juce_core/juce_core.h>
+
+namespace maqam {
+
+/**
+ * Frequency of every MIDI note, computed off the audio thread from 12-TET offsets or from Scala
+ * scale (.scl) and keyboard mapping (.kbm) files, which cover maqam tunings with quarter tones and
+ * other non-12 divisions. A new table is published whole: writers fill a pending copy under a
+ * spin lock and the audio thread takes it with a single try-lock and copy at the start of a block,
+ * so it never sees a table that is only partly updated. Note-on is then a plain array lookup.
+ */
+class TuningTable
+{
+public:
+    static constexpr int kNumNotes = 128;
+
+    using Frequencies = std::array<float, kNumNotes>;
+
+    // Degrees 1 to N in cents, the last one is the period, usually 1200
+    struct Scale
+    {
+        std::vector<double> cents;
+    };
+
+    struct KeyboardMapping
+    {
+        int              size;
+        int              firstNote;
+        int              lastNote;
+        int              middleNote;
+        int              referenceNote;
+        double           referenceFrequency;
+        int              octaveDegree;
+        std::vector<int> degrees; // -1 is an unmapped key
+    };
+
+    // Throw std::runtime_error on malformed input
+    static Scale parseScale(const juce::String& text);
+    static KeyboardMapping parseKeyboardMapping(const juce::String& text);
+
+    // Scala's default, middle C is degree 0 and A4 sets the reference
+    static KeyboardMapping createDefaultKeyboardMapping(float a4Frequency) noexcept;
+
+    // Unmapped notes get 0 Hz
+    static Frequencies computeFrequencies(const Scale& scale, const KeyboardMapping& mapping);
+    static Frequencies computeFrequencies(float a4Frequency,
+                                          const std::array<int,12>& centsFromC) noexcept;
+
+    TuningTable() noexcept;
+
+    // Any thread except the audio thread
+    void publish(const Frequencies& frequencies) noexcept;
+    void setNoteFrequency(int note, float frequency) noexcept;
+
+    // Audio thread, true when a newer table was taken. getPreviousFrequency() then returns the
+    // value before the change so the caller can retune only the notes that moved.
+    bool update() noexcept;
+    float getFrequency(int note) const noexcept { return mActive[note]; }
+    float getPreviousFrequency(int note) const noexcept { return mPrevious[note]; }
+
+private:
+    static double getDegreeCents(const Scale& scale, int degree) noexcept;
+
+    juce::SpinLock        mLock;
+    Frequencies           mPending;
+    std::atomic<uint32_t> mVersion;
+
+    // Audio thread
+    uint32_t    mActiveVersion;
+    Frequencies mActive;
+    Frequencies mPrevious;
+
+};
+
+} // maqam
+
+#endif // TUNING_TABLE_H
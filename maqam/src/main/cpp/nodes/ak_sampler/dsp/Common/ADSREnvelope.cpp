@@ -107,6 +107,13 @@ namespace AudioKitCore
         env.advanceToSegment(kRelease);
     }
 
+    void ADSREnvelope::damp()
+    {
+        // updateParams() restores the release length on the next start
+        envDesc[kRelease].lengthSamples = envDesc[kSilence].lengthSamples;
+        env.advanceToSegment(kRelease);
+    }
+
     void ADSREnvelope::reset()
     {
         env.reset(&envDesc);
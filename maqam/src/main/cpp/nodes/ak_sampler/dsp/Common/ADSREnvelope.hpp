@@ -57,6 +57,7 @@ namespace AudioKitCore
         void start();       // called for note-on
         void restart();     // quickly dampen note then start again
         void release();     // called for note-off
+        void damp();        // quick 10 mSec release, e.g. for a choked voice
         void reset();       // reset to idle state
         bool isIdle() { return env.getCurrentSegmentIndex() == kIdle; }
         bool isPreStarting() { return env.getCurrentSegmentIndex() == kSilence; }
@@ -74,6 +75,11 @@ namespace AudioKitCore
             return sample;
         }
 
+        inline void getSamples(float* out, int n)
+        {
+            env.getSamples(out, n);
+        }
+
     protected:
         MultiSegmentEnvelopeGenerator env;
         MultiSegmentEnvelopeGenerator::Descriptor envDesc;
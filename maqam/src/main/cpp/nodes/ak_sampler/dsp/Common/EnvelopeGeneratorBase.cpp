@@ -18,13 +18,12 @@ namespace AudioKitCore
         isHorizontal = targetValue == initialValue;
         isLinear = tco <= 0.0;
         isRising = targetValue > initialValue;
+        tcount = 0;
+        segLength = segmentLengthSamples;
 
-        if (isHorizontal)
-        {
-            tcount = 0;
-            segLength = segmentLengthSamples;
-        }
-        else if (isLinear)
+        if (isHorizontal) return;
+
+        if (isLinear)
         {
             if (segmentLengthSamples <= 0)
                 coefficient = target - output;
@@ -37,17 +36,23 @@ namespace AudioKitCore
             {
                 coefficient = 0.0;
                 offset = target;
+                asymptote = target;
             }
             else
             {
                 // Correction to Pirkle (who uses delta = 1.0 always)
                 // According to Redmon (who only discusses the delta = 1.0 case), delta should be defined thus
-                double delta = abs(targetValue - initialValue);
+                double delta = std::abs(targetValue - initialValue);
                 coefficient = exp(-log((delta + tco) / tco) / segmentLengthSamples);
-                if (isRising)
-                    offset = (target + tco) * (1.0 - coefficient);
-                else
-                    offset = (target - tco) * (1.0 - coefficient);
+                asymptote = isRising ? target + tco : target - tco;
+                offset = asymptote * (1.0 - coefficient);
+            }
+
+            double power = 1.0;
+            for (int j = 0; j < kBlockLanes; j++)
+            {
+                power *= coefficient;
+                powers[j] = power;
             }
         }
     }
@@ -6,7 +6,7 @@
 //  Copyright © 2018 AudioKit. All rights reserved.
 //
 #pragma once
-#include <vector>
+#include <algorithm>
 
 namespace AudioKitCore
 {
@@ -23,6 +23,8 @@ namespace AudioKitCore
     class ExponentialSegmentGenerator
     {
     public:
+        static constexpr int kBlockLanes = 8;
+
         void reset(double initialValue, double targetValue, double tco, int segmentLengthSamples);
 
         inline float getValue()
@@ -40,19 +42,69 @@ namespace AudioKitCore
             }
             else
             {
+                ++tcount;
                 if (isLinear)
                     output += coefficient;
                 else
                     output = offset + coefficient * output;
+                // Ends after segLength samples at the latest, rounding can keep output short of
+                // target for one more sample. Same length as getSamples().
                 bool overshoot = isRising ? (output >= target) : (output <= target);
-                if (overshoot) output = target;
+                bool ended = overshoot || (tcount >= segLength);
+                if (ended) output = target;
                 out = float(output);
-                return overshoot;
+                return ended;
             }
         }
 
+        // Block version of getSample(). Renders up to n samples of the current segment and sets
+        // count to the number rendered, returns true if the segment ended within them. The
+        // recurrence is evaluated in closed form, x[k] = A + (x[0] - A) * c^k, kBlockLanes
+        // samples at a time so the inner loop has no dependency between samples.
+        inline bool getSamples(float* out, int n, int& count)
+        {
+            if (isHorizontal)
+            {
+                count = segLength < 0 ? n : std::min(n, std::max(segLength - tcount, 1));
+                std::fill(out, out + count, float(target));
+                if (segLength < 0) return false;
+                tcount += count;
+                return tcount >= segLength;
+            }
+
+            const int remaining = std::max(segLength - tcount, 1);
+            count = std::min(n, remaining);
+
+            if (isLinear)
+            {
+                for (int k = 0; k < count; k++)
+                    out[k] = float(output + (k + 1) * coefficient);
+                output += count * coefficient;
+            }
+            else
+            {
+                double delta = output - asymptote;
+                for (int base = 0; base < count; base += kBlockLanes)
+                {
+                    const int lanes = std::min(kBlockLanes, count - base);
+                    for (int j = 0; j < lanes; j++)
+                        out[base + j] = float(asymptote + delta * powers[j]);
+                    output = asymptote + delta * powers[lanes - 1];
+                    delta *= powers[kBlockLanes - 1];
+                }
+            }
+
+            tcount += count;
+            if (count < remaining) return false;
+            output = target;
+            out[count - 1] = float(target);
+            return true;
+        }
+
     protected:
         double output, target, offset, coefficient;
+        double asymptote;               // value the exponential approaches, target overshot by tco
+        double powers[kBlockLanes];     // coefficient^1 .. coefficient^kBlockLanes
         bool isRising;
         bool isHorizontal;
         int tcount, segLength;
@@ -69,7 +121,20 @@ namespace AudioKitCore
             double tco;
             int lengthSamples;
         };
-        typedef std::vector<SegmentDescriptor> Descriptor;
+
+        // Fixed capacity, filling or updating one never allocates
+        struct Descriptor
+        {
+            static constexpr int kMaxSegments = 8;
+
+            SegmentDescriptor segment[kMaxSegments];
+            int count = 0;
+
+            void clear() { count = 0; }
+            void push_back(const SegmentDescriptor& seg) { if (count < kMaxSegments) segment[count++] = seg; }
+            int size() const { return count; }
+            SegmentDescriptor& operator[](int index) { return segment[index]; }
+        };
 
         void reset(Descriptor* pDesc, int initialSegmentIndex = 0);
         void advanceToSegment(int segIndex);
@@ -91,6 +156,32 @@ namespace AudioKitCore
             return false;
         }
 
+        // Block version of getSample(), fills all n samples and returns true if the last segment
+        // ended within them
+        inline bool getSamples(float* out, int n)
+        {
+            bool finished = false;
+            while (n > 0)
+            {
+                int count;
+                if (ExponentialSegmentGenerator::getSamples(out, n, count))
+                {
+                    if (++curSegIndex >= segments->size())
+                    {
+                        reset(segments);
+                        finished = true;
+                    }
+                    else
+                    {
+                        setupCurSeg();
+                    }
+                }
+                out += count;
+                n -= count;
+            }
+            return finished;
+        }
+
         int getCurrentSegmentIndex() { return curSegIndex; }
 
     protected:
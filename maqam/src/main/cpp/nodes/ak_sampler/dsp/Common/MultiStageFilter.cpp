@@ -38,12 +38,20 @@ namespace AudioKitCore
         stages = nStages;
 
         for (int i=1; i < stages; i++)
-            stage[i].setParams(stage[0].mLastCutoffHz, stage[0].mLastResLinear);
+            stage[i].copyParams(stage[0]);
     }
     
+    // All stages share the same cutoff and resonance, coefficients are computed once
     void MultiStageFilter::setParams(double newCutoffHz, double newResLinear)
     {
-        for (int i=0; i < stages; i++) stage[i].setParams(newCutoffHz, newResLinear);
+        if (stages == 0) return;
+        stage[0].setParams(newCutoffHz, newResLinear);
+        for (int i=1; i < stages; i++) stage[i].copyParams(stage[0]);
+    }
+
+    void MultiStageFilter::copyParams(const MultiStageFilter& other)
+    {
+        for (int i=0; i < stages; i++) stage[i].copyParams(other.stage[0]);
     }
     
     float MultiStageFilter::process(float sample)
@@ -53,4 +61,26 @@ namespace AudioKitCore
         return sample;
     }
 
+    void MultiStageFilter::process(float* samples, int nSamples)
+    {
+        if (nSamples <= 0) return;
+
+        if (stages == 0 || stage[0].mIsOpen)
+        {
+            // keep the stages primed with the input so engaging them again is smooth
+            float last = samples[nSamples - 1];
+            float previous = nSamples > 1 ? samples[nSamples - 2] : stage[0].x1;
+            for (int i=0; i < stages; i++) stage[i].setPassthroughState(previous, last);
+            return;
+        }
+
+        switch (stages)
+        {
+            case 1: processStages<1>(samples, nSamples); break;
+            case 2: processStages<2>(samples, nSamples); break;
+            case 3: processStages<3>(samples, nSamples); break;
+            default: processStages<maxStages>(samples, nSamples); break;
+        }
+    }
+
 }
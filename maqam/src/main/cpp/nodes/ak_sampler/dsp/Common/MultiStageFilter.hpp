@@ -31,8 +31,20 @@ namespace AudioKitCore
 
         void setStages(int nStages);
         void setParams(double newCutoffHz, double newResLinear);
+        void copyParams(const MultiStageFilter& other);
         
         float process(float sample);
+
+        // Filters a block in place. The variant is chosen once per block: bypass when there are
+        // no stages or the cutoff is open, otherwise one unrolled stage count.
+        void process(float* samples, int nSamples);
+
+    private:
+        template<int nStages>
+        void processStages(float* samples, int nSamples)
+        {
+            for (int i=0; i < nStages; i++) stage[i].process(samples, samples, nSamples);
+        }
     };
 
 }
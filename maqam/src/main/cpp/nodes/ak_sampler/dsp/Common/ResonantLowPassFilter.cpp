@@ -39,6 +39,7 @@ namespace AudioKitCore
         sampleRateHz = samplingRateHz;
         x1 = x2 = y1 = y2 = 0.0;
         mLastCutoffHz = mLastResLinear = -1.0;  // force recalc of coefficients
+        mIsOpen = false;
     }
     
     void ResonantLowPassFilter::setParams(double newCutoffHz, double newResLinear)
@@ -52,6 +53,7 @@ namespace AudioKitCore
         
         // convert cutoff from Hz to 0->1 normalized frequency
         double cutoff = 2.0 * newCutoffHz / sampleRateHz;
+        mIsOpen = cutoff >= 0.99;           // any resonance peak sits above the audible range
         if (cutoff > 0.99) cutoff = 0.99;   // clip
         
         mLastCutoffHz = newCutoffHz;
@@ -69,20 +71,40 @@ namespace AudioKitCore
         b2 = 2.0 * c1;
     }
     
+    void ResonantLowPassFilter::copyParams(const ResonantLowPassFilter& other)
+    {
+        a0 = other.a0;
+        a1 = other.a1;
+        a2 = other.a2;
+        b1 = other.b1;
+        b2 = other.b2;
+        mLastCutoffHz = other.mLastCutoffHz;
+        mLastResLinear = other.mLastResLinear;
+        mIsOpen = other.mIsOpen;
+    }
+
     void ResonantLowPassFilter::process(const float *sourceP, float *destP, int inFramesToProcess)
     {
+        // state in locals, the compiler cannot keep members in registers across the stores
+        double sx1 = x1, sx2 = x2, sy1 = y1, sy2 = y2;
+
         while (inFramesToProcess--)
         {
             float inputSample = *sourceP++;
-            float outputSample = (float)(a0*inputSample + a1*x1 + a2*x2 - b1*y1 - b2*y2);
+            float outputSample = (float)(a0*inputSample + a1*sx1 + a2*sx2 - b1*sy1 - b2*sy2);
 
-            x2 = x1;
-            x1 = inputSample;
-            y2 = y1;
-            y1 = outputSample;
+            sx2 = sx1;
+            sx1 = inputSample;
+            sy2 = sy1;
+            sy1 = outputSample;
             
             *destP++ = outputSample;
         }
+
+        x1 = sx1;
+        x2 = sx2;
+        y1 = sy1;
+        y2 = sy2;
     }
 
 }
@@ -26,6 +26,7 @@ namespace AudioKitCore
         
         // misc
         double sampleRateHz, mLastCutoffHz, mLastResLinear;
+        bool mIsOpen;   // cutoff clipped just below Nyquist, output is indistinguishable from input
         
         ResonantLowPassFilter();
         
@@ -35,6 +36,11 @@ namespace AudioKitCore
         void setParams(double newCutoffHz, double newResLinear);
         void setCutoff(double newCutoffHz) { setParams(newCutoffHz, mLastResLinear); }
         void setResonance(double newResLinear) { setParams(mLastCutoffHz, newResLinear); }
+        void copyParams(const ResonantLowPassFilter& other);
+        
+        // Seeds the state as if the filter had been passing the last two input samples through,
+        // so leaving the open state does not click
+        void setPassthroughState(float previous, float last) { x2 = y2 = previous; x1 = y1 = last; }
         
         void process(const float *inSourceP, float *inDestP, int inFramesToProcess);
 
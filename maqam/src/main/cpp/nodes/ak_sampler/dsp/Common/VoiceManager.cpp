@@ -7,6 +7,7 @@
 //
 
 #include "VoiceManager.hpp"
+#include <string.h>
 
 namespace AudioKitCore {
     
@@ -59,11 +60,12 @@ namespace AudioKitCore {
         return nVoices == polyphony;    // return true only if we got exactly what was requested
     }
 
-    void VoiceManager::playNote(unsigned noteNumber, unsigned velocity, float noteHz)
+    void VoiceManager::playNote(unsigned noteNumber, unsigned velocity, float noteHz, int layerCount)
     {
         eventCounter++;
         keyIsDown[noteNumber] = true;
-        play(noteNumber, velocity, noteHz);
+        for (int layer=0; layer < layerCount; layer++)
+            play(noteNumber, velocity, noteHz, layer);
     }
     
     void VoiceManager::stopNote(unsigned noteNumber, bool immediate)
@@ -74,6 +76,13 @@ namespace AudioKitCore {
             stop(noteNumber, immediate);
     }
     
+    void VoiceManager::playLayers(unsigned noteNumber, unsigned velocity, float noteHz, int layerCount)
+    {
+        eventCounter++;
+        for (int layer=0; layer < layerCount; layer++)
+            play(noteNumber, velocity, noteHz, layer);
+    }
+
     void VoiceManager::sustainPedal(bool down)
     {
         eventCounter++;
@@ -96,7 +105,7 @@ namespace AudioKitCore {
         }
     }
 
-    void VoiceManager::play(unsigned noteNumber, unsigned velocity, float noteHz)
+    void VoiceManager::play(unsigned noteNumber, unsigned velocity, float noteHz, int layer)
     {
         //printf("playNote nn=%d vel=%d %.2f Hz\n", noteNumber, velocity, noteHz);
         
@@ -107,14 +116,15 @@ namespace AudioKitCore {
             if (pVoice->noteNumber < 0)
             {
                 // found a free voice: assign it to play this note
-                float noteVolume = doVoicePrep(cbPtr, pVoice, noteNumber, velocity, noteHz);
+                float noteVolume = doVoicePrep(cbPtr, pVoice, noteNumber, velocity, noteHz, layer);
                 pVoice->start(eventCounter, noteNumber, noteHz, noteVolume);
                 //printf("Play note %d (%.2f Hz) vel %d\n", noteNumber, noteHz, velocity);
                 return;
             }
         }
         
-        // all oscillators in use: find "stalest" voice to steal
+        // all oscillators in use: find "stalest" voice to steal, never one started by this same
+        // event (its diff is 0) so layers of a note do not steal each other
         unsigned greatestDiffOfAll = 0;
         VoiceBase* pStalestVoiceOfAll = 0;
         unsigned greatestDiffInRelease = 0;
@@ -138,18 +148,13 @@ namespace AudioKitCore {
             }
         }
 
-        if (pStalestVoiceInRelease != 0)
-        {
-            // We have a stalest note in its release phase: restart that one
-            doVoicePrep(cbPtr, pStalestVoiceInRelease, noteNumber, velocity, noteHz);
-            pStalestVoiceInRelease->restart(eventCounter, noteNumber, noteHz, pStalestVoiceInRelease->noteVol);
-        }
-        else
-        {
-            // No notes in release phase: restart the "stalest" one we could find
-            doVoicePrep(cbPtr, pStalestVoiceOfAll, noteNumber, velocity, noteHz);
-            pStalestVoiceOfAll->restart(eventCounter, noteNumber, noteHz, pStalestVoiceOfAll->noteVol);
-        }
+        // We have a stalest note in its release phase: restart that one,
+        // otherwise restart the "stalest" one we could find
+        VoiceBase* pVoice = pStalestVoiceInRelease ? pStalestVoiceInRelease : pStalestVoiceOfAll;
+        if (pVoice == 0) return;    // more layers than voices
+
+        float noteVolume = doVoicePrep(cbPtr, pVoice, noteNumber, velocity, noteHz, layer);
+        pVoice->restart(eventCounter, noteNumber, noteHz, noteVolume);
     }
     
     void VoiceManager::stop(unsigned noteNumber, bool immediate)
@@ -20,7 +20,8 @@ namespace AudioKitCore
     class VoiceManager
     {
     public:
-        typedef float(*VoicePrepCallback)(void*, void*, unsigned, unsigned, float);
+        // the last argument is the index of the layer being prepared, see playNote()
+        typedef float(*VoicePrepCallback)(void*, void*, unsigned, unsigned, float, int);
         typedef void(*RenderPrepCallback)(void*);
 
         VoiceManager();
@@ -33,8 +34,12 @@ namespace AudioKitCore
 
         bool setPolyphony(int polyphony);
         
-        void playNote(unsigned noteNumber, unsigned velocity, float noteHz);
+        // starts one voice per layer, e.g. crossfaded samples that sound together
+        void playNote(unsigned noteNumber, unsigned velocity, float noteHz, int layerCount = 1);
         void stopNote(unsigned noteNumber, bool immediate);
+
+        // starts voices without pressing the key, e.g. samples triggered by note-off
+        void playLayers(unsigned noteNumber, unsigned velocity, float noteHz, int layerCount);
         void sustainPedal(bool down);
         void stopAll(void);
         
@@ -52,7 +57,7 @@ namespace AudioKitCore
         bool pedalIsDown;
 
         // actually start/stop notes
-        void play(unsigned noteNumber, unsigned velocity, float noteHz);
+        void play(unsigned noteNumber, unsigned velocity, float noteHz, int layer);
         void stop(unsigned noteNumber, bool immediate);
 
         // pointer to client-supplied function called just before rendering each block
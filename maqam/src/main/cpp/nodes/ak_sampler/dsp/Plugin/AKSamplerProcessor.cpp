@@ -276,7 +276,7 @@ AudioProcessor* JUCE_CALLTYPE createPluginFilter()
     return new AKSamplerProcessor();
 }
 
-bool AKSamplerProcessor::loadSampleFile(AKSampleFileDescriptor& sfd)
+bool AKSamplerProcessor::loadSampleFile(AKSampleFileDescriptor& sfd, AKSampler& sampler)
 {
     File f(sfd.path);
     std::unique_ptr<AudioFormatReader> reader(formatManager.createReaderFor(f));
@@ -303,12 +303,12 @@ bool AKSamplerProcessor::loadSampleFile(AKSampleFileDescriptor& sfd)
         }
     }
 
-    sampler1.loadSampleData(sdd);
+    sampler.loadSampleData(sdd);
     delete[] sdd.pData;
     return true;
 }
 
-bool AKSamplerProcessor::loadCompressedSampleFile(AKSampleFileDescriptor& sfd)
+bool AKSamplerProcessor::loadCompressedSampleFile(AKSampleFileDescriptor& sfd, AKSampler& sampler)
 {
     char errMsg[100];
     WavpackContext* wpc = WavpackOpenFileInput(sfd.path, errMsg, OPEN_2CH_MAX, 0);
@@ -347,7 +347,7 @@ bool AKSamplerProcessor::loadCompressedSampleFile(AKSampleFileDescriptor& sfd)
     }
     WavpackCloseFile(wpc);
 
-    sampler1.loadSampleData(sdd);
+    sampler.loadSampleData(sdd);
     delete[] sdd.pData;
     return true;
 }
@@ -485,18 +485,25 @@ bool AKSamplerProcessor::loadSfz(String folderPath, String sfzFileName)
             sfd.sd.max_note = hikey;
             sfd.sd.min_vel = lovel;
             sfd.sd.max_vel = hivel;
+            sfd.sd.bReleaseTrigger = false;
+            sfd.sd.seqLength = sfd.sd.seqPosition = 1;
+            sfd.sd.xfinLoKey = sfd.sd.xfinHiKey = 0;
+            sfd.sd.xfoutLoKey = sfd.sd.xfoutHiKey = 127;
+            sfd.sd.xfinLoVel = sfd.sd.xfinHiVel = 0;
+            sfd.sd.xfoutLoVel = sfd.sd.xfoutHiVel = 127;
+            sfd.sd.group = sfd.sd.offBy = 0;
 
             File f(buf);
             if (f.existsAsFile())
             {
-                loadSampleFile(sfd);
+                loadSampleFile(sfd, sampler1);
             }
             else
             {
                 char* px = strrchr(sampleFileName, '.');
                 strcpy(px, ".wv");
                 sprintf(buf, "%s%s", File::addTrailingSeparator(folderPath).toRawUTF8(), sampleFileName);
-                loadCompressedSampleFile(sfd);
+                loadCompressedSampleFile(sfd, sampler1);
             }
         }
     }
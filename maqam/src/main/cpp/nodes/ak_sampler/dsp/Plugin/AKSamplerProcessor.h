@@ -49,8 +49,9 @@ public:
     void getStateInformation (MemoryBlock& destData) override;
     void setStateInformation (const void* data, int sizeInBytes) override;
 
-    bool loadSampleFile(AKSampleFileDescriptor& sfd);
-    bool loadCompressedSampleFile(AKSampleFileDescriptor& sfd);
+    // Decode into the given sampler, it does not have to be the one playing
+    bool loadSampleFile(AKSampleFileDescriptor& sfd, AKSampler& sampler);
+    bool loadCompressedSampleFile(AKSampleFileDescriptor& sfd, AKSampler& sampler);
     bool loadSfz(String folderPath, String sfzFileName);
 
 public:
@@ -21,6 +21,15 @@ typedef struct
     float fLoopStart, fLoopEnd;
     float fStart, fEnd;
 
+    // SFZ region behavior
+    bool bReleaseTrigger;           // play on note-off instead of note-on
+    int seqLength, seqPosition;     // round robin, position is 1-based, length 1 always plays
+    int xfinLoKey, xfinHiKey;       // key fade-in, 0 0 is no fade
+    int xfoutLoKey, xfoutHiKey;     // key fade-out, 127 127 is no fade
+    int xfinLoVel, xfinHiVel;       // velocity fade-in, 0 0 is no fade
+    int xfoutLoVel, xfoutHiVel;     // velocity fade-out, 127 127 is no fade
+    int group, offBy;               // choke groups, 0 is none
+
 } AKSampleDescriptor;
 
 typedef struct
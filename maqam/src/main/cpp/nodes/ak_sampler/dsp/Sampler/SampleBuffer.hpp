@@ -7,6 +7,8 @@
 //
 
 #pragma once
+#include <math.h>
+
 namespace AudioKitCore
 {
 
@@ -79,6 +81,46 @@ namespace AudioKitCore
         int noteNumber;     // closest MIDI note-number to this sample's frequency (noteHz)
         int min_note, max_note;     // minimum and maximum note numbers for mapping
         int min_vel, max_vel;       // min/max MIDI velocities for mapping
+
+        // SFZ region behavior, see AKSampleDescriptor
+        bool bReleaseTrigger = false;
+        int seqLength = 1, seqPosition = 1;
+        int xfinLoKey = 0, xfinHiKey = 0;
+        int xfoutLoKey = 127, xfoutHiKey = 127;
+        int xfinLoVel = 0, xfinHiVel = 0;
+        int xfoutLoVel = 127, xfoutHiVel = 127;
+        int group = 0, offBy = 0;
+
+        unsigned seqCounter = 0;    // round robin state, counts note events this region matched
+
+        // equal-power key and velocity crossfade gain, 0.0 when the region is silent
+        inline float crossfadeGain(unsigned note, unsigned velocity)
+        {
+            return crossfade(int(note), xfinLoKey, xfinHiKey, xfoutLoKey, xfoutHiKey)
+                 * crossfade(int(velocity), xfinLoVel, xfinHiVel, xfoutLoVel, xfoutHiVel);
+        }
+
+        // fades in over [inLo, inHi] and out over [outLo, outHi], an empty range does not fade
+        static inline float crossfade(int value, int inLo, int inHi, int outLo, int outHi)
+        {
+            float gain = 1.0f;
+            if (value < inLo) return 0.0f;
+            if (inHi > inLo && value < inHi)
+                gain *= sqrtf(float(value - inLo) / float(inHi - inLo));
+            if (outHi > outLo)
+            {
+                if (value >= outHi) return 0.0f;
+                if (value > outLo) gain *= sqrtf(float(outHi - value) / float(outHi - outLo));
+            }
+            return gain;
+        }
+
+        // advances the round robin, true if this region's turn has come
+        inline bool nextInSequence()
+        {
+            if (seqLength <= 1) return true;
+            return int(seqCounter++ % unsigned(seqLength)) == seqPosition - 1;
+        }
     };
 
 }
@@ -9,11 +9,13 @@
 #include "Sampler.hpp"
 #include <math.h>
 #include <string.h>
+#include <algorithm>
 
 namespace AudioKitCore {
     
     Sampler::Sampler()
     : keyMapValid(false)
+    , pedalIsDown(false)
     , vibratoDepth(0.0f)
     , ampVelocitySensitivity(1.0f)
     , filterVelocitySensitivity(0.0f)
@@ -29,6 +31,14 @@ namespace AudioKitCore {
         modParams.cutoffEgStrength = 20.0f;
         modParams.filterQ = 1.0f;
         modParams.filterVel = 1.0f;
+        modParams.expressionSmoothing = 1.0f;
+        resetNoteExpression();
+
+        regionRuns.push_back({ 0, 0 });
+        memset(runIndex, 0, sizeof(runIndex));
+        memset(noteVelocity, 0, sizeof(noteVelocity));
+        memset(noteFrequency, 0, sizeof(noteFrequency));
+        memset(releasePending, 0, sizeof(releasePending));
 
         for (int i=0; i < MAX_POLYPHONY; i++)
         {
@@ -43,11 +53,14 @@ namespace AudioKitCore {
     
     int Sampler::init(double sampleRate)
     {
-        ampEGParams.updateSampleRate((float)(sampleRate/CHUNKSIZE));
+        ampEGParams.updateSampleRate((float)sampleRate);
         filterEGParams.updateSampleRate((float)(sampleRate/CHUNKSIZE));
         vibratoLFO.waveTable.sinusoid();
         vibratoLFO.init(sampleRate/CHUNKSIZE, 5.0f);
 
+        // 5 ms time constant for per-note expression, updated once per chunk
+        modParams.expressionSmoothing = float(1.0 - exp(-CHUNKSIZE / (0.005 * sampleRate)));
+
         //loadTestWaveform();
         buildKeyMap();
 
@@ -67,7 +80,9 @@ namespace AudioKitCore {
         keyMapValid = false;
         for (KeyMappedSampleBuffer* pBuf : sampleBufferList) delete pBuf;
         sampleBufferList.clear();
-        for (int i=0; i < MIDI_NOTENUMBERS; i++) keyMap[i].clear();
+        regionTable.clear();
+        regionRuns.resize(1);
+        memset(runIndex, 0, sizeof(runIndex));
     }
 
     void Sampler::setFilterStages(int n)
@@ -105,6 +120,19 @@ namespace AudioKitCore {
         pBuf->max_note = sdd.sd.max_note;
         pBuf->min_vel = sdd.sd.min_vel;
         pBuf->max_vel = sdd.sd.max_vel;
+        pBuf->bReleaseTrigger = sdd.sd.bReleaseTrigger;
+        pBuf->seqLength = sdd.sd.seqLength;
+        pBuf->seqPosition = sdd.sd.seqPosition;
+        pBuf->xfinLoKey = sdd.sd.xfinLoKey;
+        pBuf->xfinHiKey = sdd.sd.xfinHiKey;
+        pBuf->xfoutLoKey = sdd.sd.xfoutLoKey;
+        pBuf->xfoutHiKey = sdd.sd.xfoutHiKey;
+        pBuf->xfinLoVel = sdd.sd.xfinLoVel;
+        pBuf->xfinHiVel = sdd.sd.xfinHiVel;
+        pBuf->xfoutLoVel = sdd.sd.xfoutLoVel;
+        pBuf->xfoutHiVel = sdd.sd.xfoutHiVel;
+        pBuf->group = sdd.sd.group;
+        pBuf->offBy = sdd.sd.offBy;
         sampleBufferList.push_back(pBuf);
         
         pBuf->init(sdd.sampleRateHz, sdd.nChannels, sdd.nSamples);
@@ -123,8 +151,10 @@ namespace AudioKitCore {
         
         if (sdd.sd.fStart > 0.0f) pBuf->fStart = sdd.sd.fStart;
         if (sdd.sd.fEnd > 0.0f)   pBuf->fEnd = sdd.sd.fEnd;
+        if (pBuf->fStart > pBuf->fEnd) pBuf->fStart = pBuf->fEnd;   // offset past the end
         
-        pBuf->bLoop = sdd.sd.bLoop;
+        // release samples play once to their end, the key is already up so no note-off comes
+        pBuf->bLoop = sdd.sd.bLoop && !sdd.sd.bReleaseTrigger;
         if (pBuf->bLoop)
         {
             // fLoopStart, fLoopEnd are usually sample indices, but values 0.0-1.0
@@ -136,34 +166,12 @@ namespace AudioKitCore {
         }
     }
     
-    KeyMappedSampleBuffer* Sampler::lookupSample(unsigned noteNumber, unsigned velocity)
-    {
-        if (!keyMapValid) return nullptr;
-
-        // common case: only one sample mapped to this note - return it immediately
-        if (keyMap[noteNumber].size() == 1) return keyMap[noteNumber].front();
-        
-        // search samples mapped to this note for best choice based on velocity
-        for (KeyMappedSampleBuffer* pBuf : keyMap[noteNumber])
-        {
-            // if sample does not have velocity range, accept it trivially
-            if (pBuf->min_vel < 0 || pBuf->max_vel < 0) return pBuf;
-            
-            // otherwise (common case), accept based on velocity
-            if ((int)velocity >= pBuf->min_vel && (int)velocity <= pBuf->max_vel) return pBuf;
-        }
-        
-        // return nil if no samples mapped to note (or sample velocities are invalid)
-        return 0;
-    }
-    
-    // re-compute keyMap[] so every MIDI note number is automatically mapped to the sample buffer
-    // closest in pitch
+    // re-compute the region tables so every MIDI note number is automatically mapped to the
+    // sample buffers closest in pitch
     void Sampler::buildSimpleKeyMap()
     {
-        // clear out the old mapping entirely
         keyMapValid = false;
-        for (int i=0; i < MIDI_NOTENUMBERS; i++) keyMap[i].clear();
+        std::vector<KeyMappedSampleBuffer*> keyRegions[MIDI_NOTENUMBERS];
         
         for (int nn=0; nn < MIDI_NOTENUMBERS; nn++)
         {
@@ -184,39 +192,125 @@ namespace AudioKitCore {
                 int distance = abs(pBuf->noteNumber - nn);
                 if (distance == minDistance)
                 {
-                    keyMap[nn].push_back(pBuf);
+                    keyRegions[nn].push_back(pBuf);
                 }
             }
         }
+        buildRegionTables(keyRegions);
         keyMapValid = true;
     }
     
-    // rebuild keyMap based on explicit mapping data in samples
+    // rebuild the region tables based on explicit mapping data in samples
     void Sampler::buildKeyMap(void)
     {
-        // clear out the old mapping entirely
         keyMapValid = false;
-        for (int i=0; i < MIDI_NOTENUMBERS; i++) keyMap[i].clear();
+        std::vector<KeyMappedSampleBuffer*> keyRegions[MIDI_NOTENUMBERS];
 
         for (int nn=0; nn < MIDI_NOTENUMBERS; nn++)
         {
             for (KeyMappedSampleBuffer* pBuf : sampleBufferList)
             {
                 if (nn >= pBuf->min_note && nn <= pBuf->max_note)
-                    keyMap[nn].push_back(pBuf);
+                    keyRegions[nn].push_back(pBuf);
             }
         }
+        buildRegionTables(keyRegions);
         keyMapValid = true;
     }
 
+    void Sampler::buildRegionTables(const std::vector<KeyMappedSampleBuffer*> keyRegions[MIDI_NOTENUMBERS])
+    {
+        regionTable.clear();
+        regionRuns.resize(1);
+
+        std::vector<KeyMappedSampleBuffer*> run;
+        for (int trigger=0; trigger < kTriggerCount; trigger++)
+        {
+            for (int nn=0; nn < MIDI_NOTENUMBERS; nn++)
+            {
+                for (int vel=0; vel < MIDI_VELOCITIES; vel++)
+                {
+                    run.clear();
+                    for (KeyMappedSampleBuffer* pBuf : keyRegions[nn])
+                    {
+                        if (pBuf->bReleaseTrigger != (trigger == kReleaseTrigger)) continue;
+
+                        // if sample does not have velocity range, accept it trivially
+                        if (pBuf->min_vel < 0 || pBuf->max_vel < 0 ||
+                            (vel >= pBuf->min_vel && vel <= pBuf->max_vel))
+                            run.push_back(pBuf);
+                    }
+
+                    // neighbouring velocities usually select the same regions, share their run
+                    if (vel > 0)
+                    {
+                        const RegionRun& prev = regionRuns[runIndex[trigger][nn][vel - 1]];
+                        if (run.size() == prev.end - prev.begin &&
+                            std::equal(run.begin(), run.end(), regionTable.begin() + prev.begin))
+                        {
+                            runIndex[trigger][nn][vel] = runIndex[trigger][nn][vel - 1];
+                            continue;
+                        }
+                    }
+
+                    if (run.empty())
+                    {
+                        runIndex[trigger][nn][vel] = 0;
+                        continue;
+                    }
+
+                    unsigned begin = (unsigned)regionTable.size();
+                    regionTable.insert(regionTable.end(), run.begin(), run.end());
+                    regionRuns.push_back({ begin, (unsigned)regionTable.size() });
+                    runIndex[trigger][nn][vel] = (unsigned short)(regionRuns.size() - 1);
+                }
+            }
+        }
+    }
+
+    // O(regions mapped to this note and velocity), no allocation
+    int Sampler::selectRegions(int trigger, unsigned noteNumber, unsigned velocity)
+    {
+        if (!keyMapValid) return 0;
+
+        const RegionRun& run = regionRuns[runIndex[trigger][noteNumber][velocity]];
+        int layerCount = 0;
+        for (unsigned i = run.begin; i < run.end && layerCount < MAX_POLYPHONY; i++)
+        {
+            KeyMappedSampleBuffer* pBuf = regionTable[i];
+            if (!pBuf->nextInSequence()) continue;
+
+            float gain = pBuf->crossfadeGain(noteNumber, velocity);
+            if (gain <= 0.0f) continue;
+
+            layers[layerCount++] = { pBuf, gain };
+        }
+        return layerCount;
+    }
+
+    // silence voices whose off_by group matches one of the regions about to start
+    void Sampler::chokeGroups(int layerCount)
+    {
+        for (int layer=0; layer < layerCount; layer++)
+        {
+            int group = layers[layer].pRegion->group;
+            if (group == 0) continue;
+
+            for (int i=0; i < MAX_POLYPHONY; i++)
+                if (voice[i].noteNumber >= 0 && voice[i].offBy == group) voice[i].choke();
+        }
+    }
+
     float Sampler::voicePrepCallback(void* thisPtr, void* voicePtr,
-                                     unsigned noteNumber, unsigned velocity, float /*noteHz*/)
+                                     unsigned /*noteNumber*/, unsigned velocity, float /*noteHz*/, int layer)
     {
         Sampler& self = *((Sampler*)thisPtr);
         SamplerVoice* voice = (SamplerVoice*)voicePtr;
 
-        // assign the appropriate sample buffer, based on both note and velocity
-        voice->pSampleBuffer = self.lookupSample(noteNumber, velocity);
+        // assign the sample buffer of the region selected by selectRegions()
+        KeyMappedSampleBuffer* pRegion = self.layers[layer].pRegion;
+        voice->pSampleBuffer = pRegion;
+        voice->offBy = pRegion->offBy;
 
         // compute note volume and filter-velocity multipliers, based on velocity
         float velFraction = (velocity / 127.0f);
@@ -224,22 +318,85 @@ namespace AudioKitCore {
         float noteFVel = 1.0f - (self.filterVelocitySensitivity * (1.0f - velFraction));
         voice->noteFVel = noteFVel * noteFVel;   // filter-velocity effect is squared
 
-        return noteVolume;
+        return noteVolume * self.layers[layer].gain;
     }
 
     void Sampler::playNote(unsigned noteNumber, unsigned velocity, float noteHz)
     {
-        voiceManager.playNote(noteNumber, velocity, noteHz);
+        if (noteNumber >= MIDI_NOTENUMBERS) return;
+        if (velocity >= MIDI_VELOCITIES) velocity = MIDI_VELOCITIES - 1;
+
+        noteVelocity[noteNumber] = velocity;
+        noteFrequency[noteNumber] = noteHz;
+        releasePending[noteNumber] = false;
+
+        int layerCount = selectRegions(kAttackTrigger, noteNumber, velocity);
+        chokeGroups(layerCount);
+        voiceManager.playNote(noteNumber, velocity, noteHz, layerCount);
     }
 
     void Sampler::stopNote(unsigned noteNumber, bool immediate)
     {
+        if (noteNumber >= MIDI_NOTENUMBERS) return;
+
         voiceManager.stopNote(noteNumber, immediate);
+
+        if (immediate)
+        {
+            noteVelocity[noteNumber] = 0;
+            releasePending[noteNumber] = false;
+        }
+        else if (pedalIsDown)
+        {
+            // the note keeps sounding, so do its release samples wait for the pedal
+            releasePending[noteNumber] = true;
+        }
+        else
+        {
+            triggerRelease(noteNumber);
+        }
     }
 
     void Sampler::sustainPedal(bool down)
     {
         voiceManager.sustainPedal(down);
+        pedalIsDown = down;
+
+        if (!down)
+        {
+            for (unsigned nn=0; nn < MIDI_NOTENUMBERS; nn++)
+                if (releasePending[nn]) triggerRelease(nn);
+        }
+    }
+
+    // release-trigger regions sound once per note-on, with its velocity
+    void Sampler::triggerRelease(unsigned noteNumber)
+    {
+        unsigned velocity = noteVelocity[noteNumber];
+        noteVelocity[noteNumber] = 0;
+        releasePending[noteNumber] = false;
+        if (velocity == 0) return;
+
+        int layerCount = selectRegions(kReleaseTrigger, noteNumber, velocity);
+        chokeGroups(layerCount);
+        voiceManager.playLayers(noteNumber, velocity, noteFrequency[noteNumber], layerCount);
+    }
+
+    void Sampler::setNoteExpression(unsigned noteNumber, const NoteExpression& expression)
+    {
+        if (noteNumber < kNoteExpressions) modParams.noteExpression[noteNumber] = expression;
+    }
+
+    void Sampler::resetNoteExpression()
+    {
+        for (int i=0; i < kNoteExpressions; i++) modParams.noteExpression[i] = { 0.0f, 0.0f, 0.5f };
+    }
+
+    void Sampler::retuneNote(unsigned noteNumber, float noteHz)
+    {
+        if (noteNumber < MIDI_NOTENUMBERS) noteFrequency[noteNumber] = noteHz;
+        for (int i=0; i < MAX_POLYPHONY; i++)
+            if (voice[i].noteNumber == int(noteNumber)) voice[i].retune(noteHz);
     }
 
     void Sampler::stopAllVoices()
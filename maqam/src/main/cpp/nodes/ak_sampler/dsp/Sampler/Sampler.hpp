@@ -12,9 +12,11 @@
 #include "VoiceManager.hpp"
 
 #include <list>
+#include <vector>
 
 #define MAX_POLYPHONY 64        // number of voices
 #define MIDI_NOTENUMBERS 128    // MIDI offers 128 distinct note numbers
+#define MIDI_VELOCITIES 128     // and 128 distinct velocities
 #define CHUNKSIZE 16            // process samples in "chunks" this size
 
 namespace AudioKitCore
@@ -49,6 +51,14 @@ namespace AudioKitCore
         void playNote(unsigned noteNumber, unsigned velocity, float noteHz);
         void stopNote(unsigned noteNumber, bool immediate);
         void sustainPedal(bool down);
+
+        // changes the frequency of any voice sounding noteNumber, without restarting it
+        void retuneNote(unsigned noteNumber, float noteHz);
+
+        // per-note expression, voices sounding noteNumber follow it smoothly
+        void setNoteExpression(unsigned noteNumber, const NoteExpression& expression);
+        const NoteExpression& getNoteExpression(unsigned noteNumber) const { return modParams.noteExpression[noteNumber]; }
+        void resetNoteExpression();
         
         void Render(unsigned channelCount, unsigned sampleCount, float *outBuffers[]);
         
@@ -56,10 +66,29 @@ namespace AudioKitCore
         // list of (pointers to) all loaded samples
         std::list<KeyMappedSampleBuffer*> sampleBufferList;
         
-        // maps MIDI note numbers to "closest" samples (all velocity layers)
-        std::list<KeyMappedSampleBuffer*> keyMap[MIDI_NOTENUMBERS];
+        // Precomputed region selection. The regions of each trigger, note number and velocity are
+        // one contiguous run of regionTable, so note-on only visits the regions that can play.
+        enum { kAttackTrigger = 0, kReleaseTrigger, kTriggerCount };
+        struct RegionRun { unsigned begin, end; };
+        std::vector<KeyMappedSampleBuffer*> regionTable;
+        std::vector<RegionRun> regionRuns;     // run 0 is always empty
+        unsigned short runIndex[kTriggerCount][MIDI_NOTENUMBERS][MIDI_VELOCITIES];
         bool keyMapValid;
 
+        // regions chosen for the note event being started, read by voicePrepCallback()
+        struct Layer
+        {
+            KeyMappedSampleBuffer* pRegion;
+            float gain;     // velocity crossfade
+        };
+        Layer layers[MAX_POLYPHONY];
+
+        // note-on state kept for release-trigger regions
+        unsigned noteVelocity[MIDI_NOTENUMBERS];   // 0 once the note's release has triggered
+        float noteFrequency[MIDI_NOTENUMBERS];
+        bool releasePending[MIDI_NOTENUMBERS];     // key is up but the sustain pedal is down
+        bool pedalIsDown;
+
         // array of voice resources, and a voice manager
         SamplerVoice voice[MAX_POLYPHONY];
         VoiceManager voiceManager;
@@ -79,7 +108,7 @@ namespace AudioKitCore
 
         // voice- and render-prep callbacks
         static float voicePrepCallback(void* thisPtr, void* voicePtr,
-                                       unsigned noteNumber, unsigned velocity, float noteHz);
+                                       unsigned noteNumber, unsigned velocity, float noteHz, int layer);
         static void renderPrepCallback(void* thisPtr);
 
         // sample-related parameters
@@ -89,7 +118,10 @@ namespace AudioKitCore
         bool stoppingAllVoices;
         
         // helper functions
-        KeyMappedSampleBuffer* lookupSample(unsigned noteNumber, unsigned velocity);
+        void buildRegionTables(const std::vector<KeyMappedSampleBuffer*> keyRegions[MIDI_NOTENUMBERS]);
+        int selectRegions(int trigger, unsigned noteNumber, unsigned velocity);   // fills layers[]
+        void chokeGroups(int layerCount);
+        void triggerRelease(unsigned noteNumber);
     };
 }
 
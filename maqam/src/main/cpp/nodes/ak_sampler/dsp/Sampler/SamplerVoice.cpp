@@ -41,6 +41,9 @@ namespace AudioKitCore
         
         // Call base-class version last, after rest of setup
         VoiceBase::start(evt, noteNum, freqHz, volume);
+
+        // a new note starts from its expression, it does not glide from the previous one
+        expression = getExpressionTarget();
     }
     
     void SamplerVoice::restart(unsigned evt, float volume)
@@ -82,6 +85,20 @@ namespace AudioKitCore
         VoiceBase::release(evt);
     }
     
+    void SamplerVoice::choke()
+    {
+        // fades out fast and finishes, as for SFZ off_mode=fast
+        ampEG.damp();
+        filterEG.release();
+    }
+    
+    void SamplerVoice::retune(float freqHz)
+    {
+        noteHz = freqHz;
+        if (pSampleBuffer)
+            oscillator.fIncrement = (pSampleBuffer->sampleRateHz / sampleRateHz) * (freqHz / pSampleBuffer->noteHz);
+    }
+    
     void SamplerVoice::stop(unsigned evt)
     {
         // For stop, call base-class version first, so note stops right away
@@ -95,56 +112,95 @@ namespace AudioKitCore
     {
         if (ampEG.isIdle()) return true;
 
-        SamplerVoiceParams *timbreParams = (SamplerVoiceParams*)pTimbreParams;
         SamplerModParameters *modParams = (SamplerModParameters*)pModParams;
 
-        if (ampEG.isPreStarting())
+        const NoteExpression& target = getExpressionTarget();
+        const float k = modParams->expressionSmoothing;
+        expression.pitchBend += k * (target.pitchBend - expression.pitchBend);
+        expression.pressure += k * (target.pressure - expression.pressure);
+        expression.timbre += k * (target.timbre - expression.timbre);
+
+        oscillator.setPitchOffsetSemitones(modParams->pitchOffset + expression.pitchBend);
+        
+        float feg = filterEG.getSample();
+        if (filterL.stages > 0)
+        {
+            double cutoffHz = noteHz * (1.0f + modParams->cutoffMultiple + modParams->cutoffEgStrength * noteFVel * feg);
+            cutoffHz *= exp2f(4.0f * (expression.timbre - 0.5f));
+            filterL.setParams(cutoffHz, modParams->filterQ);
+            filterR.copyParams(filterL);
+        }
+
+        return false;
+    }
+    
+    // The amp EG runs at the full sample rate and is rendered here one block at a time, so gain
+    // is sample accurate instead of stepping once per chunk. Filters then run over the block.
+    bool SamplerVoice::getSamples(int nSamples, float* pOutLeft, float* pOutRight)
+    {
+        SamplerModParameters *modParams = (SamplerModParameters*)pModParams;
+        float ampeg[kMaxBlockSamples];
+        float left[kMaxBlockSamples], right[kMaxBlockSamples];
+
+        while (nSamples > 0)
         {
-            float ampeg = ampEG.getSample();
-            tempGain = modParams->masterVolume * noteVol * ampeg;
-            if (!ampEG.isPreStarting())
+            int n = nSamples < kMaxBlockSamples ? nSamples : kMaxBlockSamples;
+            bool preStarting = ampEG.isPreStarting();
+            ampEG.getSamples(ampeg, n);
+
+            if (preStarting && !ampEG.isPreStarting())
             {
+                // damping finished within this block and the attack has begun
                 noteVol = newNoteVol;
-                tempGain = modParams->masterVolume * noteVol * ampeg;
 
                 if (newNoteNumber >= 0)
                 {
                     // restarting a "stolen" voice with a new note number
-                    pSampleBuffer = pNewSampleBuffer;
-                    oscillator.fIndex = pSampleBuffer->fStart;
-                    oscillator.bLooping = pSampleBuffer->bLoop;
                     noteNumber = newNoteNumber;
                 }
-                ampEG.start();
+                expression = getExpressionTarget();
                 filterEG.start();
 
                 pSampleBuffer = pNewSampleBuffer;
                 oscillator.fIndex = pSampleBuffer->fStart;
                 oscillator.bLooping = pSampleBuffer->bLoop;
             }
-        }
-        else
-            tempGain = modParams->masterVolume * noteVol * ampEG.getSample();
-        oscillator.setPitchOffsetSemitones(modParams->pitchOffset);
-        
-        float feg = filterEG.getSample();
-        double cutoffHz = noteHz * (1.0f + modParams->cutoffMultiple + modParams->cutoffEgStrength * noteFVel * feg);
-        filterL.setParams(cutoffHz, modParams->filterQ);
-        filterR.setParams(cutoffHz, modParams->filterQ);
+            tempGain = modParams->masterVolume * noteVol * (1.0f + expression.pressure);
 
+            int rendered = 0;
+            bool finished = false;
+            for (; rendered < n; rendered++)
+            {
+                if (oscillator.getSamplePair(pSampleBuffer, &left[rendered], &right[rendered], tempGain * ampeg[rendered]))
+                {
+                    finished = true;
+                    break;
+                }
+            }
+
+            filterL.process(left, rendered);
+            filterR.process(right, rendered);
+
+            for (int i=0; i < rendered; i++)
+            {
+                pOutLeft[i] += left[i];
+                pOutRight[i] += right[i];
+            }
+            if (finished) return true;
+
+            pOutLeft += n;
+            pOutRight += n;
+            nSamples -= n;
+        }
         return false;
     }
-    
-    bool SamplerVoice::getSamples(int nSamples, float* pOutLeft, float* pOutRight)
+
+    const NoteExpression& SamplerVoice::getExpressionTarget()
     {
-        for (int i=0; i < nSamples; i++)
-        {
-            float leftSample, rightSample;
-            if (oscillator.getSamplePair(pSampleBuffer, &leftSample, &rightSample, tempGain)) return true;
-            *pOutLeft++ += filterL.process(leftSample);
-            *pOutRight++ += filterR.process(rightSample);
-        }
-        return false;
+        static const NoteExpression neutral = { 0.0f, 0.0f, 0.5f };
+        SamplerModParameters *modParams = (SamplerModParameters*)pModParams;
+        if (noteNumber < 0 || noteNumber >= kNoteExpressions) return neutral;
+        return modParams->noteExpression[noteNumber];
     }
 
 }
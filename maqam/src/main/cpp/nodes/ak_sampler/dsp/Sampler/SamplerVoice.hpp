@@ -24,6 +24,16 @@ namespace AudioKitCore
         int filterStages;
     };
 
+    // per-note (MPE) expression, neutral values leave the sound unchanged
+    struct NoteExpression
+    {
+        float pitchBend;    // semitones
+        float pressure;     // fraction 0.0 - 1.0, raises gain by up to 6 dB
+        float timbre;       // fraction 0.0 - 1.0, moves filter cutoff by up to 2 octaves around 0.5
+    };
+
+    static constexpr int kNoteExpressions = 128;   // one per MIDI note number
+
     struct SamplerModParameters
     {
         float masterVolume;
@@ -32,6 +42,9 @@ namespace AudioKitCore
         float cutoffEgStrength;
         float filterQ;
         float filterVel;
+
+        NoteExpression noteExpression[kNoteExpressions];    // targets, indexed by note number
+        float expressionSmoothing;                          // one-pole coefficient per chunk
     };
 
     struct SamplerVoice : public VoiceBase
@@ -43,9 +56,13 @@ namespace AudioKitCore
         
         // temporary holding variables
         float noteFVel;     // filter EG multiplier: fraction 0.0 - 1.0, based on MIDI velocity
+        NoteExpression expression;      // smoothed toward modParams->noteExpression[noteNumber]
         SampleBuffer* pNewSampleBuffer; // holds next sample buffer to use at restart
+        int offBy;          // choke group that silences this voice, 0 is none
         
-        SamplerVoice() : VoiceBase() {}
+        static constexpr int kMaxBlockSamples = 64;  // samples rendered at a time by getSamples()
+
+        SamplerVoice() : VoiceBase(), offBy(0) {}
 
         void init(double sampleRate, SamplerVoiceParams* pTimbreParameters, SamplerModParameters* pModParameters);
         void setFilterStages(int n) { filterL.setStages(n); filterR.setStages(n); }
@@ -54,12 +71,17 @@ namespace AudioKitCore
         virtual void restart(unsigned evt, float volume);
         virtual void restart(unsigned evt, unsigned noteNum, float freqHz, float volume);
         virtual void release(unsigned evt);
+        void choke();
+        void retune(float freqHz);
         virtual bool isReleasing(void) { return ampEG.isReleasing(); }
         virtual void stop(unsigned evt);
 
         // return true if amp envelope is finished
         virtual bool doModulation(void);
         virtual bool getSamples(int nSamples, float* pOutLeft, float* pOutRight);
+
+    protected:
+        const NoteExpression& getExpressionTarget();
     };
 
 }
@@ -0,0 +1,448 @@
+//
+// Maqam - Mobile App Quick Audio & MIDI
+//
+// SPDX-FileCopyrightText: 2024 TAQS.IM <contact@taqs.im>
+// SPDX-License-Identifier: MIT
+//
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "ConvolutionReverbProcessor.h"
+#include "log.h"
+
+using namespace juce;
+using namespace maqam;
+
+constexpr static int kStopTimeoutMillis = 1000;
+
+static const Identifier kStateImpulseResponsePath { "impulseResponsePath" };
+
+ConvolutionReverbProcessor::ConvolutionReverbProcessor() noexcept
+    : AudioProcessor(BusesProperties().withInput("Input", AudioChannelSet::stereo(), true)
+                                      .withOutput("Output", AudioChannelSet::stereo(), true))
+    , Thread("Convolution reverb tail")
+    , mParameters (*this, nullptr, "Convolution Reverb", createParameterLayout())
+    , mHasTail(false)
+    , mTailInputFifo(1)
+    , mTailInputDropped(0)
+    , mTailOutputFifo(1)
+    , mTailDeficit(0)
+    , mWorkerWakePending(false)
+    , mInlineTail(false)
+    , mImpulseResponseSeconds(0)
+    , mNumQueuedLoads(0)
+{
+    sem_init(&mWorkerSemaphore, /*pshared*/0, /*value*/0);
+}
+
+ConvolutionReverbProcessor::~ConvolutionReverbProcessor()
+{
+    struct OwnJobs : ThreadPool::JobSelector
+    {
+        explicit OwnJobs(const ConvolutionReverbProcessor* owner) noexcept : owner(owner) {}
+
+        bool isJobSuitable(ThreadPoolJob* job) override
+        {
+            return static_cast<LoaderJob*>(job)->isOwnedBy(owner);
+        }
+
+        const ConvolutionReverbProcessor* owner;
+    };
+
+    // The pool is shared, only the jobs queued by this node are removed. A running job holds a
+    // reference to this node, wait for it however long decoding takes.
+    OwnJobs ownJobs(this);
+    ImpulseResponseCache::getLoaderPool().removeAllJobs(true, /*timeOutMilliseconds*/-1, &ownJobs);
+    stopWorker();
+    sem_destroy(&mWorkerSemaphore);
+}
+
+void ConvolutionReverbProcessor::load(const String& path)
+{
+    if (! File(path).existsAsFile()) {
+        throw std::runtime_error("Impulse response file does not exist");
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mImpulseResponseMutex);
+        mImpulseResponsePath = path;
+    }
+
+    queueLoad();
+
+    // The path is part of the saved state, see getStateInformation()
+    updateHostDisplay(ChangeDetails().withNonParameterStateChanged(true));
+}
+
+void ConvolutionReverbProcessor::getStateInformation(MemoryBlock& destData)
+{
+    ValueTree state = mParameters.copyState();
+
+    {
+        std::lock_guard<std::mutex> lock(mImpulseResponseMutex);
+        state.setProperty(kStateImpulseResponsePath, mImpulseResponsePath, nullptr);
+    }
+
+    MemoryOutputStream stream(destData, /*appendToExistingBlockContent*/false);
+    state.writeToStream(stream);
+}
+
+void ConvolutionReverbProcessor::setStateInformation(const void* data, int sizeInBytes)
+{
+    ValueTree state = ValueTree::readFromData(data, static_cast<size_t>(sizeInBytes));
+
+    if (! state.hasType(mParameters.state.getType())) {
+        return;
+    }
+
+    const String path = state.getProperty(kStateImpulseResponsePath).toString();
+    state.removeProperty(kStateImpulseResponsePath, nullptr);
+    mParameters.replaceState(state);
+
+    {
+        std::lock_guard<std::mutex> lock(mImpulseResponseMutex);
+
+        if (path.isEmpty() || (path == mImpulseResponsePath)) {
+            return;
+        }
+    }
+
+    // Only queues the load, a file that went missing keeps the restored parameters
+    try {
+        load(path);
+    } catch (const std::exception& e) {
+        LOG_W(LOG_TAG, "ConvolutionReverb could not restore %s: %s", path.toRawUTF8(), e.what());
+    }
+}
+
+void ConvolutionReverbProcessor::prepareToPlay(double sampleRate, int samplesPerBlock)
+{
+    stopWorker();
+
+    // Offline renders load the IR before the convolutions are prepared, which installs it right
+    // away, and convolve the tail on the rendering thread. Output then only depends on input.
+    {
+        std::lock_guard<std::mutex> lock(mLoaderMutex);
+        mInlineTail = isNonRealtime();
+
+        if (mInlineTail) {
+            loadFromCache(sampleRate);
+        }
+    }
+
+    dsp::ProcessSpec headSpec = {
+        .sampleRate = sampleRate,
+        .maximumBlockSize = static_cast<uint32>(std::min(samplesPerBlock, kHeadBlockSize)),
+        .numChannels = 2
+    };
+
+    mHeadConvolution.prepare(headSpec);
+
+    dsp::ProcessSpec tailSpec = {
+        .sampleRate = sampleRate,
+        .maximumBlockSize = static_cast<uint32>(kTailBlockSize),
+        .numChannels = 2
+    };
+
+    mTailConvolution.prepare(tailSpec);
+
+    // One spare slot, juce::AbstractFifo holds up to size - 1 items
+    const int inputSize = 2 * kTailBlockSize + samplesPerBlock + 1;
+    mTailInputFifo.setTotalSize(inputSize);
+    mTailInputBuffer.setSize(2, inputSize);
+    mTailInputDropped = 0;
+
+    const int outputSize = kHeadLength + kTailBlockSize + samplesPerBlock + 1;
+    mTailOutputFifo.setTotalSize(outputSize);
+    mTailOutputBuffer.setSize(2, outputSize);
+    mTailOutputBuffer.clear();
+
+    // Delays the tail by the head length
+    mTailOutputFifo.finishedWrite(kHeadLength);
+    mTailDeficit = 0;
+
+    mTailBlock.setSize(2, kTailBlockSize);
+    mWorkerWakePending = false;
+
+    dsp::ProcessSpec spec = {
+        .sampleRate = sampleRate,
+        .maximumBlockSize = static_cast<uint32>(samplesPerBlock),
+        .numChannels = 2
+    };
+
+    mDryWetMixer.prepare(spec);
+    mDryWetMixer.setMixingRule(dsp::DryWetMixingRule::sin6dB);
+
+    mSilenceTracker.prepare(sampleRate);
+
+    mBypass.prepare(sampleRate, samplesPerBlock, 2, getBypassParameter()->getValue() != 0);
+
+    if (! mInlineTail) {
+        startThread(Thread::Priority::low);
+
+        // Cheap when the rate did not change, the cache still holds the current IR
+        queueLoad();
+    }
+}
+
+void ConvolutionReverbProcessor::releaseResources()
+{
+    stopWorker();
+}
+
+void ConvolutionReverbProcessor::processBlock(AudioBuffer<float>& buffer, MidiBuffer&)
+{
+    mBypass.process(buffer, getBypassParameter()->getValue() != 0,
+                    [this](AudioBuffer<float>& b) { process(b); });
+}
+
+void ConvolutionReverbProcessor::process(AudioBuffer<float>& buffer) noexcept
+{
+    if (mSilenceTracker.skipBlock(buffer, getTailLengthSeconds())) {
+        return;
+    }
+
+    dsp::AudioBlock<float> block(buffer);
+    mDryWetMixer.pushDrySamples(block);
+
+    pushTailInput(buffer);
+
+    const int numSamples = buffer.getNumSamples();
+
+    for (int offset = 0; offset < numSamples; offset += kHeadBlockSize) {
+        auto subBlock = block.getSubBlock(static_cast<size_t>(offset),
+                static_cast<size_t>(std::min(kHeadBlockSize, numSamples - offset)));
+        mHeadConvolution.process(dsp::ProcessContextReplacing<float>(subBlock));
+    }
+
+    addTailOutput(buffer);
+
+    mDryWetMixer.setWetMixProportion(getParameterValue(kParameterMix));
+    mDryWetMixer.mixWetSamples(block);
+
+    mSilenceTracker.trackOutput(buffer);
+}
+
+void ConvolutionReverbProcessor::pushTailInput(const AudioBuffer<float>& buffer) noexcept
+{
+    const int numSamples = buffer.getNumSamples();
+    int start1, size1, start2, size2;
+
+    // Dropped input is replaced by as much silence, the tail stays aligned with the head
+    if (mTailInputDropped > 0) {
+        mTailInputFifo.prepareToWrite(mTailInputDropped, start1, size1, start2, size2);
+
+        for (int ch = 0; ch < 2; ++ch) {
+            if (size1 > 0) mTailInputBuffer.clear(ch, start1, size1);
+            if (size2 > 0) mTailInputBuffer.clear(ch, start2, size2);
+        }
+
+        mTailInputFifo.finishedWrite(size1 + size2);
+        mTailInputDropped -= size1 + size2;
+    }
+
+    if ((mTailInputDropped > 0) || (mTailInputFifo.getFreeSpace() < numSamples)) {
+        // The worker fell behind, a partial write would shift all later input
+        mTailInputDropped += numSamples;
+    } else {
+        mTailInputFifo.prepareToWrite(numSamples, start1, size1, start2, size2);
+
+        for (int ch = 0; ch < 2; ++ch) {
+            if (size1 > 0) mTailInputBuffer.copyFrom(ch, start1, buffer, ch, 0, size1);
+            if (size2 > 0) mTailInputBuffer.copyFrom(ch, start2, buffer, ch, size1, size2);
+        }
+
+        mTailInputFifo.finishedWrite(size1 + size2);
+    }
+
+    if (mTailInputFifo.getNumReady() >= kTailBlockSize) {
+        if (mInlineTail) {
+            processTailBlocks();
+        } else {
+            wakeWorker();
+        }
+    }
+}
+
+void ConvolutionReverbProcessor::addTailOutput(AudioBuffer<float>& buffer) noexcept
+{
+    // A late worker left a gap, drop the samples that would now be played too late
+    if (mTailDeficit > 0) {
+        const int numToSkip = std::min(mTailDeficit, mTailOutputFifo.getNumReady());
+        mTailOutputFifo.finishedRead(numToSkip);
+        mTailDeficit -= numToSkip;
+    }
+
+    const int numSamples = buffer.getNumSamples();
+    int start1, size1, start2, size2;
+    mTailOutputFifo.prepareToRead(numSamples, start1, size1, start2, size2);
+
+    for (int ch = 0; ch < 2; ++ch) {
+        if (size1 > 0) buffer.addFrom(ch, 0, mTailOutputBuffer, ch, start1, size1);
+        if (size2 > 0) buffer.addFrom(ch, size1, mTailOutputBuffer, ch, start2, size2);
+    }
+
+    mTailOutputFifo.finishedRead(size1 + size2);
+    mTailDeficit += numSamples - (size1 + size2);
+}
+
+void ConvolutionReverbProcessor::run()
+{
+    while (! threadShouldExit()) {
+        // Cleared before reading the FIFO, input queued from now on posts again
+        mWorkerWakePending = false;
+
+        processTailBlocks();
+
+        if (sem_wait(&mWorkerSemaphore) != 0) {
+            continue; // EINTR
+        }
+    }
+}
+
+// Worker thread, or the rendering thread of an offline render
+void ConvolutionReverbProcessor::processTailBlocks() noexcept
+{
+    int start1, size1, start2, size2;
+
+    while ((mTailInputFifo.getNumReady() >= kTailBlockSize)
+            && (mTailOutputFifo.getFreeSpace() >= kTailBlockSize)) {
+        mTailInputFifo.prepareToRead(kTailBlockSize, start1, size1, start2, size2);
+
+        for (int ch = 0; ch < 2; ++ch) {
+            mTailBlock.copyFrom(ch, 0, mTailInputBuffer, ch, start1, size1);
+            if (size2 > 0) mTailBlock.copyFrom(ch, size1, mTailInputBuffer, ch, start2, size2);
+        }
+
+        mTailInputFifo.finishedRead(size1 + size2);
+
+        if (mHasTail) {
+            dsp::AudioBlock<float> block(mTailBlock);
+            mTailConvolution.process(dsp::ProcessContextReplacing<float>(block));
+        } else {
+            mTailBlock.clear();
+        }
+
+        mTailOutputFifo.prepareToWrite(kTailBlockSize, start1, size1, start2, size2);
+
+        for (int ch = 0; ch < 2; ++ch) {
+            mTailOutputBuffer.copyFrom(ch, start1, mTailBlock, ch, 0, size1);
+            if (size2 > 0) mTailOutputBuffer.copyFrom(ch, start2, mTailBlock, ch, size1, size2);
+        }
+
+        mTailOutputFifo.finishedWrite(size1 + size2);
+    }
+}
+
+// Audio thread, sem_post() never takes a lock unlike juce::Thread::notify()
+void ConvolutionReverbProcessor::wakeWorker() noexcept
+{
+    if (! mWorkerWakePending.exchange(true)) {
+        sem_post(&mWorkerSemaphore);
+    }
+}
+
+void ConvolutionReverbProcessor::stopWorker()
+{
+    // run() waits on the semaphore, not on the juce::Thread event stopThread() signals
+    signalThreadShouldExit();
+    sem_post(&mWorkerSemaphore);
+    stopThread(kStopTimeoutMillis);
+}
+
+void ConvolutionReverbProcessor::queueLoad()
+{
+    // A job object can only be in the pool once, a request arriving while the previous job is
+    // finishing would otherwise be dropped
+    mNumQueuedLoads++;
+    ImpulseResponseCache::getLoaderPool().addJob(new LoaderJob(*this),
+                                                 /*deleteJobWhenFinished*/true);
+}
+
+void ConvolutionReverbProcessor::setImpulseResponse(ImpulseResponseCache::Buffer impulseResponse,
+                                                    double sampleRate)
+{
+    const int length = impulseResponse->getNumSamples();
+    const int numChannels = impulseResponse->getNumChannels();
+    const int headLength = std::min(length, kHeadLength);
+
+    AudioBuffer<float> head(numChannels, headLength);
+
+    for (int ch = 0; ch < numChannels; ++ch) {
+        head.copyFrom(ch, 0, *impulseResponse, ch, 0, headLength);
+    }
+
+    // Normalization already happened once for the whole IR in ImpulseResponseCache
+    mHeadConvolution.loadImpulseResponse(std::move(head), sampleRate,
+            dsp::Convolution::Stereo::yes, dsp::Convolution::Trim::no,
+            dsp::Convolution::Normalise::no);
+
+    if (length > kHeadLength) {
+        AudioBuffer<float> tail(numChannels, length - kHeadLength);
+
+        for (int ch = 0; ch < numChannels; ++ch) {
+            tail.copyFrom(ch, 0, *impulseResponse, ch, kHeadLength, length - kHeadLength);
+        }
+
+        mTailConvolution.loadImpulseResponse(std::move(tail), sampleRate,
+                dsp::Convolution::Stereo::yes, dsp::Convolution::Trim::no,
+                dsp::Convolution::Normalise::no);
+    }
+
+    mHasTail = length > kHeadLength;
+    mImpulseResponseSeconds = static_cast<double>(length) / sampleRate;
+
+    {
+        std::lock_guard<std::mutex> lock(mImpulseResponseMutex);
+        mImpulseResponse = std::move(impulseResponse);
+    }
+
+    // Input queued while the previous IR was loading goes through the new tail
+    wakeWorker();
+}
+
+// Loader job, or prepareToPlay() of an offline render
+void ConvolutionReverbProcessor::loadFromCache(double sampleRate)
+{
+    String path;
+
+    {
+        std::lock_guard<std::mutex> lock(mImpulseResponseMutex);
+        path = mImpulseResponsePath;
+    }
+
+    if (path.isEmpty() || (sampleRate <= 0)) {
+        return;
+    }
+
+    if (auto impulseResponse = ImpulseResponseCache::getInstance().get(File(path), sampleRate)) {
+        setImpulseResponse(std::move(impulseResponse), sampleRate);
+    }
+}
+
+ThreadPoolJob::JobStatus ConvolutionReverbProcessor::LoaderJob::runJob()
+{
+    // Later jobs read the same path and rate, let the last one do the work
+    if ((--mOwner.mNumQueuedLoads > 0) || shouldExit()) {
+        return jobHasFinished;
+    }
+
+    std::lock_guard<std::mutex> lock(mOwner.mLoaderMutex);
+
+    // Already loaded by prepareToPlay(), a job landing during the render would restart the tail
+    if (! mOwner.mInlineTail) {
+        mOwner.loadFromCache(mOwner.getSampleRate());
+    }
+
+    return jobHasFinished;
+}
+
+AudioProcessorValueTreeState::ParameterLayout
+ConvolutionReverbProcessor::createParameterLayout() noexcept
+{
+    return {
+        createParameterBypass(kParameterBypass),
+        createParameterMix(kParameterMix)
+    };
+}
@@ -0,0 +1,166 @@
+//
+// Maqam - Mobile App Quick Audio & MIDI
+//
+// SPDX-FileCopyrightText: 2024 TAQS.IM <contact@taqs.im>
+// SPDX-License-Identifier: MIT
+//
+
+#ifndef CONVOLUTION_REVERB_PROCESSOR_H
+#define CONVOLUTION_REVERB_PROCESSOR_H
+
+#include <atomic>
+#include <mutex>
+#include <semaphore.h>
+
+#include <juce_audio_processors/juce_audio_processors.h>
+#include <juce_dsp/juce_dsp.h>
+
+#include "nodes/AudioProcessorHelpers.h"
+#include "nodes/SilenceTracker.h"
+#include "ImpulseResponseCache.h"
+
+namespace maqam {
+
+/**
+ * Convolution reverb with the impulse response split in two. The first kHeadLength samples are
+ * convolved on the audio thread with zero latency, the remainder runs on a low priority worker
+ * thread in kTailBlockSize steps. The tail output is needed kHeadLength samples after its input
+ * arrives, which leaves the worker kHeadLength - kTailBlockSize samples of slack. The audio thread
+ * wakes the worker with a POSIX semaphore once a full tail block is queued.
+ */
+class ConvolutionReverbProcessor : public juce::AudioProcessor
+                                 , private juce::Thread
+{
+public:
+    static constexpr const char* kParameterBypass = "bypass";
+    static constexpr const char* kParameterMix    = "mix";
+
+    static constexpr int kHeadLength    = 16384;
+    static constexpr int kHeadBlockSize = 256;
+    static constexpr int kTailBlockSize = kHeadLength / 2;
+
+    ConvolutionReverbProcessor() noexcept;
+    virtual ~ConvolutionReverbProcessor();
+
+    // Decoding and resampling happen on a background thread, the previous IR keeps playing
+    void load(const juce::String& path);
+
+    void prepareToPlay(double sampleRate, int samplesPerBlock) override;
+    void releaseResources() override;
+
+    juce::AudioProcessorParameter* getBypassParameter() const override
+    {
+        return mParameters.getParameter(kParameterBypass);
+    }
+
+    void processBlockBypassed(juce::AudioBuffer<float>&, juce::MidiBuffer&) override {}
+    void processBlock(juce::AudioBuffer<float>&, juce::MidiBuffer&) override;
+
+    juce::AudioProcessorEditor* createEditor() override { return nullptr; }
+    bool hasEditor() const override { return false; }
+
+    const juce::String getName() const override { return "Convolution Reverb"; }
+
+    bool   acceptsMidi() const override { return false; }
+    bool   producesMidi() const override { return false; }
+    double getTailLengthSeconds() const override { return mImpulseResponseSeconds; }
+
+    int  getNumPrograms() override { return 0; }
+    int  getCurrentProgram() override { return 0; }
+    void setCurrentProgram(int index) override {}
+    const juce::String getProgramName(int index) override { return ""; }
+    void changeProgramName(int index, const juce::String& newName) override {}
+
+    // Parameters plus the impulse response path
+    void getStateInformation(juce::MemoryBlock& destData) override;
+    void setStateInformation(const void* data, int sizeInBytes) override;
+
+private:
+    // One per load request, deleted by the pool when finished
+    class LoaderJob : public juce::ThreadPoolJob
+    {
+    public:
+        // The owner destructor waits for its jobs to finish, the reference stays valid
+        explicit LoaderJob(ConvolutionReverbProcessor& owner) noexcept
+            : ThreadPoolJob("Impulse response loader")
+            , mOwner(owner)
+        {}
+
+        JobStatus runJob() override;
+
+        bool isOwnedBy(const ConvolutionReverbProcessor* owner) const noexcept
+        {
+            return &mOwner == owner;
+        }
+
+    private:
+        ConvolutionReverbProcessor& mOwner;
+
+    };
+
+    // juce::Thread
+    void run() override;
+
+    void processTailBlocks() noexcept;
+    void wakeWorker() noexcept;
+    void stopWorker();
+
+    static juce::AudioProcessorValueTreeState::ParameterLayout
+    createParameterLayout() noexcept;
+
+    void process(juce::AudioBuffer<float>& buffer) noexcept;
+    void pushTailInput(const juce::AudioBuffer<float>& buffer) noexcept;
+    void addTailOutput(juce::AudioBuffer<float>& buffer) noexcept;
+
+    void queueLoad();
+    void loadFromCache(double sampleRate);
+    void setImpulseResponse(ImpulseResponseCache::Buffer impulseResponse, double sampleRate);
+
+    inline float getParameterValue(juce::StringRef parameterID) const noexcept
+    {
+        return reinterpret_cast<juce::AudioParameterFloat*>(mParameters.getParameter(parameterID))
+            ->get();
+    }
+
+    juce::AudioProcessorValueTreeState mParameters;
+
+    juce::dsp::Convolution mHeadConvolution;
+    juce::dsp::Convolution mTailConvolution;
+    std::atomic<bool>      mHasTail;
+
+    // Audio thread -> worker
+    juce::AbstractFifo       mTailInputFifo;
+    juce::AudioBuffer<float> mTailInputBuffer;
+    int                      mTailInputDropped; // replaced by silence once the FIFO has room
+
+    // Worker -> audio thread
+    juce::AbstractFifo       mTailOutputFifo;
+    juce::AudioBuffer<float> mTailOutputBuffer;
+    int                      mTailDeficit;
+
+    juce::AudioBuffer<float> mTailBlock;
+
+    sem_t             mWorkerSemaphore;
+    std::atomic<bool> mWorkerWakePending;
+
+    std::mutex mLoaderMutex;
+    bool       mInlineTail; // non-realtime, no worker, written with mLoaderMutex held
+
+    std::mutex                   mImpulseResponseMutex;
+    juce::String                 mImpulseResponsePath;
+    ImpulseResponseCache::Buffer mImpulseResponse;
+    std::atomic<double>          mImpulseResponseSeconds;
+
+    // Jobs run one at a time in order, only the last queued one needs to load
+    std::atomic<int> mNumQueuedLoads;
+
+    juce::dsp::DryWetMixer<float> mDryWetMixer;
+
+    SilenceTracker  mSilenceTracker;
+    BypassCrossfade mBypass;
+
+};
+
+} // maqam
+
+#endif //CONVOLUTION_REVERB_PROCESSOR_H
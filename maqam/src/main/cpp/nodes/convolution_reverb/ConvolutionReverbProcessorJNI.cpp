@@ -0,0 +1,30 @@
+//
+// Maqam - Mobile App Quick Audio & MIDI
+//
+// SPDX-FileCopyrightText: 2024 TAQS.IM <contact@taqs.im>
+// SPDX-License-Identifier: MIT
+//
+
+#include <jni.h>
+
+#include "impl/AudioNode.h"
+#include "ConvolutionReverbProcessor.h"
+
+using namespace maqam;
+
+#define GET_DSP(e,t) (*reinterpret_cast<ConvolutionReverbProcessor*>(AudioNode::getDSP(e,t)))
+
+extern "C"
+JNIEXPORT void JNICALL
+Java_im_taqs_maqam_node_ConvolutionReverb_jniLoad(JNIEnv *env, jobject thiz, jstring path)
+{
+    const char* cPath = env->GetStringUTFChars(path, nullptr);
+
+    try {
+        GET_DSP(env, thiz).load(juce::String::fromUTF8(cPath));
+    } catch (const std::exception& e) {
+        env->ThrowNew(env->FindClass("im/taqs/maqam/Library$Exception"), e.what());
+    }
+
+    env->ReleaseStringUTFChars(path, cPath);
+}
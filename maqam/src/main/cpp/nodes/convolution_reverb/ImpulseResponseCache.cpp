@@ -0,0 +1,116 @@
+//
+// Maqam - Mobile App Quick Audio & MIDI
+//
+// SPDX-FileCopyrightText: 2024 TAQS.IM <contact@taqs.im>
+// SPDX-License-Identifier: MIT
+//
+
+#include <algorithm>
+#include <cmath>
+
+#include "ImpulseResponseCache.h"
+
+using namespace juce;
+using namespace maqam;
+
+ImpulseResponseCache& ImpulseResponseCache::getInstance()
+{
+    static ImpulseResponseCache instance;
+    return instance;
+}
+
+ThreadPool& ImpulseResponseCache::getLoaderPool()
+{
+    static ThreadPool pool(1);
+    return pool;
+}
+
+ImpulseResponseCache::Buffer ImpulseResponseCache::get(const File& file, double sampleRate)
+{
+    const String key = file.getFullPathName() + "@" + String(roundToInt(sampleRate));
+
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    for (auto it = mEntries.begin(); it != mEntries.end();) {
+        it = it->second.expired() ? mEntries.erase(it) : std::next(it);
+    }
+
+    auto it = mEntries.find(key);
+
+    if (it != mEntries.end()) {
+        if (auto buffer = it->second.lock()) {
+            return buffer;
+        }
+    }
+
+    auto buffer = read(file, sampleRate);
+
+    if (buffer != nullptr) {
+        mEntries[key] = buffer;
+    }
+
+    return buffer;
+}
+
+ImpulseResponseCache::Buffer ImpulseResponseCache::read(const File& file, double sampleRate)
+{
+    AudioFormatManager formatManager;
+    formatManager.registerBasicFormats();
+
+    std::unique_ptr<AudioFormatReader> reader(formatManager.createReaderFor(file));
+
+    if ((reader == nullptr) || (reader->sampleRate <= 0) || (sampleRate <= 0)) {
+        return nullptr;
+    }
+
+    const int numChannels = jlimit(1, 2, static_cast<int>(reader->numChannels));
+    const int length = static_cast<int>(std::min(reader->lengthInSamples,
+            static_cast<int64>(kMaxLengthSeconds * reader->sampleRate)));
+
+    if (length <= 0) {
+        return nullptr;
+    }
+
+    AudioBuffer<float> source(numChannels, length);
+    reader->read(&source, 0, length, 0, true, numChannels > 1);
+
+    auto buffer = std::make_shared<AudioBuffer<float>>();
+
+    if (reader->sampleRate == sampleRate) {
+        *buffer = std::move(source);
+    } else {
+        // Same approach juce::dsp::Convolution follows internally
+        const double ratio = reader->sampleRate / sampleRate;
+        const int resampledLength = static_cast<int>(std::ceil(length / ratio));
+
+        MemoryAudioSource memorySource(source, false);
+        ResamplingAudioSource resampler(&memorySource, false, numChannels);
+        resampler.setResamplingRatio(ratio);
+        resampler.prepareToPlay(resampledLength, sampleRate);
+
+        buffer->setSize(numChannels, resampledLength);
+
+        AudioSourceChannelInfo info(*buffer);
+        resampler.getNextAudioBlock(info);
+    }
+
+    // Unit energy on the loudest channel
+    float maxEnergy = 0;
+
+    for (int ch = 0; ch < buffer->getNumChannels(); ++ch) {
+        const float* data = buffer->getReadPointer(ch);
+        float energy = 0;
+
+        for (int i = 0; i < buffer->getNumSamples(); ++i) {
+            energy += data[i] * data[i];
+        }
+
+        maxEnergy = std::max(maxEnergy, energy);
+    }
+
+    if (maxEnergy > 0) {
+        buffer->applyGain(1.f / std::sqrt(maxEnergy));
+    }
+
+    return buffer;
+}
@@ -0,0 +1,49 @@
+//
+// Maqam - Mobile App Quick Audio & MIDI
+//
+// SPDX-FileCopyrightText: 2024 TAQS.IM <contact@taqs.im>
+// SPDX-License-Identifier: MIT
+//
+
+#ifndef IMPULSE_RESPONSE_CACHE_H
+#define IMPULSE_RESPONSE_CACHE_H
+
+#include <map>
+#include <memory>
+#include <mutex>
+
+#include <juce_audio_formats/juce_audio_formats.h>
+
+namespace maqam {
+
+/**
+ * Process-wide store of decoded impulse responses, keyed by file path and sample rate. Entries
+ * are weakly referenced so an IR is held once no matter how many nodes use it, and released
+ * when the last one drops it.
+ */
+class ImpulseResponseCache
+{
+public:
+    using Buffer = std::shared_ptr<const juce::AudioBuffer<float>>;
+
+    static constexpr double kMaxLengthSeconds = 30.0;
+
+    static ImpulseResponseCache& getInstance();
+
+    // Shared background thread for decoding and resampling
+    static juce::ThreadPool& getLoaderPool();
+
+    // Blocking, returns a resampled and normalized stereo or mono IR, nullptr on failure
+    Buffer get(const juce::File& file, double sampleRate);
+
+private:
+    static Buffer read(const juce::File& file, double sampleRate);
+
+    std::mutex mMutex;
+    std::map<juce::String, std::weak_ptr<const juce::AudioBuffer<float>>> mEntries;
+
+};
+
+} // maqam
+
+#endif // IMPULSE_RESPONSE_CACHE_H
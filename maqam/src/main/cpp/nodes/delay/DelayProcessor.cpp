@@ -7,8 +7,6 @@
 
 #include "DelayProcessor.h"
 
-#include "nodes/AudioProcessorHelpers.h"
-
 using namespace juce;
 using namespace maqam;
 
@@ -33,12 +31,27 @@ void DelayProcessor::prepareToPlay(double sampleRate, int samplesPerBlock)
 
     mDryWetMixer.setMixingRule(dsp::DryWetMixingRule::sin6dB);
     mDryWetMixer.prepare(spec);
+
+    mSilenceTracker.prepare(sampleRate);
+
+    mBypass.prepare(sampleRate, samplesPerBlock, 2, getBypassParameter()->getValue() != 0);
+}
+
+double DelayProcessor::getTailLengthSeconds() const
+{
+    return SilenceTracker::getFeedbackTailSeconds(getParameterValue(kParameterTime),
+                                                  getParameterValue(kParameterFeedback));
 }
 
-void DelayProcessor::processBlock(AudioBuffer<float>& buffer, MidiBuffer& midi)
+void DelayProcessor::processBlock(AudioBuffer<float>& buffer, MidiBuffer&)
 {
-    if (getBypassParameter()->getValue() != 0) {
-        processBlockBypassed(buffer, midi);
+    mBypass.process(buffer, getBypassParameter()->getValue() != 0,
+                    [this](AudioBuffer<float>& b) { process(b); });
+}
+
+void DelayProcessor::process(AudioBuffer<float>& buffer) noexcept
+{
+    if (mSilenceTracker.skipBlock(buffer, getTailLengthSeconds())) {
         return;
     }
 
@@ -63,6 +76,8 @@ void DelayProcessor::processBlock(AudioBuffer<float>& buffer, MidiBuffer& midi)
 
     mDryWetMixer.setWetMixProportion(getParameterValue(kParameterMix));
     mDryWetMixer.mixWetSamples(block);
+
+    mSilenceTracker.trackOutput(buffer);
 }
 
 AudioProcessorValueTreeState::ParameterLayout
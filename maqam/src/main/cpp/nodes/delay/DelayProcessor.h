@@ -11,6 +11,9 @@
 #include <juce_audio_processors/juce_audio_processors.h>
 #include <juce_dsp/juce_dsp.h>
 
+#include "nodes/AudioProcessorHelpers.h"
+#include "nodes/SilenceTracker.h"
+
 namespace maqam {
 
 class DelayProcessor : public juce::AudioProcessor
@@ -42,7 +45,7 @@ public:
 
     bool   acceptsMidi() const override { return false; }
     bool   producesMidi() const override { return false; }
-    double getTailLengthSeconds() const override { return 0.0; }
+    double getTailLengthSeconds() const override;
 
     int  getNumPrograms() override { return 0; }
     int  getCurrentProgram() override { return 0; }
@@ -50,14 +53,23 @@ public:
     const juce::String getProgramName(int index) override { return ""; }
     void changeProgramName(int index, const juce::String& newName) override {}
 
-    void getStateInformation(juce::MemoryBlock& destData) override {}
-    void setStateInformation(const void* data, int sizeInBytes) override {}
+    void getStateInformation(juce::MemoryBlock& destData) override
+    {
+        writeParameterState(mParameters, destData);
+    }
+
+    void setStateInformation(const void* data, int sizeInBytes) override
+    {
+        readParameterState(mParameters, data, sizeInBytes);
+    }
 
 private:
     static juce::AudioProcessorValueTreeState::ParameterLayout
     createParameterLayout() noexcept;
 
-    inline float getParameterValue(juce::StringRef parameterID) noexcept
+    void process(juce::AudioBuffer<float>& buffer) noexcept;
+
+    inline float getParameterValue(juce::StringRef parameterID) const noexcept
     {
         return reinterpret_cast<juce::AudioParameterFloat*>(mParameters.getParameter(parameterID))
             ->get();
@@ -66,6 +78,8 @@ private:
     juce::AudioProcessorValueTreeState mParameters;
     juce::dsp::DelayLine<float>        mDelayDsp;
     juce::dsp::DryWetMixer<float>      mDryWetMixer;
+    SilenceTracker                     mSilenceTracker;
+    BypassCrossfade                    mBypass;
 
 };
 
@@ -7,31 +7,36 @@
 
 #include "FilterProcessor.h"
 
-#include "nodes/AudioProcessorHelpers.h"
-
 using namespace juce;
 using namespace maqam;
 
 constexpr static float PI_2 = 2.f * M_PI;
 
+constexpr static float kMinCutoff = 12.f;
+
 FilterProcessor::FilterProcessor() noexcept
     : AudioProcessor(BusesProperties().withInput("Input", AudioChannelSet::stereo(), true)
                                       .withOutput("Output", AudioChannelSet::stereo(), true))
     , mParameters (*this, nullptr, "Filter", createParameterLayout())
-    , mDspLibraryData(nullptr)
-    , mDsp(nullptr)
+    , mDsp {}
     , mLfoPhase(0)
+    , mOversamplingFadedOut(false)
+    , mDryWetMixer(BypassCrossfade::kMaxLatencySamples)
 {}
 
 void FilterProcessor::prepareToPlay(double sampleRate, int samplesPerBlock)
 {
-    if (mDsp != nullptr) {
-        return;
+    mDspArena.reset(sampleRate);
+
+    for (auto& dsp : mDsp) {
+        sp_moogladder_init(mDspArena.getData(), &dsp);
     }
 
-    sp_create(&mDspLibraryData);
-    sp_moogladder_create(&mDsp);
-    sp_moogladder_init(mDspLibraryData, mDsp);
+    mLfoPhase = 0;
+
+    mOversampler.prepare(2, samplesPerBlock);
+    setOversamplingFactorIndex(static_cast<int>(getParameterValue(kParameterOversampling)));
+    mOversamplingFadedOut = false;
 
     dsp::ProcessSpec spec = {
         .sampleRate = sampleRate,
@@ -41,27 +46,64 @@ void FilterProcessor::prepareToPlay(double sampleRate, int samplesPerBlock)
 
     mDryWetMixer.prepare(spec);
     mDryWetMixer.setMixingRule(dsp::DryWetMixingRule::sin6dB);
+
+    mSilenceTracker.prepare(sampleRate);
+
+    mBypass.prepare(sampleRate, samplesPerBlock, 2, getBypassParameter()->getValue() != 0);
+}
+
+double FilterProcessor::getTailLengthSeconds() const
+{
+    // Ringing of the resonant pole, decays as exp(-pi * f * t / Q) at the lowest swept cutoff
+    const double res = getParameterValue(kParameterResonance);
+    const double q = 0.5 / std::max(1.0 - res, 0.01);
+    const double cutoff = std::max(getParameterValue(kParameterCutoff)
+                                   - getParameterValue(kParameterLFOAmplitude), kMinCutoff);
+
+    return -std::log(SilenceTracker::kThreshold) * q / (M_PI * cutoff);
 }
 
 void FilterProcessor::releaseResources()
 {
-    if (mDsp != nullptr) {
-        sp_moogladder_destroy(&mDsp);
+    // Soundpipe state lives in mDspArena and mDsp, it is reinitialized by the next prepareToPlay()
+}
+
+void FilterProcessor::processBlock(AudioBuffer<float>& buffer, MidiBuffer&)
+{
+    // A factor switch resets the oversampling filters and moves the latency. The output fades
+    // out over one block at the old factor, the switch happens at the next block boundary and
+    // that block fades back in.
+    const int factorIndex = jlimit(0, Oversampler::kNumFactors - 1,
+            static_cast<int>(getParameterValue(kParameterOversampling)));
+    const float startGain = mOversamplingFadedOut ? 0 : 1.f;
+
+    mOversamplingFadedOut = (factorIndex != mOversampler.getFactorIndex())
+            && ! mOversamplingFadedOut && ! mBypass.isBypassed();
+
+    if (! mOversamplingFadedOut && (factorIndex != mOversampler.getFactorIndex())) {
+        setOversamplingFactorIndex(factorIndex);
     }
 
-    if (mDspLibraryData != nullptr) {
-        sp_destroy(&mDspLibraryData);
+    // Oversampling delays the filtered signal, the bypass crossfade delays the input to match
+    mBypass.setLatencySamples(mOversampler.getLatencySamples());
+    mBypass.process(buffer, getBypassParameter()->getValue() != 0,
+                    [this](AudioBuffer<float>& b) { process(b); });
+
+    const float endGain = mOversamplingFadedOut ? 0 : 1.f;
+
+    if (startGain != endGain) {
+        buffer.applyGainRamp(0, buffer.getNumSamples(), startGain, endGain);
     }
 }
 
-void FilterProcessor::processBlock(AudioBuffer<float>& buffer, MidiBuffer& midi)
+void FilterProcessor::process(AudioBuffer<float>& buffer) noexcept
 {
-    if (getBypassParameter()->getValue() != 0) {
-        processBlockBypassed(buffer, midi);
+    if (mSilenceTracker.skipBlock(buffer, getTailLengthSeconds())) {
         return;
     }
 
     dsp::AudioBlock<float> block(buffer);
+    mDryWetMixer.setWetLatency(static_cast<float>(mOversampler.getLatencySamples()));
     mDryWetMixer.pushDrySamples(block);
 
     const float cutoff = getParameterValue(kParameterCutoff);
@@ -70,21 +112,57 @@ void FilterProcessor::processBlock(AudioBuffer<float>& buffer, MidiBuffer& midi)
     mLfoPhase += PI_2 * getParameterValue(kParameterLFORate) / getSampleRate();
     if (mLfoPhase > PI_2) mLfoPhase -= PI_2;
 
-    mDsp->freq = fmax(cutoff + modCutoff, 0);
-    mDsp->res = getParameterValue(kParameterResonance);
-
-    const int numSamples = buffer.getNumSamples();
-    float ki0, ki1;
+    const float freq = fmax(cutoff + modCutoff, 0);
+    const float res = getParameterValue(kParameterResonance);
 
-    for (int i = 0; i < numSamples; i++) {
-        ki0 = buffer.getSample(0, i);
-        sp_moogladder_compute(mDspLibraryData, mDsp, &ki0, buffer.getWritePointer(0, i));
-        ki1 = buffer.getSample(1, i);
-        sp_moogladder_compute(mDspLibraryData, mDsp, &ki1, buffer.getWritePointer(1, i));
-    }
+    mOversampler.process(block, [this, freq, res](dsp::AudioBlock<float>& b, int factor) {
+        processLadder(b, factor, freq, res);
+    });
 
     mDryWetMixer.setWetMixProportion(getParameterValue(kParameterMix));
     mDryWetMixer.mixWetSamples(block);
+
+    mSilenceTracker.trackOutput(buffer);
+}
+
+void FilterProcessor::processLadder(dsp::AudioBlock<float>& block, int factor,
+                                    float freq, float res) noexcept
+{
+    sp_data* sp = mDspArena.getData();
+    const int sampleRate = static_cast<int>(getSampleRate()) * factor;
+
+    if (sp->sr != sampleRate) {
+        sp->sr = sampleRate;
+
+        // Forces recalculation of the ladder coefficients
+        for (auto& dsp : mDsp) {
+            dsp.oldfreq = 0;
+        }
+    }
+
+    const int numSamples = static_cast<int>(block.getNumSamples());
+    float ki;
+
+    // Each channel runs its own ladder, sharing one would cross-feed the channels
+    for (int ch = 0; ch < 2; ch++) {
+        sp_moogladder* dsp = &mDsp[ch];
+        dsp->freq = freq;
+        dsp->res = res;
+
+        float* data = block.getChannelPointer(static_cast<size_t>(ch));
+
+        for (int i = 0; i < numSamples; i++) {
+            ki = data[i];
+            sp_moogladder_compute(sp, dsp, &ki, &data[i]);
+        }
+    }
+}
+
+// Audio thread or prepareToPlay(), the parameter itself may change on any thread
+void FilterProcessor::setOversamplingFactorIndex(int index) noexcept
+{
+    mOversampler.setFactorIndex(index);
+    setLatencySamples(mOversampler.getLatencySamples());
 }
 
 AudioProcessorValueTreeState::ParameterLayout
@@ -96,7 +174,7 @@ FilterProcessor::createParameterLayout() noexcept
         createFloatParameter(
                 kParameterCutoff,
                 "Cutoff frequency", "Hz",
-                /*min*/12.f, /*max*/20000.f, /*def*/1000.f
+                /*min*/kMinCutoff, /*max*/20000.f, /*def*/1000.f
         ),
         createFloatParameter(
                 kParameterResonance,
@@ -112,6 +190,12 @@ FilterProcessor::createParameterLayout() noexcept
                 kParameterLFORate,
                 "LFO Rate", "Hz",
                 /*min*/1.f, /*max*/1000.f, /*def*/10.f
+        ),
+        createSteppedParameter(
+                kParameterOversampling,
+                "Oversampling factor", "x",
+                /*min*/0, /*max*/Oversampler::kNumFactors - 1, /*def*/0,
+                [](float v, int _) { return String(Oversampler::getFactor(static_cast<int>(v))); }
         )
     };
 }
\ No newline at end of file
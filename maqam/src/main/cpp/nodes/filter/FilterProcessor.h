@@ -11,9 +11,10 @@
 #include <juce_audio_processors/juce_audio_processors.h>
 #include <juce_dsp/juce_dsp.h>
 
-extern "C" {
-#include "soundpipe.h"
-}
+#include "nodes/AudioProcessorHelpers.h"
+#include "nodes/Oversampler.h"
+#include "nodes/SilenceTracker.h"
+#include "nodes/SoundpipeArena.h"
 
 namespace maqam {
 
@@ -26,7 +27,7 @@ public:
     static constexpr const char* kParameterResonance    = "resonance";
     static constexpr const char* kParameterLFOAmplitude = "lfo_amplitude";
     static constexpr const char* kParameterLFORate      = "lfo_rate";
-
+    static constexpr const char* kParameterOversampling = "oversampling";
 
     FilterProcessor() noexcept;
     virtual ~FilterProcessor() {};
@@ -49,7 +50,7 @@ public:
 
     bool   acceptsMidi() const override { return false; }
     bool   producesMidi() const override { return false; }
-    double getTailLengthSeconds() const override { return 0.0; }
+    double getTailLengthSeconds() const override;
 
     int  getNumPrograms() override { return 0; }
     int  getCurrentProgram() override { return 0; }
@@ -57,14 +58,25 @@ public:
     const juce::String getProgramName(int index) override { return ""; }
     void changeProgramName(int index, const juce::String& newName) override {}
 
-    void getStateInformation(juce::MemoryBlock& destData) override {}
-    void setStateInformation(const void* data, int sizeInBytes) override {}
+    void getStateInformation(juce::MemoryBlock& destData) override
+    {
+        writeParameterState(mParameters, destData);
+    }
+
+    void setStateInformation(const void* data, int sizeInBytes) override
+    {
+        readParameterState(mParameters, data, sizeInBytes);
+    }
 
 private:
     static juce::AudioProcessorValueTreeState::ParameterLayout
     createParameterLayout() noexcept;
 
-    inline float getParameterValue(juce::StringRef parameterID) noexcept
+    void process(juce::AudioBuffer<float>& buffer) noexcept;
+    void processLadder(juce::dsp::AudioBlock<float>& block, int factor, float freq, float res) noexcept;
+    void setOversamplingFactorIndex(int index) noexcept;
+
+    inline float getParameterValue(juce::StringRef parameterID) const noexcept
     {
         return reinterpret_cast<juce::AudioParameterFloat*>(mParameters.getParameter(parameterID))
             ->get();
@@ -72,13 +84,19 @@ private:
 
     juce::AudioProcessorValueTreeState mParameters;
 
-    sp_data*       mDspLibraryData;
-    sp_moogladder* mDsp;
+    SoundpipeArena mDspArena;
+    sp_moogladder  mDsp[2];
 
     float mLfoPhase;
 
+    Oversampler mOversampler;
+    bool        mOversamplingFadedOut; // factor switch pending, output faded out
+
     juce::dsp::DryWetMixer<float> mDryWetMixer;
 
+    SilenceTracker  mSilenceTracker;
+    BypassCrossfade mBypass;
+
 };
 
 } // maqam
@@ -15,6 +15,8 @@
 #include "sc_reverb/SCReverbProcessor.h"
 #include "filter/FilterProcessor.h"
 #include "delay/DelayProcessor.h"
+#include "convolution_reverb/ConvolutionReverbProcessor.h"
+#include "sequencer/SequencerProcessor.h"
 
 #define NODE_JAVA_PACKAGE "im.taqs.maqam.node"
 
@@ -30,6 +32,8 @@ void bindNodeClasses()
     bind<SCReverbProcessor>(NODE_JAVA_PACKAGE ".SCReverb");
     bind<FilterProcessor>(NODE_JAVA_PACKAGE ".Filter");
     bind<DelayProcessor>(NODE_JAVA_PACKAGE ".Delay");
+    bind<ConvolutionReverbProcessor>(NODE_JAVA_PACKAGE ".ConvolutionReverb");
+    bind<SequencerProcessor>(NODE_JAVA_PACKAGE ".Sequencer");
 }
 
 } // maqam
@@ -7,31 +7,32 @@
 
 #include "SCReverbProcessor.h"
 
-#include "nodes/AudioProcessorHelpers.h"
-
 using namespace juce;
 using namespace maqam;
 
+// Mean length of the eight RevSC delay lines, see reverbParams in revsc.c
+constexpr static double kMeanLoopSeconds = 3015.5 / 44100.0;
+
 SCReverbProcessor::SCReverbProcessor() noexcept
     : AudioProcessor(BusesProperties().withInput("Input", AudioChannelSet::stereo(), true)
                                       .withOutput("Output", AudioChannelSet::stereo(), true))
     , mParameters (*this, nullptr, "SC Reverb", createParameterLayout())
-    , mDspLibraryData(nullptr)
-    , mDsp(nullptr)
+    , mDspArena(sp_revsc_auxdata_size(SoundpipeArena::kMaxSampleRate))
+    , mDsp {}
 {
     AudioProcessor::addListener(this);
 }
 
 void SCReverbProcessor::prepareToPlay(double sampleRate, int samplesPerBlock)
 {
-    if (mDsp != nullptr) {
-        return;
+    // Unsupported sample rates leave initDone at 0, which turns sp_revsc_compute() into a no-op
+    if (mDspArena.reset(sampleRate)) {
+        mDspArena.allocate(&mDsp.aux, sp_revsc_auxdata_size(mDspArena.getSampleRate()));
+        sp_revsc_init_aux(mDspArena.getData(), &mDsp);
+    } else {
+        mDsp.initDone = 0;
     }
 
-    sp_create(&mDspLibraryData);
-    sp_revsc_create(&mDsp);
-    sp_revsc_init(mDspLibraryData, mDsp);
-
     dsp::ProcessSpec spec = {
         .sampleRate = sampleRate,
         .maximumBlockSize = static_cast<uint32>(samplesPerBlock),
@@ -42,17 +43,21 @@ void SCReverbProcessor::prepareToPlay(double sampleRate, int samplesPerBlock)
 
     mDryWetMixer.prepare(spec);
     mDryWetMixer.setMixingRule(dsp::DryWetMixingRule::sin6dB);
+
+    mSilenceTracker.prepare(sampleRate);
+
+    mBypass.prepare(sampleRate, samplesPerBlock, 2, getBypassParameter()->getValue() != 0);
 }
 
-void SCReverbProcessor::releaseResources()
+double SCReverbProcessor::getTailLengthSeconds() const
 {
-    if (mDsp != nullptr) {
-        sp_revsc_destroy(&mDsp);
-    }
+    return SilenceTracker::getFeedbackTailSeconds(kMeanLoopSeconds,
+                                                  getParameterValue(kParameterFeedback));
+}
 
-    if (mDspLibraryData != nullptr) {
-        sp_destroy(&mDspLibraryData);
-    }
+void SCReverbProcessor::releaseResources()
+{
+    // Delay lines live in mDspArena, they are reinitialized by the next prepareToPlay()
 }
 
 void SCReverbProcessor::processBlockBypassed(juce::AudioBuffer<float>&, juce::MidiBuffer&)
@@ -62,12 +67,17 @@ void SCReverbProcessor::processBlockBypassed(juce::AudioBuffer<float>&, juce::Mi
     // See juce_AudioProcessor.cpp : buffer.clear (ch, 0, buffer.getNumSamples());
 }
 
-void SCReverbProcessor::processBlock(AudioBuffer<float>& buffer, MidiBuffer& midi)
+void SCReverbProcessor::processBlock(AudioBuffer<float>& buffer, MidiBuffer&)
 {
     // juce::AudioProcessorGraph logic never calls AudioProcessor::processBlockBypassed() when
     // AudioProcessor::getBypassParameter() returns a non-null parameter. See static void process()
-    if (getBypassParameter()->getValue() != 0) {
-        processBlockBypassed(buffer, midi);
+    mBypass.process(buffer, getBypassParameter()->getValue() != 0,
+                    [this](AudioBuffer<float>& b) { process(b); });
+}
+
+void SCReverbProcessor::process(AudioBuffer<float>& buffer) noexcept
+{
+    if (mSilenceTracker.skipBlock(buffer, getTailLengthSeconds())) {
         return;
     }
 
@@ -75,8 +85,8 @@ void SCReverbProcessor::processBlock(AudioBuffer<float>& buffer, MidiBuffer& mid
     dsp::AudioBlock<float> block(buffer);
     mDryWetMixer.pushDrySamples(block);
 
-    mDsp->feedback = getParameterValue(kParameterFeedback);
-    mDsp->lpfreq = getParameterValue(kParameterLowPassFilterCutoff);
+    mDsp.feedback = getParameterValue(kParameterFeedback);
+    mDsp.lpfreq = getParameterValue(kParameterLowPassFilterCutoff);
 
     // Not clear why Soundpipe expects writable input parameters
     const int numSamples = buffer.getNumSamples();
@@ -86,7 +96,7 @@ void SCReverbProcessor::processBlock(AudioBuffer<float>& buffer, MidiBuffer& mid
         ki0 = buffer.getSample(0, i);
         ki1 = buffer.getSample(1, i);
 
-        sp_revsc_compute(mDspLibraryData, mDsp, &ki0, &ki1,
+        sp_revsc_compute(mDspArena.getData(), &mDsp, &ki0, &ki1,
                          buffer.getWritePointer(0, i), buffer.getWritePointer(1, i));
     }
 
@@ -94,6 +104,8 @@ void SCReverbProcessor::processBlock(AudioBuffer<float>& buffer, MidiBuffer& mid
 
     mDryWetMixer.setWetMixProportion(getParameterValue(kParameterMix));
     mDryWetMixer.mixWetSamples(block);
+
+    mSilenceTracker.trackOutput(buffer);
 }
 
 void SCReverbProcessor::audioProcessorParameterChanged(AudioProcessor* processor,
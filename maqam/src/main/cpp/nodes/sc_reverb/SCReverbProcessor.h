@@ -11,9 +11,9 @@
 #include <juce_audio_processors/juce_audio_processors.h>
 #include <juce_dsp/juce_dsp.h>
 
-extern "C" {
-#include "soundpipe.h"
-}
+#include "nodes/AudioProcessorHelpers.h"
+#include "nodes/SilenceTracker.h"
+#include "nodes/SoundpipeArena.h"
 
 namespace maqam {
 
@@ -48,7 +48,7 @@ public:
 
     bool   acceptsMidi() const override { return false; }
     bool   producesMidi() const override { return false; }
-    double getTailLengthSeconds() const override { return 0.0; }
+    double getTailLengthSeconds() const override;
 
     int  getNumPrograms() override { return 0; }
     int  getCurrentProgram() override { return 0; }
@@ -56,8 +56,15 @@ public:
     const juce::String getProgramName(int index) override { return ""; }
     void changeProgramName(int index, const juce::String& newName) override {}
 
-    void getStateInformation(juce::MemoryBlock& destData) override {}
-    void setStateInformation(const void* data, int sizeInBytes) override {}
+    void getStateInformation(juce::MemoryBlock& destData) override
+    {
+        writeParameterState(mParameters, destData);
+    }
+
+    void setStateInformation(const void* data, int sizeInBytes) override
+    {
+        readParameterState(mParameters, data, sizeInBytes);
+    }
 
 private:
     // juce::AudioProcessorListener
@@ -67,7 +74,9 @@ private:
     static juce::AudioProcessorValueTreeState::ParameterLayout
     createParameterLayout() noexcept;
 
-    inline float getParameterValue(juce::StringRef parameterID) noexcept
+    void process(juce::AudioBuffer<float>& buffer) noexcept;
+
+    inline float getParameterValue(juce::StringRef parameterID) const noexcept
     {
         return reinterpret_cast<juce::AudioParameterFloat*>(mParameters.getParameter(parameterID))
             ->get();
@@ -75,8 +84,8 @@ private:
 
     juce::AudioProcessorValueTreeState mParameters;
 
-    sp_data*  mDspLibraryData;
-    sp_revsc* mDsp;
+    SoundpipeArena mDspArena;
+    sp_revsc       mDsp;
 
     using FloatCoefficients = juce::dsp::IIR::Coefficients<float>;
     using MonoFilter        = juce::dsp::IIR::Filter<float>;
@@ -86,6 +95,9 @@ private:
 
     juce::dsp::DryWetMixer<float> mDryWetMixer;
 
+    SilenceTracker  mSilenceTracker;
+    BypassCrossfade mBypass;
+
 };
 
 } // maqam
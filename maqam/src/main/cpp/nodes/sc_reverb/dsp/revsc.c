@@ -54,7 +54,25 @@ int sp_revsc_create(sp_revsc **p){
     return SP_OK;
 }
 
+size_t sp_revsc_auxdata_size(SPFLOAT sr)
+{
+    int i, nBytes = 0;
+    for(i = 0; i < 8; i++){
+        nBytes += delay_line_bytes_alloc(sr, 1, i);
+    }
+    return nBytes;
+}
+
 int sp_revsc_init(sp_data *sp, sp_revsc *p)
+{
+    sp_auxdata_alloc(&p->aux, sp_revsc_auxdata_size(sp->sr));
+    return sp_revsc_init_aux(sp, p);
+}
+
+/* Same as sp_revsc_init() but uses the memory already held by p->aux, */
+/* which must hold at least sp_revsc_auxdata_size(sp->sr) bytes.       */
+
+int sp_revsc_init_aux(sp_data *sp, sp_revsc *p)
 {
     p->iSampleRate = sp->sr;
     p->sampleRate = sp->sr;
@@ -64,18 +82,17 @@ int sp_revsc_init(sp_data *sp, sp_revsc *p)
     p->iSkipInit = 0;
     p->dampFact = 1.0;
     p->prv_LPFreq = 0.0;
-    p->initDone = 1;
-    int i, nBytes = 0;
-    for(i = 0; i < 8; i++){
-        nBytes += delay_line_bytes_alloc(sp->sr, 1, i);
+    p->initDone = 0;
+    if (p->aux.ptr == NULL || p->aux.size < sp_revsc_auxdata_size(sp->sr)) {
+        return SP_NOT_OK;
     }
-    sp_auxdata_alloc(&p->aux, nBytes);
-    nBytes = 0;
+    int i, nBytes = 0;
     for (i = 0; i < 8; i++) {
         p->delayLines[i].buf = (p->aux.ptr) + nBytes;
         init_delay_line(p, &p->delayLines[i], i);
         nBytes += delay_line_bytes_alloc(sp->sr, 1, i);
     }
+    p->initDone = 1;
 
     return SP_OK;
 }
@@ -0,0 +1,415 @@
+//
+// Maqam - Mobile App Quick Audio & MIDI
+//
+// SPDX-FileCopyrightText: 2024 TAQS.IM <contact@taqs.im>
+// SPDX-License-Identifier: MIT
+//
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+#include "SequencerProcessor.h"
+
+using namespace juce;
+using namespace maqam;
+
+static const Identifier kStatePattern      { "PATTERN" };
+static const Identifier kStateNote         { "NOTE" };
+static const Identifier kStateNumSteps     { "numSteps" };
+static const Identifier kStateStepsPerBeat { "stepsPerBeat" };
+static const Identifier kStateSwing        { "swing" };
+static const Identifier kStateChannel      { "channel" };
+static const Identifier kStateArpeggiate   { "arpeggiate" };
+static const Identifier kStateStep         { "step" };
+static const Identifier kStateNoteNumber   { "note" };
+static const Identifier kStateVelocity     { "velocity" };
+static const Identifier kStateGate         { "gate" };
+
+SequencerProcessor::SequencerProcessor() noexcept
+    : AudioProcessor(BusesProperties())
+    , mParameters (*this, nullptr, "Sequencer", createParameterLayout())
+    , mPlayRequested(false)
+    , mFollowTransport(false)
+    , mPositionRequest(-1.0)
+    , mReportedPosition(0)
+    , mPattern()
+    , mPlaying(false)
+    , mPosition(0)
+    , mNumHeldNotes(0)
+    , mHeldNotes()
+    , mNumSoundingNotes(0)
+    , mSoundingNotes()
+{
+    mOutput.ensureSize(kReservedMidiSize);
+}
+
+void SequencerProcessor::setPattern(int numSteps, int stepsPerBeat, float swing, int channel,
+                                    bool arpeggiate, const int* stepIndices, const int* notes,
+                                    const float* velocities, const float* gates, int count)
+{
+    if ((numSteps < 0) || (numSteps > kMaxSteps)) {
+        throw std::invalid_argument("Invalid number of steps");
+    }
+
+    if ((stepsPerBeat < 1) || (stepsPerBeat > kMaxStepsPerBeat)) {
+        throw std::invalid_argument("Invalid steps per beat");
+    }
+
+    if ((swing < 0) || (swing > kMaxSwing)) {
+        throw std::invalid_argument("Invalid swing");
+    }
+
+    if ((channel < 0) || (channel > 15)) {
+        throw std::invalid_argument("Invalid MIDI channel");
+    }
+
+    const std::lock_guard<std::mutex> lock(mPatternMutex);
+
+    // Slot contents are stale, the whole pattern is written
+    Pattern& pattern = mPatterns.getWriteBuffer();
+    pattern.numSteps = numSteps;
+    pattern.stepsPerBeat = stepsPerBeat;
+    pattern.swing = swing;
+    pattern.channel = channel;
+    pattern.arpeggiate = arpeggiate;
+
+    for (Step& step : pattern.steps) {
+        step.numNotes = 0;
+    }
+
+    for (int i = 0; i < count; ++i) {
+        if ((stepIndices[i] < 0) || (stepIndices[i] >= numSteps)) {
+            throw std::invalid_argument("Invalid step index");
+        }
+
+        if ((notes[i] < 0) || (notes[i] > 127)) {
+            throw std::invalid_argument("Invalid note");
+        }
+
+        if ((velocities[i] <= 0) || (velocities[i] > 1.f)) {
+            throw std::invalid_argument("Invalid velocity");
+        }
+
+        if ((gates[i] <= 0) || (gates[i] > static_cast<float>(kMaxSteps))) {
+            throw std::invalid_argument("Invalid gate");
+        }
+
+        Step& step = pattern.steps[static_cast<size_t>(stepIndices[i])];
+
+        if (step.numNotes == kMaxNotesPerStep) {
+            throw std::invalid_argument("Too many notes in step");
+        }
+
+        step.notes[step.numNotes++] = { notes[i], velocities[i], gates[i] };
+    }
+
+    mPattern = pattern;
+    mPatterns.publish();
+
+    // The pattern is part of the saved state, see getStateInformation()
+    updateHostDisplay(ChangeDetails().withNonParameterStateChanged(true));
+}
+
+void SequencerProcessor::getStateInformation(MemoryBlock& destData)
+{
+    ValueTree state = mParameters.copyState();
+    ValueTree patternState(kStatePattern);
+
+    {
+        const std::lock_guard<std::mutex> lock(mPatternMutex);
+
+        if (mPattern.stepsPerBeat > 0) {
+            patternState.setProperty(kStateNumSteps, mPattern.numSteps, nullptr)
+                        .setProperty(kStateStepsPerBeat, mPattern.stepsPerBeat, nullptr)
+                        .setProperty(kStateSwing, mPattern.swing, nullptr)
+                        .setProperty(kStateChannel, mPattern.channel, nullptr)
+                        .setProperty(kStateArpeggiate, mPattern.arpeggiate, nullptr);
+
+            for (int i = 0; i < mPattern.numSteps; ++i) {
+                const Step& step = mPattern.steps[static_cast<size_t>(i)];
+
+                for (int j = 0; j < step.numNotes; ++j) {
+                    ValueTree noteState(kStateNote);
+                    noteState.setProperty(kStateStep, i, nullptr)
+                             .setProperty(kStateNoteNumber, step.notes[j].note, nullptr)
+                             .setProperty(kStateVelocity, step.notes[j].velocity, nullptr)
+                             .setProperty(kStateGate, step.notes[j].gate, nullptr);
+                    patternState.appendChild(noteState, nullptr);
+                }
+            }
+
+            state.appendChild(patternState, nullptr);
+        }
+    }
+
+    MemoryOutputStream stream(destData, /*appendToExistingBlockContent*/false);
+    state.writeToStream(stream);
+}
+
+void SequencerProcessor::setStateInformation(const void* data, int sizeInBytes)
+{
+    ValueTree state = ValueTree::readFromData(data, static_cast<size_t>(sizeInBytes));
+
+    if (! state.hasType(mParameters.state.getType())) {
+        return;
+    }
+
+    const ValueTree patternState = state.getChildWithName(kStatePattern);
+    state.removeChild(patternState, nullptr);
+    mParameters.replaceState(state);
+
+    if (! patternState.isValid()) {
+        return;
+    }
+
+    std::vector<int> stepIndices, notes;
+    std::vector<float> velocities, gates;
+
+    for (const ValueTree& noteState : patternState) {
+        stepIndices.push_back(noteState[kStateStep]);
+        notes.push_back(noteState[kStateNoteNumber]);
+        velocities.push_back(noteState[kStateVelocity]);
+        gates.push_back(noteState[kStateGate]);
+    }
+
+    // An invalid pattern keeps the current one, like a rejected setPattern() call
+    try {
+        setPattern(patternState[kStateNumSteps], patternState[kStateStepsPerBeat],
+                   patternState[kStateSwing], patternState[kStateChannel],
+                   patternState[kStateArpeggiate], stepIndices.data(), notes.data(),
+                   velocities.data(), gates.data(), static_cast<int>(notes.size()));
+    } catch (const std::invalid_argument&) {}
+}
+
+void SequencerProcessor::setPosition(double steps) noexcept
+{
+    mPositionRequest = std::max(0.0, steps);
+}
+
+void SequencerProcessor::prepareToPlay(double sampleRate, int samplesPerBlock)
+{
+    mOutput.ensureSize(kReservedMidiSize);
+}
+
+void SequencerProcessor::processBlock(AudioBuffer<float>& buffer, MidiBuffer& midiMessages)
+{
+    mPatterns.update();
+    const Pattern& pattern = mPatterns.getReadBuffer();
+    const int numSamples = buffer.getNumSamples();
+
+    mOutput.clear();
+
+    if (! pattern.arpeggiate) {
+        mNumHeldNotes = 0;
+    }
+
+    // Input is passed through, except notes played to the arpeggiator
+    for (const MidiMessageMetadata metadata : midiMessages) {
+        const MidiMessage message = metadata.getMessage();
+
+        if (pattern.arpeggiate && (message.isNoteOn() || message.isNoteOff())) {
+            trackHeldNote(message);
+        } else {
+            mOutput.addEvent(message, metadata.samplePosition);
+        }
+    }
+
+    const double positionRequest = mPositionRequest.exchange(-1.0);
+    bool playing = mPlayRequested;
+    double tempo = static_cast<double>(getParameterValue(kParameterTempo));
+
+    if (mFollowTransport) {
+        readPlayHead(pattern, playing, tempo);
+    } else if (positionRequest >= 0) {
+        allNotesOff(0);
+        mPosition = positionRequest;
+    }
+
+    if (playing != mPlaying) {
+        mPlaying = playing;
+
+        if (! mPlaying) {
+            allNotesOff(0);
+        }
+    }
+
+    if (mPlaying && (numSamples > 0)) {
+        const double stepsPerMinute = tempo * std::max(1, pattern.stepsPerBeat);
+        const double samplesPerStep = getSampleRate() * 60.0 / stepsPerMinute;
+        const double end = mPosition + numSamples / samplesPerStep;
+
+        if (pattern.numSteps > 0) {
+            // A swung odd step may start after the position, look one step back
+            const auto first = std::max<int64_t>(0, static_cast<int64_t>(mPosition) - 1);
+
+            for (int64_t step = first; ; ++step) {
+                const double start = getStepStart(step, pattern);
+
+                if (start >= end) {
+                    break;
+                }
+
+                if (start < mPosition) {
+                    continue;
+                }
+
+                const int offset = std::min(numSamples - 1,
+                        static_cast<int>((start - mPosition) * samplesPerStep));
+
+                releaseNotesBefore(start, samplesPerStep, numSamples);
+                playStep(step, pattern, start, offset);
+            }
+        }
+
+        releaseNotesBefore(end, samplesPerStep, numSamples);
+        mPosition = end;
+    }
+
+    mReportedPosition.store(mPosition, std::memory_order_relaxed);
+
+    midiMessages.clear();
+    midiMessages.addEvents(mOutput, 0, -1, 0);
+}
+
+// Leaves the arguments unchanged when there is no play head or it lacks tempo or position
+void SequencerProcessor::readPlayHead(const Pattern& pattern, bool& playing,
+                                      double& tempo) noexcept
+{
+    AudioPlayHead* playHead = getPlayHead();
+
+    if (playHead == nullptr) {
+        return;
+    }
+
+    const Optional<AudioPlayHead::PositionInfo> info = playHead->getPosition();
+
+    if (! info.hasValue() || ! info->getBpm().hasValue() || ! info->getPpqPosition().hasValue()) {
+        return;
+    }
+
+    const double position = *info->getPpqPosition() * std::max(1, pattern.stepsPerBeat);
+
+    if (std::abs(position - mPosition) > kMaxTransportDrift) {
+        allNotesOff(0);
+        mPosition = position;
+    }
+
+    playing = info->getIsPlaying();
+    tempo = *info->getBpm();
+}
+
+double SequencerProcessor::getStepStart(int64_t step, const Pattern& pattern) const noexcept
+{
+    return static_cast<double>(step) + ((step % 2) == 1 ? pattern.swing : 0);
+}
+
+void SequencerProcessor::trackHeldNote(const MidiMessage& message) noexcept
+{
+    const int note = message.getNoteNumber();
+    auto begin = mHeldNotes.begin();
+    auto end = begin + mNumHeldNotes;
+    auto it = std::lower_bound(begin, end, note);
+    const bool held = (it != end) && (*it == note);
+
+    if (message.isNoteOn()) {
+        if (! held && (mNumHeldNotes < kMaxHeldNotes)) {
+            std::copy_backward(it, end, end + 1);
+            *it = note;
+            mNumHeldNotes++;
+        }
+    } else if (held) {
+        std::copy(it + 1, end, it);
+        mNumHeldNotes--;
+    }
+}
+
+void SequencerProcessor::playStep(int64_t step, const Pattern& pattern, double stepStart,
+                                  int sampleOffset) noexcept
+{
+    const Step& s = pattern.steps[static_cast<size_t>(step % pattern.numSteps)];
+
+    for (int i = 0; i < s.numNotes; ++i) {
+        const StepNote& stepNote = s.notes[i];
+        int note = stepNote.note;
+
+        if (pattern.arpeggiate) {
+            if (mNumHeldNotes == 0) {
+                continue;
+            }
+
+            // Indices past the held notes continue in the octaves above
+            note = mHeldNotes[static_cast<size_t>(note % mNumHeldNotes)]
+                    + 12 * (note / mNumHeldNotes);
+
+            if (note > 127) {
+                continue;
+            }
+        }
+
+        // A note still sounding from an earlier step is ended before it plays again
+        for (int j = 0; j < mNumSoundingNotes; ++j) {
+            const SoundingNote& sounding = mSoundingNotes[static_cast<size_t>(j)];
+
+            if ((sounding.channel == pattern.channel) && (sounding.note == note)) {
+                noteOff(j, sampleOffset);
+                break;
+            }
+        }
+
+        if (mNumSoundingNotes == kMaxSoundingNotes) {
+            noteOff(0, sampleOffset);
+        }
+
+        mOutput.addEvent(MidiMessage::noteOn(pattern.channel + 1, note, stepNote.velocity),
+                         sampleOffset);
+        mSoundingNotes[static_cast<size_t>(mNumSoundingNotes++)] = {
+            pattern.channel, note, stepStart + stepNote.gate
+        };
+    }
+}
+
+void SequencerProcessor::releaseNotesBefore(double position, double samplesPerStep,
+                                            int numSamples) noexcept
+{
+    // Backwards, noteOff() moves the last note into the freed slot
+    for (int i = mNumSoundingNotes - 1; i >= 0; --i) {
+        const double offPosition = mSoundingNotes[static_cast<size_t>(i)].offPosition;
+
+        if (offPosition < position) {
+            const int offset = std::clamp(
+                    static_cast<int>((offPosition - mPosition) * samplesPerStep),
+                    0, numSamples - 1);
+            noteOff(i, offset);
+        }
+    }
+}
+
+void SequencerProcessor::noteOff(int index, int sampleOffset) noexcept
+{
+    const SoundingNote& sounding = mSoundingNotes[static_cast<size_t>(index)];
+    mOutput.addEvent(MidiMessage::noteOff(sounding.channel + 1, sounding.note), sampleOffset);
+    mSoundingNotes[static_cast<size_t>(index)] =
+            mSoundingNotes[static_cast<size_t>(--mNumSoundingNotes)];
+}
+
+void SequencerProcessor::allNotesOff(int sampleOffset) noexcept
+{
+    while (mNumSoundingNotes > 0) {
+        noteOff(mNumSoundingNotes - 1, sampleOffset);
+    }
+}
+
+AudioProcessorValueTreeState::ParameterLayout
+SequencerProcessor::createParameterLayout() noexcept
+{
+    return {
+        createFloatParameter(
+                kParameterTempo,
+                "Tempo", "BPM",
+                /*min*/20.f, /*max*/300.f, /*def*/120.f,
+                [](float v, int _) { return String(v, 1); }
+        ),
+    };
+}
@@ -0,0 +1,164 @@
+//
+// Maqam - Mobile App Quick Audio & MIDI
+//
+// SPDX-FileCopyrightText: 2024 TAQS.IM <contact@taqs.im>
+// SPDX-License-Identifier: MIT
+//
+
+#ifndef SEQUENCER_PROCESSOR_H
+#define SEQUENCER_PROCESSOR_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+
+#include <juce_audio_processors/juce_audio_processors.h>
+
+#include "nodes/AudioProcessorHelpers.h"
+#include "nodes/TripleBuffer.h"
+
+namespace maqam {
+
+/**
+ * Step sequencer and arpeggiator generating sample-accurate MIDI on the audio thread, so timing
+ * does not depend on Java threads. Connect its MIDI output to an instrument. A pattern is a loop
+ * of steps, each one playing up to kMaxNotesPerStep notes with their own velocity and gate. In
+ * arpeggiator mode pattern notes are indices into the notes held on the MIDI input, which is
+ * otherwise passed through. Patterns are replaced whole and take effect at the next block. When
+ * following the transport, play state, tempo and position come from the host play head instead.
+ */
+class SequencerProcessor : public juce::AudioProcessor
+{
+public:
+    static constexpr int kMaxSteps = 64;
+    static constexpr int kMaxNotesPerStep = 8;
+    static constexpr int kMaxHeldNotes = 16;
+    static constexpr int kMaxSoundingNotes = 64;
+    static constexpr int kMaxStepsPerBeat = 16;
+    static constexpr float kMaxSwing = 0.75f;
+    static constexpr int kReservedMidiSize = 4096;
+    // Larger jumps from the transport position are a relocation, not rounding between the clocks
+    static constexpr double kMaxTransportDrift = 1e-3;
+
+    static constexpr const char* kParameterTempo = "tempo";
+
+    struct StepNote
+    {
+        int   note;     // MIDI note, or held note index in arpeggiator mode
+        float velocity; // (0, 1]
+        float gate;     // in steps, over 1 ties into the following steps
+    };
+
+    struct Step
+    {
+        int      numNotes;
+        StepNote notes[kMaxNotesPerStep];
+    };
+
+    struct Pattern
+    {
+        int   numSteps;
+        int   stepsPerBeat;
+        float swing;    // delays odd steps by this fraction of a step, [0, 0.75]
+        int   channel;  // 0-based
+        bool  arpeggiate;
+        std::array<Step,kMaxSteps> steps;
+    };
+
+    SequencerProcessor() noexcept;
+    virtual ~SequencerProcessor() {}
+
+    // Any thread except the audio thread, throws std::invalid_argument
+    void setPattern(int numSteps, int stepsPerBeat, float swing, int channel, bool arpeggiate,
+                    const int* stepIndices, const int* notes, const float* velocities,
+                    const float* gates, int count);
+
+    void start() noexcept { mPlayRequested = true; }
+    void stop() noexcept { mPlayRequested = false; }
+    bool isPlaying() const noexcept { return mPlayRequested; }
+
+    // start(), stop(), setPosition() and the tempo parameter are ignored while following
+    void setFollowTransport(bool follow) noexcept { mFollowTransport = follow; }
+    bool getFollowTransport() const noexcept { return mFollowTransport; }
+
+    // Steps since the start of the pattern, setPosition() is applied at the next block
+    double getPosition() const noexcept { return mReportedPosition; }
+    void   setPosition(double steps) noexcept;
+
+    void prepareToPlay(double sampleRate, int samplesPerBlock) override;
+    void releaseResources() override {};
+
+    void processBlock(juce::AudioBuffer<float>&, juce::MidiBuffer&) override;
+
+    juce::AudioProcessorEditor* createEditor() override { return nullptr; }
+    bool hasEditor() const override { return false; }
+
+    const juce::String getName() const override { return "Sequencer"; }
+
+    bool   acceptsMidi() const override { return true; }
+    bool   producesMidi() const override { return true; }
+    bool   isMidiEffect() const override { return true; }
+    double getTailLengthSeconds() const override { return 0; }
+
+    int  getNumPrograms() override { return 0; }
+    int  getCurrentProgram() override { return 0; }
+    void setCurrentProgram(int index) override {}
+    const juce::String getProgramName(int index) override { return ""; }
+    void changeProgramName(int index, const juce::String& newName) override {}
+
+    // Parameters plus the pattern
+    void getStateInformation(juce::MemoryBlock& destData) override;
+    void setStateInformation(const void* data, int sizeInBytes) override;
+
+private:
+    struct SoundingNote
+    {
+        int    channel;
+        int    note;
+        double offPosition; // steps
+    };
+
+    static juce::AudioProcessorValueTreeState::ParameterLayout
+    createParameterLayout() noexcept;
+
+    inline float getParameterValue(juce::StringRef parameterID) const noexcept
+    {
+        return reinterpret_cast<juce::AudioParameterFloat*>(mParameters.getParameter(parameterID))
+            ->get();
+    }
+
+    void   readPlayHead(const Pattern& pattern, bool& playing, double& tempo) noexcept;
+    double getStepStart(int64_t step, const Pattern& pattern) const noexcept;
+    void   trackHeldNote(const juce::MidiMessage& message) noexcept;
+    void   playStep(int64_t step, const Pattern& pattern, double stepStart,
+                    int sampleOffset) noexcept;
+    void   releaseNotesBefore(double position, double samplesPerStep, int numSamples) noexcept;
+    void   noteOff(int index, int sampleOffset) noexcept;
+    void   allNotesOff(int sampleOffset) noexcept;
+
+    juce::AudioProcessorValueTreeState mParameters;
+
+    TripleBuffer<Pattern> mPatterns;
+    std::mutex            mPatternMutex;
+    Pattern               mPattern; // last one set for the saved state, stepsPerBeat 0 if none
+
+    std::atomic<bool>   mPlayRequested;
+    std::atomic<bool>   mFollowTransport;
+    std::atomic<double> mPositionRequest; // negative when none
+    std::atomic<double> mReportedPosition;
+
+    // Audio thread
+    bool   mPlaying;
+    double mPosition;   // steps
+    int    mNumHeldNotes;
+    std::array<int,kMaxHeldNotes> mHeldNotes; // ascending
+    int    mNumSoundingNotes;
+    std::array<SoundingNote,kMaxSoundingNotes> mSoundingNotes;
+    juce::MidiBuffer mOutput;
+
+};
+
+} // maqam
+
+#endif // SEQUENCER_PROCESSOR_H
@@ -0,0 +1,100 @@
+//
+// Maqam - Mobile App Quick Audio & MIDI
+//
+// SPDX-FileCopyrightText: 2024 TAQS.IM <contact@taqs.im>
+// SPDX-License-Identifier: MIT
+//
+
+#include <jni.h>
+
+#include "impl/AudioNode.h"
+#include "SequencerProcessor.h"
+
+using namespace maqam;
+
+#define GET_DSP(e,t) (*reinterpret_cast<SequencerProcessor*>(AudioNode::getDSP(e,t)))
+
+extern "C"
+JNIEXPORT void JNICALL
+Java_im_taqs_maqam_node_Sequencer_jniSetPattern(JNIEnv *env, jobject thiz, jint num_steps,
+                                                jint steps_per_beat, jfloat swing, jint channel,
+                                                jboolean arpeggiate, jintArray steps,
+                                                jintArray notes, jfloatArray velocities,
+                                                jfloatArray gates)
+{
+    const jsize count = env->GetArrayLength(steps);
+
+    if ((env->GetArrayLength(notes) != count) || (env->GetArrayLength(velocities) != count)
+            || (env->GetArrayLength(gates) != count)) {
+        env->ThrowNew(env->FindClass("im/taqs/maqam/Library$Exception"),
+                      "Pattern arrays must have the same length");
+        return;
+    }
+
+    jint* cSteps = env->GetIntArrayElements(steps, nullptr);
+    jint* cNotes = env->GetIntArrayElements(notes, nullptr);
+    jfloat* cVelocities = env->GetFloatArrayElements(velocities, nullptr);
+    jfloat* cGates = env->GetFloatArrayElements(gates, nullptr);
+
+    try {
+        GET_DSP(env, thiz).setPattern(num_steps, steps_per_beat, swing, channel, arpeggiate,
+            cSteps, cNotes, cVelocities, cGates, count);
+    } catch (const std::exception& e) {
+        env->ThrowNew(env->FindClass("im/taqs/maqam/Library$Exception"), e.what());
+    }
+
+    env->ReleaseFloatArrayElements(gates, cGates, JNI_ABORT);
+    env->ReleaseFloatArrayElements(velocities, cVelocities, JNI_ABORT);
+    env->ReleaseIntArrayElements(notes, cNotes, JNI_ABORT);
+    env->ReleaseIntArrayElements(steps, cSteps, JNI_ABORT);
+}
+
+extern "C"
+JNIEXPORT void JNICALL
+Java_im_taqs_maqam_node_Sequencer_start(JNIEnv *env, jobject thiz)
+{
+    GET_DSP(env, thiz).start();
+}
+
+extern "C"
+JNIEXPORT void JNICALL
+Java_im_taqs_maqam_node_Sequencer_stop(JNIEnv *env, jobject thiz)
+{
+    GET_DSP(env, thiz).stop();
+}
+
+extern "C"
+JNIEXPORT jboolean JNICALL
+Java_im_taqs_maqam_node_Sequencer_jniIsPlaying(JNIEnv *env, jobject thiz)
+{
+    return GET_DSP(env, thiz).isPlaying();
+}
+
+extern "C"
+JNIEXPORT jdouble JNICALL
+Java_im_taqs_maqam_node_Sequencer_jniGetPosition(JNIEnv *env, jobject thiz)
+{
+    return GET_DSP(env, thiz).getPosition();
+}
+
+extern "C"
+JNIEXPORT void JNICALL
+Java_im_taqs_maqam_node_Sequencer_jniSetPosition(JNIEnv *env, jobject thiz, jdouble steps)
+{
+    GET_DSP(env, thiz).setPosition(steps);
+}
+
+extern "C"
+JNIEXPORT void JNICALL
+Java_im_taqs_maqam_node_Sequencer_jniSetFollowTransport(JNIEnv *env, jobject thiz,
+                                                        jboolean follow)
+{
+    GET_DSP(env, thiz).setFollowTransport(follow);
+}
+
+extern "C"
+JNIEXPORT jboolean JNICALL
+Java_im_taqs_maqam_node_Sequencer_jniGetFollowTransport(JNIEnv *env, jobject thiz)
+{
+    return GET_DSP(env, thiz).getFollowTransport();
+}
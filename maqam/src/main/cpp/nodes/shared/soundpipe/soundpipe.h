@@ -1230,6 +1230,8 @@ typedef struct  {
 int sp_revsc_create(sp_revsc **p);
 int sp_revsc_destroy(sp_revsc **p);
 int sp_revsc_init(sp_data *sp, sp_revsc *p);
+int sp_revsc_init_aux(sp_data *sp, sp_revsc *p);
+size_t sp_revsc_auxdata_size(SPFLOAT sr);
 int sp_revsc_compute(sp_data *sp, sp_revsc *p, SPFLOAT *in1, SPFLOAT *in2, SPFLOAT *out1, SPFLOAT *out2);
 typedef struct sp_rms{
     SPFLOAT ihp, istor;
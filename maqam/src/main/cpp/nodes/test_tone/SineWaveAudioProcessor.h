@@ -9,6 +9,7 @@
 
 #include <juce_audio_processors/juce_audio_processors.h>
 
+#include "nodes/AudioProcessorHelpers.h"
 #include "SineWave.h"
 
 namespace maqam {
@@ -87,8 +88,15 @@ namespace maqam {
         const juce::String getProgramName(int index) override { return ""; }
         void changeProgramName(int index, const juce::String& newName) override {}
 
-        void getStateInformation(juce::MemoryBlock& destData) override {}
-        void setStateInformation(const void* data, int sizeInBytes) override {}
+        void getStateInformation(juce::MemoryBlock& destData) override
+        {
+            writeParameterState(mParameters, destData);
+        }
+
+        void setStateInformation(const void* data, int sizeInBytes) override
+        {
+            readParameterState(mParameters, data, sizeInBytes);
+        }
 
     private:
         juce::AudioProcessorValueTreeState mParameters;
@@ -99,6 +99,22 @@ class AudioGraph(
         }
     }
 
+    // MIDI reaching the graph output is sent to all open MIDI devices that accept input
+    fun sendMidiOutputFrom(vararg sources: AudioNode) {
+        if (Library.hasJNI) {
+            for (source in sources) {
+                jniConnectNodes(source, null, audio = false, midi = true)
+            }
+        }
+    }
+
+    // Forwards MIDI input unchanged to the graph output
+    fun routeMidiThrough() {
+        if (Library.hasJNI) {
+            jniConnectNodes(null, null, audio = false, midi = true)
+        }
+    }
+
     fun resetNodePropertyValues(
         skip: AudioNodePropertyIdentifiers = listOf(),
         includeMetadata: Boolean = false
@@ -120,6 +136,25 @@ class AudioGraph(
         }
     }
 
+    // Native binary snapshot of topology, parameters and node state, much faster to save and
+    // restore than nodePropertyValues. Restoring requires a graph with the same nodes added in the
+    // same order and takes effect at the next audio block boundary. Metadata is not included.
+    fun saveSnapshot(): ByteArray {
+        return if (Library.hasJNI) jniSaveSnapshot() else ByteArray(0)
+    }
+
+    fun restoreSnapshot(snapshot: ByteArray): Boolean {
+        return Library.hasJNI && jniRestoreSnapshot(snapshot)
+    }
+
+    internal fun mergeNodeMetadataValues(other: AudioGraphNodePropertyValues) {
+        nodes.forEach { (tag, node) ->
+            other[tag]?.let {
+                node.mergeMetadataValues(it)
+            }
+        }
+    }
+
     fun debugPrintConnections() {
         jniDebugPrintConnections()
     }
@@ -129,6 +164,8 @@ class AudioGraph(
     private external fun jniAddNode(node: AudioNode)
     private external fun jniConnectNodes(source: AudioNode?, sink: AudioNode?,
                                          audio: Boolean, midi: Boolean)
+    private external fun jniSaveSnapshot(): ByteArray
+    private external fun jniRestoreSnapshot(snapshot: ByteArray): Boolean
     private external fun jniDebugPrintConnections();
 
     // For simplicity, when creating a graph using Builder the first added node is automatically
@@ -26,6 +26,9 @@ open class AudioNode(): NativeWrapper() {
     interface Listener {
         fun onAudioNodePropertyValueChanged(node: AudioNode, property: AudioNodeProperty,
                                             value: Variant) {}
+
+        // Native state that is not a property changed, like a loaded file
+        fun onAudioNodeStateChanged(node: AudioNode) {}
     }
 
     internal interface Callback {
@@ -96,6 +99,54 @@ open class AudioNode(): NativeWrapper() {
         }
     }
 
+    // Metadata lives only on the Kotlin side, see AudioGraph.restoreSnapshot()
+    internal fun mergeMetadataValues(other: AudioNodePropertyValues) {
+        mergePropertyValues(other.filterKeys { properties[it] is AudioNodeMetadata })
+    }
+
+    //
+    // Presets are named snapshots of all parameter values kept on the native side. Morphing
+    // interpolates between two presets on the audio thread, moving morphPosition from 0 to 1
+    // changes every parameter with a single call.
+    //
+
+    val presetNames: List<String>
+        get() = if (Library.hasJNI) jniGetPresetNames().toList() else listOf()
+
+    var morphPosition: Float
+        get() = if (Library.hasJNI) jniGetMorphPosition() else 0f
+        set(value) {
+            if (Library.hasJNI) {
+                jniSetMorphPosition(value)
+            }
+        }
+
+    fun storePreset(name: String) {
+        if (Library.hasJNI) {
+            jniStorePreset(name)
+        }
+    }
+
+    fun removePreset(name: String): Boolean {
+        return Library.hasJNI && jniRemovePreset(name)
+    }
+
+    fun recallPreset(name: String): Boolean {
+        return Library.hasJNI && jniRecallPreset(name)
+    }
+
+    fun morphBetween(from: String, to: String) {
+        if (Library.hasJNI && ! jniSetMorphPresets(from, to)) {
+            throw Library.Exception("Unknown preset")
+        }
+    }
+
+    fun stopMorph() {
+        if (Library.hasJNI) {
+            jniClearMorph()
+        }
+    }
+
     fun addListener(listener: Listener) {
         synchronized(listeners) {
             listeners.add(listener)
@@ -193,6 +244,12 @@ open class AudioNode(): NativeWrapper() {
         return registerProperty(AudioNodeState(key, serializable, callback, type), false)
     }
 
+    protected fun notifyStateChanged() {
+        synchronized(listeners) {
+            listeners.forEach { it.onAudioNodeStateChanged(this) }
+        }
+    }
+
     // By design, MIDI events are sent to all nodes owned by the graph and not just this node.
     protected fun queueMidiEvent(event: MidiEvent) {
         midi.queue(event)
@@ -244,37 +301,19 @@ open class AudioNode(): NativeWrapper() {
         return property
     }
 
-    // Callback invoked from JNI code
-    protected fun jniOnParameterChanged(id: String, value: Float) {
-        properties[id]?.let { property ->
-            synchronized(listeners) {
-                listeners.forEach {
-                    it.onAudioNodePropertyValueChanged(this, property,
-                        property.serializableValue)
-                }
-            }
-        }
-    }
-
-    // Callback invoked from JNI code
-    protected fun jniOnValueTreePropertyStringValueChanged(id: String, value: String) {
-        properties[id]?.let { property ->
-            synchronized(listeners) {
-                listeners.forEach {
-                    it.onAudioNodePropertyValueChanged(this, property,
-                        property.serializableValue)
-                }
-            }
-        }
-    }
-
-    // Callback invoked from JNI code
-    protected fun jniOnValueTreePropertyFloatValueChanged(id: String, value: Float) {
-        properties[id]?.let { property ->
-            synchronized(listeners) {
-                listeners.forEach {
-                    it.onAudioNodePropertyValueChanged(this, property,
-                        property.serializableValue)
+    // Callback invoked from JNI code on the native notification thread, once per batch of
+    // coalesced changes. Listeners get the value that was current when the batch was collected.
+    // Values are NaN for string properties, those are read back from the node.
+    protected fun jniOnPropertiesChanged(ids: Array<String>, values: FloatArray) {
+        ids.forEachIndexed { index, id ->
+            properties[id]?.let { property ->
+                val value = values[index]
+                val variant = if (value.isNaN()) property.serializableValue else Variant(value)
+
+                synchronized(listeners) {
+                    listeners.forEach {
+                        it.onAudioNodePropertyValueChanged(this, property, variant)
+                    }
                 }
             }
         }
@@ -292,5 +331,13 @@ open class AudioNode(): NativeWrapper() {
     external fun jniSetValueTreePropertyStringValue(id: String, value: String)
 
     private external fun jniCreateProcessor()
+    private external fun jniStorePreset(name: String)
+    private external fun jniRemovePreset(name: String): Boolean
+    private external fun jniRecallPreset(name: String): Boolean
+    private external fun jniGetPresetNames(): Array<String>
+    private external fun jniSetMorphPresets(from: String, to: String): Boolean
+    private external fun jniClearMorph()
+    private external fun jniGetMorphPosition(): Float
+    private external fun jniSetMorphPosition(position: Float)
 
 }
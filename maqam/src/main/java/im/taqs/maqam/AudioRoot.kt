@@ -11,6 +11,7 @@ import android.content.Context
 import android.media.midi.MidiDevice
 import android.os.Handler
 import android.os.Looper
+import android.util.Base64
 import android.util.Log
 import im.taqs.maqam.impl.AudioNodeMetadata
 import im.taqs.maqam.impl.AudioNodeProperty
@@ -32,9 +33,23 @@ class AudioRoot(context: Context, private val options: Options = Options())
         fun onAudioRootStopped() {}
     }
 
+    // Audio callback thread scheduling, see ThreadPolicy.h. Callbacks off the fast cores are the
+    // usual cause of underruns on phones with big and little cores.
+    data class ThreadPolicyStats(
+        val isFifo: Boolean,
+        val isAffinitySet: Boolean,
+        val hasPerformanceHint: Boolean,
+        val numCallbacks: Long,
+        val numCallbacksOffFastCores: Long,
+        val maxWorkNanos: Long
+    )
+
     data class Options(
         val stateFile: File? = null,
-        val autoOpenMidiPorts: Boolean = true
+        val autoOpenMidiPorts: Boolean = true,
+        // Full-duplex mode, feeds the microphone to AudioGraph.captureInputTo(). Requires the
+        // RECORD_AUDIO permission to be granted before start().
+        val audioInput: Boolean = false
     )
 
     var isStarted: Boolean = false
@@ -53,6 +68,82 @@ class AudioRoot(context: Context, private val options: Options = Options())
             applyGraph()
         }
 
+    // Calls the graph with exactly this many frames no matter the device callback size, useful
+    // for nodes that need fixed size blocks. Power of two from 16 to 1024, 0 disables.
+    var fixedBlockSize: Int
+        get() = if (Library.hasJNI) jniGetFixedBlockSize() else 0
+        set(value) {
+            if (Library.hasJNI) {
+                jniSetFixedBlockSize(value)
+            }
+        }
+
+    // Added by fixedBlockSize between MIDI or audio input and output
+    val extraLatencyFrames: Int
+        get() = if (Library.hasJNI) jniGetExtraLatencyFrames() else 0
+
+    val threadPolicyStats: ThreadPolicyStats?
+        get() = if (Library.hasJNI) {
+            jniGetThreadPolicyStats().let {
+                ThreadPolicyStats(it[0] != 0L, it[1] != 0L, it[2] != 0L, it[3], it[4], it[5])
+            }
+        } else {
+            null
+        }
+
+    // Musical clock read by every node of the graph on the audio thread, changes are applied in
+    // order at the next audio block. Position is in quarter notes and only moves while the
+    // transport plays and the stream is started.
+    inner class Transport {
+        val isPlaying: Boolean
+            get() = if (Library.hasJNI) jniTransportIsPlaying() else false
+
+        var tempo: Double // BPM
+            get() = if (Library.hasJNI) jniTransportGetTempo() else 120.0
+            set(value) {
+                if (Library.hasJNI) {
+                    jniTransportSetTempo(value)
+                }
+            }
+
+        var position: Double
+            get() = if (Library.hasJNI) jniTransportGetPosition() else 0.0
+            set(value) {
+                if (Library.hasJNI) {
+                    jniTransportSetPosition(value)
+                }
+            }
+
+        // Numerator and denominator
+        val timeSignature: Pair<Int, Int>
+            get() = if (Library.hasJNI) {
+                jniTransportGetTimeSignature().let { Pair(it[0], it[1]) }
+            } else {
+                Pair(4, 4)
+            }
+
+        fun play() {
+            if (Library.hasJNI) {
+                jniTransportPlay()
+            }
+        }
+
+        fun stop() {
+            if (Library.hasJNI) {
+                jniTransportStop()
+            }
+        }
+
+        // Applies from the start of the current bar, denominator is a power of two
+        fun setTimeSignature(numerator: Int, denominator: Int) {
+            if (Library.hasJNI) {
+                jniTransportSetTimeSignature(numerator, denominator)
+            }
+        }
+    }
+
+    val transport = Transport()
+
     val midi = Midi(context, if (Library.hasJNI) this else object : Midi.Callback {})
     val metadata = AudioNodeMetadata(Library.PrivateMetadataKey, this)
 
@@ -62,7 +153,16 @@ class AudioRoot(context: Context, private val options: Options = Options())
     private var isLoadingState = false
     private var saveStateBlock: Runnable? = null
 
+    // Property values of every node as of the last save, saveState() only reads again the nodes
+    // that reported a change since then
+    private val savedNodePropertyValues = mutableMapOf<String, AudioNodePropertyValues>()
+    private val changedNodes = mutableSetOf<AudioNode>()
+
     init {
+        if (Library.hasJNI) {
+            jniSetInputEnabled(options.audioInput)
+        }
+
         applyGraph()
         midi.addListener(this)
     }
@@ -122,6 +222,21 @@ class AudioRoot(context: Context, private val options: Options = Options())
         Log.i(Library.LOG_TAG, "Stopped")
     }
 
+    // Sends MIDI from a device port only to node, on a single channel 0-15 or on all channels
+    // when null. Routed events skip the graph MIDI input, nodes wired with sendMidiInputTo() do
+    // not receive them. Routes are cleared when the graph is replaced.
+    fun routeMidi(port: Midi.Port, node: AudioNode, channel: Int? = null, portNumber: Int = 0) {
+        if (Library.hasJNI) {
+            jniRouteMidi(port.id, portNumber, channel ?: -1, node)
+        }
+    }
+
+    fun clearMidiRoutes() {
+        if (Library.hasJNI) {
+            jniClearMidiRoutes()
+        }
+    }
+
     fun loadState(): Boolean {
         if (options.stateFile == null) {
             throw StateFileNotSpecifiedException()
@@ -135,7 +250,14 @@ class AudioRoot(context: Context, private val options: Options = Options())
 
         val state = Json.decodeFromString<State>(options.stateFile.readText())
 
-        graph.nodePropertyValues = state.graphNodePropertyValues
+        val snapshot = state.graphSnapshot?.let { Base64.decode(it, Base64.NO_WRAP) }
+
+        if ((snapshot != null) && graph.restoreSnapshot(snapshot)) {
+            graph.mergeNodeMetadataValues(state.graphNodePropertyValues)
+        } else {
+            graph.nodePropertyValues = state.graphNodePropertyValues
+        }
+
         midi.portOpenState = state.midiPortOpenState
         metadata.store = state.rootMetadata
 
@@ -152,7 +274,8 @@ class AudioRoot(context: Context, private val options: Options = Options())
         }
 
         val state = State(
-            graphNodePropertyValues = graph.nodePropertyValues,
+            graphNodePropertyValues = collectNodePropertyValues(),
+            graphSnapshot = Base64.encodeToString(graph.saveSnapshot(), Base64.NO_WRAP),
             midiPortOpenState = midi.portOpenState,
             rootMetadata = metadata.store
         )
@@ -221,6 +344,15 @@ class AudioRoot(context: Context, private val options: Options = Options())
 
     override fun onAudioNodePropertyValueChanged(node: AudioNode, property: AudioNodeProperty,
                                                  value: Variant) {
+        synchronized(changedNodes) {
+            changedNodes.add(node)
+        }
+
+        saveStateIfNeeded(delayed = true)
+    }
+
+    // The graph snapshot carries the native state, node properties did not change
+    override fun onAudioNodeStateChanged(node: AudioNode) {
         saveStateIfNeeded(delayed = true)
     }
 
@@ -237,6 +369,11 @@ class AudioRoot(context: Context, private val options: Options = Options())
     //
 
     private fun applyGraph() {
+        synchronized(changedNodes) {
+            savedNodePropertyValues.clear()
+            changedNodes.clear()
+        }
+
         _graph.addListener(this)
         _graph.nodes.values.forEach { onAudioGraphNodeAdded(_graph, it) }
 
@@ -245,6 +382,22 @@ class AudioRoot(context: Context, private val options: Options = Options())
         }
     }
 
+    private fun collectNodePropertyValues(): AudioGraphNodePropertyValues {
+        synchronized(changedNodes) {
+            savedNodePropertyValues.keys.retainAll(graph.nodes.keys)
+
+            graph.nodes.forEach { (tag, node) ->
+                if ((node in changedNodes) || (tag !in savedNodePropertyValues)) {
+                    savedNodePropertyValues[tag] = node.propertyValues
+                }
+            }
+
+            changedNodes.clear()
+
+            return savedNodePropertyValues.toMap()
+        }
+    }
+
     @Synchronized
     private fun saveStateIfNeeded(delayed: Boolean = false) {
         if (isLoadingState) {
@@ -285,7 +438,23 @@ class AudioRoot(context: Context, private val options: Options = Options())
 
     private external fun jniStartStream()
     private external fun jniStopStream()
+    private external fun jniSetInputEnabled(enabled: Boolean)
+    private external fun jniSetFixedBlockSize(blockSize: Int)
+    private external fun jniGetFixedBlockSize(): Int
+    private external fun jniGetExtraLatencyFrames(): Int
     private external fun jniSetGraph(graph: AudioGraph)
+    private external fun jniGetThreadPolicyStats(): LongArray
+    private external fun jniRouteMidi(deviceId: Int, portNumber: Int, channel: Int, node: AudioNode)
+    private external fun jniClearMidiRoutes()
+    private external fun jniTransportPlay()
+    private external fun jniTransportStop()
+    private external fun jniTransportIsPlaying(): Boolean
+    private external fun jniTransportSetTempo(bpm: Double)
+    private external fun jniTransportGetTempo(): Double
+    private external fun jniTransportSetTimeSignature(numerator: Int, denominator: Int)
+    private external fun jniTransportGetTimeSignature(): IntArray
+    private external fun jniTransportSetPosition(quarterNotes: Double)
+    private external fun jniTransportGetPosition(): Double
 
     private class StateFileNotSpecifiedException : Library.Exception("State file not specified")
 
@@ -293,7 +462,9 @@ class AudioRoot(context: Context, private val options: Options = Options())
     private data class State(
         val graphNodePropertyValues: AudioGraphNodePropertyValues,
         val midiPortOpenState: MidiPortOpenState,
-        val rootMetadata: Map<String, Variant>
+        val rootMetadata: Map<String, Variant>,
+        // Fast path, graphNodePropertyValues is still used when the graph changed since saving
+        val graphSnapshot: String? = null
     )
 
 }
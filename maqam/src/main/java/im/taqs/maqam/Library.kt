@@ -20,6 +20,23 @@ object Library {
     internal var hasJNI = false
         private set
 
+    // Rate at which native parameter and state changes are delivered to AudioNode listeners.
+    // Changes to the same property in between deliveries are coalesced.
+    var notificationRateHz: Int = 60
+        set(value) {
+            field = value
+
+            if (hasJNI) {
+                jniSetNotificationRate(value)
+            }
+        }
+
+    // Logs audio thread allocations, locks and blocking calls recorded so far and returns their
+    // count. Always 0 unless the library was built with -DMAQAM_RT_SANITIZER=ON.
+    fun dumpRealtimeViolations(): Int {
+        return if (hasJNI) jniDumpRealtimeViolations() else 0
+    }
+
     // Must call before instantiating any Maqam class
 
     fun init(context: Context) {
@@ -30,6 +47,7 @@ object Library {
         System.loadLibrary("maqam")
 
         jniInit(context)
+        jniSetNotificationRate(notificationRateHz)
 
         hasJNI = true
     }
@@ -37,3 +55,5 @@ object Library {
 }
 
 private external fun jniInit(context: Context)
+private external fun jniSetNotificationRate(hz: Int)
+private external fun jniDumpRealtimeViolations(): Int
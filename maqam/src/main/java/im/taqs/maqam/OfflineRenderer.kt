@@ -0,0 +1,62 @@
+//
+// Maqam - Mobile App Quick Audio & MIDI
+//
+// SPDX-FileCopyrightText: 2024 TAQS.IM <contact@taqs.im>
+// SPDX-License-Identifier: MIT
+//
+
+package im.taqs.maqam
+
+import im.taqs.maqam.impl.MidiEvent
+import im.taqs.maqam.impl.NativeWrapper
+import java.io.File
+
+// Renders a graph into a 32-bit float WAV file without an audio device. The same script and
+// settings always produce the same file, so renders can be compared against reference files.
+// The graph must not be playing through a started AudioRoot while rendering. Nodes see a
+// transport playing from the first frame at tempo, see AudioRoot.Transport.
+class OfflineRenderer(
+    val graph: AudioGraph,
+    val sampleRate: Int = 48000,
+    val blockSize: Int = 256,
+    val tempo: Double = 120.0,
+    val timeSignature: Pair<Int, Int> = Pair(4, 4)
+) : NativeWrapper() {
+
+    // Sample accurate
+    fun midi(frame: Long, event: MidiEvent) {
+        if (Library.hasJNI) {
+            jniAddMidiEvent(frame, event.bytes)
+        }
+    }
+
+    // Applied at the start of the block containing frame
+    fun parameter(frame: Long, node: AudioNode, key: String, value: Float) {
+        if (Library.hasJNI) {
+            jniAddParameterChange(frame, node, key, value)
+        }
+    }
+
+    fun clear() {
+        if (Library.hasJNI) {
+            jniClear()
+        }
+    }
+
+    // Blocking, call from a background thread
+    fun render(numFrames: Long, file: File) {
+        if (Library.hasJNI) {
+            jniRender(graph, sampleRate, blockSize, tempo, timeSignature.first,
+                timeSignature.second, numFrames, file.absolutePath)
+        }
+    }
+
+    private external fun jniAddMidiEvent(frame: Long, bytes: ByteArray)
+    private external fun jniAddParameterChange(frame: Long, node: AudioNode, id: String,
+                                               value: Float)
+    private external fun jniClear()
+    private external fun jniRender(graph: AudioGraph, sampleRate: Int, blockSize: Int,
+                                   tempo: Double, numerator: Int, denominator: Int,
+                                   numFrames: Long, path: String)
+
+}
@@ -55,6 +55,13 @@ open class AKSampler(midiChannel: Int = 0) : SFZPlayer(midiChannel) {
         get() = jniGetMidiChannel()
         set(value) = jniSetMidiChannel(value)
 
+    // MPE lower zone, 0 disables it. Channel 0 is the master channel and the following
+    // mpeMemberChannels channels carry one note each, with its own pitch bend (48 semitones),
+    // channel pressure and timbre (CC74). Overrides midiChannel while enabled.
+    var mpeMemberChannels: Int
+        get() = jniGetMpeMemberChannels()
+        set(value) = jniSetMpeMemberChannels(value)
+
     init {
         if (Library.hasJNI) {
             jniSetMidiChannel(midiChannel)
@@ -92,12 +99,21 @@ open class AKSampler(midiChannel: Int = 0) : SFZPlayer(midiChannel) {
         ))
     }
 
-    external override fun load(path: String)
+    override fun load(path: String) {
+        jniLoad(path)
+        notifyStateChanged()
+    }
+
     external override fun stopAllVoices()
     external override fun setA4Frequency(frequency: Float)
     external override fun setScaleTuning(centsFromC: IntArray)
+    external override fun setScalaTuning(scale: String, keyboardMapping: String?)
+    external override fun retuneNote(note: Int, frequency: Float)
 
+    private external fun jniLoad(path: String)
     private external fun jniGetMidiChannel(): Int
     private external fun jniSetMidiChannel(midiChannel: Int)
+    private external fun jniGetMpeMemberChannels(): Int
+    private external fun jniSetMpeMemberChannels(numChannels: Int)
 
 }
@@ -0,0 +1,25 @@
+//
+// Maqam - Mobile App Quick Audio & MIDI
+//
+// SPDX-FileCopyrightText: 2024 TAQS.IM <contact@taqs.im>
+// SPDX-License-Identifier: MIT
+//
+
+package im.taqs.maqam.node
+
+import im.taqs.maqam.AudioNode
+
+class ConvolutionReverb: AudioNode(), BypassControl, MixControl {
+
+    override val bypass = parameter("bypass")
+    override val mix    = parameter("mix")
+
+    // Returns immediately, the impulse response is decoded in the background
+    fun load(path: String) {
+        jniLoad(path)
+        notifyStateChanged()
+    }
+
+    private external fun jniLoad(path: String)
+
+}
@@ -17,5 +17,6 @@ class Filter: AudioNode(), BypassControl, MixControl {
     val resonance       = parameter("resonance")
     val lfoAmplitude    = parameter("lfo_amplitude")
     val lfoRate         = parameter("lfo_rate")
+    val oversampling    = parameter("oversampling")
 
 }
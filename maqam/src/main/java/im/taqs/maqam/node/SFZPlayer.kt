@@ -21,6 +21,10 @@ abstract class SFZPlayer(open var midiChannel: Int = 0): AudioNode(), GainContro
     abstract fun setA4Frequency(frequency: Float)
     abstract fun setScaleTuning(centsFromC: IntArray)
 
+    // Scala .scl and optional .kbm file contents, see https://www.huygens-fokker.org/scala/
+    abstract fun setScalaTuning(scale: String, keyboardMapping: String? = null)
+    abstract fun retuneNote(note: Int, frequency: Float)
+
     abstract fun noteOn(note: Int, velocity: Float = 1f)
     abstract fun noteOff(note: Int, velocity: Float = 1f)
     abstract fun pitchBend(value: Float)
@@ -0,0 +1,65 @@
+//
+// Maqam - Mobile App Quick Audio & MIDI
+//
+// SPDX-FileCopyrightText: 2024 TAQS.IM <contact@taqs.im>
+// SPDX-License-Identifier: MIT
+//
+
+package im.taqs.maqam.node
+
+import im.taqs.maqam.AudioNode
+
+// Step sequencer and arpeggiator generating MIDI on the audio thread. It has no audio, connect it
+// to an instrument with graph.connect(sequencer, instrument, audio = false, midi = true).
+class Sequencer: AudioNode() {
+
+    // Gate is in steps. In arpeggiator mode note is an index into the notes held on the MIDI
+    // input, indices past the last one continue in the octaves above.
+    data class Note(
+        val step: Int,
+        val note: Int,
+        val velocity: Float = 1f,
+        val gate: Float = 0.5f
+    )
+
+    val tempo = parameter("tempo") // BPM
+
+    val isPlaying: Boolean
+        get() = jniIsPlaying()
+
+    // Plays along AudioRoot.transport, which then sets the play state, tempo and position.
+    // start(), stop(), position and tempo have no effect while following.
+    var followTransport: Boolean
+        get() = jniGetFollowTransport()
+        set(value) = jniSetFollowTransport(value)
+
+    // Steps since the start of the pattern
+    var position: Double
+        get() = jniGetPosition()
+        set(value) = jniSetPosition(value)
+
+    // Takes effect at the next audio block. Swing delays odd steps by up to 0.75 step.
+    fun setPattern(numSteps: Int, notes: List<Note>, stepsPerBeat: Int = 4, swing: Float = 0f,
+                   channel: Int = 0, arpeggiate: Boolean = false) {
+        jniSetPattern(numSteps, stepsPerBeat, swing, channel, arpeggiate,
+            notes.map { it.step }.toIntArray(),
+            notes.map { it.note }.toIntArray(),
+            notes.map { it.velocity }.toFloatArray(),
+            notes.map { it.gate }.toFloatArray())
+        notifyStateChanged()
+    }
+
+    external fun start()
+    external fun stop()
+
+    private external fun jniSetPattern(numSteps: Int, stepsPerBeat: Int, swing: Float,
+                                       channel: Int, arpeggiate: Boolean, steps: IntArray,
+                                       notes: IntArray, velocities: FloatArray,
+                                       gates: FloatArray)
+    private external fun jniIsPlaying(): Boolean
+    private external fun jniGetPosition(): Double
+    private external fun jniSetPosition(steps: Double)
+    private external fun jniSetFollowTransport(follow: Boolean)
+    private external fun jniGetFollowTransport(): Boolean
+
+}
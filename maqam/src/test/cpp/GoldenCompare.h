@@ -0,0 +1,160 @@
+//
+// Maqam - Mobile App Quick Audio & MIDI
+//
+// SPDX-FileCopyrightText: 2024 TAQS.IM <contact@taqs.im>
+// SPDX-License-Identifier: MIT
+//
+
+#ifndef MAQAM_GOLDEN_COMPARE_H
+#define MAQAM_GOLDEN_COMPARE_H
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <cstddef>
+#include <vector>
+
+namespace maqam::test {
+
+/**
+ * Compares a render against its reference, one channel at a time. Renders match when samples
+ * agree within the peak tolerance, or when the phase drifted a little and the average magnitude
+ * spectrum still agrees within the spectral tolerance. Drift happens across compilers and libm
+ * versions, rounding differences build up in oscillators and feedback paths. Renders that only
+ * share a spectrum, like noise from another seed or a shifted note, do not match.
+ */
+struct GoldenTolerance
+{
+    float peak = 1e-4f;             // largest sample difference, -80 dBFS
+    float driftPeak = 1e-2f;        // largest sample difference when the spectrum matches, -40 dBFS
+    float spectrumDb = 0.5f;        // largest band level difference
+    float spectrumFloorDb = -90.f;  // bands quieter than this in both signals are ignored
+};
+
+struct GoldenDifference
+{
+    float peak;
+    float spectrumDb;
+
+    bool isWithin(const GoldenTolerance& tolerance) const noexcept
+    {
+        return (peak <= tolerance.peak)
+            || ((peak <= tolerance.driftPeak) && (spectrumDb <= tolerance.spectrumDb));
+    }
+};
+
+namespace golden {
+
+constexpr size_t kFftOrder = 11;
+constexpr size_t kFftSize = size_t(1) << kFftOrder;
+constexpr size_t kBinsPerBand = 32;
+constexpr size_t kNumBands = kFftSize / 2 / kBinsPerBand;
+
+// In place, iterative radix 2
+inline void fft(std::vector<std::complex<float>>& data)
+{
+    const size_t n = data.size();
+
+    for (size_t i = 1, j = 0; i < n; ++i) {
+        size_t bit = n >> 1;
+
+        for (; (j & bit) != 0; bit >>= 1) {
+            j ^= bit;
+        }
+
+        j ^= bit;
+
+        if (i < j) {
+            std::swap(data[i], data[j]);
+        }
+    }
+
+    for (size_t length = 2; length <= n; length <<= 1) {
+        const double angle = -2.0 * M_PI / static_cast<double>(length);
+        const std::complex<float> step(static_cast<float>(std::cos(angle)),
+                                       static_cast<float>(std::sin(angle)));
+
+        for (size_t start = 0; start < n; start += length) {
+            std::complex<float> w(1.f, 0.f);
+
+            for (size_t k = 0; k < length / 2; ++k) {
+                const std::complex<float> even = data[start + k];
+                const std::complex<float> odd = data[start + k + length / 2] * w;
+                data[start + k] = even + odd;
+                data[start + k + length / 2] = even - odd;
+                w *= step;
+            }
+        }
+    }
+}
+
+// Level in dB of each band of the power spectrum averaged over Hann windowed frames. A trailing
+// partial frame is left out, its cut would spread over the whole spectrum. Samples are padded
+// with silence up to length.
+inline std::vector<float> getBandLevels(const std::vector<float>& samples, size_t length)
+{
+    std::vector<double> power(kNumBands, 0);
+    std::vector<std::complex<float>> frame(kFftSize);
+    const size_t numFrames = std::max<size_t>(length / kFftSize, 1);
+
+    for (size_t offset = 0; offset < numFrames * kFftSize; offset += kFftSize) {
+        for (size_t i = 0; i < kFftSize; ++i) {
+            const float window = 0.5f - 0.5f * static_cast<float>(std::cos(2.0 * M_PI
+                    * static_cast<double>(i) / kFftSize));
+            const float sample = offset + i < samples.size() ? samples[offset + i] : 0.f;
+            frame[i] = { window * sample, 0.f };
+        }
+
+        fft(frame);
+
+        for (size_t bin = 0; bin < kFftSize / 2; ++bin) {
+            power[bin / kBinsPerBand] += std::norm(frame[bin]);
+        }
+    }
+
+    std::vector<float> levels(kNumBands);
+    const double scale = 1.0 / (numFrames * kBinsPerBand
+            * (kFftSize / 4.0) * (kFftSize / 4.0));
+
+    for (size_t band = 0; band < kNumBands; ++band) {
+        levels[band] = static_cast<float>(10.0 * std::log10(power[band] * scale + 1e-30));
+    }
+
+    return levels;
+}
+
+} // golden
+
+// Samples past the end of the shorter signal compare against silence
+inline GoldenDifference compareToGolden(const std::vector<float>& rendered,
+                                        const std::vector<float>& golden,
+                                        const GoldenTolerance& tolerance = {})
+{
+    GoldenDifference difference { 0, 0 };
+    const size_t length = std::max(rendered.size(), golden.size());
+
+    for (size_t i = 0; i < length; ++i) {
+        const float a = i < rendered.size() ? rendered[i] : 0.f;
+        const float b = i < golden.size() ? golden[i] : 0.f;
+        difference.peak = std::max(difference.peak, std::abs(a - b));
+    }
+
+    const std::vector<float> renderedLevels = golden::getBandLevels(rendered, length);
+    const std::vector<float> goldenLevels = golden::getBandLevels(golden, length);
+
+    for (size_t band = 0; band < golden::kNumBands; ++band) {
+        if ((renderedLevels[band] < tolerance.spectrumFloorDb)
+                && (goldenLevels[band] < tolerance.spectrumFloorDb)) {
+            continue;
+        }
+
+        difference.spectrumDb = std::max(difference.spectrumDb,
+                                         std::abs(renderedLevels[band] - goldenLevels[band]));
+    }
+
+    return difference;
+}
+
+} // maqam::test
+
+#endif // MAQAM_GOLDEN_COMPARE_H
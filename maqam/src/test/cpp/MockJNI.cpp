@@ -0,0 +1,196 @@
+//
+// Maqam - Mobile App Quick Audio & MIDI
+//
+// SPDX-FileCopyrightText: 2024 TAQS.IM <contact@taqs.im>
+// SPDX-License-Identifier: MIT
+//
+
+#include <cassert>
+#include <cstring>
+
+#include "MockJNI.h"
+
+using namespace maqam::test;
+
+namespace {
+
+MockJNI* sInstance = nullptr;
+
+thread_local bool tAttached = false;
+
+constexpr int kMaxLongFields = 8;
+
+} // namespace
+
+// Field and method IDs point at these
+struct MockJNI::Member
+{
+    const Class* clazz;
+    std::string  name;
+    int          index;
+    bool         method;
+};
+
+struct MockJNI::Object
+{
+    const Class* clazz;
+    jlong        longFields[kMaxLongFields];
+};
+
+MockJNI::MockJNI(std::vector<Class> classes)
+    : mFunctions {}
+    , mInvokeFunctions {}
+    , mEnv {}
+    , mVM {}
+    , mClasses(std::move(classes))
+    , mNumCalls(0)
+    , mNumAttaches(0)
+    , mNumDetaches(0)
+{
+    assert(sInstance == nullptr);
+    sInstance = this;
+    tAttached = true;
+
+    for (const Class& clazz : mClasses) {
+        assert(clazz.longFields.size() <= kMaxLongFields);
+
+        for (size_t i = 0; i < clazz.longFields.size(); ++i) {
+            mMembers.push_back({ &clazz, clazz.longFields[i], static_cast<int>(i), false });
+        }
+
+        for (size_t i = 0; i < clazz.methods.size(); ++i) {
+            mMembers.push_back({ &clazz, clazz.methods[i], static_cast<int>(i), true });
+        }
+    }
+
+    mFunctions.GetJavaVM = [](JNIEnv*, JavaVM** vm) -> jint {
+        get().mNumCalls++;
+        *vm = get().getVM();
+        return JNI_OK;
+    };
+
+    mFunctions.FindClass = [](JNIEnv*, const char* name) -> jclass {
+        get().mNumCalls++;
+        return reinterpret_cast<jclass>(const_cast<Class*>(get().findClass(name)));
+    };
+
+    mFunctions.GetObjectClass = [](JNIEnv*, jobject obj) -> jclass {
+        get().mNumCalls++;
+        return reinterpret_cast<jclass>(const_cast<Class*>(reinterpret_cast<Object*>(obj)->clazz));
+    };
+
+    mFunctions.NewGlobalRef = [](JNIEnv*, jobject obj) -> jobject {
+        get().mNumCalls++;
+        return obj;
+    };
+
+    mFunctions.DeleteGlobalRef = [](JNIEnv*, jobject) {
+        get().mNumCalls++;
+    };
+
+    mFunctions.DeleteLocalRef = [](JNIEnv*, jobject) {
+        get().mNumCalls++;
+    };
+
+    mFunctions.GetFieldID = [](JNIEnv*, jclass clazz, const char* name, const char*) -> jfieldID {
+        get().mNumCalls++;
+        const Member* member = get().findMember(reinterpret_cast<Class*>(clazz), name, false);
+        return reinterpret_cast<jfieldID>(const_cast<Member*>(member));
+    };
+
+    mFunctions.GetMethodID = [](JNIEnv*, jclass clazz, const char* name,
+                                const char*) -> jmethodID {
+        get().mNumCalls++;
+        const Member* member = get().findMember(reinterpret_cast<Class*>(clazz), name, true);
+        return reinterpret_cast<jmethodID>(const_cast<Member*>(member));
+    };
+
+    mFunctions.GetLongField = [](JNIEnv*, jobject obj, jfieldID id) -> jlong {
+        get().mNumCalls++;
+        const auto member = reinterpret_cast<const Member*>(id);
+        return reinterpret_cast<Object*>(obj)->longFields[member->index];
+    };
+
+    mFunctions.SetLongField = [](JNIEnv*, jobject obj, jfieldID id, jlong value) {
+        get().mNumCalls++;
+        const auto member = reinterpret_cast<const Member*>(id);
+        reinterpret_cast<Object*>(obj)->longFields[member->index] = value;
+    };
+
+    mInvokeFunctions.GetEnv = [](JavaVM*, void** env, jint) -> jint {
+        get().mNumCalls++;
+
+        if (! tAttached) {
+            *env = nullptr;
+            return JNI_EDETACHED;
+        }
+
+        *env = get().getEnv();
+        return JNI_OK;
+    };
+
+    mInvokeFunctions.AttachCurrentThread = [](JavaVM*, void** env, void*) -> jint {
+        get().mNumCalls++;
+        get().mNumAttaches++;
+        tAttached = true;
+        *env = get().getEnv();
+        return JNI_OK;
+    };
+
+    mInvokeFunctions.DetachCurrentThread = [](JavaVM*) -> jint {
+        get().mNumCalls++;
+        get().mNumDetaches++;
+        tAttached = false;
+        return JNI_OK;
+    };
+
+    mEnv.functions = &mFunctions;
+    mVM.functions = &mInvokeFunctions;
+}
+
+MockJNI::~MockJNI()
+{
+    for (Object* object : mObjects) {
+        delete object;
+    }
+
+    sInstance = nullptr;
+}
+
+jobject MockJNI::newObject(const char* className)
+{
+    const Class* clazz = findClass(className);
+    assert(clazz != nullptr);
+
+    mObjects.push_back(new Object { clazz, {} });
+
+    return reinterpret_cast<jobject>(mObjects.back());
+}
+
+MockJNI& MockJNI::get() noexcept
+{
+    return *sInstance;
+}
+
+const MockJNI::Class* MockJNI::findClass(const char* name) const noexcept
+{
+    for (const Class& clazz : mClasses) {
+        if (clazz.name == name) {
+            return &clazz;
+        }
+    }
+
+    return nullptr;
+}
+
+const MockJNI::Member* MockJNI::findMember(const Class* clazz, const char* name,
+                                           bool method) const noexcept
+{
+    for (const Member& member : mMembers) {
+        if ((member.clazz == clazz) && (member.method == method) && (member.name == name)) {
+            return &member;
+        }
+    }
+
+    return nullptr;
+}
@@ -0,0 +1,76 @@
+//
+// Maqam - Mobile App Quick Audio & MIDI
+//
+// SPDX-FileCopyrightText: 2024 TAQS.IM <contact@taqs.im>
+// SPDX-License-Identifier: MIT
+//
+
+#ifndef MOCK_JNI_H
+#define MOCK_JNI_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <jni.h>
+
+namespace maqam::test {
+
+/**
+ * Stand-in Java VM for host tests, implements the JNI functions the library calls on the way in
+ * and out of Java. Classes know their long fields and methods by name and lookups compare
+ * strings, like symbol resolution in a real VM but far cheaper, so benchmarks should compare the
+ * number of calls rather than time. The thread that creates the mock counts as a Java thread,
+ * other threads have to attach. One instance at a time.
+ */
+class MockJNI
+{
+public:
+    struct Class
+    {
+        std::string              name;
+        std::vector<std::string> longFields;
+        std::vector<std::string> methods;
+    };
+
+    explicit MockJNI(std::vector<Class> classes);
+    ~MockJNI();
+
+    JNIEnv* getEnv() noexcept { return &mEnv; }
+    JavaVM* getVM() noexcept { return &mVM; }
+
+    // Instance of one of the classes, owned by the mock
+    jobject newObject(const char* className);
+
+    int64_t getNumCalls() const noexcept { return mNumCalls; }
+    int64_t getNumAttaches() const noexcept { return mNumAttaches; }
+    int64_t getNumDetaches() const noexcept { return mNumDetaches; }
+
+private:
+    struct Object;
+    struct Member;
+
+    static MockJNI& get() noexcept;
+
+    const Class* findClass(const char* name) const noexcept;
+    const Member* findMember(const Class* clazz, const char* name, bool method) const noexcept;
+
+    JNINativeInterface_ mFunctions;
+    JNIInvokeInterface_ mInvokeFunctions;
+    JNIEnv              mEnv;
+    JavaVM              mVM;
+
+    std::vector<Class>   mClasses;
+    std::vector<Member>  mMembers;
+    std::vector<Object*> mObjects;
+
+    std::atomic<int64_t> mNumCalls;
+    std::atomic<int64_t> mNumAttaches;
+    std::atomic<int64_t> mNumDetaches;
+
+};
+
+} // maqam::test
+
+#endif // MOCK_JNI_H
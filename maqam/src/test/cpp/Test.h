@@ -0,0 +1,72 @@
+//
+// Maqam - Mobile App Quick Audio & MIDI
+//
+// SPDX-FileCopyrightText: 2024 TAQS.IM <contact@taqs.im>
+// SPDX-License-Identifier: MIT
+//
+
+#ifndef MAQAM_TEST_H
+#define MAQAM_TEST_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+
+// Minimal checks for the host tests, each test is an executable that exits non-zero on failure
+#define CHECK(condition) maqam::test::check((condition), #condition, __FILE__, __LINE__)
+
+namespace maqam::test {
+
+// CTest reports a test exiting with this code as skipped, see SKIP_RETURN_CODE in CMakeLists.txt
+constexpr int kSkipped = 77;
+
+inline int& getNumFailures() noexcept
+{
+    static int numFailures = 0;
+    return numFailures;
+}
+
+inline bool check(bool passed, const char* condition, const char* file, int line) noexcept
+{
+    if (! passed) {
+        std::fprintf(stderr, "%s:%d: check failed: %s\n", file, line, condition);
+        getNumFailures()++;
+    }
+
+    return passed;
+}
+
+inline int finish() noexcept
+{
+    if (getNumFailures() > 0) {
+        std::fprintf(stderr, "%d check(s) failed\n", getNumFailures());
+        return 1;
+    }
+
+    return 0;
+}
+
+// Seconds per call of function, best of several runs to filter out scheduling noise
+template<class Function>
+double measureSeconds(int numCalls, Function&& function)
+{
+    using Clock = std::chrono::steady_clock;
+    double best = 0;
+
+    for (int run = 0; run < 5; ++run) {
+        const Clock::time_point start = Clock::now();
+
+        for (int i = 0; i < numCalls; ++i) {
+            function();
+        }
+
+        const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        best = (run == 0) ? seconds : std::min(best, seconds);
+    }
+
+    return best / numCalls;
+}
+
+} // maqam::test
+
+#endif // MAQAM_TEST_H
@@ -0,0 +1,170 @@
+//
+// Maqam - Mobile App Quick Audio & MIDI
+//
+// SPDX-FileCopyrightText: 2024 TAQS.IM <contact@taqs.im>
+// SPDX-License-Identifier: MIT
+//
+
+#include <cmath>
+#include <cstdio>
+#include <memory>
+
+#include "nodes/convolution_reverb/ConvolutionReverbProcessor.h"
+
+#include "Test.h"
+
+using namespace maqam;
+
+namespace {
+
+constexpr double kSampleRate = 48000;
+constexpr int    kBlockSize = 256;
+constexpr int    kNumBlocks = 1000;
+constexpr int    kNumTailBlocks = 20;
+constexpr int    kLoadTimeoutMillis = 10000;
+
+constexpr double kImpulseResponseSeconds[] = { 1, 3, 6 };
+
+// Stereo noise decaying by 60 dB over the length, written as a 24-bit WAV
+juce::File writeImpulseResponse(double seconds)
+{
+    const int length = juce::roundToInt(seconds * kSampleRate);
+    juce::AudioBuffer<float> impulseResponse(2, length);
+    juce::Random random(1);
+
+    for (int ch = 0; ch < 2; ++ch) {
+        for (int i = 0; i < length; ++i) {
+            const double decay = std::pow(1e-3, static_cast<double>(i) / length);
+            impulseResponse.setSample(ch, i,
+                    static_cast<float>((2.0 * random.nextDouble() - 1.0) * decay));
+        }
+    }
+
+    const juce::File file = juce::File::createTempFile(".wav");
+    juce::WavAudioFormat wav;
+    std::unique_ptr<juce::AudioFormatWriter> writer(wav.createWriterFor(
+            file.createOutputStream().release(), kSampleRate, 2, 24, {}, 0));
+
+    if ((writer == nullptr) || ! writer->writeFromAudioSampleBuffer(impulseResponse, 0, length)) {
+        std::fprintf(stderr, "Cannot write %s\n", file.getFullPathName().toRawUTF8());
+    }
+
+    return file;
+}
+
+void fillNoise(juce::AudioBuffer<float>& buffer)
+{
+    juce::Random random(2);
+
+    for (int ch = 0; ch < buffer.getNumChannels(); ++ch) {
+        for (int i = 0; i < buffer.getNumSamples(); ++i) {
+            buffer.setSample(ch, i, 0.5f * (2.f * random.nextFloat() - 1.f));
+        }
+    }
+}
+
+// Audio thread cost of the node with the worker running next to it, kHeadLength samples are
+// convolved per block on this thread whatever the IR length
+double measureAudioThread(const juce::File& file, double seconds)
+{
+    ConvolutionReverbProcessor processor;
+    processor.setRateAndBufferSizeDetails(kSampleRate, kBlockSize);
+    processor.prepareToPlay(kSampleRate, kBlockSize);
+    processor.load(file.getFullPathName());
+
+    juce::AudioBuffer<float> input(2, kBlockSize);
+    juce::AudioBuffer<float> buffer(2, kBlockSize);
+    juce::MidiBuffer midi;
+    fillNoise(input);
+
+    const auto processBlock = [&processor, &input, &buffer, &midi]() {
+        for (int ch = 0; ch < 2; ++ch) {
+            buffer.copyFrom(ch, 0, input, ch, 0, kBlockSize);
+        }
+
+        processor.processBlock(buffer, midi);
+    };
+
+    // The loader job and the juce::dsp::Convolution engines load in the background
+    for (int millis = 0; (processor.getTailLengthSeconds() < seconds * 0.99)
+            && (millis < kLoadTimeoutMillis); millis += 10) {
+        juce::Thread::sleep(10);
+    }
+
+    CHECK(processor.getTailLengthSeconds() >= seconds * 0.99);
+
+    for (int i = 0; i < 100; ++i) {
+        processBlock();
+        juce::Thread::sleep(1);
+    }
+
+    const double result = test::measureSeconds(kNumBlocks, processBlock);
+
+    CHECK(std::isfinite(buffer.getSample(0, 0)));
+    processor.releaseResources();
+
+    return result;
+}
+
+// Worker cost per tail block, the IR minus the head convolved in kTailBlockSize steps
+double measureTail(double seconds)
+{
+    constexpr int kTailBlockSize = ConvolutionReverbProcessor::kTailBlockSize;
+    const int length = juce::roundToInt(seconds * kSampleRate)
+            - ConvolutionReverbProcessor::kHeadLength;
+
+    juce::AudioBuffer<float> tail(2, length);
+    fillNoise(tail);
+
+    juce::dsp::Convolution convolution;
+    convolution.prepare({ kSampleRate, static_cast<juce::uint32>(kTailBlockSize), 2 });
+    convolution.loadImpulseResponse(std::move(tail), kSampleRate,
+            juce::dsp::Convolution::Stereo::yes, juce::dsp::Convolution::Trim::no,
+            juce::dsp::Convolution::Normalise::no);
+
+    juce::AudioBuffer<float> buffer(2, kTailBlockSize);
+    fillNoise(buffer);
+
+    const auto processBlock = [&convolution, &buffer]() {
+        juce::dsp::AudioBlock<float> block(buffer);
+        convolution.process(juce::dsp::ProcessContextReplacing<float>(block));
+    };
+
+    // The new engine is swapped in by process() once the background loader built it
+    for (int millis = 0; (convolution.getCurrentIRSize() != length)
+            && (millis < kLoadTimeoutMillis); millis += 10) {
+        processBlock();
+        juce::Thread::sleep(10);
+    }
+
+    CHECK(convolution.getCurrentIRSize() == length);
+
+    return test::measureSeconds(kNumTailBlocks, processBlock);
+}
+
+} // namespace
+
+// CPU cost of the convolution reverb for impulse responses of increasing length. The audio thread
+// cost should stay flat, the worker cost grows with the IR and must stay below 100 % of the
+// real-time budget for the tail to keep up.
+int main()
+{
+    const double audioBudget = kBlockSize / kSampleRate;
+    const double tailBudget = ConvolutionReverbProcessor::kTailBlockSize / kSampleRate;
+
+    std::printf("%8s %14s %10s %14s %10s\n", "IR s", "audio us/blk", "rt %", "tail ms/blk",
+                "rt %");
+
+    for (const double seconds : kImpulseResponseSeconds) {
+        const juce::File file = writeImpulseResponse(seconds);
+        const double audio = measureAudioThread(file, seconds);
+        const double tail = measureTail(seconds);
+
+        std::printf("%8.0f %14.2f %10.2f %14.2f %10.2f\n", seconds, audio * 1e6,
+                    100.0 * audio / audioBudget, tail * 1e3, 100.0 * tail / tailBudget);
+
+        file.deleteFile();
+    }
+
+    return test::finish();
+}
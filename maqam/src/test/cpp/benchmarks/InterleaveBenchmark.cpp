@@ -0,0 +1,81 @@
+//
+// Maqam - Mobile App Quick Audio & MIDI
+//
+// SPDX-FileCopyrightText: 2024 TAQS.IM <contact@taqs.im>
+// SPDX-License-Identifier: MIT
+//
+
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+#include "impl/Interleave.h"
+
+#include "Test.h"
+
+using namespace maqam;
+
+namespace {
+
+constexpr int kMinFrames = 64;
+constexpr int kMaxFrames = 8192;
+
+// Per-sample loop the output stage used before, kept out of line so it is not folded into the
+// benchmark loop
+[[gnu::noinline]] void interleaveScalar(const float* left, const float* right, float* dest,
+                                        int32_t numFrames) noexcept
+{
+    for (int32_t i = 0; i < numFrames; ++i) {
+        dest[2 * i] = left[i];
+        dest[2 * i + 1] = right[i];
+    }
+}
+
+} // namespace
+
+// Output stage cost, stereo planar to the interleaved device buffer, across the buffer sizes
+// Oboe asks for. Odd sizes are included to cover the scalar tail.
+int main()
+{
+    std::vector<float> left(kMaxFrames + 1);
+    std::vector<float> right(kMaxFrames + 1);
+    std::vector<float> dest(2 * (kMaxFrames + 1));
+    std::vector<float> expected(2 * (kMaxFrames + 1));
+
+    for (int i = 0; i <= kMaxFrames; ++i) {
+        left[i] = static_cast<float>(i);
+        right[i] = -static_cast<float>(i);
+    }
+
+    std::printf("%8s %14s %14s %10s\n", "frames", "scalar ns", "kernel ns", "speedup");
+
+    for (int numFrames = kMinFrames; numFrames <= kMaxFrames; numFrames *= 2) {
+        for (const int n : { numFrames, numFrames + 1 }) {
+            interleaveScalar(left.data(), right.data(), expected.data(), n);
+            interleaveStereo(left.data(), right.data(), dest.data(), n);
+            CHECK(std::equal(dest.begin(), dest.begin() + 2 * n, expected.begin()));
+        }
+
+        const int numCalls = 4 * kMaxFrames / numFrames * 64;
+
+        const double scalar = test::measureSeconds(numCalls, [&]() {
+            interleaveScalar(left.data(), right.data(), dest.data(), numFrames);
+        });
+
+        const double kernel = test::measureSeconds(numCalls, [&]() {
+            interleaveStereo(left.data(), right.data(), dest.data(), numFrames);
+        });
+
+        std::printf("%8d %14.1f %14.1f %10.2f\n", numFrames, scalar * 1e9, kernel * 1e9,
+                    scalar / kernel);
+
+        // Round trip, the input path uses the inverse
+        std::vector<float> l(numFrames);
+        std::vector<float> r(numFrames);
+        deinterleaveStereo(dest.data(), l.data(), r.data(), numFrames);
+        CHECK(std::equal(l.begin(), l.end(), left.begin()));
+        CHECK(std::equal(r.begin(), r.end(), right.begin()));
+    }
+
+    return test::finish();
+}
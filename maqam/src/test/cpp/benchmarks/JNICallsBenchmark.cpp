@@ -0,0 +1,122 @@
+//
+// Maqam - Mobile App Quick Audio & MIDI
+//
+// SPDX-FileCopyrightText: 2024 TAQS.IM <contact@taqs.im>
+// SPDX-License-Identifier: MIT
+//
+
+#include <cstdio>
+#include <thread>
+
+#include "impl/AudioNode.h"
+#include "impl/JNICache.h"
+#include "impl/NativeWrapper.h"
+
+#include "MockJNI.h"
+#include "Test.h"
+
+using namespace maqam;
+
+namespace {
+
+constexpr int kNumCalls = 100000;
+
+// How every JNI entry point found its native pointer before JNICache
+jlong getImplUncached(JNIEnv* env, jobject thiz)
+{
+    jclass clazz = env->GetObjectClass(thiz);
+    jfieldID id = env->GetFieldID(clazz, NativeWrapper::kDefaultImplFieldName, "J");
+    env->DeleteLocalRef(clazz);
+
+    return env->GetLongField(thiz, id);
+}
+
+// How a native thread got an env for each notification before JNICache
+void withAttachedThread(JavaVM* vm)
+{
+    JNIEnv* env = nullptr;
+    vm->AttachCurrentThread(reinterpret_cast<void**>(&env), nullptr);
+    vm->DetachCurrentThread();
+}
+
+struct Measurement
+{
+    double callsPerOperation;
+    double operationsPerSecond;
+};
+
+template<class Function>
+Measurement measure(test::MockJNI& jni, Function&& function)
+{
+    const int64_t numCalls = jni.getNumCalls();
+    function();
+    const double callsPerOperation = static_cast<double>(jni.getNumCalls() - numCalls);
+
+    const double seconds = test::measureSeconds(kNumCalls, function);
+
+    return { callsPerOperation, 1.0 / seconds };
+}
+
+void report(const char* name, const Measurement& before, const Measurement& after)
+{
+    std::printf("%-22s %6.0f -> %-6.0f JNI calls %12.0f -> %-12.0f ops/s\n", name,
+                before.callsPerOperation, after.callsPerOperation,
+                before.operationsPerSecond, after.operationsPerSecond);
+}
+
+} // namespace
+
+// JNI traffic of the two hot paths JNICache changed, native pointer lookup in every entry point
+// and getting an env on a native thread for every callback into Java. The mock VM resolves
+// names much faster than ART, so the call counts are the figure that carries over to devices.
+int main()
+{
+    test::MockJNI jni({
+        { "java/lang/Class", {}, { "getName" } },
+        { "java/lang/String", {}, {} },
+        { "im/taqs/maqam/impl/NativeWrapper", { NativeWrapper::kDefaultImplFieldName }, {} },
+        { "im/taqs/maqam/AudioNode", { AudioNode::kDSPFieldName }, { "jniOnPropertiesChanged" } }
+    });
+
+    JNIEnv* env = jni.getEnv();
+    JNICache::init(env);
+
+    int impl = 0;
+    jobject wrapper = jni.newObject("im/taqs/maqam/impl/NativeWrapper");
+    env->SetLongField(wrapper, env->GetFieldID(env->GetObjectClass(wrapper),
+                      NativeWrapper::kDefaultImplFieldName, "J"), reinterpret_cast<jlong>(&impl));
+
+    CHECK(NativeWrapper::getImpl<int>(env, wrapper) == &impl);
+    CHECK(getImplUncached(env, wrapper) == reinterpret_cast<jlong>(&impl));
+
+    const Measurement implBefore = measure(jni, [&]() { getImplUncached(env, wrapper); });
+    const Measurement implAfter = measure(jni, [&]() {
+        NativeWrapper::getImpl<int>(env, wrapper);
+    });
+
+    report("native pointer", implBefore, implAfter);
+    CHECK(implAfter.callsPerOperation < implBefore.callsPerOperation);
+
+    // Callbacks come from native threads, measured on one
+    std::thread thread([&jni]() {
+        const Measurement envBefore = measure(jni, [&jni]() { withAttachedThread(jni.getVM()); });
+
+        // First use attaches, the thread then stays attached
+        const int64_t numAttaches = jni.getNumAttaches();
+        JNICache::getEnv();
+
+        const Measurement envAfter = measure(jni, []() { JNICache::getEnv(); });
+
+        report("native thread env", envBefore, envAfter);
+        CHECK(envAfter.callsPerOperation == 0);
+        CHECK(jni.getNumAttaches() - numAttaches == 1);
+        CHECK(JNICache::getEnv() == jni.getEnv());
+    });
+
+    thread.join();
+
+    // Detached once, when the thread exited
+    CHECK(jni.getNumAttaches() == jni.getNumDetaches());
+
+    return test::finish();
+}
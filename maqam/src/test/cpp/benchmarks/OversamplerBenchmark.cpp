@@ -0,0 +1,69 @@
+//
+// Maqam - Mobile App Quick Audio & MIDI
+//
+// SPDX-FileCopyrightText: 2024 TAQS.IM <contact@taqs.im>
+// SPDX-License-Identifier: MIT
+//
+
+#include <cmath>
+#include <cstdio>
+
+#include "nodes/Oversampler.h"
+
+#include "Test.h"
+
+using namespace maqam;
+
+namespace {
+
+constexpr double kSampleRate = 48000;
+constexpr int    kBlockSize = 256;
+constexpr int    kNumChannels = 2;
+constexpr int    kNumBlocks = 1000;
+
+} // namespace
+
+// CPU cost of each oversampling factor around a tanh saturator, the kind of nonlinearity the
+// wrapper is meant for. Reports time per block and the share of the real-time budget.
+int main()
+{
+    Oversampler oversampler;
+    juce::AudioBuffer<float> buffer(kNumChannels, kBlockSize);
+
+    oversampler.prepare(kNumChannels, kBlockSize);
+
+    const double budget = kBlockSize / kSampleRate;
+
+    std::printf("%8s %14s %10s %10s\n", "factor", "us/block", "rt %", "latency");
+
+    for (int index = 0; index < Oversampler::kNumFactors; ++index) {
+        oversampler.setFactorIndex(index);
+
+        for (int i = 0; i < kBlockSize; ++i) {
+            const float x = static_cast<float>(std::sin(0.05 * i));
+            buffer.setSample(0, i, x);
+            buffer.setSample(1, i, x);
+        }
+
+        const double seconds = test::measureSeconds(kNumBlocks, [&oversampler, &buffer]() {
+            juce::dsp::AudioBlock<float> block(buffer);
+
+            oversampler.process(block, [](juce::dsp::AudioBlock<float>& b, int) {
+                for (size_t ch = 0; ch < b.getNumChannels(); ++ch) {
+                    float* samples = b.getChannelPointer(ch);
+
+                    for (size_t i = 0; i < b.getNumSamples(); ++i) {
+                        samples[i] = std::tanh(2.f * samples[i]);
+                    }
+                }
+            });
+        });
+
+        std::printf("%8d %14.2f %10.2f %10d\n", Oversampler::getFactor(index), seconds * 1e6,
+                    100.0 * seconds / budget, oversampler.getLatencySamples());
+
+        CHECK(std::isfinite(buffer.getSample(0, 0)));
+    }
+
+    return test::finish();
+}
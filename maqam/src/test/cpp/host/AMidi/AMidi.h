@@ -0,0 +1,146 @@
+//
+// Maqam - Mobile App Quick Audio & MIDI
+//
+// SPDX-FileCopyrightText: 2024 TAQS.IM <contact@taqs.im>
+// SPDX-License-Identifier: MIT
+//
+
+#ifndef HOST_AMIDI_H
+#define HOST_AMIDI_H
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include <sys/types.h>
+
+/**
+ * Host replacement for the subset of the NDK AMidi API used by MidiOutput. An AMidiDevice is a
+ * mock device that tests create directly, its input ports record every message sent to them.
+ * Output ports never open, they only let AudioRoot.cpp compile.
+ */
+typedef int32_t media_status_t;
+
+constexpr media_status_t AMEDIA_OK = 0;
+constexpr media_status_t AMEDIA_ERROR_UNKNOWN = -10000;
+
+constexpr int32_t AMIDI_OPCODE_DATA = 1;
+
+namespace amidi::host {
+
+struct SentMessage
+{
+    int32_t              portNumber;
+    std::vector<uint8_t> bytes;
+    int64_t              timestampNanos;
+};
+
+} // amidi::host
+
+struct AMidiDevice
+{
+    explicit AMidiDevice(int32_t numPorts) noexcept : numInputPorts(numPorts) {}
+
+    // Test thread, copy of what the ports received so far
+    std::vector<amidi::host::SentMessage> getSentMessages()
+    {
+        const std::lock_guard<std::mutex> lock(mutex);
+        return sentMessages;
+    }
+
+    int getNumOpenInputPorts()
+    {
+        const std::lock_guard<std::mutex> lock(mutex);
+        return numOpenInputPorts;
+    }
+
+    const int32_t                         numInputPorts;
+    std::mutex                            mutex;
+    std::vector<amidi::host::SentMessage> sentMessages;
+    int                                   numOpenInputPorts = 0;
+};
+
+struct AMidiOutputPort;
+
+struct AMidiInputPort
+{
+    AMidiDevice* device;
+    int32_t      portNumber;
+};
+
+inline ssize_t AMidiDevice_getNumInputPorts(const AMidiDevice* device)
+{
+    return device->numInputPorts;
+}
+
+inline ssize_t AMidiDevice_getNumOutputPorts(const AMidiDevice* /*device*/)
+{
+    return 0;
+}
+
+inline media_status_t AMidiOutputPort_open(const AMidiDevice* /*device*/, int32_t /*portNumber*/,
+                                           AMidiOutputPort** /*outputPortPtr*/)
+{
+    return AMEDIA_ERROR_UNKNOWN;
+}
+
+inline ssize_t AMidiOutputPort_receive(const AMidiOutputPort* /*outputPort*/,
+                                       int32_t* /*opcodePtr*/, uint8_t* /*buffer*/,
+                                       size_t /*maxBytes*/, size_t* /*numBytesReceivedPtr*/,
+                                       int64_t* /*outTimestampPtr*/)
+{
+    return 0;
+}
+
+inline void AMidiOutputPort_close(const AMidiOutputPort* /*outputPort*/) {}
+
+// Only for code built against the JNI headers, devices never come from Java on the host
+#if __has_include(<jni.h>)
+#include <jni.h>
+
+inline media_status_t AMidiDevice_fromJava(JNIEnv* /*env*/, jobject /*midiDeviceObj*/,
+                                           AMidiDevice** /*outDevicePtrPtr*/)
+{
+    return AMEDIA_ERROR_UNKNOWN;
+}
+#endif
+
+inline media_status_t AMidiInputPort_open(const AMidiDevice* device, int32_t portNumber,
+                                          AMidiInputPort** inputPortPtr)
+{
+    if ((portNumber < 0) || (portNumber >= device->numInputPorts)) {
+        return AMEDIA_ERROR_UNKNOWN;
+    }
+
+    auto* mutableDevice = const_cast<AMidiDevice*>(device);
+    const std::lock_guard<std::mutex> lock(mutableDevice->mutex);
+    mutableDevice->numOpenInputPorts++;
+    *inputPortPtr = new AMidiInputPort { mutableDevice, portNumber };
+
+    return AMEDIA_OK;
+}
+
+inline void AMidiInputPort_close(const AMidiInputPort* inputPort)
+{
+    {
+        const std::lock_guard<std::mutex> lock(inputPort->device->mutex);
+        inputPort->device->numOpenInputPorts--;
+    }
+
+    delete inputPort;
+}
+
+inline ssize_t AMidiInputPort_sendWithTimestamp(const AMidiInputPort* inputPort,
+                                                const uint8_t* buffer, size_t numBytes,
+                                                int64_t timestamp)
+{
+    const std::lock_guard<std::mutex> lock(inputPort->device->mutex);
+    inputPort->device->sentMessages.push_back({
+        inputPort->portNumber, std::vector<uint8_t>(buffer, buffer + numBytes), timestamp
+    });
+
+    return static_cast<ssize_t>(numBytes);
+}
+
+#endif // HOST_AMIDI_H
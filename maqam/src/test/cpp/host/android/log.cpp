@@ -0,0 +1,37 @@
+//
+// Maqam - Mobile App Quick Audio & MIDI
+//
+// SPDX-FileCopyrightText: 2024 TAQS.IM <contact@taqs.im>
+// SPDX-License-Identifier: MIT
+//
+
+#include <cstdio>
+
+#include "log.h"
+
+extern "C" {
+
+int __android_log_print(int prio, const char* tag, const char* fmt, ...)
+{
+    va_list ap;
+    va_start(ap, fmt);
+    const int result = __android_log_vprint(prio, tag, fmt, ap);
+    va_end(ap);
+
+    return result;
+}
+
+int __android_log_vprint(int prio, const char* tag, const char* fmt, va_list ap)
+{
+    static constexpr char kPriorities[] = "??VDIWEFS";
+
+    const bool known = (prio >= 0) && (prio <= ANDROID_LOG_SILENT);
+
+    std::fprintf(stderr, "%c/%s: ", known ? kPriorities[prio] : '?', tag);
+    const int result = std::vfprintf(stderr, fmt, ap);
+    std::fputc('\n', stderr);
+
+    return result;
+}
+
+}
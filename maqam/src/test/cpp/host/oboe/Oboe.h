@@ -0,0 +1,280 @@
+//
+// Maqam - Mobile App Quick Audio & MIDI
+//
+// SPDX-FileCopyrightText: 2024 TAQS.IM <contact@taqs.im>
+// SPDX-License-Identifier: MIT
+//
+
+#ifndef HOST_OBOE_H
+#define HOST_OBOE_H
+
+#include <algorithm>
+#include <cstdint>
+#include <ctime>
+#include <deque>
+#include <memory>
+
+/**
+ * Host replacement for the subset of Oboe used by the library. Input streams read from a
+ * simulated device, see oboe::host::SimulatedInputDevice, that tests fill with the frames a
+ * microphone would have captured. Output streams open with the format of
+ * oboe::host::SimulatedOutputDevice and never call back on their own, tests call onAudioReady()
+ * and onErrorAfterClose() themselves.
+ */
+namespace oboe {
+
+enum class Result : int32_t
+{
+    OK = 0,
+    ErrorInternal = -896,
+    ErrorUnavailable = -879
+};
+
+inline const char* convertToText(Result result) noexcept
+{
+    return result == Result::OK ? "OK" : "Error";
+}
+
+template<class T>
+class ResultWithValue
+{
+public:
+    ResultWithValue(T value) noexcept : mValue(value), mError(Result::OK) {}
+    ResultWithValue(Result error) noexcept : mValue(), mError(error) {}
+
+    explicit operator bool() const noexcept { return mError == Result::OK; }
+
+    T value() const noexcept { return mValue; }
+    Result error() const noexcept { return mError; }
+
+private:
+    T      mValue;
+    Result mError;
+
+};
+
+enum class Direction { Output, Input };
+enum class PerformanceMode { None, PowerSaving, LowLatency };
+enum class SharingMode { Exclusive, Shared };
+enum class AudioFormat { Invalid, Unspecified, I16, Float };
+enum class InputPreset { Generic, Camcorder, VoiceRecognition, VoiceCommunication, Unprocessed,
+                         VoicePerformance };
+enum class SampleRateConversionQuality { None, Fastest, Low, Medium, High, Best };
+enum class DataCallbackResult : int32_t { Continue, Stop };
+
+enum ChannelCount : int32_t
+{
+    Unspecified = 0,
+    Mono = 1,
+    Stereo = 2
+};
+
+namespace host {
+
+// Interleaved frames captured by the simulated microphone, queued until the stream reads them
+struct SimulatedInputDevice
+{
+    static SimulatedInputDevice& getInstance()
+    {
+        static SimulatedInputDevice device;
+        return device;
+    }
+
+    void reset(int32_t numChannels, int32_t burst)
+    {
+        channelCount = numChannels;
+        framesPerBurst = burst;
+        samples.clear();
+    }
+
+    void capture(const float* interleaved, int32_t numFrames)
+    {
+        samples.insert(samples.end(), interleaved, interleaved + numFrames * channelCount);
+    }
+
+    int32_t getAvailableFrames() const noexcept
+    {
+        return static_cast<int32_t>(samples.size()) / std::max(1, channelCount);
+    }
+
+    int32_t           channelCount = 2;
+    int32_t           framesPerBurst = 96;
+    bool              failOpen = false;
+    std::deque<float> samples;
+};
+
+// Format output streams open with, read once when a stream opens
+struct SimulatedOutputDevice
+{
+    static SimulatedOutputDevice& getInstance()
+    {
+        static SimulatedOutputDevice device;
+        return device;
+    }
+
+    int32_t sampleRate = 48000;
+    int32_t framesPerBurst = 96;
+    int32_t bufferCapacity = 1920;
+};
+
+} // host
+
+struct FrameTimestamp
+{
+    int64_t position;
+    int64_t timestamp;
+};
+
+class AudioStream
+{
+public:
+    explicit AudioStream(int32_t sampleRate) noexcept
+        : mSampleRate(sampleRate)
+        , mFramesPerBurst(0)
+        , mBufferCapacity(0)
+    {}
+
+    AudioStream(int32_t sampleRate, int32_t framesPerBurst, int32_t bufferCapacity) noexcept
+        : mSampleRate(sampleRate)
+        , mFramesPerBurst(framesPerBurst)
+        , mBufferCapacity(bufferCapacity)
+    {}
+
+    Result requestStart() noexcept { return Result::OK; }
+    Result requestStop() noexcept { return Result::OK; }
+    Result stop() noexcept { return Result::OK; }
+    Result close() noexcept { return Result::OK; }
+
+    int32_t getSampleRate() const noexcept { return mSampleRate; }
+
+    // Input streams follow the simulated input device
+    int32_t getFramesPerBurst() const noexcept
+    {
+        return mFramesPerBurst > 0 ? mFramesPerBurst
+                : host::SimulatedInputDevice::getInstance().framesPerBurst;
+    }
+
+    int32_t getBufferCapacityInFrames() const noexcept { return mBufferCapacity; }
+
+    int64_t getFramesWritten() const noexcept { return 0; }
+
+    // Never available, callers fall back to the current time
+    ResultWithValue<FrameTimestamp> getTimestamp(clockid_t /*clockId*/) const noexcept
+    {
+        return Result::ErrorUnavailable;
+    }
+
+    ResultWithValue<int32_t> getAvailableFrames() const noexcept
+    {
+        return host::SimulatedInputDevice::getInstance().getAvailableFrames();
+    }
+
+    // Never blocks, whatever the timeout
+    ResultWithValue<int32_t> read(void* buffer, int32_t numFrames, int64_t /*timeoutNanoseconds*/)
+    {
+        host::SimulatedInputDevice& device = host::SimulatedInputDevice::getInstance();
+        const int32_t numRead = std::min(numFrames, device.getAvailableFrames());
+        const auto numSamples = static_cast<size_t>(numRead * device.channelCount);
+
+        std::copy_n(device.samples.begin(), numSamples, static_cast<float*>(buffer));
+        device.samples.erase(device.samples.begin(), device.samples.begin() + numSamples);
+
+        return numRead;
+    }
+
+private:
+    int32_t mSampleRate;
+    int32_t mFramesPerBurst;
+    int32_t mBufferCapacity;
+
+};
+
+class AudioStreamDataCallback
+{
+public:
+    virtual ~AudioStreamDataCallback() = default;
+
+    virtual DataCallbackResult onAudioReady(AudioStream* audioStream, void* audioData,
+                                            int32_t numFrames) = 0;
+};
+
+class AudioStreamErrorCallback
+{
+public:
+    virtual ~AudioStreamErrorCallback() = default;
+
+    virtual void onErrorAfterClose(AudioStream* /*audioStream*/, Result /*error*/) {}
+};
+
+class LatencyTuner
+{
+public:
+    explicit LatencyTuner(AudioStream& /*stream*/) noexcept {}
+
+    Result tune() noexcept { return Result::OK; }
+};
+
+class AudioStreamBuilder
+{
+public:
+    AudioStreamBuilder* setDataCallback(AudioStreamDataCallback*) noexcept { return this; }
+    AudioStreamBuilder* setErrorCallback(AudioStreamErrorCallback*) noexcept { return this; }
+
+    AudioStreamBuilder* setDirection(Direction direction) noexcept
+    {
+        mDirection = direction;
+        return this;
+    }
+
+    AudioStreamBuilder* setPerformanceMode(PerformanceMode) noexcept { return this; }
+    AudioStreamBuilder* setSharingMode(SharingMode) noexcept { return this; }
+    AudioStreamBuilder* setFormat(AudioFormat) noexcept { return this; }
+    AudioStreamBuilder* setInputPreset(InputPreset) noexcept { return this; }
+    AudioStreamBuilder* setFormatConversionAllowed(bool) noexcept { return this; }
+    AudioStreamBuilder* setChannelConversionAllowed(bool) noexcept { return this; }
+    AudioStreamBuilder* setSampleRateConversionQuality(SampleRateConversionQuality) noexcept
+    {
+        return this;
+    }
+
+    AudioStreamBuilder* setChannelCount(int32_t channelCount) noexcept
+    {
+        mChannelCount = channelCount;
+        return this;
+    }
+
+    AudioStreamBuilder* setSampleRate(int32_t sampleRate) noexcept
+    {
+        mSampleRate = sampleRate;
+        return this;
+    }
+
+    Result openStream(std::shared_ptr<AudioStream>& stream)
+    {
+        if (mDirection == Direction::Output) {
+            const host::SimulatedOutputDevice& output = host::SimulatedOutputDevice::getInstance();
+            stream = std::make_shared<AudioStream>(output.sampleRate, output.framesPerBurst,
+                                                   output.bufferCapacity);
+            return Result::OK;
+        }
+
+        host::SimulatedInputDevice& device = host::SimulatedInputDevice::getInstance();
+
+        if (device.failOpen || (mChannelCount != device.channelCount)) {
+            return Result::ErrorUnavailable;
+        }
+
+        stream = std::make_shared<AudioStream>(mSampleRate);
+        return Result::OK;
+    }
+
+private:
+    Direction mDirection = Direction::Output;
+    int32_t   mChannelCount = 2;
+    int32_t   mSampleRate = 48000;
+
+};
+
+} // oboe
+
+#endif // HOST_OBOE_H
@@ -0,0 +1,153 @@
+//
+// Maqam - Mobile App Quick Audio & MIDI
+//
+// SPDX-FileCopyrightText: 2024 TAQS.IM <contact@taqs.im>
+// SPDX-License-Identifier: MIT
+//
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include "impl/AudioGraph.h"
+#include "impl/AudioRoot.h"
+
+#include "Test.h"
+
+using namespace maqam;
+
+namespace {
+
+constexpr int kTimeoutMillis = 5000;
+
+// Exposes the Oboe callbacks, on a device they come from Oboe threads
+class TestAudioRoot : public AudioRoot
+{
+public:
+    using AudioRoot::onErrorAfterClose;
+};
+
+void setOutputDevice(int32_t sampleRate, int32_t framesPerBurst, int32_t bufferCapacity)
+{
+    oboe::host::SimulatedOutputDevice& device = oboe::host::SimulatedOutputDevice::getInstance();
+    device.sampleRate = sampleRate;
+    device.framesPerBurst = framesPerBurst;
+    device.bufferCapacity = bufferCapacity;
+}
+
+// The stream reopens on a thread of its own
+template<class Condition>
+bool waitFor(Condition&& condition)
+{
+    for (int millis = 0; millis < kTimeoutMillis; ++millis) {
+        if (condition()) {
+            return true;
+        }
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    return condition();
+}
+
+bool isPreparedWith(AudioGraph& graph, double sampleRate, int blockSize)
+{
+    const juce::AudioProcessorGraph& impl = graph.getAudioProcessorGraph();
+    return (impl.getSampleRate() == sampleRate) && (impl.getBlockSize() == blockSize);
+}
+
+// Block size is the buffer capacity rounded down to whole bursts
+void testReopenPreparesGraph()
+{
+    setOutputDevice(48000, 96, 1920);
+    TestAudioRoot root;
+    AudioGraph graph;
+
+    root.setGraph(&graph);
+    CHECK(isPreparedWith(graph, 48000, 1920));
+
+    setOutputDevice(44100, 64, 1000);
+    root.onErrorAfterClose(nullptr, oboe::Result::ErrorInternal);
+    CHECK(waitFor([&graph]() { return isPreparedWith(graph, 44100, 960); }));
+
+    root.setGraph(nullptr);
+}
+
+// Graphs set while the stream reopens end up prepared for the stream that is open last
+void testSetGraphDuringReopen()
+{
+    setOutputDevice(48000, 96, 1920);
+    TestAudioRoot root;
+    AudioGraph first;
+    AudioGraph second;
+    std::atomic<bool> done(false);
+
+    std::thread setter([&root, &first, &second, &done]() {
+        for (int i = 0; ! done; ++i) {
+            root.setGraph((i % 2 == 0) ? &first : &second);
+        }
+
+        root.setGraph(&first);
+    });
+
+    for (int i = 0; i < 50; ++i) {
+        setOutputDevice((i % 2 == 0) ? 44100 : 48000, 96, 1920);
+        root.onErrorAfterClose(nullptr, oboe::Result::ErrorInternal);
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    done = true;
+    setter.join();
+
+    setOutputDevice(32000, 96, 960);
+    root.onErrorAfterClose(nullptr, oboe::Result::ErrorInternal);
+    CHECK(waitFor([&first]() { return isPreparedWith(first, 32000, 960); }));
+
+    root.setGraph(nullptr);
+}
+
+// A smaller stream lowers the fixed block size to the largest power of two that fits
+void testReopenClampsFixedBlockSize()
+{
+    setOutputDevice(48000, 96, 1920);
+    TestAudioRoot root;
+
+    root.setFixedBlockSize(1024);
+    CHECK(root.getFixedBlockSize() == 1024);
+
+    setOutputDevice(48000, 96, 192);
+    root.onErrorAfterClose(nullptr, oboe::Result::ErrorInternal);
+    CHECK(waitFor([&root]() { return root.getFixedBlockSize() == 128; }));
+
+    // Below the minimum the stream renders at the callback size
+    setOutputDevice(48000, 8, 8);
+    root.onErrorAfterClose(nullptr, oboe::Result::ErrorInternal);
+    CHECK(waitFor([&root]() { return root.getFixedBlockSize() == 0; }));
+
+    // Sizes that still fit are kept
+    AudioGraph graph;
+    root.setGraph(&graph);
+
+    setOutputDevice(48000, 96, 1920);
+    root.onErrorAfterClose(nullptr, oboe::Result::ErrorInternal);
+    CHECK(waitFor([&graph]() { return isPreparedWith(graph, 48000, 1920); }));
+    root.setFixedBlockSize(256);
+
+    setOutputDevice(44100, 96, 960);
+    root.onErrorAfterClose(nullptr, oboe::Result::ErrorInternal);
+    CHECK(waitFor([&graph]() { return isPreparedWith(graph, 44100, 960); }));
+    CHECK(root.getFixedBlockSize() == 256);
+
+    root.setGraph(nullptr);
+}
+
+} // namespace
+
+int main()
+{
+    testReopenPreparesGraph();
+    testSetGraphDuringReopen();
+    testReopenClampsFixedBlockSize();
+
+    return test::finish();
+}
@@ -0,0 +1,131 @@
+//
+// Maqam - Mobile App Quick Audio & MIDI
+//
+// SPDX-FileCopyrightText: 2024 TAQS.IM <contact@taqs.im>
+// SPDX-License-Identifier: MIT
+//
+
+#include <random>
+#include <vector>
+
+#include "impl/BlockSizeAdapter.h"
+
+#include "Test.h"
+
+using namespace maqam;
+
+namespace {
+
+constexpr int32_t kNumChannels = 2;
+constexpr int32_t kMaxCallbackFrames = 2048;
+constexpr int     kNumCallbacks = 20000;
+
+struct Event
+{
+    int64_t arrivalFrame;
+    int32_t offset;
+    int32_t latency;
+};
+
+/**
+ * Drives the adapter with random callback sizes the way AudioRoot does. Rendered blocks carry a
+ * running frame counter, so the device output must count up without gaps. Events arrive at the
+ * start of some callbacks and are held with the same bookkeeping as AudioRoot's pending MIDI, each
+ * must be rendered exactly one block after it arrived.
+ */
+void testRandomCallbackSizes(uint32_t seed, const std::vector<int32_t>& blockSizes)
+{
+    std::mt19937 random(seed);
+    std::uniform_int_distribution<int32_t> callbackFrames(1, kMaxCallbackFrames);
+    std::bernoulli_distribution hasEvent(0.3);
+
+    BlockSizeAdapter adapter(kNumChannels);
+    std::vector<float> dest(static_cast<size_t>(kNumChannels * kMaxCallbackFrames));
+    std::vector<Event> pending;
+    std::vector<Event> remaining;
+
+    int64_t playedFrames = 0;  // device position at the start of a callback
+    int64_t renderedFrames = 0;
+    int64_t expectedSample = 0;
+    int numEvents = 0;
+    int numRendered = 0;
+    bool continuous = true;
+    bool onTime = true;
+
+    adapter.setBlockSize(blockSizes.front());
+
+    for (int callback = 0; callback < kNumCallbacks; ++callback) {
+        if (callback % 1000 == 999) {
+            adapter.setBlockSize(blockSizes[(callback / 1000) % blockSizes.size()]);
+        }
+
+        const int32_t numFrames = callbackFrames(random);
+
+        CHECK(adapter.update());
+
+        // Events keep the delay of the block size in effect when they arrive
+        const int32_t latency = adapter.getActiveBlockSize();
+
+        if (hasEvent(random)) {
+            pending.push_back({ playedFrames, adapter.getArrivalOffset(), latency });
+            numEvents++;
+        }
+
+        adapter.process(dest.data(), numFrames, [&](float* block, int32_t n) {
+            CHECK(n == adapter.getActiveBlockSize());
+
+            for (int32_t i = 0; i < n; ++i) {
+                for (int ch = 0; ch < kNumChannels; ++ch) {
+                    block[i * kNumChannels + ch] = static_cast<float>(renderedFrames + i);
+                }
+            }
+
+            remaining.clear();
+
+            for (const Event& event : pending) {
+                if (event.offset < n) {
+                    onTime &= renderedFrames + event.offset == event.arrivalFrame + event.latency;
+                    numRendered++;
+                } else {
+                    remaining.push_back({ event.arrivalFrame, event.offset - n, event.latency });
+                }
+            }
+
+            pending.swap(remaining);
+            renderedFrames += n;
+        });
+
+        for (int32_t i = 0; i < numFrames; ++i) {
+            for (int ch = 0; ch < kNumChannels; ++ch) {
+                continuous &= dest[i * kNumChannels + ch] == static_cast<float>(expectedSample);
+            }
+
+            expectedSample++;
+        }
+
+        playedFrames += numFrames;
+
+        // Never more than one block rendered ahead
+        CHECK(renderedFrames - playedFrames < adapter.getActiveBlockSize());
+        CHECK(renderedFrames >= playedFrames);
+    }
+
+    CHECK(continuous);
+    CHECK(onTime);
+
+    // Only events that fall in blocks not rendered yet may be pending
+    CHECK(numRendered + static_cast<int>(pending.size()) == numEvents);
+    CHECK(pending.size() <= 1);
+}
+
+} // namespace
+
+int main()
+{
+    testRandomCallbackSizes(1, { 64 });
+    testRandomCallbackSizes(2, { 1024 });
+    testRandomCallbackSizes(3, { 1 });
+    testRandomCallbackSizes(4, { 128, 1000, 32, BlockSizeAdapter::kMaxBlockSize, 7 });
+
+    return test::finish();
+}
@@ -0,0 +1,164 @@
+//
+// Maqam - Mobile App Quick Audio & MIDI
+//
+// SPDX-FileCopyrightText: 2024 TAQS.IM <contact@taqs.im>
+// SPDX-License-Identifier: MIT
+//
+
+#include <cstdio>
+#include <deque>
+#include <vector>
+
+#include "impl/DuplexInput.h"
+
+#include "Test.h"
+
+using namespace maqam;
+
+namespace {
+
+constexpr int32_t kSampleRate = 48000;
+constexpr int32_t kChannelCount = 2;
+constexpr int32_t kBurst = 96;
+
+// Double buffered output plus one burst of input buffering
+constexpr int32_t kDeviceLatency = 3 * kBurst;
+
+constexpr int kPulseInterval = 50;  // callbacks
+constexpr int kPulseLength = 4;     // frames
+
+struct Result
+{
+    int numPulses = 0;
+    int numDetected = 0;
+    int minLatency = 0;
+    int maxLatency = 0;
+};
+
+/**
+ * Loopback through a simulated device. Every output callback the microphone captures what was
+ * played kDeviceLatency frames earlier, at the input clock rate relative to the output clock.
+ * The app side reads the input with DuplexInput, emits a short pulse now and then and looks for
+ * it in the input, the distance between both is the round trip latency.
+ */
+Result runLoopback(double inputClockRatio, int numCallbacks)
+{
+    oboe::host::SimulatedInputDevice& device = oboe::host::SimulatedInputDevice::getInstance();
+    device.reset(kChannelCount, kBurst);
+
+    DuplexInput input;
+    CHECK(input.open(kSampleRate, kChannelCount, kBurst));
+    input.start();
+
+    std::deque<float> line(static_cast<size_t>(kDeviceLatency * kChannelCount), 0.f);
+    std::vector<float> captured;
+    juce::AudioBuffer<float> buffer(kChannelCount, kBurst);
+
+    Result result;
+    double captureClock = 0;
+    int64_t lastPulse = -1;
+    float previous = 0;
+
+    for (int callback = 0; callback < numCallbacks; ++callback) {
+        // Device side, one burst of played audio captured at the input clock rate
+        captureClock += kBurst * inputClockRatio;
+        const auto numCaptured = static_cast<int32_t>(captureClock);
+        captureClock -= numCaptured;
+
+        captured.resize(static_cast<size_t>(numCaptured * kChannelCount));
+
+        for (int32_t i = 0; i < numCaptured; ++i) {
+            const size_t frame = static_cast<size_t>(i * kBurst / numCaptured);
+
+            for (int ch = 0; ch < kChannelCount; ++ch) {
+                captured[i * kChannelCount + ch] = line[frame * kChannelCount + ch];
+            }
+        }
+
+        line.erase(line.begin(), line.begin() + kBurst * kChannelCount);
+        device.capture(captured.data(), numCaptured);
+
+        // App side
+        const int64_t position = static_cast<int64_t>(callback) * kBurst;
+
+        input.read(buffer, kBurst);
+
+        for (int i = 0; i < kBurst; ++i) {
+            const float sample = buffer.getSample(0, i);
+
+            if ((sample > 0.5f) && (previous <= 0.5f) && (lastPulse >= 0)) {
+                const int latency = static_cast<int>(position + i - lastPulse);
+
+                result.minLatency = result.numDetected == 0 ? latency
+                        : std::min(result.minLatency, latency);
+                result.maxLatency = std::max(result.maxLatency, latency);
+                result.numDetected++;
+                lastPulse = -1;
+            }
+
+            previous = sample;
+        }
+
+        const bool pulse = (callback >= 2 * DuplexInput::kNumCallbacksToDrain)
+                && (callback % kPulseInterval == 0);
+
+        if (pulse) {
+            lastPulse = position;
+            result.numPulses++;
+        }
+
+        for (int i = 0; i < kBurst; ++i) {
+            const float sample = pulse && (i < kPulseLength) ? 1.f : 0.f;
+            line.insert(line.end(), kChannelCount, sample);
+        }
+    }
+
+    input.stop();
+    input.close();
+
+    return result;
+}
+
+void report(const char* name, const Result& result)
+{
+    std::printf("%-12s %4d/%-4d pulses, latency %d..%d frames (%.2f..%.2f ms)\n", name,
+                result.numDetected, result.numPulses, result.minLatency, result.maxLatency,
+                1e3 * result.minLatency / kSampleRate, 1e3 * result.maxLatency / kSampleRate);
+}
+
+} // namespace
+
+int main()
+{
+    // One minute of callbacks
+    const int numCallbacks = 60 * kSampleRate / kBurst;
+
+    // Matched clocks, the latency is the device latency and stays constant
+    const Result matched = runLoopback(1.0, numCallbacks);
+    report("matched", matched);
+    CHECK(matched.numDetected == matched.numPulses);
+    CHECK(matched.minLatency == matched.maxLatency);
+    CHECK(matched.minLatency <= kDeviceLatency + kBurst);
+
+    // Input ahead of the output, the queue may not grow past the drift window
+    const int maxLatency = kDeviceLatency + kBurst + DuplexInput::kDriftWindowBursts * kBurst;
+
+    const Result fast = runLoopback(1.005, numCallbacks);
+    report("input fast", fast);
+    CHECK(fast.numDetected >= fast.numPulses * 9 / 10);
+    CHECK(fast.maxLatency <= maxLatency);
+
+    // Input behind the output, short reads are padded and nothing accumulates
+    const Result slow = runLoopback(0.995, numCallbacks);
+    report("input slow", slow);
+    CHECK(slow.numDetected >= slow.numPulses * 9 / 10);
+    CHECK(slow.maxLatency <= maxLatency);
+
+    // Failing to open leaves the input silent
+    oboe::host::SimulatedInputDevice::getInstance().failOpen = true;
+    DuplexInput input;
+    CHECK(! input.open(kSampleRate, kChannelCount, kBurst));
+    oboe::host::SimulatedInputDevice::getInstance().failOpen = false;
+
+    return test::finish();
+}
@@ -0,0 +1,134 @@
+//
+// Maqam - Mobile App Quick Audio & MIDI
+//
+// SPDX-FileCopyrightText: 2024 TAQS.IM <contact@taqs.im>
+// SPDX-License-Identifier: MIT
+//
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "GoldenCompare.h"
+#include "Test.h"
+
+using namespace maqam::test;
+
+namespace {
+
+constexpr int kLength = 48000;
+
+std::vector<float> sine(double frequency, float gain, double phase)
+{
+    std::vector<float> samples(kLength);
+
+    for (int i = 0; i < kLength; ++i) {
+        samples[i] = gain * static_cast<float>(std::sin(2.0 * M_PI * frequency * i / 48000.0
+                + phase));
+    }
+
+    return samples;
+}
+
+void testIdentical()
+{
+    const std::vector<float> a = sine(440, 0.5f, 0);
+    const GoldenDifference difference = compareToGolden(a, a);
+
+    CHECK(difference.peak == 0);
+    CHECK(difference.spectrumDb == 0);
+    CHECK(difference.isWithin({}));
+}
+
+// Rounding noise far below the peak tolerance
+void testRounding()
+{
+    std::vector<float> a = sine(440, 0.5f, 0);
+    const std::vector<float> b = a;
+
+    for (size_t i = 0; i < a.size(); i += 7) {
+        a[i] += 1e-6f;
+    }
+
+    CHECK(compareToGolden(a, b).isWithin({}));
+}
+
+// Phase drift fails the peak comparison but keeps the spectrum
+void testPhaseDrift()
+{
+    const GoldenDifference difference = compareToGolden(sine(440, 0.5f, 0.01),
+                                                        sine(440, 0.5f, 0));
+
+    CHECK(difference.peak > 1e-3f);
+    CHECK(difference.spectrumDb < 0.1f);
+    CHECK(difference.isWithin({}));
+}
+
+// Same spectrum, but the waveform moved too far to be drift
+void testLargeDrift()
+{
+    const GoldenDifference difference = compareToGolden(sine(440, 0.5f, 0.3),
+                                                        sine(440, 0.5f, 0));
+
+    CHECK(difference.peak > 0.1f);
+    CHECK(difference.spectrumDb < 0.1f);
+    CHECK(! difference.isWithin({}));
+}
+
+// White noise from another seed has the same spectrum within a fraction of a dB
+void testOtherNoise()
+{
+    const auto noise = [](uint32_t seed) {
+        std::vector<float> samples(kLength);
+
+        for (float& sample : samples) {
+            seed = seed * 1664525u + 1013904223u;
+            sample = 0.25f * (static_cast<float>(seed >> 8) / (1 << 23) - 1.f);
+        }
+
+        return samples;
+    };
+
+    CHECK(! compareToGolden(noise(1), noise(2)).isWithin({}));
+}
+
+void testLevelChange()
+{
+    const GoldenDifference difference = compareToGolden(sine(440, 0.25f, 0),
+                                                        sine(440, 0.5f, 0));
+
+    CHECK(std::abs(difference.spectrumDb - 6.02f) < 0.1f);
+    CHECK(! difference.isWithin({}));
+}
+
+void testFrequencyChange()
+{
+    CHECK(! compareToGolden(sine(880, 0.5f, 0), sine(440, 0.5f, 0)).isWithin({}));
+}
+
+// A missing tail compares against silence
+void testLength()
+{
+    std::vector<float> a = sine(440, 0.5f, 0);
+    const std::vector<float> b = a;
+    a.resize(a.size() / 2);
+
+    CHECK(compareToGolden(a, b).peak > 0.4f);
+    CHECK(! compareToGolden(a, b).isWithin({}));
+}
+
+} // namespace
+
+int main()
+{
+    testIdentical();
+    testRounding();
+    testPhaseDrift();
+    testLargeDrift();
+    testOtherNoise();
+    testLevelChange();
+    testFrequencyChange();
+    testLength();
+
+    return finish();
+}
@@ -0,0 +1,124 @@
+//
+// Maqam - Mobile App Quick Audio & MIDI
+//
+// SPDX-FileCopyrightText: 2024 TAQS.IM <contact@taqs.im>
+// SPDX-License-Identifier: MIT
+//
+
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "impl/MidiOutput.h"
+
+#include "Test.h"
+
+using namespace maqam;
+
+namespace {
+
+constexpr double  kSampleRate = 48000;
+constexpr int64_t kBlockTimeNanos = 1000000000;
+
+// The writer thread delivers asynchronously, poll the mock device for a while
+std::vector<amidi::host::SentMessage> waitForMessages(AMidiDevice& device, size_t count)
+{
+    for (int i = 0; i < 1000; ++i) {
+        std::vector<amidi::host::SentMessage> messages = device.getSentMessages();
+
+        if (messages.size() >= count) {
+            return messages;
+        }
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    return device.getSentMessages();
+}
+
+// Every open port gets every event, stamped with the presentation time of its frame
+void testDelivery()
+{
+    AMidiDevice device(/*numPorts*/2);
+    MidiOutput output;
+
+    CHECK(! output.isActive());
+    output.openPort(/*id*/1, &device);
+    CHECK(output.isActive());
+    CHECK(device.getNumOpenInputPorts() == 2);
+
+    juce::MidiBuffer buffer;
+    buffer.addEvent(juce::MidiMessage::noteOn(1, 60, 0.5f), 0);
+    buffer.addEvent(juce::MidiMessage::noteOff(1, 60), 48);
+
+    output.queue(buffer, kBlockTimeNanos, kSampleRate);
+
+    const std::vector<amidi::host::SentMessage> messages = waitForMessages(device, 4);
+    CHECK(messages.size() == 4);
+
+    for (const amidi::host::SentMessage& message : messages) {
+        CHECK(message.bytes.size() == 3);
+
+        if (message.bytes.size() == 3) {
+            const bool noteOn = (message.bytes[0] & 0xf0) == 0x90;
+            const int64_t expected = kBlockTimeNanos + (noteOn ? 0 : 1000000);
+            CHECK(message.timestampNanos == expected);
+        }
+    }
+
+    output.closePort(1);
+    CHECK(! output.isActive());
+    CHECK(device.getNumOpenInputPorts() == 0);
+}
+
+// SysEx does not fit an event and is dropped, shorter messages around it still go out
+void testSysExDropped()
+{
+    AMidiDevice device(/*numPorts*/1);
+    MidiOutput output;
+    output.openPort(/*id*/1, &device);
+
+    const uint8_t sysEx[] = { 0xf0, 0x7e, 0x7f, 0x06, 0x01, 0xf7 };
+    juce::MidiBuffer buffer;
+    buffer.addEvent(sysEx, static_cast<int>(sizeof(sysEx)), 0);
+    buffer.addEvent(juce::MidiMessage::controllerEvent(1, 7, 100), 1);
+
+    output.queue(buffer, kBlockTimeNanos, kSampleRate);
+
+    const std::vector<amidi::host::SentMessage> messages = waitForMessages(device, 1);
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+    CHECK(device.getSentMessages().size() == 1);
+    CHECK((messages.size() == 1) && (messages[0].bytes[0] == 0xb0));
+
+    output.closePort(1);
+}
+
+// The writer sleeps on a semaphore, destruction must wake it instead of hitting the timeout
+void testStopsPromptly()
+{
+    AMidiDevice device(/*numPorts*/1);
+    const auto start = std::chrono::steady_clock::now();
+
+    {
+        MidiOutput output;
+        output.openPort(/*id*/1, &device);
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now()
+            - start).count();
+    CHECK(seconds < 0.5);
+    CHECK(device.getNumOpenInputPorts() == 0);
+}
+
+} // namespace
+
+int main()
+{
+    testDelivery();
+    testSysExDropped();
+    testStopsPromptly();
+
+    return test::finish();
+}
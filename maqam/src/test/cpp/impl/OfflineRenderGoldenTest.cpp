@@ -0,0 +1,311 @@
+//
+// Maqam - Mobile App Quick Audio & MIDI
+//
+// SPDX-FileCopyrightText: 2024 TAQS.IM <contact@taqs.im>
+// SPDX-License-Identifier: MIT
+//
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include <juce_audio_formats/juce_audio_formats.h>
+
+#include "impl/AudioGraph.h"
+#include "impl/OfflineRenderer.h"
+#include "nodes/ak_sampler/AKSamplerProcessorEx.h"
+#include "nodes/convolution_reverb/ConvolutionReverbProcessor.h"
+#include "nodes/delay/DelayProcessor.h"
+#include "nodes/filter/FilterProcessor.h"
+#include "nodes/sc_reverb/SCReverbProcessor.h"
+#include "nodes/sequencer/SequencerProcessor.h"
+#include "nodes/test_tone/SineWaveAudioProcessor.h"
+
+#include "GoldenCompare.h"
+#include "Test.h"
+
+using namespace maqam;
+
+namespace {
+
+constexpr double  kSampleRate = 48000;
+constexpr int     kBlockSize = 192;
+constexpr int64_t kNumFrames = 2 * 48000;
+constexpr int64_t kNoteInterval = 12000;
+constexpr int     kImpulseResponseLength = 48000;
+
+using Channels = std::vector<std::vector<float>>;
+
+// ~AudioNode() goes through JNI to delete the processor of its Java owner. These nodes have no
+// owner and are leaked on purpose, the graph still owns and deletes the processors.
+AudioNode* addNode(AudioGraph& graph, juce::AudioProcessor* processor)
+{
+    auto* node = new AudioNode();
+    graph.addNode(node, processor);
+    return node;
+}
+
+AudioNode* addSampler(AudioGraph& graph)
+{
+    auto* sampler = new AKSamplerProcessorEx();
+    AudioNode* node = addNode(graph, sampler);
+    sampler->load("builtin:test-waveform");
+    return node;
+}
+
+// Sampler played from the graph MIDI input through the effect
+AudioNode* addEffectChain(AudioGraph& graph, juce::AudioProcessor* effect)
+{
+    AudioNode* sampler = addSampler(graph);
+    AudioNode* node = addNode(graph, effect);
+    graph.connectNodes(nullptr, sampler, /*audio*/true, /*midi*/true);
+    graph.connectNodes(sampler, node, /*audio*/true, /*midi*/false);
+    graph.connectNodes(node, nullptr, /*audio*/true, /*midi*/false);
+    return node;
+}
+
+// Stereo noise decaying by 60 dB over one second, the same file on every run
+juce::File writeImpulseResponse()
+{
+    juce::AudioBuffer<float> impulseResponse(2, kImpulseResponseLength);
+    juce::Random random(1);
+
+    for (int ch = 0; ch < 2; ++ch) {
+        for (int i = 0; i < kImpulseResponseLength; ++i) {
+            const double decay = std::pow(1e-3, static_cast<double>(i) / kImpulseResponseLength);
+            impulseResponse.setSample(ch, i,
+                    static_cast<float>((2.0 * random.nextDouble() - 1.0) * decay));
+        }
+    }
+
+    const juce::File file = juce::File::getSpecialLocation(juce::File::tempDirectory)
+            .getChildFile("maqam_golden_impulse_response.wav");
+    file.deleteFile();
+
+    juce::WavAudioFormat wav;
+    std::unique_ptr<juce::AudioFormatWriter> writer(wav.createWriterFor(
+            file.createOutputStream().release(), kSampleRate, 2, 24, {}, 0));
+
+    CHECK((writer != nullptr)
+          && writer->writeFromAudioSampleBuffer(impulseResponse, 0, kImpulseResponseLength));
+
+    return file;
+}
+
+struct Case
+{
+    const char*                                        name;
+    std::function<void(AudioGraph&, OfflineRenderer&)> build;
+};
+
+const Case kCases[] = {
+    { "test_tone", [](AudioGraph& graph, OfflineRenderer&) {
+        graph.connectNodes(addNode(graph, new SineWaveAudioProcessor()), nullptr,
+                           /*audio*/true, /*midi*/false);
+    } },
+
+    { "ak_sampler", [](AudioGraph& graph, OfflineRenderer&) {
+        AudioNode* sampler = addSampler(graph);
+        graph.connectNodes(nullptr, sampler, /*audio*/true, /*midi*/true);
+        graph.connectNodes(sampler, nullptr, /*audio*/true, /*midi*/false);
+    } },
+
+    { "sc_reverb", [](AudioGraph& graph, OfflineRenderer&) {
+        addEffectChain(graph, new SCReverbProcessor());
+    } },
+
+    { "filter", [](AudioGraph& graph, OfflineRenderer&) {
+        addEffectChain(graph, new FilterProcessor());
+    } },
+
+    { "delay", [](AudioGraph& graph, OfflineRenderer&) {
+        addEffectChain(graph, new DelayProcessor());
+    } },
+
+    // The tail is convolved on the rendering thread offline, see OfflineRenderer::render()
+    { "convolution_reverb", [](AudioGraph& graph, OfflineRenderer&) {
+        auto* reverb = new ConvolutionReverbProcessor();
+        addEffectChain(graph, reverb);
+        reverb->load(writeImpulseResponse().getFullPathName());
+    } },
+
+    // Every changed parameter is also set at frame 0, the renderer does not reset parameters
+    // between renders
+    { "parameter_script", [](AudioGraph& graph, OfflineRenderer& renderer) {
+        AudioNode* filter = addEffectChain(graph, new FilterProcessor());
+
+        renderer.addParameterChange(0, filter, FilterProcessor::kParameterCutoff, 200);
+        renderer.addParameterChange(0, filter, FilterProcessor::kParameterResonance, 0.5f);
+        renderer.addParameterChange(0, filter, FilterProcessor::kParameterOversampling, 0);
+        renderer.addParameterChange(0, filter, FilterProcessor::kParameterBypass, 0);
+
+        // Sweeps the cutoff up within the first note, one change per block and in between
+        for (int64_t frame = 0; frame < kNoteInterval; frame += 500) {
+            renderer.addParameterChange(frame, filter, FilterProcessor::kParameterCutoff,
+                                        200.f + 0.5f * static_cast<float>(frame));
+        }
+
+        renderer.addParameterChange(kNoteInterval, filter,
+                                    FilterProcessor::kParameterResonance, 0.95f);
+        renderer.addParameterChange(2 * kNoteInterval + 77, filter,
+                                    FilterProcessor::kParameterOversampling, 1);
+        renderer.addParameterChange(3 * kNoteInterval, filter,
+                                    FilterProcessor::kParameterBypass, 1);
+        renderer.addParameterChange(3 * kNoteInterval + kNoteInterval / 2, filter,
+                                    FilterProcessor::kParameterBypass, 0);
+    } },
+
+    // Notes come from the pattern only, timing follows the renderer transport
+    { "sequencer", [](AudioGraph& graph, OfflineRenderer&) {
+        auto* sequencer = new SequencerProcessor();
+        AudioNode* node = addNode(graph, sequencer);
+        AudioNode* sampler = addSampler(graph);
+        graph.connectNodes(node, sampler, /*audio*/false, /*midi*/true);
+        graph.connectNodes(sampler, nullptr, /*audio*/true, /*midi*/false);
+
+        const int stepIndices[] = { 0, 1, 2, 3 };
+        const int notes[] = { 60, 64, 67, 72 };
+        const float velocities[] = { 1.f, 0.8f, 0.8f, 0.6f };
+        const float gates[] = { 0.5f, 0.5f, 0.5f, 0.5f };
+
+        sequencer->setPattern(/*numSteps*/4, /*stepsPerBeat*/4, /*swing*/0, /*channel*/0,
+                              /*arpeggiate*/false, stepIndices, notes, velocities, gates, 4);
+        sequencer->setFollowTransport(true);
+    } },
+};
+
+// Script shared by all cases, before the changes a case adds itself
+void build(const Case& c, AudioGraph& graph, OfflineRenderer& renderer)
+{
+    for (int64_t frame = 0; frame < kNumFrames; frame += kNoteInterval) {
+        const juce::MidiMessage on = juce::MidiMessage::noteOn(1, 60, 0.8f);
+        const juce::MidiMessage off = juce::MidiMessage::noteOff(1, 60);
+        renderer.addMidiEvent(frame, on.getRawData(), on.getRawDataSize());
+        renderer.addMidiEvent(frame + kNoteInterval / 2, off.getRawData(), off.getRawDataSize());
+    }
+
+    c.build(graph, renderer);
+}
+
+void render(AudioGraph& graph, OfflineRenderer& renderer, const juce::File& file)
+{
+    renderer.render(graph, kSampleRate, kBlockSize, /*tempo*/120, /*numerator*/4,
+                    /*denominator*/4, kNumFrames, file);
+}
+
+Channels read(const juce::File& file)
+{
+    juce::WavAudioFormat wav;
+    std::unique_ptr<juce::AudioFormatReader> reader(wav.createReaderFor(
+        file.createInputStream().release(), /*deleteStreamIfOpeningFails*/true));
+
+    if (reader == nullptr) {
+        return {};
+    }
+
+    juce::AudioBuffer<float> buffer(static_cast<int>(reader->numChannels),
+                                    static_cast<int>(reader->lengthInSamples));
+    reader->read(&buffer, 0, buffer.getNumSamples(), 0, true, true);
+
+    Channels channels;
+
+    for (int ch = 0; ch < buffer.getNumChannels(); ++ch) {
+        const float* samples = buffer.getReadPointer(ch);
+        channels.emplace_back(samples, samples + buffer.getNumSamples());
+    }
+
+    return channels;
+}
+
+bool compare(const char* name, const Channels& rendered, const Channels& golden)
+{
+    if (rendered.size() != golden.size()) {
+        std::fprintf(stderr, "%s: %zu channel(s), reference has %zu\n", name, rendered.size(),
+                     golden.size());
+        return false;
+    }
+
+    const test::GoldenTolerance tolerance;
+    bool passed = true;
+
+    for (size_t ch = 0; ch < rendered.size(); ++ch) {
+        const test::GoldenDifference difference = test::compareToGolden(rendered[ch], golden[ch],
+                                                                        tolerance);
+
+        if (! difference.isWithin(tolerance)) {
+            std::fprintf(stderr, "%s: channel %zu differs, peak %g, spectrum %.2f dB\n", name, ch,
+                         difference.peak, difference.spectrumDb);
+            passed = false;
+        }
+    }
+
+    return passed;
+}
+
+// Rendering the same graph twice gives the same file, nodes start over from a clean state
+void testRepeatable(const Case& c)
+{
+    AudioGraph graph;
+    OfflineRenderer renderer;
+    build(c, graph, renderer);
+
+    const juce::File first = juce::File::createTempFile(".wav");
+    const juce::File second = juce::File::createTempFile(".wav");
+    render(graph, renderer, first);
+    render(graph, renderer, second);
+
+    const Channels a = read(first);
+    CHECK(! a.empty());
+    CHECK(a == read(second));
+
+    first.deleteFile();
+    second.deleteFile();
+}
+
+// A missing reference fails, it has to be recorded and checked in with the case
+void testGolden(const Case& c, bool record)
+{
+    const juce::File reference = juce::File(MAQAM_GOLDEN_DIR).getChildFile(c.name)
+            .withFileExtension(".wav");
+
+    if (! (record || reference.existsAsFile())) {
+        std::fprintf(stderr, "%s: no reference %s, record it with MAQAM_RECORD_GOLDEN=1 ctest "
+                     "--test-dir build/host-tests -R offline_render_golden_test\n", c.name,
+                     reference.getFullPathName().toRawUTF8());
+        CHECK(reference.existsAsFile());
+        return;
+    }
+
+    AudioGraph graph;
+    OfflineRenderer renderer;
+    build(c, graph, renderer);
+
+    const juce::File file = juce::File::createTempFile(".wav");
+    render(graph, renderer, file);
+
+    if (record) {
+        CHECK(reference.getParentDirectory().createDirectory().wasOk());
+        CHECK(file.copyFileTo(reference));
+    } else {
+        CHECK(compare(c.name, read(file), read(reference)));
+    }
+
+    file.deleteFile();
+}
+
+} // namespace
+
+int main()
+{
+    const bool record = std::getenv("MAQAM_RECORD_GOLDEN") != nullptr;
+
+    for (const Case& c : kCases) {
+        testRepeatable(c);
+        testGolden(c, record);
+    }
+
+    return test::finish();
+}
@@ -0,0 +1,190 @@
+//
+// Maqam - Mobile App Quick Audio & MIDI
+//
+// SPDX-FileCopyrightText: 2024 TAQS.IM <contact@taqs.im>
+// SPDX-License-Identifier: MIT
+//
+
+#include <cmath>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <utility>
+
+#include <juce_audio_formats/juce_audio_formats.h>
+
+#include "impl/AudioGraph.h"
+#include "impl/AudioNode.h"
+#include "impl/OfflineRenderer.h"
+#include "impl/RealtimeSanitizer.h"
+#include "nodes/ak_sampler/AKSamplerProcessorEx.h"
+#include "nodes/convolution_reverb/ConvolutionReverbProcessor.h"
+#include "nodes/delay/DelayProcessor.h"
+#include "nodes/filter/FilterProcessor.h"
+#include "nodes/sc_reverb/SCReverbProcessor.h"
+#include "nodes/sequencer/SequencerProcessor.h"
+#include "nodes/test_tone/SineWaveAudioProcessor.h"
+
+#include "Test.h"
+
+using namespace maqam;
+
+namespace {
+
+constexpr double  kSampleRate = 48000;
+constexpr int     kBlockSize = 192;
+constexpr int64_t kNumFrames = 2 * 48000;
+constexpr int64_t kNoteInterval = 12000;
+
+// One second of decaying noise, enough to make the convolution do real work
+juce::File createImpulseResponse()
+{
+    const juce::File file = juce::File::createTempFile(".wav");
+    juce::AudioBuffer<float> buffer(2, static_cast<int>(kSampleRate));
+    juce::Random random(1);
+
+    for (int ch = 0; ch < buffer.getNumChannels(); ++ch) {
+        for (int i = 0; i < buffer.getNumSamples(); ++i) {
+            const float decay = std::exp(-6.f * static_cast<float>(i) / buffer.getNumSamples());
+            buffer.setSample(ch, i, decay * (2.f * random.nextFloat() - 1.f));
+        }
+    }
+
+    juce::WavAudioFormat wav;
+    std::unique_ptr<juce::AudioFormatWriter> writer(wav.createWriterFor(
+        file.createOutputStream().release(), kSampleRate, 2, /*bitsPerSample*/32, {}, 0));
+    writer->writeFromAudioSampleBuffer(buffer, 0, buffer.getNumSamples());
+
+    return file;
+}
+
+// Renders the graph with notes coming in through its MIDI input, and fails on any violation
+// recorded while OfflineRenderer was inside its realtime scope
+void render(AudioGraph& graph, const char* name)
+{
+    OfflineRenderer renderer;
+
+    for (int64_t frame = 0; frame < kNumFrames; frame += kNoteInterval) {
+        const juce::MidiMessage on = juce::MidiMessage::noteOn(1, 60, 0.8f);
+        const juce::MidiMessage off = juce::MidiMessage::noteOff(1, 60);
+        renderer.addMidiEvent(frame, on.getRawData(), on.getRawDataSize());
+        renderer.addMidiEvent(frame + kNoteInterval / 2, off.getRawData(), off.getRawDataSize());
+    }
+
+    const juce::File file = juce::File::createTempFile(".wav");
+    const int before = RealtimeSanitizer::dump();
+
+    renderer.render(graph, kSampleRate, kBlockSize, /*tempo*/120, /*numerator*/4,
+                    /*denominator*/4, kNumFrames, file);
+
+    const int numViolations = RealtimeSanitizer::dump() - before;
+
+    if (numViolations > 0) {
+        std::fprintf(stderr, "%s: %d realtime violation(s), see above\n", name, numViolations);
+    }
+
+    CHECK(numViolations == 0);
+    file.deleteFile();
+}
+
+// ~AudioNode() goes through JNI to delete the processor of its Java owner. These nodes have no
+// owner and are leaked on purpose, the graph still owns and deletes the processors.
+AudioNode* addNode(AudioGraph& graph, std::unique_ptr<juce::AudioProcessor> processor)
+{
+    auto* node = new AudioNode();
+    graph.addNode(node, processor.release());
+    graph.connectNodes(nullptr, node, /*audio*/true, /*midi*/true);
+    graph.connectNodes(node, nullptr, /*audio*/true, /*midi*/false);
+
+    return node;
+}
+
+// A graph holding only the node, setup runs after the node is in the graph like it would from Java
+template<class T>
+void testNode(const char* name, const std::function<void(T&)>& setup = nullptr)
+{
+    AudioGraph graph;
+    auto processor = std::make_unique<T>();
+    T& dsp = *processor;
+    addNode(graph, std::move(processor));
+
+    if (setup) {
+        setup(dsp);
+    }
+
+    render(graph, name);
+}
+
+// Morphing writes every parameter of the node from the audio thread. Listeners are only told
+// later, when NotificationHub collects the changes.
+void testMorph()
+{
+    AudioGraph graph;
+    auto processor = std::make_unique<DelayProcessor>();
+    DelayProcessor& dsp = *processor;
+    AudioNode* node = addNode(graph, std::move(processor));
+    PresetMorph& morph = node->getPresetMorph();
+
+    morph.storePreset("from");
+
+    for (juce::AudioProcessorParameter* parameter : dsp.getParameters()) {
+        if (parameter != dsp.getBypassParameter()) {
+            parameter->setValueNotifyingHost(parameter->getValue() < 0.5f ? 1.f : 0);
+        }
+    }
+
+    morph.storePreset("to");
+    CHECK(morph.recallPreset("from"));
+    CHECK(morph.setMorphPresets("from", "to"));
+    morph.setPosition(1.f);
+
+    juce::StringArray ids;
+    juce::Array<float> values;
+    node->collectNotifications(ids, values);
+
+    render(graph, "Morph");
+
+    // Every parameter but bypass reached the second preset
+    CHECK(node->collectNotifications(ids, values));
+    CHECK(ids.size() == dsp.getParameters().size() - 1);
+    CHECK(! ids.contains(DelayProcessor::kParameterBypass));
+}
+
+} // namespace
+
+int main()
+{
+    testNode<SineWaveAudioProcessor>("TestTone");
+
+    testNode<AKSamplerProcessorEx>("AKSampler", [](AKSamplerProcessorEx& sampler) {
+        sampler.load("builtin:test-waveform");
+    });
+
+    testNode<SCReverbProcessor>("SCReverb");
+    testNode<FilterProcessor>("Filter");
+    testNode<DelayProcessor>("Delay");
+
+    const juce::File impulseResponse = createImpulseResponse();
+
+    testNode<ConvolutionReverbProcessor>("ConvolutionReverb",
+        [&impulseResponse](ConvolutionReverbProcessor& reverb) {
+            reverb.load(impulseResponse.getFullPathName());
+        });
+
+    impulseResponse.deleteFile();
+
+    testNode<SequencerProcessor>("Sequencer", [](SequencerProcessor& sequencer) {
+        const int stepIndices[] = { 0, 1, 2, 3 };
+        const int notes[] = { 60, 64, 67, 72 };
+        const float velocities[] = { 1.f, 0.8f, 0.8f, 0.6f };
+        const float gates[] = { 0.5f, 0.5f, 0.5f, 0.5f };
+
+        sequencer.setPattern(/*numSteps*/4, /*stepsPerBeat*/4, /*swing*/0, /*channel*/0,
+                             /*arpeggiate*/false, stepIndices, notes, velocities, gates, 4);
+        sequencer.setFollowTransport(true);
+    });
+
+    testMorph();
+
+    return test::finish();
+}
@@ -0,0 +1,130 @@
+//
+// Maqam - Mobile App Quick Audio & MIDI
+//
+// SPDX-FileCopyrightText: 2024 TAQS.IM <contact@taqs.im>
+// SPDX-License-Identifier: MIT
+//
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "impl/ThreadPolicy.h"
+
+#include "Test.h"
+
+using namespace maqam;
+
+namespace {
+
+// Fake /sys/devices/system/cpu, 0 leaves out the cpufreq entry like for an offline core
+class CpuTree
+{
+public:
+    explicit CpuTree(const std::vector<long>& maxFreqs)
+        : mRoot(std::filesystem::temp_directory_path() / "maqam_thread_policy_test")
+    {
+        std::filesystem::remove_all(mRoot);
+
+        for (size_t cpu = 0; cpu < maxFreqs.size(); ++cpu) {
+            const std::filesystem::path dir = mRoot / ("cpu" + std::to_string(cpu)) / "cpufreq";
+            std::filesystem::create_directories(dir);
+
+            if (maxFreqs[cpu] > 0) {
+                std::ofstream(dir / "cpuinfo_max_freq") << maxFreqs[cpu] << "\n";
+            }
+        }
+    }
+
+    ~CpuTree() { std::filesystem::remove_all(mRoot); }
+
+    std::string getRoot() const { return mRoot.string(); }
+
+private:
+    std::filesystem::path mRoot;
+
+};
+
+// Indexes of the cores findFastCores() selected, empty when it returned false
+std::vector<int> findFastCores(const std::vector<long>& maxFreqs, long numCpus)
+{
+    const CpuTree tree(maxFreqs);
+    cpu_set_t cores;
+    std::vector<int> result;
+
+    if (ThreadPolicy::findFastCores(cores, tree.getRoot().c_str(), numCpus)) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+            if (CPU_ISSET(cpu, &cores)) {
+                result.push_back(cpu);
+            }
+        }
+    }
+
+    return result;
+}
+
+std::vector<int> findFastCores(const std::vector<long>& maxFreqs)
+{
+    return findFastCores(maxFreqs, static_cast<long>(maxFreqs.size()));
+}
+
+void testBigLittle()
+{
+    CHECK(findFastCores({ 1800000, 1800000, 1800000, 1800000,
+                          2400000, 2400000, 2400000, 2400000 })
+            == std::vector<int>({ 4, 5, 6, 7 }));
+}
+
+// Only the slowest cluster is left out, the mid cores stay next to the prime core
+void testThreeClusters()
+{
+    CHECK(findFastCores({ 1800000, 1800000, 1800000, 1800000,
+                          2500000, 2500000, 2500000, 3200000 })
+            == std::vector<int>({ 4, 5, 6, 7 }));
+}
+
+// Clusters are found by frequency, not by position
+void testUnorderedCores()
+{
+    CHECK(findFastCores({ 2400000, 2400000, 1800000, 1800000 }) == std::vector<int>({ 0, 1 }));
+}
+
+void testSymmetric()
+{
+    CHECK(findFastCores({ 2000000, 2000000, 2000000, 2000000 }).empty());
+}
+
+void testUnknownTopology()
+{
+    CHECK(findFastCores({ 0, 0, 0, 0 }).empty());
+    CHECK(findFastCores({}, 8).empty());
+}
+
+// Cores without a readable frequency are never selected
+void testOfflineCore()
+{
+    CHECK(findFastCores({ 1800000, 1800000, 2400000, 0, 2400000 }) == std::vector<int>({ 2, 4 }));
+}
+
+// Cores past the configured count are not read
+void testNumCpus()
+{
+    CHECK(findFastCores({ 1800000, 1800000, 2400000, 2400000 }, 2).empty());
+    CHECK(findFastCores({ 1800000, 2400000, 2400000, 3000000 }, 3) == std::vector<int>({ 1, 2 }));
+}
+
+} // namespace
+
+int main()
+{
+    testBigLittle();
+    testThreeClusters();
+    testUnorderedCores();
+    testSymmetric();
+    testUnknownTopology();
+    testOfflineCore();
+    testNumCpus();
+
+    return test::finish();
+}
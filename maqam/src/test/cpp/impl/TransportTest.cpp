@@ -0,0 +1,315 @@
+//
+// Maqam - Mobile App Quick Audio & MIDI
+//
+// SPDX-FileCopyrightText: 2024 TAQS.IM <contact@taqs.im>
+// SPDX-License-Identifier: MIT
+//
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+#include "impl/Transport.h"
+#include "nodes/sequencer/SequencerProcessor.h"
+
+#include "Test.h"
+
+using namespace maqam;
+
+namespace {
+
+constexpr double kSampleRate = 48000;
+constexpr int    kBlockSize = 512;
+constexpr int    kSamplesPerStep = 6000; // 16th notes at the default 120 BPM
+
+struct Event
+{
+    int64_t time; // samples since the start of the render
+    bool    isNoteOn;
+    int     note;
+};
+
+bool throws(const std::function<void()>& function, bool invalidArgument)
+{
+    try {
+        function();
+    } catch (const std::invalid_argument&) {
+        return invalidArgument;
+    } catch (const std::runtime_error&) {
+        return ! invalidArgument;
+    }
+
+    return false;
+}
+
+bool isNear(double value, double expected)
+{
+    return std::abs(value - expected) < 1e-9;
+}
+
+// Applies the commands queued so far, like AudioRoot at the start of a block
+juce::AudioPlayHead::PositionInfo beginBlock(Transport& transport)
+{
+    transport.beginBlock(kSampleRate);
+    return *transport.getPosition();
+}
+
+// The sequencer as a node of the graph, between beginBlock() and endBlock()
+std::vector<Event> render(Transport& transport, SequencerProcessor& sequencer, int numSamples)
+{
+    juce::AudioBuffer<float> buffer(1, kBlockSize);
+    juce::MidiBuffer midi;
+    std::vector<Event> events;
+
+    for (int start = 0; start < numSamples; start += kBlockSize) {
+        const int numFrames = std::min(kBlockSize, numSamples - start);
+        buffer.setSize(1, numFrames);
+
+        transport.beginBlock(kSampleRate);
+        sequencer.processBlock(buffer, midi);
+        transport.endBlock(numFrames);
+
+        for (const juce::MidiMessageMetadata metadata : midi) {
+            const juce::MidiMessage message = metadata.getMessage();
+
+            if (message.isNoteOnOrOff()) {
+                events.push_back({ start + metadata.samplePosition, message.isNoteOn(),
+                                   message.getNoteNumber() });
+            }
+        }
+
+        midi.clear();
+    }
+
+    return events;
+}
+
+// One sample apart is in time, offsets come from positions in floating point
+bool matches(const std::vector<Event>& actual, const std::vector<Event>& expected)
+{
+    bool same = actual.size() == expected.size();
+
+    for (size_t i = 0; same && (i < actual.size()); ++i) {
+        same = (std::abs(actual[i].time - expected[i].time) <= 1)
+            && (actual[i].isNoteOn == expected[i].isNoteOn)
+            && (actual[i].note == expected[i].note);
+    }
+
+    if (! same) {
+        for (const Event& event : actual) {
+            std::fprintf(stderr, "  %lld %s %d\n", static_cast<long long>(event.time),
+                         event.isNoteOn ? "on" : "off", event.note);
+        }
+    }
+
+    return same;
+}
+
+// One note a step with half a step gate, 60 to 63
+void prepareFollowing(SequencerProcessor& sequencer, Transport& transport)
+{
+    const int steps[] = { 0, 1, 2, 3 };
+    const int notes[] = { 60, 61, 62, 63 };
+    const float velocities[] = { 0.8f, 0.8f, 0.8f, 0.8f };
+    const float gates[] = { 0.5f, 0.5f, 0.5f, 0.5f };
+
+    sequencer.setRateAndBufferSizeDetails(kSampleRate, kBlockSize);
+    sequencer.prepareToPlay(kSampleRate, kBlockSize);
+    sequencer.setPattern(4, 4, 0, 0, false, steps, notes, velocities, gates, 4);
+    sequencer.setPlayHead(&transport);
+    sequencer.setFollowTransport(true);
+}
+
+// Position commands move the musical and sample time together, bars follow the time signature
+void testPositionCommands()
+{
+    Transport transport;
+
+    juce::AudioPlayHead::PositionInfo info = beginBlock(transport);
+    CHECK(! info.getIsPlaying());
+    CHECK(*info.getPpqPosition() == 0);
+    CHECK(*info.getBarCount() == 0);
+
+    // Stopped, time does not move
+    transport.endBlock(kBlockSize);
+    CHECK(transport.getPpqPosition() == 0);
+
+    transport.play();
+    CHECK(! transport.isPlaying()); // until the next block
+    info = beginBlock(transport);
+    CHECK(info.getIsPlaying());
+    transport.endBlock(24000);
+    CHECK(transport.isPlaying());
+    CHECK(isNear(transport.getPpqPosition(), 1));
+
+    info = beginBlock(transport);
+    CHECK(*info.getTimeInSamples() == 24000);
+    CHECK(isNear(*info.getTimeInSeconds(), 0.5));
+
+    // Bars counted from 0, bar 2 starts at quarter 8
+    transport.setPpqPosition(10);
+    info = beginBlock(transport);
+    CHECK(isNear(*info.getPpqPosition(), 10));
+    CHECK(*info.getTimeInSamples() == 240000);
+    CHECK(isNear(*info.getTimeInSeconds(), 5));
+    CHECK(isNear(*info.getPpqPositionOfLastBarStart(), 8));
+    CHECK(*info.getBarCount() == 2);
+    transport.endBlock(kBlockSize);
+
+    // Queued commands apply in order, the last one wins
+    transport.setPpqPosition(2);
+    transport.setPpqPosition(6);
+    transport.stop();
+    transport.play();
+    transport.stop();
+    info = beginBlock(transport);
+    CHECK(isNear(*info.getPpqPosition(), 6));
+    CHECK(! info.getIsPlaying());
+    transport.endBlock(kBlockSize);
+    CHECK(isNear(transport.getPpqPosition(), 6));
+
+    // 3/4 from the start of bar 1 at quarter 4, quarter 10 starts bar 3
+    transport.setTimeSignature(3, 4);
+    transport.setPpqPosition(10);
+    info = beginBlock(transport);
+    CHECK(isNear(*info.getPpqPositionOfLastBarStart(), 10));
+    CHECK(*info.getBarCount() == 3);
+    CHECK(info.getTimeSignature()->numerator == 3);
+
+    // Sample time at the current tempo
+    transport.setTempo(90);
+    transport.setPpqPosition(12);
+    info = beginBlock(transport);
+    CHECK(*info.getTimeInSamples() == 384000);
+    CHECK(*info.getBarCount() == 3);
+
+    // Before the last time signature change, bars count from the start in the new signature
+    transport.setPpqPosition(2);
+    info = beginBlock(transport);
+    CHECK(isNear(*info.getPpqPositionOfLastBarStart(), 0));
+    CHECK(*info.getBarCount() == 0);
+    transport.setPpqPosition(7);
+    info = beginBlock(transport);
+    CHECK(isNear(*info.getPpqPositionOfLastBarStart(), 6));
+    CHECK(*info.getBarCount() == 2);
+
+    CHECK(throws([&]() { transport.setPpqPosition(-1); }, true));
+    CHECK(throws([&]() {
+        transport.setPpqPosition(std::numeric_limits<double>::quiet_NaN());
+    }, true));
+    CHECK(throws([&]() { transport.setTempo(Transport::kMaxTempo + 1); }, true));
+    CHECK(throws([&]() { transport.setTimeSignature(4, 3); }, true));
+}
+
+// A full queue refuses commands until the audio thread takes them
+void testCommandQueue()
+{
+    Transport transport;
+
+    for (int i = 0; i < Transport::kMaxQueuedCommands; ++i) {
+        transport.setPpqPosition(i);
+    }
+
+    CHECK(throws([&]() { transport.setPpqPosition(1000); }, false));
+
+    const juce::AudioPlayHead::PositionInfo info = beginBlock(transport);
+    CHECK(isNear(*info.getPpqPosition(), Transport::kMaxQueuedCommands - 1));
+
+    transport.setPpqPosition(1000);
+    CHECK(isNear(*beginBlock(transport).getPpqPosition(), 1000));
+}
+
+// A following sequencer plays from the transport position, tracks it without resyncing and
+// ends its notes when the transport relocates or stops
+void testFollowTransport()
+{
+    Transport transport;
+    SequencerProcessor sequencer;
+    prepareFollowing(sequencer, transport);
+
+    // Its own play state is ignored
+    sequencer.start();
+    CHECK(render(transport, sequencer, kSamplesPerStep).empty());
+
+    // Quarter 1 is step 4, the start of the pattern
+    transport.setPpqPosition(1);
+    transport.play();
+    CHECK(matches(render(transport, sequencer, 4 * kSamplesPerStep + kSamplesPerStep / 4), {
+        { 0, true, 60 },
+        { 3000, false, 60 },
+        { 6000, true, 61 },
+        { 9000, false, 61 },
+        { 12000, true, 62 },
+        { 15000, false, 62 },
+        { 18000, true, 63 },
+        { 21000, false, 63 },
+        { 24000, true, 60 }
+    }));
+    CHECK(isNear(sequencer.getPosition(), 8.25));
+
+    // Relocated while note 60 sounds, to step 3
+    transport.setPpqPosition(0.75);
+    CHECK(matches(render(transport, sequencer, kSamplesPerStep / 4), {
+        { 0, false, 60 },
+        { 0, true, 63 }
+    }));
+
+    // Tempo changes are followed without a resync, 8000 samples a step at 90 BPM. Over a
+    // thousand blocks the positions do not drift apart.
+    transport.setTempo(90);
+    std::vector<Event> events = render(transport, sequencer, 64 * 8000);
+    CHECK(events.size() == 2 * 64);
+    CHECK((events.size() >= 5) && matches({ events.begin(), events.begin() + 5 }, {
+        { 2000, false, 63 },
+        { 6000, true, 60 },
+        { 10000, false, 60 },
+        { 14000, true, 61 },
+        { 18000, false, 61 }
+    }));
+
+    for (size_t i = 1; i < events.size(); i += 2) {
+        CHECK(events[i].isNoteOn && (events[i].note == 60 + static_cast<int>(i / 2) % 4));
+    }
+
+    CHECK(isNear(sequencer.getPosition(), 4 * transport.getPpqPosition()));
+
+    // Stopping ends the sounding note, the position stays
+    transport.stop();
+    CHECK(matches(render(transport, sequencer, kSamplesPerStep), { { 0, false, 63 } }));
+    CHECK(isNear(sequencer.getPosition(), 4 * transport.getPpqPosition()));
+
+    // Relocated while stopped, it starts from there
+    transport.setTempo(120);
+    transport.setPpqPosition(0.5);
+    CHECK(render(transport, sequencer, kBlockSize).empty());
+    CHECK(isNear(sequencer.getPosition(), 2));
+
+    transport.play();
+    CHECK(matches(render(transport, sequencer, kSamplesPerStep / 2 + kSamplesPerStep / 4), {
+        { 0, true, 62 },
+        { 3000, false, 62 }
+    }));
+
+    // Not following, it keeps its own position
+    sequencer.setFollowTransport(false);
+    sequencer.setPosition(1);
+    render(transport, sequencer, kBlockSize);
+    CHECK(isNear(sequencer.getPosition(), 1 + static_cast<double>(kBlockSize) / kSamplesPerStep));
+}
+
+} // namespace
+
+int main()
+{
+    testPositionCommands();
+    testCommandQueue();
+    testFollowTransport();
+
+    return test::finish();
+}
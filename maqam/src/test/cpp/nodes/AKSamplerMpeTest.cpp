@@ -0,0 +1,183 @@
+//
+// Maqam - Mobile App Quick Audio & MIDI
+//
+// SPDX-FileCopyrightText: 2024 TAQS.IM <contact@taqs.im>
+// SPDX-License-Identifier: MIT
+//
+
+#include <cmath>
+#include <initializer_list>
+#include <memory>
+
+#include "nodes/ak_sampler/AKSamplerProcessorEx.h"
+
+#include "Test.h"
+
+using namespace maqam;
+
+namespace {
+
+constexpr double kSampleRate = 48000;
+constexpr int    kBlockSize = 256;
+constexpr int    kMemberChannels = 3; // MIDI channel 1 is the master, 2 to 4 are members
+
+constexpr float  kBendRange = AKSamplerProcessorEx::kMpePitchBendRangeSemitones;
+
+const AudioKitCore::NoteExpression kNeutral = { 0, 0, 0.5f };
+
+class TestSampler : public AKSamplerProcessorEx
+{
+public:
+    // Targets the voices of the note follow
+    const AudioKitCore::NoteExpression& getNoteExpression(int note) const
+    {
+        return samplerPtr->getNoteExpression(static_cast<unsigned>(note));
+    }
+};
+
+// Messages all at the start of the block, returns the output peak
+float render(TestSampler& sampler, std::initializer_list<juce::MidiMessage> messages)
+{
+    juce::AudioBuffer<float> buffer(2, kBlockSize);
+    juce::MidiBuffer midi;
+
+    for (const juce::MidiMessage& message : messages) {
+        midi.addEvent(message, 0);
+    }
+
+    buffer.clear();
+    sampler.processBlock(buffer, midi);
+
+    return buffer.getMagnitude(0, kBlockSize);
+}
+
+// The member count is taken on the audio thread, at the start of the next block
+std::unique_ptr<TestSampler> createSampler(int memberChannels)
+{
+    auto sampler = std::make_unique<TestSampler>();
+    sampler->setRateAndBufferSizeDetails(kSampleRate, kBlockSize);
+    sampler->prepareToPlay(kSampleRate, kBlockSize);
+    sampler->load("builtin:test-waveform");
+    sampler->setMpeMemberChannels(memberChannels);
+    render(*sampler, {});
+    return sampler;
+}
+
+bool isSounding(TestSampler& sampler, int channel)
+{
+    render(sampler, { juce::MidiMessage::noteOn(channel, 60, 0.8f) });
+    return render(sampler, {}) > 0.01f;
+}
+
+bool isNear(const AudioKitCore::NoteExpression& a, const AudioKitCore::NoteExpression& b)
+{
+    return (std::abs(a.pitchBend - b.pitchBend) < 0.01f)
+        && (std::abs(a.pressure - b.pressure) < 0.01f)
+        && (std::abs(a.timbre - b.timbre) < 0.01f);
+}
+
+// Notes from the master and member channels play, the zone ignores the channels above it
+void testMemberChannelRouting()
+{
+    for (int channel = 1; channel <= 16; ++channel) {
+        CHECK(isSounding(*createSampler(kMemberChannels), channel) == (channel <= 4));
+    }
+
+    // Without MPE the single channel setting applies again, 0-based
+    for (int channel = 1; channel <= 16; ++channel) {
+        const std::unique_ptr<TestSampler> sampler = createSampler(0);
+        sampler->setMidiChannel(4);
+        CHECK(isSounding(*sampler, channel) == (channel == 5));
+    }
+}
+
+// Member channel messages change the expression of the note on that channel only
+void testMemberChannelExpression()
+{
+    const std::unique_ptr<TestSampler> sampler = createSampler(kMemberChannels);
+
+    render(*sampler, {
+        juce::MidiMessage::noteOn(2, 60, 0.8f),
+        juce::MidiMessage::noteOn(3, 64, 0.8f),
+        juce::MidiMessage::pitchWheel(2, 12288),
+        juce::MidiMessage::channelPressureChange(3, 127),
+        juce::MidiMessage::controllerEvent(2, AKSamplerProcessorEx::kMpeTimbreController, 0)
+    });
+
+    CHECK(isNear(sampler->getNoteExpression(60), { 0.5f * kBendRange, 0, 0 }));
+    CHECK(isNear(sampler->getNoteExpression(64), { 0, 1, 0.5f }));
+
+    // Master channel messages apply to the whole zone, not per note
+    render(*sampler, {
+        juce::MidiMessage::pitchWheel(1, 0),
+        juce::MidiMessage::channelPressureChange(1, 127)
+    });
+
+    CHECK(isNear(sampler->getNoteExpression(60), { 0.5f * kBendRange, 0, 0 }));
+    CHECK(isNear(sampler->getNoteExpression(64), { 0, 1, 0.5f }));
+
+    // Expression sent before the note-on applies from the start of the note
+    render(*sampler, {
+        juce::MidiMessage::pitchWheel(4, 0),
+        juce::MidiMessage::noteOn(4, 67, 0.8f)
+    });
+
+    CHECK(isNear(sampler->getNoteExpression(67), { -kBendRange, 0, 0.5f }));
+
+    // Other controllers on a member channel are not timbre
+    render(*sampler, { juce::MidiMessage::controllerEvent(3, 1, 0) });
+    CHECK(isNear(sampler->getNoteExpression(64), { 0, 1, 0.5f }));
+}
+
+// A released note leaves neutral expression behind for the next note on the same key
+void testExpressionResetOnNoteOff()
+{
+    const std::unique_ptr<TestSampler> sampler = createSampler(kMemberChannels);
+
+    render(*sampler, {
+        juce::MidiMessage::noteOn(2, 60, 0.8f),
+        juce::MidiMessage::pitchWheel(2, 12288),
+        juce::MidiMessage::channelPressureChange(2, 64),
+        juce::MidiMessage::noteOn(3, 62, 0.8f),
+        juce::MidiMessage::controllerEvent(3, AKSamplerProcessorEx::kMpeTimbreController, 127),
+        juce::MidiMessage::noteOn(4, 65, 0.8f),
+        juce::MidiMessage::pitchWheel(4, 12288)
+    });
+
+    CHECK(! isNear(sampler->getNoteExpression(60), kNeutral));
+    CHECK(! isNear(sampler->getNoteExpression(62), kNeutral));
+
+    render(*sampler, {
+        juce::MidiMessage::noteOff(2, 60),
+        juce::MidiMessage::noteOn(3, 62, static_cast<juce::uint8>(0)),
+        juce::MidiMessage::noteOff(4, 66)
+    });
+
+    CHECK(isNear(sampler->getNoteExpression(60), kNeutral));
+    CHECK(isNear(sampler->getNoteExpression(62), kNeutral));
+
+    // Not the note of that channel, its expression stays
+    CHECK(isNear(sampler->getNoteExpression(65), { 0.5f * kBendRange, 0, 0.5f }));
+
+    // The channel keeps its controller values for its next note, the old key does not
+    render(*sampler, { juce::MidiMessage::noteOn(2, 72, 0.8f) });
+    CHECK(isNear(sampler->getNoteExpression(72), { 0.5f * kBendRange, 64.f / 127.f, 0.5f }));
+    CHECK(isNear(sampler->getNoteExpression(60), kNeutral));
+
+    // Turning MPE off resets every note
+    sampler->setMpeMemberChannels(0);
+    render(*sampler, {});
+    CHECK(isNear(sampler->getNoteExpression(65), kNeutral));
+    CHECK(isNear(sampler->getNoteExpression(72), kNeutral));
+}
+
+} // namespace
+
+int main()
+{
+    testMemberChannelRouting();
+    testMemberChannelExpression();
+    testExpressionResetOnNoteOff();
+
+    return test::finish();
+}
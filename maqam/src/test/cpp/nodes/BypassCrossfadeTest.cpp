@@ -0,0 +1,227 @@
+//
+// Maqam - Mobile App Quick Audio & MIDI
+//
+// SPDX-FileCopyrightText: 2024 TAQS.IM <contact@taqs.im>
+// SPDX-License-Identifier: MIT
+//
+
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#include "nodes/AudioProcessorHelpers.h"
+
+#include "Test.h"
+
+using namespace maqam;
+
+namespace {
+
+constexpr double kSampleRate = 48000;
+constexpr int    kBlockSize = 64;
+constexpr int    kNumChannels = 2;
+constexpr int    kNumBlocks = 64;
+
+float input(int index)
+{
+    return static_cast<float>(std::sin(0.01 * index));
+}
+
+void fillInput(juce::AudioBuffer<float>& buffer, int offset)
+{
+    for (int ch = 0; ch < buffer.getNumChannels(); ++ch) {
+        for (int i = 0; i < buffer.getNumSamples(); ++i) {
+            buffer.setSample(ch, i, input(offset + i));
+        }
+    }
+}
+
+// Stands in for a node with latency, output is the input delayed by latency samples
+class DelayLine
+{
+public:
+    explicit DelayLine(int latency)
+        : mLine(kNumChannels, std::vector<float>(static_cast<size_t>(latency), 0))
+    {}
+
+    void operator()(juce::AudioBuffer<float>& buffer)
+    {
+        for (int ch = 0; ch < buffer.getNumChannels(); ++ch) {
+            std::vector<float>& line = mLine[static_cast<size_t>(ch)];
+            float* samples = buffer.getWritePointer(ch);
+
+            for (int i = 0; i < buffer.getNumSamples(); ++i) {
+                line.push_back(samples[i]);
+                samples[i] = line.front();
+                line.erase(line.begin());
+            }
+        }
+    }
+
+private:
+    std::vector<std::vector<float>> mLine;
+
+};
+
+// With a process function that only delays, the output must equal the delayed input whatever
+// the bypass state, crossfades included. The delay line is not run while bypassed, like a real
+// node, so its first latency samples after resuming are stale and not compared.
+void testContinuity(int latency)
+{
+    BypassCrossfade bypass;
+    DelayLine delay(latency);
+    juce::AudioBuffer<float> buffer(kNumChannels, kBlockSize);
+    float maxError = 0;
+    int resumed = 0;
+
+    bypass.prepare(kSampleRate, kBlockSize, kNumChannels, /*bypassed*/false);
+    bypass.setLatencySamples(latency);
+
+    for (int block = 0; block < kNumBlocks; ++block) {
+        const int offset = block * kBlockSize;
+        const bool bypassed = (block / 8) % 2 == 1;
+
+        if ((block > 0) && (block % 16 == 0)) {
+            resumed = offset;
+        }
+
+        fillInput(buffer, offset);
+        bypass.process(buffer, bypassed, [&delay](juce::AudioBuffer<float>& b) { delay(b); });
+
+        for (int ch = 0; ch < kNumChannels; ++ch) {
+            for (int i = 0; i < kBlockSize; ++i) {
+                const int index = offset + i - latency;
+
+                if ((resumed > 0) && (index >= resumed - latency) && (index < resumed)) {
+                    continue;
+                }
+
+                const float expected = index >= 0 ? input(index) : 0;
+                maxError = std::max(maxError, std::abs(buffer.getSample(ch, i) - expected));
+            }
+        }
+    }
+
+    CHECK(maxError < 1e-6f);
+}
+
+// The output of a gain stage may not jump when the bypass toggles, only glide
+void testNoClick()
+{
+    BypassCrossfade bypass;
+    juce::AudioBuffer<float> buffer(kNumChannels, kBlockSize);
+    float previous = 1.f;
+    float maxJump = 0;
+
+    bypass.prepare(kSampleRate, kBlockSize, kNumChannels, /*bypassed*/true);
+
+    for (int block = 0; block < kNumBlocks; ++block) {
+        const bool bypassed = (block / 4) % 2 == 0;
+
+        for (int i = 0; i < kBlockSize; ++i) {
+            buffer.setSample(0, i, 1.f);
+            buffer.setSample(1, i, 1.f);
+        }
+
+        bypass.process(buffer, bypassed, [](juce::AudioBuffer<float>& b) { b.applyGain(-1.f); });
+
+        for (int i = 0; i < kBlockSize; ++i) {
+            maxJump = std::max(maxJump, std::abs(buffer.getSample(0, i) - previous));
+            previous = buffer.getSample(0, i);
+        }
+    }
+
+    // A full -1 to 1 swing spread over the fade length
+    const float fadeSamples = static_cast<float>(BypassCrossfade::kFadeSeconds * kSampleRate);
+    CHECK(maxJump <= 2.f / fadeSamples + 1e-5f);
+    CHECK(maxJump > 0);
+}
+
+// Fully bypassed without latency the buffer stays bitwise unchanged and nothing is processed
+void testNoWorkWhenBypassed()
+{
+    BypassCrossfade bypass;
+    juce::AudioBuffer<float> buffer(kNumChannels, kBlockSize);
+    juce::AudioBuffer<float> reference(kNumChannels, kBlockSize);
+    int numCalls = 0;
+
+    bypass.prepare(kSampleRate, kBlockSize, kNumChannels, /*bypassed*/true);
+    CHECK(bypass.isBypassed());
+
+    for (int block = 0; block < kNumBlocks; ++block) {
+        fillInput(buffer, block * kBlockSize);
+        reference.makeCopyOf(buffer);
+
+        bypass.process(buffer, /*bypassed*/true, [&numCalls](juce::AudioBuffer<float>&) {
+            numCalls++;
+        });
+
+        for (int ch = 0; ch < kNumChannels; ++ch) {
+            CHECK(std::memcmp(buffer.getReadPointer(ch), reference.getReadPointer(ch),
+                              kBlockSize * sizeof(float)) == 0);
+        }
+    }
+
+    CHECK(numCalls == 0);
+
+    // With latency the input is only delayed, still without processing
+    bypass.setLatencySamples(16);
+    bypass.process(buffer, /*bypassed*/true, [&numCalls](juce::AudioBuffer<float>&) {
+        numCalls++;
+    });
+
+    CHECK(numCalls == 0);
+}
+
+// Blocks longer than prepared for are split, they still fade instead of switching at once and
+// the processing function never sees more samples than prepared for
+void testLongBlocks()
+{
+    constexpr int kLongBlockSize = 3 * kBlockSize + 17;
+
+    BypassCrossfade bypass;
+    juce::AudioBuffer<float> buffer(kNumChannels, kLongBlockSize);
+    float previous = 1.f;
+    float maxJump = 0;
+    int maxCallSize = 0;
+
+    bypass.prepare(kSampleRate, kBlockSize, kNumChannels, /*bypassed*/true);
+
+    for (int block = 0; block < kNumBlocks; ++block) {
+        const bool bypassed = (block / 2) % 2 == 0;
+
+        for (int i = 0; i < kLongBlockSize; ++i) {
+            buffer.setSample(0, i, 1.f);
+            buffer.setSample(1, i, 1.f);
+        }
+
+        bypass.process(buffer, bypassed, [&maxCallSize](juce::AudioBuffer<float>& b) {
+            maxCallSize = std::max(maxCallSize, b.getNumSamples());
+            b.applyGain(-1.f);
+        });
+
+        for (int i = 0; i < kLongBlockSize; ++i) {
+            maxJump = std::max(maxJump, std::abs(buffer.getSample(0, i) - previous));
+            previous = buffer.getSample(0, i);
+        }
+    }
+
+    const float fadeSamples = static_cast<float>(BypassCrossfade::kFadeSeconds * kSampleRate);
+    CHECK(maxJump <= 2.f / fadeSamples + 1e-5f);
+    CHECK(maxCallSize == kBlockSize);
+}
+
+} // namespace
+
+int main()
+{
+    testContinuity(0);
+    testContinuity(1);
+    testContinuity(37);
+    testContinuity(BypassCrossfade::kMaxLatencySamples);
+    testNoClick();
+    testNoWorkWhenBypassed();
+    testLongBlocks();
+
+    return test::finish();
+}
@@ -0,0 +1,201 @@
+//
+// Maqam - Mobile App Quick Audio & MIDI
+//
+// SPDX-FileCopyrightText: 2024 TAQS.IM <contact@taqs.im>
+// SPDX-License-Identifier: MIT
+//
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+#include "EnvelopeGeneratorBase.hpp"
+
+#include "Test.h"
+
+using namespace AudioKitCore;
+using namespace maqam;
+
+namespace {
+
+// Closed form against iterated recurrence, both in double and rounded to float
+constexpr float kTolerance = 1e-5f;
+
+// Longer than every timed segment, where rendering of a segment that never ends stops
+constexpr int kSustainLength = 1000;
+
+// Around and across kBlockLanes
+constexpr int kBlockLengths[] = { 1, 2, 3, 7, 8, 9, 31, 64, 256, 1000 };
+
+struct Segment
+{
+    const char* name;
+    double      initialValue;
+    double      targetValue;
+    double      tco;
+    int         lengthSamples;
+};
+
+const Segment kSegments[] = {
+    { "hold", 0.7, 0.7, 0.0, 100 },
+    { "sustain", 0.7, 0.7, 0.0, -1 },
+    { "linear rise", 0.0, 1.0, 0.0, 250 },
+    { "linear fall", 1.0, 0.2, 0.0, 97 },
+    { "linear jump", 0.3, 0.0, 0.0, 0 },
+    { "exponential rise", 0.0, 1.0, 0.3, 480 },
+    { "exponential fall", 1.0, 0.0, 0.01, 333 },
+    { "exponential short", 0.5, 0.6, 0.01, 5 },
+    { "exponential jump", 1.0, 0.0, 0.01, 0 },
+};
+
+struct Render
+{
+    std::vector<float> samples;
+    bool               ended = false;
+};
+
+Render renderSamples(const Segment& segment)
+{
+    ExponentialSegmentGenerator generator;
+    generator.reset(segment.initialValue, segment.targetValue, segment.tco,
+                    segment.lengthSamples);
+    Render render;
+
+    while (! render.ended && (render.samples.size() < kSustainLength)) {
+        float sample;
+        render.ended = generator.getSample(sample);
+        render.samples.push_back(sample);
+    }
+
+    return render;
+}
+
+Render renderBlocks(const Segment& segment, int blockLength)
+{
+    ExponentialSegmentGenerator generator;
+    generator.reset(segment.initialValue, segment.targetValue, segment.tco,
+                    segment.lengthSamples);
+    Render render;
+    std::vector<float> block(blockLength);
+
+    while (! render.ended && (render.samples.size() < kSustainLength)) {
+        int count;
+        render.ended = generator.getSamples(block.data(), blockLength, count);
+        CHECK((count > 0) && (count <= blockLength));
+        render.samples.insert(render.samples.end(), block.begin(), block.begin() + count);
+    }
+
+    render.samples.resize(std::min(render.samples.size(), size_t(kSustainLength)));
+    return render;
+}
+
+bool isClose(const std::vector<float>& a, const std::vector<float>& b)
+{
+    if (a.size() != b.size()) {
+        return false;
+    }
+
+    for (size_t i = 0; i < a.size(); ++i) {
+        if (std::abs(a[i] - b[i]) > kTolerance) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Same samples and same end, whatever the block length
+void testSegments()
+{
+    for (const Segment& segment : kSegments) {
+        const Render expected = renderSamples(segment);
+
+        for (const int blockLength : kBlockLengths) {
+            const Render actual = renderBlocks(segment, blockLength);
+
+            if (! isClose(actual.samples, expected.samples) || (actual.ended != expected.ended)) {
+                std::fprintf(stderr, "%s, blocks of %d: %zu samples%s, expected %zu%s\n",
+                             segment.name, blockLength, actual.samples.size(),
+                             actual.ended ? " ended" : "", expected.samples.size(),
+                             expected.ended ? " ended" : "");
+                CHECK(false);
+            }
+        }
+    }
+}
+
+// Attack, hold, decay, sustain, then release from where it was, like ADSREnvelope
+void testMultiSegment()
+{
+    MultiSegmentEnvelopeGenerator::Descriptor segments;
+    segments.push_back({ 0.0, 1.0, 0.3, 200 });
+    segments.push_back({ 1.0, 1.0, 0.0, 50 });
+    segments.push_back({ 1.0, 0.6, 0.01, 150 });
+    segments.push_back({ 0.6, 0.6, 0.0, -1 });
+    segments.push_back({ 0.6, 0.0, 0.01, 300 });
+
+    constexpr int kReleaseAt = 700;
+    constexpr int kLength = 1200;
+
+    MultiSegmentEnvelopeGenerator generator;
+    generator.reset(&segments);
+    std::vector<float> expected;
+    int expectedEnd = -1;
+
+    for (int i = 0; i < kLength; ++i) {
+        if (i == kReleaseAt) {
+            generator.advanceToSegment(4);
+        }
+
+        float sample;
+
+        if (generator.getSample(sample) && (expectedEnd < 0)) {
+            expectedEnd = i;
+        }
+
+        expected.push_back(sample);
+    }
+
+    CHECK((expectedEnd > kReleaseAt) && (expectedEnd < kLength));
+
+    for (const int blockLength : kBlockLengths) {
+        generator.reset(&segments);
+        std::vector<float> actual(kLength);
+        int actualEnd = -1;
+
+        for (int start = 0; start < kLength; ) {
+            if (start == kReleaseAt) {
+                generator.advanceToSegment(4);
+            }
+
+            // Release lands inside a block for most lengths, split there like a note-off does
+            int end = std::min(start + blockLength, kLength);
+
+            if ((start < kReleaseAt) && (end > kReleaseAt)) {
+                end = kReleaseAt;
+            }
+
+            if (generator.getSamples(actual.data() + start, end - start) && (actualEnd < 0)) {
+                actualEnd = end - 1;
+            }
+
+            start = end;
+        }
+
+        CHECK(isClose(actual, expected));
+
+        // Reported with the block the envelope ended in
+        CHECK((actualEnd >= expectedEnd) && (actualEnd < expectedEnd + blockLength));
+    }
+}
+
+} // namespace
+
+int main()
+{
+    testSegments();
+    testMultiSegment();
+
+    return test::finish();
+}
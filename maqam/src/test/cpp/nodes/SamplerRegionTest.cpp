@@ -0,0 +1,319 @@
+//
+// Maqam - Mobile App Quick Audio & MIDI
+//
+// SPDX-FileCopyrightText: 2024 TAQS.IM <contact@taqs.im>
+// SPDX-License-Identifier: MIT
+//
+
+#include <algorithm>
+#include <cmath>
+#include <initializer_list>
+#include <utility>
+#include <vector>
+
+#include "Sampler.hpp"
+
+#include "Test.h"
+
+using namespace maqam;
+
+namespace {
+
+constexpr double kSampleRate = 48000;
+constexpr int    kSampleLength = 4800;
+constexpr int    kChokeLength = 480; // 10 ms damping
+constexpr float  kNoteHz = 261.63f;
+
+// Every sample is filled with its region id, so a voice tells which region it plays
+struct Region
+{
+    int  id;
+    int  loKey = 0, hiKey = 127;
+    int  loVel = 0, hiVel = 127;
+    bool releaseTrigger = false;
+    int  seqLength = 1, seqPosition = 1;
+    int  xfinLoKey = 0, xfinHiKey = 0;
+    int  xfoutLoKey = 127, xfoutHiKey = 127;
+    int  xfinLoVel = 0, xfinHiVel = 0;
+    int  xfoutLoVel = 127, xfoutHiVel = 127;
+    int  group = 0, offBy = 0;
+};
+
+struct Voice
+{
+    int   region;
+    int   note;
+    float volume;
+    bool  releasing;
+};
+
+class TestSampler : public AudioKitCore::Sampler
+{
+public:
+    explicit TestSampler(const std::vector<Region>& regions)
+    {
+        init(kSampleRate);
+        deinit(); // drops the built-in waveform
+
+        std::vector<float> data(kSampleLength);
+
+        for (const Region& region : regions) {
+            std::fill(data.begin(), data.end(), static_cast<float>(region.id));
+
+            // Attack regions loop so they sound until released, release regions play once
+            AKSampleDataDescriptor sdd {};
+            sdd.sd.noteNumber = 60;
+            sdd.sd.noteHz = kNoteHz;
+            sdd.sd.min_note = region.loKey;
+            sdd.sd.max_note = region.hiKey;
+            sdd.sd.min_vel = region.loVel;
+            sdd.sd.max_vel = region.hiVel;
+            sdd.sd.bLoop = true;
+            sdd.sd.fLoopEnd = 1.f;
+            sdd.sd.bReleaseTrigger = region.releaseTrigger;
+            sdd.sd.seqLength = region.seqLength;
+            sdd.sd.seqPosition = region.seqPosition;
+            sdd.sd.xfinLoKey = region.xfinLoKey;
+            sdd.sd.xfinHiKey = region.xfinHiKey;
+            sdd.sd.xfoutLoKey = region.xfoutLoKey;
+            sdd.sd.xfoutHiKey = region.xfoutHiKey;
+            sdd.sd.xfinLoVel = region.xfinLoVel;
+            sdd.sd.xfinHiVel = region.xfinHiVel;
+            sdd.sd.xfoutLoVel = region.xfoutLoVel;
+            sdd.sd.xfoutHiVel = region.xfoutHiVel;
+            sdd.sd.group = region.group;
+            sdd.sd.offBy = region.offBy;
+            sdd.sampleRateHz = static_cast<float>(kSampleRate);
+            sdd.nChannels = 1;
+            sdd.nSamples = kSampleLength;
+            sdd.pData = data.data();
+            loadSampleData(sdd);
+        }
+
+        buildKeyMap();
+    }
+
+    ~TestSampler() { deinit(); }
+
+    void play(unsigned note, unsigned velocity) { playNote(note, velocity, kNoteHz); }
+    void release(unsigned note) { stopNote(note, /*immediate*/false); }
+
+    // Voices in use, in voice order
+    std::vector<Voice> getVoices()
+    {
+        std::vector<Voice> voices;
+
+        for (AudioKitCore::SamplerVoice& v : voice) {
+            if (v.noteNumber >= 0) {
+                voices.push_back({ static_cast<int>(v.pSampleBuffer->pSamples[0]), v.noteNumber,
+                                   v.noteVol, v.isReleasing() });
+            }
+        }
+
+        return voices;
+    }
+
+    // Regions of the voices that are not releasing, sorted
+    std::vector<int> getHeldRegions()
+    {
+        std::vector<int> regions;
+
+        for (const Voice& v : getVoices()) {
+            if (! v.releasing) {
+                regions.push_back(v.region);
+            }
+        }
+
+        std::sort(regions.begin(), regions.end());
+        return regions;
+    }
+
+    void render(int numSamples)
+    {
+        float left[CHUNKSIZE];
+        float right[CHUNKSIZE];
+        float* out[] = { left, right };
+
+        for (int i = 0; i < numSamples; i += CHUNKSIZE) {
+            Render(2, CHUNKSIZE, out);
+        }
+    }
+};
+
+std::vector<int> regions(std::initializer_list<int> ids)
+{
+    return ids;
+}
+
+// Velocity crossfade gain of the voice playing a region, the velocity volume divided out
+float getGain(TestSampler& sampler, int region, unsigned velocity)
+{
+    for (const Voice& v : sampler.getVoices()) {
+        if ((v.region == region) && ! v.releasing) {
+            return v.volume * 127.f / static_cast<float>(velocity);
+        }
+    }
+
+    return 0;
+}
+
+bool isNear(float value, float expected)
+{
+    return std::abs(value - expected) < 1e-4f;
+}
+
+// Release regions sound on note-off, once per note-on, and wait for the pedal to come up
+void testReleaseTrigger()
+{
+    const std::vector<Region> layers = { { .id = 1 }, { .id = 2, .releaseTrigger = true } };
+
+    TestSampler sampler(layers);
+    sampler.play(60, 100);
+    CHECK(sampler.getHeldRegions() == regions({ 1 }));
+
+    // With the note-on velocity
+    sampler.release(60);
+    CHECK(sampler.getHeldRegions() == regions({ 2 }));
+    CHECK(isNear(getGain(sampler, 2, 100), 1.f));
+
+    const size_t numVoices = sampler.getVoices().size();
+    sampler.release(60);
+    CHECK(sampler.getVoices().size() == numVoices);
+
+    // Played once to its end, nothing is left once the attack region has faded
+    sampler.render(kSampleLength + CHUNKSIZE);
+    CHECK(sampler.getHeldRegions().empty());
+
+    sampler.sustainPedal(true);
+    sampler.play(62, 90);
+    sampler.release(62);
+    CHECK(sampler.getHeldRegions() == regions({ 1 }));
+
+    sampler.sustainPedal(false);
+    CHECK(sampler.getHeldRegions() == regions({ 2 }));
+
+    // A key still down when the pedal comes up releases on its own note-off
+    sampler.sustainPedal(true);
+    sampler.play(64, 90);
+    sampler.sustainPedal(false);
+    CHECK(sampler.getHeldRegions() == regions({ 1 }));
+
+    sampler.release(64);
+    CHECK(sampler.getHeldRegions() == regions({ 2 }));
+
+    // Stopped at once, as for all notes off, the release regions do not sound
+    TestSampler stopped(layers);
+    stopped.play(60, 100);
+    stopped.stopNote(60, /*immediate*/true);
+    stopped.release(60);
+    CHECK(stopped.getVoices().empty());
+}
+
+// Regions of a sequence take turns, in order of their position
+void testRoundRobin()
+{
+    TestSampler sampler({
+        { .id = 1, .seqLength = 3, .seqPosition = 1 },
+        { .id = 2, .seqLength = 3, .seqPosition = 2 },
+        { .id = 3, .seqLength = 3, .seqPosition = 3 },
+        { .id = 4 } // not in the sequence, always plays
+    });
+
+    for (const int id : { 1, 2, 3, 1, 2 }) {
+        sampler.play(60, 100);
+        CHECK(sampler.getHeldRegions() == regions({ id, 4 }));
+        sampler.stopNote(60, /*immediate*/true);
+    }
+
+    // Only note-ons that reach a region move its sequence on
+    TestSampler layered({
+        { .id = 1, .hiVel = 63, .seqLength = 2, .seqPosition = 1 },
+        { .id = 2, .hiVel = 63, .seqLength = 2, .seqPosition = 2 },
+        { .id = 3, .loVel = 64 }
+    });
+
+    for (const auto& [velocity, id] : { std::pair(10, 1), std::pair(100, 3), std::pair(10, 2) }) {
+        layered.play(60, static_cast<unsigned>(velocity));
+        CHECK(layered.getHeldRegions() == regions({ id }));
+        layered.stopNote(60, /*immediate*/true);
+    }
+}
+
+// Equal-power fades over the xfin and xfout ranges, a region faded out takes no voice
+void testCrossfades()
+{
+    const std::vector<Region> velocityLayers = {
+        { .id = 1, .xfoutLoVel = 40, .xfoutHiVel = 80 },
+        { .id = 2, .xfinLoVel = 40, .xfinHiVel = 80 }
+    };
+
+    struct Expected { unsigned velocity; float gain1, gain2; };
+
+    const Expected expected[] = {
+        { 20, 1.f, 0 },
+        { 40, 1.f, 0 },
+        { 60, std::sqrt(0.5f), std::sqrt(0.5f) },
+        { 70, std::sqrt(0.25f), std::sqrt(0.75f) },
+        { 80, 0, 1.f },
+        { 127, 0, 1.f }
+    };
+
+    for (const Expected& e : expected) {
+        TestSampler sampler(velocityLayers);
+        sampler.play(60, e.velocity);
+        CHECK(sampler.getVoices().size() == size_t((e.gain1 > 0) + (e.gain2 > 0)));
+        CHECK(isNear(getGain(sampler, 1, e.velocity), e.gain1));
+        CHECK(isNear(getGain(sampler, 2, e.velocity), e.gain2));
+    }
+
+    // Across the keyboard the same way, times the velocity fades
+    TestSampler keys({
+        { .id = 1, .xfoutLoKey = 60, .xfoutHiKey = 72 },
+        { .id = 2, .xfinLoKey = 60, .xfinHiKey = 72, .xfinLoVel = 0, .xfinHiVel = 100 }
+    });
+
+    keys.play(66, 50);
+    CHECK(isNear(getGain(keys, 1, 50), std::sqrt(0.5f)));
+    CHECK(isNear(getGain(keys, 2, 50), std::sqrt(0.5f) * std::sqrt(0.5f)));
+}
+
+// A region chokes the voices whose off_by is its group, held or not, and nothing else
+void testChokeGroups()
+{
+    TestSampler sampler({
+        { .id = 1, .hiKey = 59, .group = 1, .offBy = 2 },  // open hi-hat
+        { .id = 2, .loKey = 60, .hiKey = 60, .group = 2 }, // closed hi-hat
+        { .id = 3, .loKey = 61 }                           // no group
+    });
+
+    sampler.play(42, 100);
+    sampler.play(64, 100);
+    CHECK(sampler.getHeldRegions() == regions({ 1, 3 }));
+
+    sampler.play(60, 100);
+    CHECK(sampler.getHeldRegions() == regions({ 2, 3 }));
+
+    // Fades out fast, its key is still down
+    sampler.render(kChokeLength + CHUNKSIZE);
+    const std::vector<Voice> voices = sampler.getVoices();
+    CHECK(std::none_of(voices.begin(), voices.end(), [](const Voice& v) {
+        return v.region == 1;
+    }));
+
+    // Not by its own group, two open hi-hats sound together
+    sampler.play(42, 100);
+    sampler.play(43, 100);
+    CHECK(sampler.getHeldRegions() == regions({ 1, 1, 2, 3 }));
+}
+
+} // namespace
+
+int main()
+{
+    testReleaseTrigger();
+    testRoundRobin();
+    testCrossfades();
+    testChokeGroups();
+
+    return test::finish();
+}
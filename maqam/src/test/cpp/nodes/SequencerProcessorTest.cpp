@@ -0,0 +1,357 @@
+//
+// Maqam - Mobile App Quick Audio & MIDI
+//
+// SPDX-FileCopyrightText: 2024 TAQS.IM <contact@taqs.im>
+// SPDX-License-Identifier: MIT
+//
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <stdexcept>
+#include <vector>
+
+#include "nodes/sequencer/SequencerProcessor.h"
+
+#include "Test.h"
+
+using namespace maqam;
+
+namespace {
+
+constexpr double kSampleRate = 48000;
+constexpr int    kSamplesPerStep = 6000; // 16th notes at the default 120 BPM
+
+// Around the step length and not dividing it, so steps start inside blocks
+constexpr int kBlockSizes[] = { 1, 64, 512, 1000, 4096 };
+
+// Renders end between steps, a step on the last sample could go either way with rounding
+constexpr int kQuarterStep = kSamplesPerStep / 4;
+
+enum class Kind { NoteOn, NoteOff, Controller };
+
+struct Event
+{
+    int64_t time;    // samples since the start of the render
+    Kind    kind;
+    int     channel; // 1-based
+    int     number;  // note or controller
+};
+
+struct PatternNote
+{
+    int   step;
+    int   note;
+    float gate;
+};
+
+void setPattern(SequencerProcessor& sequencer, int numSteps, int stepsPerBeat, float swing,
+                int channel, bool arpeggiate, const std::vector<PatternNote>& pattern)
+{
+    std::vector<int> steps, notes;
+    std::vector<float> velocities, gates;
+
+    for (const PatternNote& note : pattern) {
+        steps.push_back(note.step);
+        notes.push_back(note.note);
+        velocities.push_back(0.8f);
+        gates.push_back(note.gate);
+    }
+
+    sequencer.setPattern(numSteps, stepsPerBeat, swing, channel, arpeggiate, steps.data(),
+                         notes.data(), velocities.data(), gates.data(),
+                         static_cast<int>(pattern.size()));
+}
+
+void setTempo(SequencerProcessor& sequencer, float bpm)
+{
+    for (juce::AudioProcessorParameter* parameter : sequencer.getParameters()) {
+        auto* ranged = dynamic_cast<juce::RangedAudioParameter*>(parameter);
+
+        if ((ranged != nullptr)
+                && (ranged->getParameterID() == SequencerProcessor::kParameterTempo)) {
+            ranged->setValueNotifyingHost(ranged->convertTo0to1(bpm));
+        }
+    }
+}
+
+void prepare(SequencerProcessor& sequencer, int blockSize)
+{
+    sequencer.setRateAndBufferSizeDetails(kSampleRate, blockSize);
+    sequencer.prepareToPlay(kSampleRate, blockSize);
+}
+
+// Input messages go in the first block, at its start
+std::vector<Event> render(SequencerProcessor& sequencer, int numSamples, int blockSize,
+                          const std::vector<juce::MidiMessage>& input = {})
+{
+    juce::AudioBuffer<float> buffer(1, blockSize);
+    juce::MidiBuffer midi;
+    std::vector<Event> events;
+
+    for (const juce::MidiMessage& message : input) {
+        midi.addEvent(message, 0);
+    }
+
+    for (int start = 0; start < numSamples; start += blockSize) {
+        buffer.setSize(1, std::min(blockSize, numSamples - start));
+        sequencer.processBlock(buffer, midi);
+
+        for (const juce::MidiMessageMetadata metadata : midi) {
+            const juce::MidiMessage message = metadata.getMessage();
+            const int64_t time = start + metadata.samplePosition;
+
+            if (message.isNoteOn()) {
+                events.push_back({ time, Kind::NoteOn, message.getChannel(),
+                                   message.getNoteNumber() });
+            } else if (message.isNoteOff()) {
+                events.push_back({ time, Kind::NoteOff, message.getChannel(),
+                                   message.getNoteNumber() });
+            } else if (message.isController()) {
+                events.push_back({ time, Kind::Controller, message.getChannel(),
+                                   message.getControllerNumber() });
+            }
+        }
+
+        midi.clear();
+    }
+
+    return events;
+}
+
+// Sample offsets come from the step position in floating point, one sample apart is in time
+bool matches(const std::vector<Event>& actual, const std::vector<Event>& expected)
+{
+    bool same = actual.size() == expected.size();
+
+    for (size_t i = 0; same && (i < actual.size()); ++i) {
+        same = (std::abs(actual[i].time - expected[i].time) <= 1)
+            && (actual[i].kind == expected[i].kind)
+            && (actual[i].channel == expected[i].channel)
+            && (actual[i].number == expected[i].number);
+    }
+
+    if (! same) {
+        for (const Event& event : actual) {
+            std::fprintf(stderr, "  %lld %d ch%d #%d\n", static_cast<long long>(event.time),
+                         static_cast<int>(event.kind), event.channel, event.number);
+        }
+    }
+
+    return same;
+}
+
+bool throwsInvalidArgument(SequencerProcessor& sequencer, int numSteps, int stepsPerBeat,
+                           float swing, const std::vector<PatternNote>& pattern)
+{
+    try {
+        setPattern(sequencer, numSteps, stepsPerBeat, swing, 0, false, pattern);
+    } catch (const std::invalid_argument&) {
+        return true;
+    }
+
+    return false;
+}
+
+// Steps land on their sample whatever the block size, gates end notes across the loop point
+void testStepTiming()
+{
+    const std::vector<Event> expected = {
+        { 0, Kind::NoteOn, 1, 60 },
+        { 3000, Kind::NoteOff, 1, 60 },
+        { 6000, Kind::NoteOn, 1, 62 },
+        { 12000, Kind::NoteOff, 1, 62 },
+        { 18000, Kind::NoteOn, 1, 64 },
+        { 24000, Kind::NoteOn, 1, 60 },
+        { 25500, Kind::NoteOff, 1, 64 },
+        { 27000, Kind::NoteOff, 1, 60 },
+        { 30000, Kind::NoteOn, 1, 62 },
+        { 36000, Kind::NoteOff, 1, 62 },
+        { 42000, Kind::NoteOn, 1, 64 }
+    };
+
+    for (const int blockSize : kBlockSizes) {
+        SequencerProcessor sequencer;
+        prepare(sequencer, blockSize);
+        setPattern(sequencer, 4, 4, 0, 0, false, {
+            { 0, 60, 0.5f },
+            { 1, 62, 1.f },
+            { 3, 64, 1.25f }
+        });
+
+        // Nothing before start()
+        CHECK(render(sequencer, kSamplesPerStep, blockSize).empty());
+        CHECK(sequencer.getPosition() == 0);
+
+        sequencer.start();
+        CHECK(matches(render(sequencer, 8 * kSamplesPerStep - kQuarterStep, blockSize),
+                      expected));
+
+        // Stopping ends what is still sounding, at the start of the next block
+        sequencer.stop();
+        CHECK(matches(render(sequencer, kSamplesPerStep, blockSize),
+                      { { 0, Kind::NoteOff, 1, 64 } }));
+
+        // From a new position, at its step
+        sequencer.setPosition(3);
+        sequencer.start();
+        CHECK(matches(render(sequencer, 3 * kQuarterStep, blockSize),
+                      { { 0, Kind::NoteOn, 1, 64 } }));
+        CHECK(std::abs(sequencer.getPosition() - 3.75) < 1e-6);
+    }
+
+    // Eighth notes at 90 BPM, 16000 samples each
+    SequencerProcessor sequencer;
+    prepare(sequencer, 512);
+    setTempo(sequencer, 90);
+    setPattern(sequencer, 2, 2, 0, 9, false, { { 0, 36, 0.25f }, { 1, 38, 0.25f } });
+    sequencer.start();
+
+    CHECK(matches(render(sequencer, 40000, 512), {
+        { 0, Kind::NoteOn, 10, 36 },
+        { 4000, Kind::NoteOff, 10, 36 },
+        { 16000, Kind::NoteOn, 10, 38 },
+        { 20000, Kind::NoteOff, 10, 38 },
+        { 32000, Kind::NoteOn, 10, 36 },
+        { 36000, Kind::NoteOff, 10, 36 }
+    }));
+
+    CHECK(throwsInvalidArgument(sequencer, SequencerProcessor::kMaxSteps + 1, 4, 0, {}));
+    CHECK(throwsInvalidArgument(sequencer, 4, 0, 0, {}));
+    CHECK(throwsInvalidArgument(sequencer, 4, 4, 0, { { 4, 60, 0.5f } }));
+    CHECK(throwsInvalidArgument(sequencer, 4, 4, 0, { { 0, 60, 0 } }));
+}
+
+// Odd steps start late by the swing, also when the position starts between a step and its swing
+void testSwing()
+{
+    const std::vector<Event> expected = {
+        { 0, Kind::NoteOn, 1, 60 },
+        { 1500, Kind::NoteOff, 1, 60 },
+        { 9000, Kind::NoteOn, 1, 61 },
+        { 10500, Kind::NoteOff, 1, 61 },
+        { 12000, Kind::NoteOn, 1, 62 },
+        { 13500, Kind::NoteOff, 1, 62 },
+        { 21000, Kind::NoteOn, 1, 63 },
+        { 22500, Kind::NoteOff, 1, 63 }
+    };
+
+    const std::vector<PatternNote> pattern = {
+        { 0, 60, 0.25f },
+        { 1, 61, 0.25f },
+        { 2, 62, 0.25f },
+        { 3, 63, 0.25f }
+    };
+
+    for (const int blockSize : kBlockSizes) {
+        SequencerProcessor sequencer;
+        prepare(sequencer, blockSize);
+        setPattern(sequencer, 4, 4, 0.5f, 0, false, pattern);
+        sequencer.start();
+        CHECK(matches(render(sequencer, 4 * kSamplesPerStep - kQuarterStep / 2, blockSize),
+                      expected));
+
+        sequencer.setPosition(1.25);
+        CHECK(matches(render(sequencer, 4000, blockSize), {
+            { 1500, Kind::NoteOn, 1, 61 },
+            { 3000, Kind::NoteOff, 1, 61 }
+        }));
+    }
+
+    // The gate counts from the swung start
+    SequencerProcessor sequencer;
+    prepare(sequencer, 512);
+    setPattern(sequencer, 2, 4, SequencerProcessor::kMaxSwing, 0, false, { { 1, 61, 0.5f } });
+    sequencer.start();
+
+    CHECK(matches(render(sequencer, 2 * kSamplesPerStep, 512), {
+        { 10500, Kind::NoteOn, 1, 61 }
+    }));
+    CHECK(matches(render(sequencer, kSamplesPerStep, 512), {
+        { 1500, Kind::NoteOff, 1, 61 }
+    }));
+
+    CHECK(throwsInvalidArgument(sequencer, 4, 4, SequencerProcessor::kMaxSwing + 0.01f, {}));
+}
+
+// Pattern notes index the held notes from the lowest, then the octaves above
+void testArpeggiator()
+{
+    const std::vector<PatternNote> pattern = {
+        { 0, 0, 0.5f },
+        { 1, 1, 0.5f },
+        { 2, 2, 0.5f },
+        { 3, 3, 0.5f }
+    };
+
+    for (const int blockSize : kBlockSizes) {
+        SequencerProcessor sequencer;
+        prepare(sequencer, blockSize);
+        setPattern(sequencer, 4, 4, 0, 2, true, pattern);
+        sequencer.start();
+
+        // Held notes are taken, other messages pass through
+        CHECK(matches(render(sequencer, 4 * kSamplesPerStep - kQuarterStep, blockSize, {
+            juce::MidiMessage::noteOn(1, 64, 0.8f),
+            juce::MidiMessage::noteOn(1, 60, 0.8f),
+            juce::MidiMessage::noteOn(1, 67, 0.8f),
+            juce::MidiMessage::controllerEvent(1, 1, 100)
+        }), {
+            { 0, Kind::Controller, 1, 1 },
+            { 0, Kind::NoteOn, 3, 60 },
+            { 3000, Kind::NoteOff, 3, 60 },
+            { 6000, Kind::NoteOn, 3, 64 },
+            { 9000, Kind::NoteOff, 3, 64 },
+            { 12000, Kind::NoteOn, 3, 67 },
+            { 15000, Kind::NoteOff, 3, 67 },
+            { 18000, Kind::NoteOn, 3, 72 },
+            { 21000, Kind::NoteOff, 3, 72 }
+        }));
+
+        CHECK(matches(render(sequencer, 4 * kSamplesPerStep, blockSize, {
+            juce::MidiMessage::noteOff(1, 64)
+        }), {
+            { 1500, Kind::NoteOn, 3, 60 },
+            { 4500, Kind::NoteOff, 3, 60 },
+            { 7500, Kind::NoteOn, 3, 67 },
+            { 10500, Kind::NoteOff, 3, 67 },
+            { 13500, Kind::NoteOn, 3, 72 },
+            { 16500, Kind::NoteOff, 3, 72 },
+            { 19500, Kind::NoteOn, 3, 79 },
+            { 22500, Kind::NoteOff, 3, 79 }
+        }));
+
+        // Silent with no notes held
+        CHECK(render(sequencer, 4 * kSamplesPerStep, blockSize, {
+            juce::MidiMessage::noteOff(1, 60),
+            juce::MidiMessage::noteOff(1, 67)
+        }).empty());
+    }
+
+    // Notes pass through when not arpeggiating
+    SequencerProcessor sequencer;
+    prepare(sequencer, 512);
+    setPattern(sequencer, 4, 4, 0, 2, false, {});
+    sequencer.start();
+
+    CHECK(matches(render(sequencer, 512, 512, {
+        juce::MidiMessage::noteOn(1, 64, 0.8f),
+        juce::MidiMessage::noteOff(1, 64)
+    }), {
+        { 0, Kind::NoteOn, 1, 64 },
+        { 0, Kind::NoteOff, 1, 64 }
+    }));
+}
+
+} // namespace
+
+int main()
+{
+    testStepTiming();
+    testSwing();
+    testArpeggiator();
+
+    return test::finish();
+}
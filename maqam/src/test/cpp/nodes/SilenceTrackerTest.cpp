@@ -0,0 +1,141 @@
+//
+// Maqam - Mobile App Quick Audio & MIDI
+//
+// SPDX-FileCopyrightText: 2024 TAQS.IM <contact@taqs.im>
+// SPDX-License-Identifier: MIT
+//
+
+#include <cmath>
+#include <limits>
+
+#include "nodes/SilenceTracker.h"
+
+#include "Test.h"
+
+using namespace maqam;
+
+namespace {
+
+constexpr double kSampleRate = 48000;
+constexpr int    kBlockSize = 480;
+constexpr double kTailSeconds = 0.1; // 10 blocks
+
+void fill(juce::AudioBuffer<float>& buffer, float level)
+{
+    for (int ch = 0; ch < buffer.getNumChannels(); ++ch) {
+        for (int i = 0; i < buffer.getNumSamples(); ++i) {
+            buffer.setSample(ch, i, (i % 2 == 0) ? level : -level);
+        }
+    }
+}
+
+// Blocks of silent input it takes until the tracker lets the node skip its DSP, -1 if never
+int countBlocksUntilSkip(SilenceTracker& tracker, double tailSeconds, float outputLevel,
+                         int maxBlocks)
+{
+    juce::AudioBuffer<float> buffer(2, kBlockSize);
+
+    for (int block = 0; block < maxBlocks; ++block) {
+        fill(buffer, 0);
+
+        if (tracker.skipBlock(buffer, tailSeconds)) {
+            return block;
+        }
+
+        // Stands in for the DSP, its output stays at the given level
+        fill(buffer, outputLevel);
+        tracker.trackOutput(buffer);
+    }
+
+    return -1;
+}
+
+void testFeedbackTail()
+{
+    CHECK(SilenceTracker::getFeedbackTailSeconds(0.25, 0) == 0.25);
+    CHECK(std::isinf(SilenceTracker::getFeedbackTailSeconds(0.25, 1.0)));
+
+    // One pass plus the passes it takes 0.5^n to fall below -90 dB
+    const double expected = 0.1 * (1.0 + std::log(SilenceTracker::kThreshold) / std::log(0.5));
+    CHECK(std::abs(SilenceTracker::getFeedbackTailSeconds(0.1, 0.5) - expected) < 1e-9);
+    CHECK(std::pow(0.5, expected / 0.1 - 1.0) <= SilenceTracker::kThreshold * 1.0001);
+}
+
+// Silent input is processed for the tail length, then skipped
+void testSkipsAfterTail()
+{
+    SilenceTracker tracker;
+    tracker.prepare(kSampleRate);
+
+    const int numBlocks = countBlocksUntilSkip(tracker, kTailSeconds, 0, 100);
+    CHECK(numBlocks == static_cast<int>(kTailSeconds * kSampleRate / kBlockSize) - 1);
+    CHECK(tracker.isIdle());
+}
+
+// The tail length is a lower bound, output still above the threshold keeps the DSP running
+void testWaitsForOutputDecay()
+{
+    SilenceTracker tracker;
+    tracker.prepare(kSampleRate);
+
+    CHECK(countBlocksUntilSkip(tracker, kTailSeconds, 1e-3f, 100) == -1);
+    CHECK(! tracker.isIdle());
+
+    // Decayed below the threshold, skipped on the next block
+    CHECK(countBlocksUntilSkip(tracker, kTailSeconds, 1e-6f, 100) == 1);
+}
+
+void testInfiniteTail()
+{
+    SilenceTracker tracker;
+    tracker.prepare(kSampleRate);
+
+    CHECK(countBlocksUntilSkip(tracker, std::numeric_limits<double>::infinity(), 0, 1000) == -1);
+}
+
+// Input above the threshold wakes the node right away and restarts the tail count, input below
+// it is cleared while idle
+void testWakesOnInput()
+{
+    SilenceTracker tracker;
+    tracker.prepare(kSampleRate);
+    CHECK(countBlocksUntilSkip(tracker, kTailSeconds, 0, 100) >= 0);
+
+    juce::AudioBuffer<float> buffer(2, kBlockSize);
+    fill(buffer, 1e-6f);
+    CHECK(tracker.skipBlock(buffer, kTailSeconds));
+    CHECK(buffer.getMagnitude(0, kBlockSize) == 0);
+
+    fill(buffer, 0.5f);
+    CHECK(! tracker.skipBlock(buffer, kTailSeconds));
+    CHECK(! tracker.isIdle());
+    CHECK(buffer.getMagnitude(0, kBlockSize) == 0.5f);
+    tracker.trackOutput(buffer);
+
+    CHECK(countBlocksUntilSkip(tracker, kTailSeconds, 0, 100) > 0);
+}
+
+// A new prepare starts from the active state
+void testReset()
+{
+    SilenceTracker tracker;
+    tracker.prepare(kSampleRate);
+    CHECK(countBlocksUntilSkip(tracker, kTailSeconds, 0, 100) >= 0);
+
+    tracker.prepare(kSampleRate);
+    CHECK(! tracker.isIdle());
+}
+
+} // namespace
+
+int main()
+{
+    testFeedbackTail();
+    testSkipsAfterTail();
+    testWaitsForOutputDecay();
+    testInfiniteTail();
+    testWakesOnInput();
+    testReset();
+
+    return test::finish();
+}
@@ -0,0 +1,238 @@
+//
+// Maqam - Mobile App Quick Audio & MIDI
+//
+// SPDX-FileCopyrightText: 2024 TAQS.IM <contact@taqs.im>
+// SPDX-License-Identifier: MIT
+//
+
+#include <array>
+#include <cmath>
+#include <functional>
+#include <stdexcept>
+#include <vector>
+
+#include "nodes/ak_sampler/TuningTable.h"
+
+#include "Test.h"
+
+using namespace maqam;
+
+namespace {
+
+constexpr double kCentsTolerance = 0.01;
+
+bool throwsRuntimeError(const std::function<void()>& function)
+{
+    try {
+        function();
+    } catch (const std::runtime_error&) {
+        return true;
+    }
+
+    return false;
+}
+
+bool isNear(double value, double expected, double tolerance = 1e-6)
+{
+    return std::abs(value - expected) <= tolerance;
+}
+
+// Interval between two frequencies
+double getCents(float frequency, float reference)
+{
+    return 1200.0 * std::log2(static_cast<double>(frequency) / reference);
+}
+
+TuningTable::Scale getEqualTemperament(int numDegrees)
+{
+    TuningTable::Scale scale;
+
+    for (int degree = 1; degree <= numDegrees; ++degree) {
+        scale.cents.push_back(1200.0 * degree / numDegrees);
+    }
+
+    return scale;
+}
+
+void testParseScale()
+{
+    // Rast with a neutral third and seventh, ratios and cents mixed like in published files
+    const TuningTable::Scale scale = TuningTable::parseScale(
+            "! rast.scl\n"
+            "!\n"
+            "Rast\n"
+            " 7\n"
+            "!\n"
+            "9/8\n"
+            "350.0 neutral third\n"
+            "4/3\n"
+            "3/2\n"
+            "27/16\n"
+            "1050.\n"
+            "2\n");
+
+    CHECK(scale.cents.size() == 7);
+    CHECK(isNear(scale.cents[0], 1200.0 * std::log2(9.0 / 8.0)));
+    CHECK(isNear(scale.cents[1], 350.0));
+    CHECK(isNear(scale.cents[2], 1200.0 * std::log2(4.0 / 3.0)));
+    CHECK(isNear(scale.cents[5], 1050.0));
+    CHECK(isNear(scale.cents[6], 1200.0));
+
+    // Empty description, pitches past the declared size are ignored
+    const TuningTable::Scale octave = TuningTable::parseScale("\n1\n1200.0\n600.0\n");
+    CHECK((octave.cents.size() == 1) && isNear(octave.cents[0], 1200.0));
+}
+
+void testParseScaleErrors()
+{
+    CHECK(throwsRuntimeError([]() { TuningTable::parseScale("! only a comment\n"); }));
+    CHECK(throwsRuntimeError([]() { TuningTable::parseScale("Too few\n3\n100.0\n200.0\n"); }));
+    CHECK(throwsRuntimeError([]() { TuningTable::parseScale("Empty\n0\n"); }));
+    CHECK(throwsRuntimeError([]() { TuningTable::parseScale("Size\nseven\n1200.0\n"); }));
+    CHECK(throwsRuntimeError([]() { TuningTable::parseScale("Pitch\n1\nfifth\n"); }));
+    CHECK(throwsRuntimeError([]() { TuningTable::parseScale("Ratio\n1\n0/2\n"); }));
+    CHECK(throwsRuntimeError([]() { TuningTable::parseScale("Period\n2\n100.0\n-1200.0\n"); }));
+}
+
+void testParseKeyboardMapping()
+{
+    const TuningTable::KeyboardMapping mapping = TuningTable::parseKeyboardMapping(
+            "! 7 of 12 keys\n"
+            "12\n"
+            "0\n"
+            "127\n"
+            "60\n"
+            "69\n"
+            "440.0\n"
+            "7\n"
+            "! mapping\n"
+            "0\n"
+            "x\n"
+            "1\n"
+            "X\n"
+            "2\n"
+            "3\n"
+            "x\n"
+            "4\n"
+            "x\n"
+            "5\n"
+            "x\n");
+
+    CHECK(mapping.size == 12);
+    CHECK((mapping.firstNote == 0) && (mapping.lastNote == 127));
+    CHECK((mapping.middleNote == 60) && (mapping.referenceNote == 69));
+    CHECK(isNear(mapping.referenceFrequency, 440.0));
+    CHECK(mapping.octaveDegree == 7);
+
+    // The last entry is missing and unmapped like the ones marked x
+    CHECK(mapping.degrees == std::vector<int>({ 0, -1, 1, -1, 2, 3, -1, 4, -1, 5, -1, -1 }));
+}
+
+void testParseKeyboardMappingErrors()
+{
+    CHECK(throwsRuntimeError([]() {
+        TuningTable::parseKeyboardMapping("0\n0\n127\n60\n69\n");
+    }));
+    CHECK(throwsRuntimeError([]() {
+        TuningTable::parseKeyboardMapping("0\n0\n128\n60\n69\n440.0\n0\n");
+    }));
+    CHECK(throwsRuntimeError([]() {
+        TuningTable::parseKeyboardMapping("0\n0\n127\n60\n69\n0\n0\n");
+    }));
+    CHECK(throwsRuntimeError([]() {
+        TuningTable::parseKeyboardMapping("1\n0\n127\n60\n69\n440.0\n0\nnone\n");
+    }));
+}
+
+// 12 degrees with the default mapping is 12-TET from A4
+void testComputeEqualTemperament()
+{
+    const TuningTable::Frequencies frequencies = TuningTable::computeFrequencies(
+            getEqualTemperament(12), TuningTable::createDefaultKeyboardMapping(440.f));
+
+    CHECK(isNear(frequencies[69], 440.0, 1e-3));
+    CHECK(isNear(frequencies[60], 261.6256, 1e-3));
+    CHECK(isNear(frequencies[81], 880.0, 1e-3));
+
+    for (int note = 1; note < TuningTable::kNumNotes; ++note) {
+        CHECK(isNear(getCents(frequencies[note], frequencies[note - 1]), 100.0, kCentsTolerance));
+    }
+}
+
+// Every key is a quarter tone with 24 degrees, middle C stays in place
+void testComputeQuarterTones()
+{
+    const TuningTable::Frequencies frequencies = TuningTable::computeFrequencies(
+            getEqualTemperament(24), TuningTable::createDefaultKeyboardMapping(440.f));
+
+    CHECK(isNear(frequencies[60], 261.6256, 1e-3));
+    CHECK(isNear(getCents(frequencies[61], frequencies[60]), 50.0, kCentsTolerance));
+    CHECK(isNear(getCents(frequencies[84], frequencies[60]), 1200.0, kCentsTolerance));
+    CHECK(isNear(getCents(frequencies[36], frequencies[60]), -1200.0, kCentsTolerance));
+}
+
+// Keys map to scale degrees, unmapped keys and keys outside the range get 0 Hz
+void testComputeMapping()
+{
+    TuningTable::KeyboardMapping mapping {
+        .size = 3,
+        .firstNote = 48,
+        .lastNote = 72,
+        .middleNote = 60,
+        .referenceNote = 60,
+        .referenceFrequency = 200.0,
+        .octaveDegree = 2,
+        .degrees = { 0, -1, 1 }
+    };
+
+    TuningTable::Scale scale;
+    scale.cents = { 300.0, 700.0, 1200.0 };
+
+    const TuningTable::Frequencies frequencies = TuningTable::computeFrequencies(scale, mapping);
+
+    // One repeat of the mapping spans octaveDegree degrees, 700 cents here
+    CHECK(isNear(frequencies[60], 200.0, 1e-3));
+    CHECK(frequencies[61] == 0);
+    CHECK(isNear(getCents(frequencies[62], frequencies[60]), 300.0, kCentsTolerance));
+    CHECK(isNear(getCents(frequencies[63], frequencies[60]), 700.0, kCentsTolerance));
+    CHECK(isNear(getCents(frequencies[65], frequencies[60]), 1000.0, kCentsTolerance));
+    CHECK(isNear(getCents(frequencies[57], frequencies[60]), -700.0, kCentsTolerance));
+    CHECK(frequencies[58] == 0);
+    CHECK(frequencies[47] == 0);
+    CHECK(frequencies[73] == 0);
+
+    mapping.referenceNote = 61;
+    CHECK(throwsRuntimeError([&]() { TuningTable::computeFrequencies(scale, mapping); }));
+}
+
+// Offsets from 12-TET per pitch class, like the sampler's per-note tuning parameters
+void testComputeCentsFromC()
+{
+    std::array<int,12> centsFromC {};
+    centsFromC[4] = -50; // E half flat
+    centsFromC[11] = -50; // B half flat
+
+    const TuningTable::Frequencies frequencies = TuningTable::computeFrequencies(442.f,
+                                                                                 centsFromC);
+
+    CHECK(isNear(frequencies[69], 442.0, 1e-3));
+    CHECK(isNear(getCents(frequencies[64], frequencies[60]), 350.0, kCentsTolerance));
+    CHECK(isNear(getCents(frequencies[71], frequencies[69]), 150.0, kCentsTolerance));
+    CHECK(isNear(getCents(frequencies[76], frequencies[64]), 1200.0, kCentsTolerance));
+}
+
+} // namespace
+
+int main()
+{
+    testParseScale();
+    testParseScaleErrors();
+    testParseKeyboardMapping();
+    testParseKeyboardMappingErrors();
+    testComputeEqualTemperament();
+    testComputeQuarterTones();
+    testComputeMapping();
+    testComputeCentsFromC();
+
+    return test::finish();
+}